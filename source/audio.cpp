@@ -17,6 +17,7 @@
 #include <asndlib.h>
 
 #include "video.h"
+#include "pacing.h"
 
 #include "snes9x/snes9x.h"
 #include "snes9x/memmap.h"
@@ -60,7 +61,7 @@ static void DMACallback () {
 }
 
 static void S9xAudioCallback (void *data) {
-	double rate = 1.0;
+	double rate = PacingAudioRate();
 
 	if(unplayed > 8) {
 		rate = 1.005;
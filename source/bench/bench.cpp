@@ -0,0 +1,814 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * bench.cpp
+ *
+ * Headless host benchmark runner. Loads a ROM through CMemory::LoadROMMem,
+ * emulates a fixed number of frames without pacing and reports throughput,
+ * time per subsystem and hashes of everything that was presented, so core
+ * changes can be benchmarked and regression-checked on the host.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "snes9x/memmap.h"
+#include "snes9x/gfx.h"
+#include "snes9x/gfxthread.h"
+#include "snes9x/tile.h"
+#include "snes9x/apu/apu.h"
+#include "snes9x/controls.h"
+#include "snes9x/ppu.h"
+#include "snes9x/snapshot.h"
+#include "snes9x/rewind.h"
+#include "snes9x/runahead.h"
+#include "snes9x/profile.h"
+#include "snes9x/cheats.h"
+#include "snes9x/sdd1emu.h"
+
+#define BENCH_SOUND_CHUNK	4096
+
+static uint16	*screen = NULL;
+static int16	soundbuffer[BENCH_SOUND_CHUNK * 2];
+
+static void Usage (const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [options] rom\n"
+		"  -frames N    emulate N frames (default 3600)\n"
+		"  -norender    skip rendering (CPU/APU only)\n"
+		"  -mute        do not generate sound\n"
+		"  -noblockcache  interpret every opcode through the fetch path\n"
+		"  -threaded    render on a separate thread\n"
+		"  -aputhread   run the SPC700 and S-DSP on a separate thread\n"
+		"  -tileconv N  tile converters: 0 table, 1 SWAR, 2 SSE2, 3 AVX2 (default best)\n"
+		"  -linemath    do colour math a line at a time after drawing the main screen\n"
+		"  -sinc        resample the sound output with the windowed sinc filter\n"
+		"  -rewind MB   capture rewind history into an MB sized arena\n"
+		"  -runahead K  present the frame K frames ahead (1-%d)\n"
+		"  -snapshots   time saving and loading the final state in every format\n"
+		"  -sa1quantum N  let the SA-1 catch up every N S-CPU instructions (default 1, lockstep)\n"
+		"  -sa1check    compare the RAM after every frame against a lockstep SA-1 run\n"
+		"  -dmacheck    check linear VRAM DMAs from odd sources and lengths, then exit\n"
+		"  -sdd1check   check that cheats on compressed data reach S-DD1 DMAs, then exit\n"
+		"  -replaycheck run every frame twice, the second time from a loaded snapshot, and compare the RAM\n"
+		"  -filter N    apply video filter N (1-%d) to every low resolution frame\n"
+		"  -filterthreads N  filter in N horizontal bands in parallel (1-%d)\n"
+#ifdef USE_PROFILER
+		"  -profile F   write the hot path counters of the last frames to F as CSV\n"
+#endif
+		"  -v           print core messages\n", name, RUNAHEAD_MAX_FRAMES, NUM_FILTERS - 1, FILTER_MAX_THREADS);
+	exit(1);
+}
+
+static void DefaultSettings (void)
+{
+	memset(&Settings, 0, sizeof(Settings));
+
+	// mirrors the console defaults from DefaultSettings() in preferences.cpp
+	Settings.DontSaveOopsSnapshot = true;
+	Settings.HDMATimingHack = 100;
+
+	Settings.SoundSync = false;
+	Settings.SixteenBitSound = true;
+	Settings.Stereo = true;
+	Settings.ReverseStereo = true;
+	Settings.SoundPlaybackRate = 48000;
+	Settings.SoundInputRate = 31920;
+	Settings.InterpolationMethod = DSP_INTERPOLATION_GAUSSIAN;
+
+	Settings.Transparency = true;
+	Settings.SupportHiRes = true;
+	Settings.FrameTimePAL = 20000;
+	Settings.FrameTimeNTSC = 16667;
+
+	Settings.BlockInvalidVRAMAccessMaster = true;
+	Settings.SuperFXSpeedPerLine = 5823405;
+	Settings.SuperFXClockMultiplier = 100;
+
+	Settings.CPUBlockCache = true;
+	Settings.SA1Quantum = 1;
+	Settings.OneClockCycle = 6;
+	Settings.OneSlowClockCycle = 8;
+	Settings.TwoClockCycles = 12;
+	Settings.MaxSpriteTilesPerLine = 34;
+}
+
+static uint8 * LoadFile (const char *filename, uint32 *size)
+{
+	FILE	*fp = fopen(filename, "rb");
+	if (!fp)
+		return NULL;
+
+	fseek(fp, 0, SEEK_END);
+	long	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	uint8	*data = NULL;
+	if (len > 0 && len <= CMemory::MAX_ROM_SIZE + 0x200)
+	{
+		data = (uint8 *) malloc(len);
+		if (data && fread(data, 1, len, fp) != (size_t) len)
+		{
+			free(data);
+			data = NULL;
+		}
+	}
+
+	fclose(fp);
+	*size = (uint32) len;
+	return data;
+}
+
+static void VerifyRewind (void)
+{
+	uint32	size = S9xFreezeSize();
+	uint8	*before = (uint8 *) malloc(size);
+	uint8	*after = (uint8 *) calloc(size, 1);
+
+	S9xFreezeGameMem(before, size);
+
+	if (!S9xRewindStep())
+		printf("rewind: restore FAILED\n");
+	else
+	{
+		S9xFreezeGameMem(after, size);
+		printf("rewind: restore %s\n", memcmp(before, after, size) ? "MISMATCH" : "ok");
+	}
+
+	free(before);
+	free(after);
+}
+
+#define BENCH_SNAPSHOT_ROUNDS	200
+#define BENCH_SNAPSHOT_FILE		"/tmp/snes9xfx-bench.s9b"
+
+static void ReportSnapshot (const char *kind, uint64 save, uint64 load, uint32 size)
+{
+	printf("state:  %-12s %7.1f us save, %7.1f us load (%u KB)\n", kind, (double) save / BENCH_SNAPSHOT_ROUNDS,
+		(double) load / BENCH_SNAPSHOT_ROUNDS, size >> 10);
+}
+
+// Average cost of saving and restoring the current state in every format.
+// Each format has to bring back exactly the state the stream format saw.
+static void MeasureSnapshots (void)
+{
+	uint32	fullSize = S9xFreezeSize();
+	uint32	binSize = S9xFreezeBinarySize();
+	uint32	fastSize = S9xFreezeFastSize();
+	uint8	*full = (uint8 *) malloc(fullSize);
+	uint8	*check = (uint8 *) malloc(fullSize);
+	uint8	*bin = (uint8 *) malloc(binSize);
+	uint8	*fast = (uint8 *) malloc(fastSize ? fastSize : 1);
+	uint64	t, save, load;
+	uint32	size = 0;
+
+	S9xFreezeGameMem(full, fullSize);
+
+	#define VERIFY(kind) \
+		memset(check, 0, fullSize); \
+		S9xFreezeGameMem(check, fullSize); \
+		if (memcmp(full, check, fullSize)) \
+			printf("state:  %s restore MISMATCH\n", kind);
+
+	#define ROUNDS(total, what) \
+		t = BenchTime(); \
+		for (int i = 0; i < BENCH_SNAPSHOT_ROUNDS; i++) \
+			what; \
+		total = BenchTime() - t;
+
+	if (fastSize)
+	{
+		ROUNDS(save, S9xFreezeGameFast(fast));
+		ROUNDS(load, S9xUnfreezeGameFast(fast));
+		ReportSnapshot("fast", save, load, fastSize);
+		VERIFY("fast");
+	}
+
+	ROUNDS(save, S9xFreezeGameMem(check, fullSize));
+	ROUNDS(load, S9xUnfreezeGameMem(full, fullSize));
+	ReportSnapshot("stream", save, load, fullSize);
+	VERIFY("stream");
+
+	ROUNDS(save, size = S9xFreezeGameBinaryMem(bin, binSize, FALSE));
+	ROUNDS(load, S9xUnfreezeGameBinaryMem(bin, size));
+	ReportSnapshot("binary", save, load, size);
+	VERIFY("binary");
+
+	ROUNDS(save, size = S9xFreezeGameBinaryMem(bin, binSize, TRUE));
+	ROUNDS(load, S9xUnfreezeGameBinaryMem(bin, size));
+	ReportSnapshot("deflated", save, load, size);
+	VERIFY("deflated");
+
+	ROUNDS(save, S9xFreezeGameBinary(BENCH_SNAPSHOT_FILE, FALSE));
+	ROUNDS(load, S9xUnfreezeGameBinary(BENCH_SNAPSHOT_FILE));
+	ReportSnapshot("binary file", save, load, binSize);
+	VERIFY("binary file");
+	remove(BENCH_SNAPSHOT_FILE);
+
+	#undef ROUNDS
+	#undef VERIFY
+
+	free(full);
+	free(check);
+	free(bin);
+	free(fast);
+}
+
+// Everything the S-CPU and the SA-1 can write to. Between slices the SA-1
+// lags behind, so it catches up first, as it would the next time the S-CPU
+// looked at its RAM.
+static uint64 RAMHash (void)
+{
+	uint64	h = BENCH_HASH_SEED;
+	uint32	sram = Memory.SRAMSize ? 1024 << Memory.SRAMSize : 0;
+
+	if (Settings.SA1)
+		S9xSA1CatchUp();
+
+	if (sram > 0x80000)
+		sram = 0x80000;
+
+	h = BenchHash(h, Memory.RAM, 0x20000);
+	h = BenchHash(h, Memory.VRAM, 0x10000);
+	h = BenchHash(h, Memory.SRAM, sram);
+	h = BenchHash(h, Memory.FillRAM + 0x3000, 0x800);
+
+	return h;
+}
+
+// Linear DMAs into VMDATAL from WRAM at odd addresses and with odd lengths,
+// so the transfer crosses memory map chunks with the next byte due for
+// either half of the VRAM word. Each has to leave the source in VRAM.
+static int CheckDMA (void)
+{
+	static const struct { uint16 source, length; } cases[] =
+	{
+		{ 0x0000, 0x2000 }, { 0x0001, 0x2000 }, { 0x0fff, 0x1003 }, { 0x1001, 0x1fff },
+		{ 0x0801, 0x1801 }, { 0x0003, 0x0005 }, { 0x1ffd, 0x0006 }
+	};
+	int		n = sizeof(cases) / sizeof(cases[0]);
+	int		failed = 0;
+
+	S9xSetPPU(0x80, 0x2100); // force blank, VRAM can be written any time
+
+	for (int c = 0; c < n; c++)
+	{
+		uint16	source = cases[c].source, length = cases[c].length;
+
+		for (int i = 0; i < 0x20000; i++)
+			Memory.RAM[i] = (uint8) (i * 7 + (i >> 8) + c);
+		memset(Memory.VRAM, 0, 0x10000);
+
+		S9xSetPPU(0x80, 0x2115); // increment by 1 after the high byte
+		S9xSetPPU(0x00, 0x2116);
+		S9xSetPPU(0x00, 0x2117);
+
+		S9xSetCPU(0x01, 0x4300); // two registers, A to B
+		S9xSetCPU(0x18, 0x4301);
+		S9xSetCPU(source & 0xff, 0x4302);
+		S9xSetCPU(source >> 8, 0x4303);
+		S9xSetCPU(0x7e, 0x4304);
+		S9xSetCPU(length & 0xff, 0x4305);
+		S9xSetCPU(length >> 8, 0x4306);
+		S9xSetCPU(0x01, 0x420b);
+
+		int	bad = -1;
+		for (int i = 0; i < 0x10000 && bad < 0; i++)
+		{
+			if (Memory.VRAM[i] != (i < length ? Memory.RAM[source + i] : 0))
+				bad = i;
+		}
+
+		if (bad >= 0)
+		{
+			printf("dmacheck: 7e:%04x + %04x DIFFERS from VRAM %04x on\n", source, length, bad);
+			failed++;
+		}
+	}
+
+	if (!failed)
+		printf("dmacheck: all %d transfers match\n", n);
+
+	return failed;
+}
+
+// Decompresses len bytes at c0:4000 through a fixed address S-DD1 DMA on
+// channel 0 into VRAM $0000, which is where the decoded block cache is used.
+static void SDD1DMA (uint16 length)
+{
+	S9xSetPPU(0x80, 0x2115);
+	S9xSetPPU(0x00, 0x2116);
+	S9xSetPPU(0x00, 0x2117);
+
+	S9xSetCPU(0x09, 0x4300); // fixed source, two registers, A to B
+	S9xSetCPU(0x18, 0x4301);
+	S9xSetCPU(0x00, 0x4302);
+	S9xSetCPU(0x40, 0x4303);
+	S9xSetCPU(0xc0, 0x4304);
+	S9xSetCPU(length & 0xff, 0x4305);
+	S9xSetCPU(length >> 8, 0x4306);
+	S9xSetCPU(0x01, 0x4800);
+	S9xSetCPU(0x01, 0x4801);
+	S9xSetCPU(0x01, 0x420b);
+}
+
+// A cheat that patches compressed ROM data has to show up in the next S-DD1
+// DMA, although the block was decoded and cached before, and removing the
+// cheat has to bring the original output back.
+static int CheckSDD1 (void)
+{
+	const uint16	length = 0x800;
+	uint8			*in = S9xGetBasePointer(0xc04000) + 0x4000;
+	uint8			before[length], patched[length];
+	int				failed = 0;
+
+	S9xSetPPU(0x80, 0x2100); // force blank, VRAM can be written any time
+	S9xCheatsEnable();
+
+	SDD1DMA(length);
+	memcpy(before, Memory.VRAM, length);
+
+	char	code[16];
+	sprintf(code, "c04000=%02x", in[0] ^ 0xff);
+	int		group = S9xAddCheatGroup("sdd1check", code);
+	S9xEnableCheatGroup(group);
+
+	SDD1_decompress(patched, in, length);
+	SDD1DMA(length);
+	if (memcmp(Memory.VRAM, patched, length) || !memcmp(patched, before, length))
+	{
+		printf("sdd1check: the DMA after enabling a cheat on c0:4000 DIFFERS from the patched data\n");
+		failed++;
+	}
+
+	S9xDeleteCheatGroup(group);
+
+	SDD1DMA(length);
+	if (memcmp(Memory.VRAM, before, length))
+	{
+		printf("sdd1check: the DMA after removing the cheat DIFFERS from the original data\n");
+		failed++;
+	}
+
+	if (!failed)
+		printf("sdd1check: cheats on compressed data reach the DMA output\n");
+
+	return failed;
+}
+
+static uint64 DrainSound (void);
+
+// Runs `frames` frames with the SA-1 in lockstep and keeps the RAM hash of
+// each, then puts the machine back where it started.
+static uint64 * RecordLockstepRAM (int frames, bool8 mute)
+{
+	uint32	size = S9xFreezeSize();
+	uint8	*start = (uint8 *) malloc(size);
+	uint64	*hashes = (uint64 *) malloc(frames * sizeof(uint64));
+	int32	quantum = SA1.Quantum;
+
+	// the handlers the quantum map sends shared memory through are just as
+	// right in lockstep, so the map can stay
+	S9xFreezeGameMem(start, size);
+	SA1.Quantum = 1;
+
+	for (int i = 0; i < frames; i++)
+	{
+		S9xMainLoop();
+		if (!mute)
+			DrainSound();
+		hashes[i] = RAMHash();
+	}
+
+	SA1.Quantum = quantum;
+	S9xUnfreezeGameMem(start, size);
+	free(start);
+
+	return hashes;
+}
+
+// Saves the state, runs a frame and notes the RAM it left, then loads the
+// state again, so the frame the caller runs next starts from a snapshot.
+static uint64 ReplayFrame (uint8 *state, uint32 size, bool8 mute)
+{
+	struct SBench	saved = Bench;
+	uint64			h;
+
+	S9xFreezeGameMem(state, size);
+	S9xMainLoop();
+	if (!mute)
+		DrainSound();
+	h = RAMHash();
+	S9xUnfreezeGameMem(state, size);
+
+	// only the replayed frames are reported
+	Bench = saved;
+
+	return (h);
+}
+
+static uint64 DrainSound (void)
+{
+	uint64	start = BenchTime();
+
+	S9xFinalizeSamples();
+
+	int	avail;
+	while ((avail = S9xGetSampleCount()) > 0)
+	{
+		if (avail > BENCH_SOUND_CHUNK * 2)
+			avail = BENCH_SOUND_CHUNK * 2;
+
+		S9xMixSamples((uint8 *) soundbuffer, avail);
+		Bench.AudioHash = BenchHash(Bench.AudioHash, soundbuffer, avail * sizeof(int16));
+	}
+
+	return BenchTime() - start;
+}
+
+int main (int argc, char *argv[])
+{
+	const char	*romname = NULL;
+	int			frames = 3600;
+	bool8		mute = FALSE;
+	bool8		blockcache = TRUE;
+	bool8		threaded = FALSE;
+	bool8		aputhread = FALSE;
+	int			tileconv = -1;
+	bool8		linemath = FALSE;
+	bool8		sinc = FALSE;
+	uint32		rewindMB = 0;
+	int			runahead = 0;
+	bool8		snapshots = FALSE;
+	int			sa1quantum = -1;
+	bool8		sa1check = FALSE;
+	bool8		dmacheck = FALSE;
+	bool8		sdd1check = FALSE;
+	bool8		replaycheck = FALSE;
+	uint8		*replayState = NULL;
+	uint32		replaySize = 0;
+	int			replaydiffs = 0, replayfirst = -1;
+	uint64		*lockstepRAM = NULL;
+	int			sa1diffs = 0, sa1first = -1;
+	int			filter = FILTER_NONE;
+	int			filterthreads = 1;
+#ifdef USE_PROFILER
+	const char	*profilename = NULL;
+#endif
+	uint8		*rewindArena = NULL;
+
+	memset(&Bench, 0, sizeof(Bench));
+	Bench.Render = TRUE;
+	Bench.VideoHash = BENCH_HASH_SEED;
+	Bench.AudioHash = BENCH_HASH_SEED;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-frames") && i + 1 < argc)
+			frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-norender"))
+			Bench.Render = FALSE;
+		else if (!strcmp(argv[i], "-mute"))
+			mute = TRUE;
+		else if (!strcmp(argv[i], "-noblockcache"))
+			blockcache = FALSE;
+		else if (!strcmp(argv[i], "-threaded"))
+			threaded = TRUE;
+		else if (!strcmp(argv[i], "-aputhread"))
+			aputhread = TRUE;
+		else if (!strcmp(argv[i], "-tileconv") && i + 1 < argc)
+			tileconv = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-linemath"))
+			linemath = TRUE;
+		else if (!strcmp(argv[i], "-sinc"))
+			sinc = TRUE;
+		else if (!strcmp(argv[i], "-rewind") && i + 1 < argc)
+			rewindMB = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-runahead") && i + 1 < argc)
+			runahead = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-filter") && i + 1 < argc)
+			filter = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-filterthreads") && i + 1 < argc)
+			filterthreads = atoi(argv[++i]);
+#ifdef USE_PROFILER
+		else if (!strcmp(argv[i], "-profile") && i + 1 < argc)
+			profilename = argv[++i];
+#endif
+		else if (!strcmp(argv[i], "-snapshots"))
+			snapshots = TRUE;
+		else if (!strcmp(argv[i], "-sa1quantum") && i + 1 < argc)
+			sa1quantum = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-sa1check"))
+			sa1check = TRUE;
+		else if (!strcmp(argv[i], "-dmacheck"))
+			dmacheck = TRUE;
+		else if (!strcmp(argv[i], "-sdd1check"))
+			sdd1check = TRUE;
+		else if (!strcmp(argv[i], "-replaycheck"))
+			replaycheck = TRUE;
+		else if (!strcmp(argv[i], "-v"))
+			Bench.Verbose = TRUE;
+		else if (argv[i][0] == '-' || romname)
+			Usage(argv[0]);
+		else
+			romname = argv[i];
+	}
+
+	if (!romname || frames <= 0)
+		Usage(argv[0]);
+
+	DefaultSettings();
+	Settings.Mute = mute;
+	Settings.CPUBlockCache = blockcache;
+	Settings.LineColourMath = linemath;
+	Settings.SincResampling = sinc;
+	if (sa1quantum >= 0)
+		Settings.SA1Quantum = sa1quantum;
+
+	if (!Memory.Init() || !S9xInitAPU())
+	{
+		fprintf(stderr, "failed to allocate SNES memory\n");
+		return 1;
+	}
+
+	S9xInitSound(64, 0);
+	S9xSetSoundMute(mute);
+
+	// same layout as the port, the filters read the border around the image
+	screen = (uint16 *) calloc(EXT_PITCH * EXT_HEIGHT, 1);
+	GFX.Pitch = EXT_PITCH;
+	GFX.Screen = screen + EXT_OFFSET / 2;
+	if (!S9xGraphicsInit())
+	{
+		fprintf(stderr, "failed to initialise graphics\n");
+		return 1;
+	}
+
+	if (tileconv >= 0 && !S9xSetTileConverters(tileconv))
+	{
+		fprintf(stderr, "tile converter %d is not supported here\n", tileconv);
+		return 1;
+	}
+
+	if (filter != FILTER_NONE)
+	{
+		if (filter < 0 || filter >= NUM_FILTERS || filterthreads < 1 || filterthreads > FILTER_MAX_THREADS)
+			Usage(argv[0]);
+
+		Bench.Filter = FilterToMethod((RenderFilter) filter);
+		Bench.FilterScale = GetFilterScale((RenderFilter) filter);
+		Bench.FilterBuffer = (uint8 *) calloc(MAX_SNES_WIDTH * Bench.FilterScale * MAX_SNES_HEIGHT * Bench.FilterScale, sizeof(uint16));
+		Bench.FilterHash = BENCH_HASH_SEED;
+
+		if (!InitFilterThreads(filterthreads))
+		{
+			fprintf(stderr, "cannot start the filter threads\n");
+			return 1;
+		}
+	}
+
+	S9xUnmapAllControls();
+
+	uint32	romsize;
+	uint8	*rom = LoadFile(romname, &romsize);
+	if (!rom)
+	{
+		fprintf(stderr, "cannot read %s\n", romname);
+		return 1;
+	}
+
+	if (!Memory.LoadROMMem(rom, romsize))
+	{
+		fprintf(stderr, "cannot load %s\n", romname);
+		return 1;
+	}
+
+	free(rom);
+
+	printf("rom:    %s [%s] %s\n", Memory.ROMName, Memory.ROMId, Settings.PAL ? "PAL" : "NTSC");
+
+	if (dmacheck)
+		return CheckDMA() ? 1 : 0;
+
+	if (sdd1check)
+	{
+		if (!Settings.SDD1)
+		{
+			fprintf(stderr, "-sdd1check needs an S-DD1 game\n");
+			return 1;
+		}
+
+		return CheckSDD1() ? 1 : 0;
+	}
+
+	if (sa1check)
+	{
+		if (!Settings.SA1)
+		{
+			fprintf(stderr, "-sa1check needs an SA-1 game\n");
+			return 1;
+		}
+
+		lockstepRAM = RecordLockstepRAM(frames, mute);
+
+		// only the run below is reported
+		Bench.VideoHash = BENCH_HASH_SEED;
+		Bench.AudioHash = BENCH_HASH_SEED;
+		Bench.FilterHash = BENCH_HASH_SEED;
+		Bench.VideoUsec = Bench.FilterUsec = 0;
+		Bench.PresentedFrames = Bench.FilteredFrames = 0;
+	}
+
+	if (replaycheck)
+	{
+		if (runahead || threaded || aputhread)
+		{
+			fprintf(stderr, "-replaycheck runs the frames on this thread, without run-ahead\n");
+			return 1;
+		}
+
+		replaySize = S9xFreezeSize();
+		replayState = (uint8 *) malloc(replaySize);
+	}
+
+	if (rewindMB)
+	{
+		rewindArena = (uint8 *) malloc(rewindMB << 20);
+		if (!S9xRewindInit(rewindArena, rewindMB << 20, REWIND_DEFAULT_INTERVAL, REWIND_DEFAULT_KEYFRAMES))
+		{
+			fprintf(stderr, "rewind arena of %u MB is too small\n", rewindMB);
+			return 1;
+		}
+	}
+
+	if (runahead && !S9xRunAheadInit(runahead))
+	{
+		fprintf(stderr, "run-ahead of %d frames is not available for this game\n", runahead);
+		return 1;
+	}
+
+	if (threaded && !S9xRenderThreadStart())
+	{
+		fprintf(stderr, "cannot start the render thread\n");
+		return 1;
+	}
+
+	if (aputhread && !S9xAPUThreadStart())
+	{
+		fprintf(stderr, "cannot start the APU thread\n");
+		return 1;
+	}
+
+#ifdef USE_PROFILER
+	S9xProfileReset();
+#endif
+
+	uint64	emuUsec = 0, soundUsec = 0, rewindUsec = 0;
+	uint64	start = BenchTime();
+
+	for (int i = 0; i < frames; i++)
+	{
+		uint64	replayRAM = 0;
+		if (replayState)
+			replayRAM = ReplayFrame(replayState, replaySize, mute);
+
+		uint64	t = BenchTime();
+		if (runahead)
+			S9xRunAheadFrame();
+		else
+			S9xMainLoop();
+		emuUsec += BenchTime() - t;
+
+		if (!mute)
+			soundUsec += DrainSound();
+
+		if (rewindArena)
+		{
+			t = BenchTime();
+			S9xRewindCapture();
+			rewindUsec += BenchTime() - t;
+		}
+
+		if (lockstepRAM && RAMHash() != lockstepRAM[i])
+		{
+			if (!sa1diffs++)
+				sa1first = i;
+		}
+
+		if (replayState && RAMHash() != replayRAM)
+		{
+			if (!replaydiffs++)
+				replayfirst = i;
+		}
+	}
+
+	if (threaded)
+		S9xRenderThreadSync(FALSE);
+
+	// collect the samples still on their way from the APU thread
+	if (aputhread)
+	{
+		S9xAPUThreadSync();
+		if (!mute)
+			soundUsec += DrainSound();
+	}
+
+	uint64	totalUsec = BenchTime() - start;
+	double	seconds = totalUsec / 1e6;
+
+	// presenting happens on the render thread, in parallel with emulation
+	if (!threaded)
+		emuUsec -= Bench.VideoUsec;
+
+	printf("frames: %d in %.3f s, %.1f fps (%.2fx realtime)\n", frames, seconds,
+		frames / seconds, frames / seconds / (Settings.PAL ? 50.0 : 60.0988));
+	printf("emu:    %8.3f ms/frame\n", emuUsec / 1000.0 / frames);
+	printf("video:  %8.3f ms/frame (%u presented, %ux%u)\n", Bench.VideoUsec / 1000.0 / frames,
+		Bench.PresentedFrames, Bench.LastWidth, Bench.LastHeight);
+	printf("sound:  %8.3f ms/frame\n", soundUsec / 1000.0 / frames);
+	printf("vhash:  %016llx\n", (unsigned long long) Bench.VideoHash);
+	printf("ahash:  %016llx\n", (unsigned long long) Bench.AudioHash);
+
+	if (rewindArena)
+	{
+		int	captures = frames / REWIND_DEFAULT_INTERVAL;
+
+		printf("rewind: %8.3f ms/capture, %d of %d captures kept in %u KB\n",
+			captures ? rewindUsec / 1000.0 / captures : 0.0, S9xRewindCount(), captures, S9xRewindMemoryUsed() >> 10);
+
+		if (frames % REWIND_DEFAULT_INTERVAL == 0)
+			VerifyRewind();
+
+		S9xRewindDeinit();
+		free(rewindArena);
+	}
+
+	// the frames are shown `runahead` frames early, the sound is unchanged
+	if (runahead)
+	{
+		printf("runahead: %d frames ahead, %u KB state\n", runahead, S9xRunAheadStateSize() >> 10);
+		S9xRunAheadDeinit();
+	}
+
+	if (lockstepRAM)
+	{
+		if (sa1diffs)
+			printf("sa1check: quantum %d DIFFERS from lockstep in %d of %d frames, first at frame %d\n",
+				Settings.SA1Quantum, sa1diffs, frames, sa1first);
+		else
+			printf("sa1check: quantum %d matches lockstep in all %d frames\n", Settings.SA1Quantum, frames);
+
+		free(lockstepRAM);
+	}
+
+	if (replayState)
+	{
+		if (replaydiffs)
+			printf("replaycheck: a loaded snapshot DIFFERS in %d of %d frames, first at frame %d\n",
+				replaydiffs, frames, replayfirst);
+		else
+			printf("replaycheck: a loaded snapshot matches in all %d frames\n", frames);
+
+		free(replayState);
+	}
+
+	if (Bench.Filter)
+	{
+		printf("filter: %-8s %8.3f ms/frame (%u filtered, %d bands)\n", GetFilterName((RenderFilter) filter),
+			Bench.FilteredFrames ? Bench.FilterUsec / 1000.0 / Bench.FilteredFrames : 0.0, Bench.FilteredFrames, filterthreads);
+		printf("fhash:  %016llx\n", (unsigned long long) Bench.FilterHash);
+	}
+
+#ifdef USE_PROFILER
+	if (profilename)
+	{
+		if (S9xProfileDumpCSV(profilename))
+			printf("profile: last %d frames written to %s\n", S9xProfileFrameCount(), profilename);
+		else
+			fprintf(stderr, "cannot write %s\n", profilename);
+	}
+#endif
+
+	if (snapshots)
+		MeasureSnapshots();
+
+	if (threaded)
+		S9xRenderThreadStop();
+	if (aputhread)
+		S9xAPUThreadStop();
+	if (Bench.Filter)
+	{
+		DeinitFilterThreads();
+		free(Bench.FilterBuffer);
+	}
+
+	S9xGraphicsDeinit();
+	S9xDeinitAPU();
+	Memory.Deinit();
+	free(screen);
+
+	return 0;
+}
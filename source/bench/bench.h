@@ -0,0 +1,42 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * bench.h
+ *
+ * Headless host benchmark runner
+ ***************************************************************************/
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "snes9x/snes9x.h"
+#include "filterkernels.h"
+
+#define BENCH_HASH_SEED		0xcbf29ce484222325ULL
+
+struct SBench
+{
+	bool8	Render;			// value handed to IPPU.RenderThisFrame
+	bool8	Verbose;		// forward core messages to stderr
+
+	uint64	VideoHash;		// FNV-1a over every presented frame
+	uint64	AudioHash;		// FNV-1a over every mixed sample
+	uint64	VideoUsec;		// time spent presenting frames
+	uint32	PresentedFrames;
+	uint32	LastWidth;
+	uint32	LastHeight;
+
+	TFilterMethod	Filter;	// applied to every presented frame, as video.cpp does
+	int		FilterScale;
+	uint8	*FilterBuffer;
+	uint64	FilterHash;
+	uint64	FilterUsec;
+	uint32	FilteredFrames;
+};
+
+extern struct SBench	Bench;
+
+uint64 BenchTime (void);
+uint64 BenchHash (uint64, const void *, size_t);
+
+#endif
@@ -0,0 +1,215 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * benchsupport.cpp
+ *
+ * Snes9x support functions for the headless host build. Frames are hashed
+ * instead of displayed, sound is pulled by the runner and nothing is paced.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "snes9x/memmap.h"
+#include "snes9x/display.h"
+#include "snes9x/gfx.h"
+#include "snes9x/apu/apu.h"
+#include "snes9x/controls.h"
+
+struct SBench	Bench;
+
+bool	bsxBiosLoadFailed = false;
+
+uint64 BenchTime (void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+uint64 BenchHash (uint64 hash, const void *data, size_t len)
+{
+	const uint8	*p = (const uint8 *) data;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return (hash);
+}
+
+/*** Miscellaneous Functions ***/
+void S9xExit()
+{
+	exit(1);
+}
+
+void S9xMessage(int /*type */, int /*number */, const char *message)
+{
+	if (Bench.Verbose)
+		fprintf(stderr, "%s\n", message);
+}
+
+void S9xAutoSaveSRAM()
+{
+
+}
+
+/*** Sound based functions ***/
+void S9xToggleSoundChannel(int c)
+{
+	static int sound_switch = 255;
+
+	if (c == 8)
+		sound_switch = 255;
+	else
+		sound_switch ^= 1 << c;
+
+	S9xSetSoundControl (sound_switch);
+}
+
+bool8 S9xOpenSoundDevice(void)
+{
+	return TRUE;
+}
+
+/*** Synchronisation ***/
+void S9xSyncSpeed ()
+{
+	IPPU.RenderThisFrame = Bench.Render;
+	IPPU.SkippedFrames = 0;
+}
+
+/*** Video / Display related functions ***/
+bool8 S9xInitUpdate()
+{
+	return (TRUE);
+}
+
+bool8 S9xDeinitUpdate(int Width, int Height)
+{
+	uint64	start = BenchTime();
+
+	for (int y = 0; y < Height; y++)
+		Bench.VideoHash = BenchHash(Bench.VideoHash, (uint8 *) GFX.Screen + y * GFX.Pitch, Width * sizeof(uint16));
+
+	Bench.PresentedFrames++;
+	Bench.LastWidth = Width;
+	Bench.LastHeight = Height;
+	Bench.VideoUsec += BenchTime() - start;
+
+	// the port only filters low resolution frames
+	if (Bench.Filter && Width <= 256 && Height <= 239)
+	{
+		uint32	pitch = Width * Bench.FilterScale * sizeof(uint16);
+
+		start = BenchTime();
+		RunFilterBands(Bench.Filter, Bench.FilterScale, (uint8 *) GFX.Screen, GFX.Pitch, Bench.FilterBuffer, pitch, Width, Height);
+		Bench.FilterUsec += BenchTime() - start;
+		Bench.FilteredFrames++;
+
+		Bench.FilterHash = BenchHash(Bench.FilterHash, Bench.FilterBuffer, pitch * Height * Bench.FilterScale);
+	}
+
+	return (TRUE);
+}
+
+bool8 S9xContinueUpdate(int Width, int Height)
+{
+	return (TRUE);
+}
+
+/*** Input functions ***/
+void S9xHandlePortCommand(s9xcommand_t cmd, int16 data1, int16 data2)
+{
+	return;
+}
+
+bool S9xPollButton(uint32 id, bool * pressed)
+{
+	return 0;
+}
+
+bool S9xPollAxis(uint32 id, int16 * value)
+{
+	return 0;
+}
+
+bool S9xPollPointer(uint32 id, int16 * x, int16 * y)
+{
+	return 0;
+}
+
+/****************************************************************************
+ * The runner never touches the file system after loading the ROM, so these
+ * only have to keep the core away from paths that would.
+ ***************************************************************************/
+const char * S9xGetDirectory(enum s9x_getdirtype dirtype)
+{
+	return ".";
+}
+
+const char * S9xGetFilename(const char *ex, enum s9x_getdirtype dirtype)
+{
+	static char filename[PATH_MAX + 1];
+
+	snprintf(filename, sizeof(filename), "%s%s", Memory.ROMFilename, ex);
+	return filename;
+}
+
+const char * S9xGetFilenameInc(const char *e, enum s9x_getdirtype dirtype)
+{
+	return S9xGetFilename(e, dirtype);
+}
+
+const char * S9xBasename(const char *name)
+{
+	const char	*p = strrchr(name, SLASH_CHAR);
+
+	return (p ? p + 1 : name);
+}
+
+const char * S9xStringInput (const char * s)
+{
+	return NULL;
+}
+
+bool8 S9xOpenSnapshotFile (const char *filename, bool8 read_only, STREAM *file)
+{
+	return (FALSE);
+}
+
+void S9xCloseSnapshotFile (STREAM file)
+{
+	CLOSE_STREAM(file);
+}
+
+void _splitpath(char const *buf, char *drive, char *dir, char *fname, char *ext)
+{
+	*drive = 0;
+	*dir = 0;
+	strcpy(fname, S9xBasename(buf));
+	*ext = 0;
+
+	char	*p = strrchr(fname, '.');
+	if (p)
+	{
+		strcpy(ext, p + 1);
+		*p = 0;
+	}
+}
+
+void _makepath(char *filename, const char *drive, const char *dir,
+		const char *fname, const char *ext)
+{
+	if (ext && *ext)
+		sprintf(filename, "%s%s%s.%s", dir ? dir : "", (dir && *dir) ? SLASH_STR : "", fname, ext);
+	else
+		sprintf(filename, "%s%s%s", dir ? dir : "", (dir && *dir) ? SLASH_STR : "", fname);
+}
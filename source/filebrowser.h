@@ -16,6 +16,7 @@
 #include "snes9xtx.h"
 
 #define MAXJOLIET 255
+#define ROM_TITLE_LEN 21
 #ifdef HW_DOL
 #define MAX_BROWSER_SIZE	1000
 #else
@@ -39,6 +40,11 @@ typedef struct
 	char displayname[MAXJOLIET + 1]; // name for browser display
 	int filenum; // file # (for 7z support)
 	int icon; // icon to display
+	u32 mtime; // modification time, for the directory index
+	u8 romInfo; // ROMINFO_ flags, the fields below are valid with ROMINFO_VALID
+	char title[ROM_TITLE_LEN + 1]; // internal title from the ROM header
+	u32 crc32; // of the ROM without a copier header
+	u8 sha256[32];
 } BROWSERENTRY;
 
 extern BROWSERINFO browser;
@@ -30,6 +30,7 @@
 #include "gcunzip.h"
 #include "menu.h"
 #include "filebrowser.h"
+#include "romindex.h"
 #include "gui/gui.h"
 
 #ifdef HW_RVL
@@ -37,6 +38,8 @@
 #endif
 
 #define THREAD_SLEEP 100
+#define PARSE_FIRST 20		// entries listed before the browser is shown
+#define PARSE_BATCH 128	// entries the parse thread sorts and merges at a time
 
 unsigned char *savebuffer = NULL;
 u8 *ext_font_ttf = NULL;
@@ -61,7 +64,12 @@ static lwp_t parsethread = LWP_THREAD_NULL;
 static DIR *dir = NULL;
 static bool parseHalt = true;
 static bool parseFilter = true;
-static bool ParseDirEntries();
+static bool parseListing = false;	// the directory is still being listed
+static bool parseIndex = false;		// entries get their ROM info and the index is saved
+static bool indexCurrent = false;	// the listing was restored from the index
+static bool listingComplete = false;
+static bool ParseDirEntries(int max);
+static void IndexDirEntries();
 int selectLoadedFile = 0;
 
 // device thread
@@ -171,8 +179,14 @@ parsecallback (void *arg)
 {
 	while(1)
 	{
-		while(ParseDirEntries())
+		while(ParseDirEntries(PARSE_BATCH))
 			usleep(THREAD_SLEEP);
+		parseListing = false;
+
+		if(parseIndex && !parseHalt)
+			IndexDirEntries();
+		parseIndex = false;
+
 		LWP_SuspendThread(parsethread);
 	}
 	return NULL;
@@ -477,6 +491,25 @@ static char *GetExt(char *file)
 	return ext;
 }
 
+/****************************************************************************
+ * SelectBrowserEntry
+ *
+ * Selects an entry and shows the page it is on
+ ***************************************************************************/
+void SelectBrowserEntry (int index)
+{
+	int newIndex = (index / FILE_PAGESIZE) * FILE_PAGESIZE;
+
+	if(newIndex + FILE_PAGESIZE > browser.numEntries)
+		newIndex = browser.numEntries - FILE_PAGESIZE;
+
+	if(newIndex < 0)
+		newIndex = 0;
+
+	browser.pageIndex = newIndex;
+	browser.selIndex = index;
+}
+
 void FindAndSelectLastLoadedFile () 
 {
 	int indexFound = -1;
@@ -492,72 +525,150 @@ void FindAndSelectLastLoadedFile ()
 
 	// move to this file
 	if(indexFound > 0)
+		SelectBrowserEntry(indexFound);
+	
+	selectLoadedFile = 2; // selecting done
+}
+
+static void SetDisplayName(BROWSERENTRY *entry)
+{
+	if(entry->isdir)
 	{
-		if(indexFound >= FILE_PAGESIZE)
-		{			
-			int newIndex = (floor(indexFound/(float)FILE_PAGESIZE)) * FILE_PAGESIZE;
+		if(strcmp(entry->filename, "..") == 0)
+			sprintf(entry->displayname, "Up One Level");
+		else
+			snprintf(entry->displayname, MAXJOLIET, "%s", entry->filename);
+		entry->icon = ICON_FOLDER;
+	}
+	else
+	{
+		StripExt(entry->displayname, entry->filename); // hide file extension
+	}
+}
+
+/****************************************************************************
+ * MergeDirEntries
+ *
+ * Sorts the count entries after browser.numEntries and merges them into the
+ * list before them, which is already sorted
+ ***************************************************************************/
+static void MergeDirEntries(int count)
+{
+	BROWSERENTRY *list = browserList;
+	int sorted = browser.numEntries;
 
-			if(newIndex + FILE_PAGESIZE > browser.numEntries)
-				newIndex = browser.numEntries - FILE_PAGESIZE;
+	qsort(&list[sorted], count, sizeof(BROWSERENTRY), FileSortCallback);
 
-			if(newIndex < 0)
-				newIndex = 0;
+	if(sorted == 0 || count == 0 || FileSortCallback(&list[sorted-1], &list[sorted]) <= 0)
+		return; // already in place
 
-			browser.pageIndex = newIndex;
-		}
-		browser.selIndex = indexFound;
+	BROWSERENTRY *batch = (BROWSERENTRY *)malloc(count * sizeof(BROWSERENTRY));
+
+	if(!batch)
+	{
+		qsort(list, sorted+count, sizeof(BROWSERENTRY), FileSortCallback);
+		return;
 	}
-	
-	selectLoadedFile = 2; // selecting done
+
+	memcpy(batch, &list[sorted], count * sizeof(BROWSERENTRY));
+
+	int a = sorted - 1;
+	int b = count - 1;
+	int k = sorted + count - 1;
+
+	while(b >= 0)
+	{
+		if(a >= 0 && FileSortCallback(&list[a], &batch[b]) > 0)
+			memcpy(&list[k--], &list[a--], sizeof(BROWSERENTRY));
+		else
+			memcpy(&list[k--], &batch[b--], sizeof(BROWSERENTRY));
+	}
+	free(batch);
+}
+
+/****************************************************************************
+ * ListedDirEntry
+ *
+ * Returns -1 if the entry is not listed, otherwise whether it is a directory
+ ***************************************************************************/
+static int ListedDirEntry(struct dirent *entry)
+{
+	if(entry->d_name[0] == '.' && entry->d_name[1] != '.')
+		return -1;
+
+	if(strcmp(entry->d_name, "..") == 0)
+		return 1;
+
+	if(entry->d_type==DT_DIR)
+		return 1;
+
+	// don't show the file if it's not a valid ROM
+	if(parseFilter)
+	{
+		char *ext = GetExt(entry->d_name);
+
+		if(ext == NULL)
+			return -1;
+
+		if(	strcasecmp(ext, "bs") != 0 && strcasecmp(ext, "smc") != 0 &&
+			strcasecmp(ext, "fig") != 0 && strcasecmp(ext, "sfc") != 0 &&
+			strcasecmp(ext, "swc") != 0 && strcasecmp(ext, "zip") != 0 &&
+			strcasecmp(ext, "7z") != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/****************************************************************************
+ * DirMatchesIndex
+ *
+ * FAT does not reliably update the time of a directory when files are added
+ * or removed, so the names in it are checked against the index as well.
+ * Only the names are read, nothing is looked up per file. Leaves the
+ * directory open at its first entry.
+ ***************************************************************************/
+static bool DirMatchesIndex()
+{
+	struct dirent *entry;
+	int count = 0;
+	u32 names = 0;
+
+	while((entry = readdir(dir)) != NULL)
+	{
+		if(ListedDirEntry(entry) < 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+
+		count++;
+		names += crc32(0, (const Bytef *)entry->d_name, strlen(entry->d_name));
+	}
+
+	closedir(dir);
+	dir = opendir(browser.dir);
+
+	return (dir != NULL && RomIndexMatches(count, names));
 }
 
-static bool ParseDirEntries()
+static bool ParseDirEntries(int max)
 {
 	if(!dir)
 		return false;
 
-	char *ext;
 	struct dirent *entry = NULL;
 	int isdir;
 
 	int i = 0;
 
-	while(i < 20 && !parseHalt)
+	while(i < max && !parseHalt)
 	{
 		entry = readdir(dir);
 
 		if(entry == NULL)
 			break;
 
-		if(entry->d_name[0] == '.' && entry->d_name[1] != '.')
-			continue;
+		isdir = ListedDirEntry(entry);
 
-		if(strcmp(entry->d_name, "..") == 0)
-		{
-			isdir = 1;
-		}
-		else
-		{
-			if(entry->d_type==DT_DIR)
-				isdir = 1;
-			else
-				isdir = 0;
-			
-			// don't show the file if it's not a valid ROM
-			if(parseFilter && !isdir)
-			{
-				ext = GetExt(entry->d_name);
-				
-				if(ext == NULL)
-					continue;
-
-				if(	strcasecmp(ext, "bs") != 0 && strcasecmp(ext, "smc") != 0 &&
-					strcasecmp(ext, "fig") != 0 && strcasecmp(ext, "sfc") != 0 &&
-					strcasecmp(ext, "swc") != 0 && strcasecmp(ext, "zip") != 0 &&
-					strcasecmp(ext, "7z") != 0)
-					continue;
-			}
-		}
+		if(isdir < 0)
+			continue;
 
 		if(!AddBrowserEntry())
 		{
@@ -565,35 +676,28 @@ static bool ParseDirEntries()
 			break;
 		}
 
-		snprintf(browserList[browser.numEntries+i].filename, MAXJOLIET, "%s", entry->d_name);
-		browserList[browser.numEntries+i].isdir = isdir; // flag this as a dir
+		BROWSERENTRY *e = &browserList[browser.numEntries+i];
 
-		if(isdir)
-		{
-			if(strcmp(entry->d_name, "..") == 0)
-				sprintf(browserList[browser.numEntries+i].displayname, "Up One Level");
-			else
-				snprintf(browserList[browser.numEntries+i].displayname, MAXJOLIET, "%s", browserList[browser.numEntries+i].filename);
-			browserList[browser.numEntries+i].icon = ICON_FOLDER;
-		}
-		else
-		{
-			StripExt(browserList[browser.numEntries+i].displayname, browserList[browser.numEntries+i].filename); // hide file extension
-		}
+		snprintf(e->filename, MAXJOLIET, "%s", entry->d_name);
+		e->isdir = isdir; // flag this as a dir
+
+		if(parseIndex)
+			RomIndexLookup(e); // what is known of it from the last visit
+
+		SetDisplayName(e);
 		i++;
 	}
 
 	if(!parseHalt)
 	{
-		// Sort the file list
-		if(i >= 0)
-			qsort(browserList, browser.numEntries+i, sizeof(BROWSERENTRY), FileSortCallback);
-	
+		// Sort the new entries into the file list
+		MergeDirEntries(i);
 		browser.numEntries += i;
 	}
 
 	if(entry == NULL || parseHalt)
 	{
+		listingComplete = !parseHalt;
 		closedir(dir); // close directory
 		dir = NULL;
 		
@@ -602,6 +706,33 @@ static bool ParseDirEntries()
 	return true; // more entries
 }
 
+/****************************************************************************
+ * IndexDirEntries
+ *
+ * Checks the size and time of the listed entries, reads the ROM info of the
+ * ones that changed and saves the directory index. A listing restored from
+ * the index is checked too, as a ROM copied over one of the same name does
+ * not change the directory.
+ ***************************************************************************/
+static void IndexDirEntries()
+{
+	bool changed = !indexCurrent;
+
+	if(!listingComplete)
+		return;
+
+	for(int i = 0; i < browser.numEntries && !parseHalt; i++)
+	{
+		if(RomIndexUpdate(&browserList[i], &parseHalt))
+			changed = true;
+
+		usleep(THREAD_SLEEP);
+	}
+
+	if(changed)
+		RomIndexSave(!parseHalt);
+}
+
 /***************************************************************************
  * Browse subdirectories
  **************************************************************************/
@@ -665,16 +796,69 @@ ParseDirectory(bool waitParse, bool filter)
 		browser.numEntries++;
 	}
 
+	// ROM listings keep an index, which stands in for the directory while
+	// the directory has not been modified since
+	parseIndex = filter;
+	indexCurrent = false;
+	listingComplete = false;
+
+	if(parseIndex)
+	{
+		char path[MAXPATHLEN];
+		struct stat st;
+		u32 dirTime = 0;
+
+		snprintf(path, MAXPATHLEN, "%s", browser.dir);
+		if(!IsDeviceRoot(path))
+			path[strlen(path)-1] = 0; // strip the trailing slash
+
+		if(stat(path, &st) == 0)
+			dirTime = st.st_mtime;
+
+		indexCurrent = RomIndexOpen(browser.dir, dirTime) && DirMatchesIndex();
+	}
+
+	if(dir == NULL)
+	{
+		RomIndexClose();
+		return -1;
+	}
+
+	if(indexCurrent)
+	{
+		closedir(dir);
+		dir = NULL;
+
+		for(int i = 0; i < RomIndexCount(); i++)
+		{
+			BROWSERENTRY e;
+			memset(&e, 0, sizeof(e)); // the index does not set the icon or file #
+			RomIndexGet(i, &e);
+
+			if(browser.numEntries > 0 && strcmp(e.filename, "..") == 0)
+				continue; // added above
+
+			if(!AddBrowserEntry())
+				break;
+
+			browserList[browser.numEntries] = e;
+			SetDisplayName(&browserList[browser.numEntries]);
+			browser.numEntries++;
+		}
+		listingComplete = true;
+	}
+
 	parseHalt = false;
-	ParseDirEntries(); // index first 20 entries
+	parseListing = true;
+	ParseDirEntries(PARSE_FIRST); // index first entries
 
 	LWP_ResumeThread(parsethread); // index remaining entries
 
-	if(waitParse) // wait for complete parsing
+	if(waitParse) // wait for the complete listing, the ROM info can follow
 	{
 		ShowAction("Loading...");
 
-		while(!LWP_ThreadIsSuspended(parsethread))
+		while(parseListing)
 			usleep(THREAD_SLEEP);
 
 		CancelAction();
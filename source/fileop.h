@@ -32,6 +32,7 @@ char * StripDevice(char * path);
 bool ChangeInterface(int device, bool silent);
 bool ChangeInterface(char * filepath, bool silent);
 void CreateAppPath(char * origpath);
+void SelectBrowserEntry(int index);
 void FindAndSelectLastLoadedFile();
 int ParseDirectory(bool waitParse = false, bool filter = true);
 bool CreateDirectory(char * path);
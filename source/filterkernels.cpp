@@ -0,0 +1,578 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * Michniewski 2008
+ * Tanooki 2019-2023
+ *
+ * Scale2x filter
+ * (c) Copyright 2001         Andrea Mazzoleni (amadvance@gmail.com)
+ *
+ * Adapted from AdvanceMAME
+ * Video Filter Code (scale2x)
+ * http://www.scale2x.it/
+ *
+ * 2xBR filter
+ * (c) Copyright 2011, 2012   Hyllian/Jararaca (sergiogdb@gmail.com)
+ *
+ * filterkernels.cpp
+ *
+ * Video filter kernels and the band scheduler
+ ****************************************************************************/
+
+/*
+  Every kernel takes RGB565 pixels from a buffer with the two pixel EXT border
+  and writes `scale` output rows per input row, so any run of input rows can
+  be filtered on its own. RunFilterBands uses that to hand horizontal bands
+  to helper threads on hosts with more than one core.
+
+  Where SSE2 is available TV mode and Scale2x work on eight pixels at a time.
+  The Wii and GameCube have no integer SIMD (paired singles only operate on
+  floats), so there the scalar loops keep their neighbours in registers and
+  write two output pixels per store instead.
+
+  2xBR looks at a 5x5 neighbourhood and compares colours in YUV through a
+  65536 entry table that is built when the filter is selected.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#ifndef GEKKO
+#include <pthread.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "filterkernels.h"
+
+#define	Mask_2	0x07E0	// 00000 111111 00000
+#define	Mask13	0xF81F	// 11111 000000 11111
+
+static uint32	*yuvTable = NULL;
+
+const char* GetFilterName (RenderFilter filterID)
+{
+	switch(filterID)
+	{
+		default: return "Unknown";
+		case FILTER_NONE: return "None";
+		case FILTER_TVMODE: return "TV Mode";
+		case FILTER_SCALE2X: return "Scale2x";
+		case FILTER_2XBR: return "2xBR";
+	}
+}
+
+int GetFilterScale(RenderFilter filterID)
+{
+	switch(filterID)
+	{
+		case FILTER_NONE:
+			return 1;
+		default:
+		case FILTER_TVMODE:
+		case FILTER_SCALE2X:
+		case FILTER_2XBR:
+			return 2;
+	}
+}
+
+// two horizontally adjacent output pixels as one aligned 32-bit store
+static inline uint32 PixelPair (uint16 left, uint16 right)
+{
+#ifdef LSB_FIRST
+	return (left | (right << 16));
+#else
+	return ((left << 16) | right);
+#endif
+}
+
+static inline uint16 TVDim (uint16 p)
+{
+	uint32 pi;
+
+	pi = (((p & Mask_2) * 6) >> 3) & Mask_2;
+	pi |= (((p & Mask13) * 6) >> 3) & Mask13;
+
+	return (uint16) pi;
+}
+
+static void RenderTVMode (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	unsigned int nextlineSrc = srcPitch / sizeof(uint16);
+	uint16 *p = (uint16 *)srcPtr;
+
+	unsigned int nextlineDst = dstPitch / sizeof(uint16);
+	uint16 *q = (uint16 *)dstPtr;
+
+#ifdef __SSE2__
+	const __m128i m31 = _mm_set1_epi16(0x1f);
+	const __m128i m63 = _mm_set1_epi16(0x3f);
+	const __m128i three = _mm_set1_epi16(3);
+#endif
+
+	while(height--) {
+		int i = 0;
+#ifdef __SSE2__
+		for (; i + 8 <= width; i += 8) {
+			__m128i p1 = _mm_loadu_si128((__m128i *) (p + i));
+			__m128i r = _mm_srli_epi16(p1, 11);
+			__m128i g = _mm_and_si128(_mm_srli_epi16(p1, 5), m63);
+			__m128i b = _mm_and_si128(p1, m31);
+
+			// c * 6 >> 3 per channel, as c - ceil(c / 4)
+			r = _mm_sub_epi16(r, _mm_srli_epi16(_mm_add_epi16(r, three), 2));
+			g = _mm_sub_epi16(g, _mm_srli_epi16(_mm_add_epi16(g, three), 2));
+			b = _mm_sub_epi16(b, _mm_srli_epi16(_mm_add_epi16(b, three), 2));
+
+			__m128i pi = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+
+			_mm_storeu_si128((__m128i *) (q + i * 2), _mm_unpacklo_epi16(p1, p1));
+			_mm_storeu_si128((__m128i *) (q + i * 2 + 8), _mm_unpackhi_epi16(p1, p1));
+			_mm_storeu_si128((__m128i *) (q + i * 2 + nextlineDst), _mm_unpacklo_epi16(pi, pi));
+			_mm_storeu_si128((__m128i *) (q + i * 2 + nextlineDst + 8), _mm_unpackhi_epi16(pi, pi));
+		}
+#endif
+		uint32 *q0 = (uint32 *) q;
+		uint32 *q1 = (uint32 *) (q + nextlineDst);
+
+		for (; i < width; ++i) {
+			uint16 p1 = *(p + i);
+			uint16 pi = TVDim(p1);
+
+			q0[i] = PixelPair(p1, p1);
+			q1[i] = PixelPair(pi, pi);
+		}
+		p += nextlineSrc;
+		q += nextlineDst << 1;
+	}
+}
+
+static void RenderScale2X (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	unsigned int nextlineSrc = srcPitch / sizeof(uint16);
+	uint16 *p = (uint16 *)srcPtr;
+
+	unsigned int nextlineDst = dstPitch / sizeof(uint16);
+	uint16 *q = (uint16 *)dstPtr;
+
+	while (height--) {
+		int i = 0;
+#ifdef __SSE2__
+		for (; i + 8 <= width; i += 8) {
+			__m128i B = _mm_loadu_si128((__m128i *) (p + i - nextlineSrc));
+			__m128i D = _mm_loadu_si128((__m128i *) (p + i - 1));
+			__m128i E = _mm_loadu_si128((__m128i *) (p + i));
+			__m128i F = _mm_loadu_si128((__m128i *) (p + i + 1));
+			__m128i H = _mm_loadu_si128((__m128i *) (p + i + nextlineSrc));
+
+			__m128i eqDB = _mm_cmpeq_epi16(D, B);
+			__m128i eqBF = _mm_cmpeq_epi16(B, F);
+			__m128i eqDH = _mm_cmpeq_epi16(D, H);
+			__m128i eqHF = _mm_cmpeq_epi16(H, F);
+
+			// lanes where the corner takes the neighbour instead of E
+			__m128i m0 = _mm_andnot_si128(_mm_or_si128(eqBF, eqDH), eqDB);
+			__m128i m1 = _mm_andnot_si128(_mm_or_si128(eqDB, eqHF), eqBF);
+			__m128i m2 = _mm_andnot_si128(_mm_or_si128(eqDB, eqHF), eqDH);
+			__m128i m3 = _mm_andnot_si128(_mm_or_si128(eqDH, eqBF), eqHF);
+
+			__m128i E0 = _mm_or_si128(_mm_and_si128(m0, D), _mm_andnot_si128(m0, E));
+			__m128i E1 = _mm_or_si128(_mm_and_si128(m1, F), _mm_andnot_si128(m1, E));
+			__m128i E2 = _mm_or_si128(_mm_and_si128(m2, D), _mm_andnot_si128(m2, E));
+			__m128i E3 = _mm_or_si128(_mm_and_si128(m3, F), _mm_andnot_si128(m3, E));
+
+			_mm_storeu_si128((__m128i *) (q + i * 2), _mm_unpacklo_epi16(E0, E1));
+			_mm_storeu_si128((__m128i *) (q + i * 2 + 8), _mm_unpackhi_epi16(E0, E1));
+			_mm_storeu_si128((__m128i *) (q + i * 2 + nextlineDst), _mm_unpacklo_epi16(E2, E3));
+			_mm_storeu_si128((__m128i *) (q + i * 2 + nextlineDst + 8), _mm_unpackhi_epi16(E2, E3));
+		}
+#endif
+		uint32 *q0 = (uint32 *) q;
+		uint32 *q1 = (uint32 *) (q + nextlineDst);
+		uint16 D = *(p + i - 1);
+		uint16 E = *(p + i);
+
+		for (; i < width; ++i) {
+			uint16 B = *(p + i - nextlineSrc);
+			uint16 F = *(p + i + 1);
+			uint16 H = *(p + i + nextlineSrc);
+
+			q0[i] = PixelPair(D == B && B != F && D != H ? D : E, B == F && B != D && F != H ? F : E);
+			q1[i] = PixelPair(D == H && D != B && H != F ? D : E, H == F && D != H && B != F ? F : E);
+
+			D = E;
+			E = F;
+		}
+		p += nextlineSrc;
+		q += nextlineDst << 1;
+	}
+}
+
+/*** 2xBR ***/
+
+static void BuildYUVTable (void)
+{
+	if (yuvTable)
+		return;
+
+	yuvTable = (uint32 *) malloc(65536 * sizeof(uint32));
+	if (!yuvTable)
+		return;
+
+	for (int c = 0; c < 65536; c++)
+	{
+		int r = ((c >> 11) & 0x1f) << 3;
+		int g = ((c >> 5) & 0x3f) << 2;
+		int b = (c & 0x1f) << 3;
+
+		int y = (299 * r + 587 * g + 114 * b) / 1000;
+		int u = (-169 * r - 331 * g + 500 * b) / 1000 + 128;
+		int v = (500 * r - 419 * g - 81 * b) / 1000 + 128;
+
+		yuvTable[c] = (y << 16) | (u << 8) | v;
+	}
+}
+
+static inline uint32 YUVDiff (uint32 x, uint32 y)
+{
+	return (abs((int) (x >> 16) - (int) (y >> 16)) +
+			abs((int) ((x >> 8) & 0xff) - (int) ((y >> 8) & 0xff)) +
+			abs((int) (x & 0xff) - (int) (y & 0xff)));
+}
+
+static inline bool YUVEqual (uint32 x, uint32 y)
+{
+	return (YUVDiff(x, y) < 155);
+}
+
+// moves `dst` towards `src` by `w` eighths
+static inline uint16 Blend (uint16 dst, uint16 src, int w)
+{
+	uint32 d = (dst | (dst << 16)) & 0x07E0F81F;
+	uint32 s = (src | (src << 16)) & 0x07E0F81F;
+	uint32 r = ((d * (8 - w) + s * w) >> 3) & 0x07E0F81F;
+
+	return (uint16) (r | (r >> 16));
+}
+
+// The 5x5 neighbourhood, row by row:
+//
+//        A1 B1 C1
+//     A0  A  B  C C4
+//     D0  D  E  F F4
+//     G0  G  H  I I4
+//        G5 H5 I5
+//
+// Every corner of the 2x2 output block is decided by the same rule with the
+// neighbourhood rotated so that the corner is the bottom right one. Each row
+// lists where E, I, H, F, G, C, D, B, F4, I4, H5 and I5 are after rotating,
+// followed by the output pixels N1, N2 and N3 (0 top left, 1 top right,
+// 2 bottom left, 3 bottom right).
+static const uint8 Rotations[4][15] = {
+	{ 12, 18, 17, 13, 16,  8, 11,  7, 14, 19, 22, 23,  1, 2, 3 },
+	{ 12,  8, 13,  7, 18,  6, 17, 11,  2,  3, 14,  9,  0, 3, 1 },
+	{ 12,  6,  7, 11,  8, 16, 13, 17, 10,  5,  2,  1,  2, 1, 0 },
+	{ 12, 16, 11, 17,  6, 18,  7, 13, 22, 21, 10, 15,  3, 0, 2 }
+};
+
+template <int k>
+static inline void Filt2 (uint16 *out, const uint16 *n, const uint32 *y)
+{
+	const uint8 *r = Rotations[k];
+
+	uint16 E = n[r[0]], H = n[r[2]], F = n[r[3]];
+	uint16 G = n[r[4]], C = n[r[5]], D = n[r[6]], B = n[r[7]];
+
+	if (E == H || E == F)
+		return;
+
+	uint32 yE = y[r[0]], yI = y[r[1]], yH = y[r[2]], yF = y[r[3]];
+	uint32 yG = y[r[4]], yC = y[r[5]], yD = y[r[6]], yB = y[r[7]];
+	uint32 yF4 = y[r[8]], yI4 = y[r[9]], yH5 = y[r[10]], yI5 = y[r[11]];
+	int N1 = r[12], N2 = r[13], N3 = r[14];
+
+	uint32 e = YUVDiff(yE, yC) + YUVDiff(yE, yG) + YUVDiff(yI, yH5) + YUVDiff(yI, yF4) + (YUVDiff(yH, yF) << 2);
+	uint32 i = YUVDiff(yH, yD) + YUVDiff(yH, yI5) + YUVDiff(yF, yI4) + YUVDiff(yF, yB) + (YUVDiff(yE, yI) << 2);
+
+	if (e > i)
+		return;
+
+	uint16 px = YUVDiff(yE, yF) <= YUVDiff(yE, yH) ? F : H;
+
+	if (e < i && ((!YUVEqual(yF, yB) && !YUVEqual(yH, yD)) ||
+				  (YUVEqual(yE, yI) && !YUVEqual(yF, yI4) && !YUVEqual(yH, yI5)) ||
+				  YUVEqual(yE, yG) || YUVEqual(yE, yC)))
+	{
+		uint32 ke = YUVDiff(yF, yG);
+		uint32 ki = YUVDiff(yH, yC);
+		bool left = (ke << 1) <= ki && E != G && D != G;
+		bool up = ke >= (ki << 1) && E != C && B != C;
+
+		if (left && up) {
+			out[N3] = Blend(out[N3], px, 7);
+			out[N2] = Blend(out[N2], px, 2);
+			out[N1] = out[N2];
+		}
+		else if (left) {
+			out[N3] = Blend(out[N3], px, 6);
+			out[N2] = Blend(out[N2], px, 2);
+		}
+		else if (up) {
+			out[N3] = Blend(out[N3], px, 6);
+			out[N1] = Blend(out[N1], px, 2);
+		}
+		else
+			out[N3] = Blend(out[N3], px, 4);
+	}
+	else
+		out[N3] = Blend(out[N3], px, 4);
+}
+
+static void Render2xBR (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	int nl = srcPitch / sizeof(uint16);
+	uint16 *p = (uint16 *)srcPtr;
+
+	unsigned int nextlineDst = dstPitch / sizeof(uint16);
+	uint16 *q = (uint16 *)dstPtr;
+
+	// YUV of the five source rows around the current one, including the border
+	uint32 yuvRows[5][MAX_SNES_WIDTH + 4];
+	uint32 *yr[5];
+
+	for (int row = 0; row < 5; row++)
+	{
+		yr[row] = yuvRows[row] + 2;
+		for (int x = -2; x < width + 2; x++)
+			yr[row][x] = yuvTable[p[(row - 2) * nl + x]];
+	}
+
+	while (height--) {
+		uint32 *q0 = (uint32 *) q;
+		uint32 *q1 = (uint32 *) (q + nextlineDst);
+
+		for (int x = 0; x < width; ++x) {
+			const uint16 *s = p + x;
+			uint16 E = s[0];
+
+			// flat areas are by far the most common case
+			if (E == s[-nl] && E == s[-1] && E == s[1] && E == s[nl]) {
+				q0[x] = q1[x] = PixelPair(E, E);
+				continue;
+			}
+
+			uint16 n[25];
+			uint32 y[25];
+
+			for (int row = 0; row < 5; row++)
+				for (int col = 0; col < 5; col++)
+				{
+					n[row * 5 + col] = s[(row - 2) * nl + col - 2];
+					y[row * 5 + col] = yr[row][x + col - 2];
+				}
+
+			uint16 out[4] = { E, E, E, E };
+
+			Filt2<0>(out, n, y);
+			Filt2<1>(out, n, y);
+			Filt2<2>(out, n, y);
+			Filt2<3>(out, n, y);
+
+			q0[x] = PixelPair(out[0], out[1]);
+			q1[x] = PixelPair(out[2], out[3]);
+		}
+		p += nl;
+		q += nextlineDst << 1;
+
+		if (height) {
+			uint32 *top = yr[0];
+			for (int row = 0; row < 4; row++)
+				yr[row] = yr[row + 1];
+			yr[4] = top;
+
+			for (int x = -2; x < width + 2; x++)
+				yr[4][x] = yuvTable[p[2 * nl + x]];
+		}
+	}
+}
+
+// Return pointer to appropriate function
+TFilterMethod FilterToMethod (RenderFilter filterID)
+{
+	switch(filterID)
+	{
+		case FILTER_TVMODE:   return RenderTVMode;
+		case FILTER_SCALE2X:  return RenderScale2X;
+		case FILTER_2XBR:
+			BuildYUVTable();
+			return yuvTable ? Render2xBR : RenderScale2X;
+		default: return 0;
+	}
+}
+
+/*** Band scheduler ***/
+
+#ifndef GEKKO
+
+struct SFilterBand
+{
+	TFilterMethod	method;
+	uint8			*src;
+	uint8			*dst;
+	uint32			srcPitch;
+	uint32			dstPitch;
+	int				width;
+	int				height;
+};
+
+namespace filterthreads
+{
+	static pthread_t		threads[FILTER_MAX_THREADS];
+	static pthread_mutex_t	lock = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t	wake = PTHREAD_COND_INITIALIZER;
+	static pthread_cond_t	done = PTHREAD_COND_INITIALIZER;
+
+	static SFilterBand		bands[FILTER_MAX_THREADS];
+	static int				helpers = 0;
+	static int				pending = 0;
+	static uint32			generation = 0;
+	static bool8			quit = FALSE;
+} // namespace filterthreads
+
+using namespace filterthreads;
+
+static inline void RunBand (const SFilterBand &band)
+{
+	if (band.height > 0)
+		band.method(band.src, band.srcPitch, band.dst, band.dstPitch, band.width, band.height);
+}
+
+// helper n always takes band n + 1, the caller keeps band 0
+static void * FilterThread (void *arg)
+{
+	int		n = (int) (intptr_t) arg;
+	uint32	seen = 0;
+
+	pthread_mutex_lock(&lock);
+
+	for (;;)
+	{
+		while (!quit && generation == seen)
+			pthread_cond_wait(&wake, &lock);
+
+		if (quit)
+			break;
+
+		seen = generation;
+		SFilterBand band = bands[n + 1];
+		pthread_mutex_unlock(&lock);
+
+		RunBand(band);
+
+		pthread_mutex_lock(&lock);
+		if (--pending == 0)
+			pthread_cond_signal(&done);
+	}
+
+	pthread_mutex_unlock(&lock);
+	return (NULL);
+}
+
+bool8 InitFilterThreads (int threads)
+{
+	DeinitFilterThreads();
+
+	if (threads > FILTER_MAX_THREADS)
+		threads = FILTER_MAX_THREADS;
+
+	quit = FALSE;
+	generation = 0;
+
+	for (int i = 0; i < threads - 1; i++)
+	{
+		if (pthread_create(&filterthreads::threads[i], NULL, FilterThread, (void *) (intptr_t) i))
+		{
+			DeinitFilterThreads();
+			return (FALSE);
+		}
+
+		helpers++;
+	}
+
+	return (TRUE);
+}
+
+void DeinitFilterThreads (void)
+{
+	if (!helpers)
+		return;
+
+	pthread_mutex_lock(&lock);
+	quit = TRUE;
+	pthread_cond_broadcast(&wake);
+	pthread_mutex_unlock(&lock);
+
+	for (int i = 0; i < helpers; i++)
+		pthread_join(filterthreads::threads[i], NULL);
+
+	helpers = 0;
+}
+
+void RunFilterBands (TFilterMethod method, int scale, uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	if (!helpers)
+	{
+		method(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+		return;
+	}
+
+	int	count = helpers + 1;
+	int	y = 0;
+
+	pthread_mutex_lock(&lock);
+
+	for (int n = 0; n < count; n++)
+	{
+		int	rows = (height - y) / (count - n);
+
+		bands[n].method = method;
+		bands[n].src = srcPtr + y * srcPitch;
+		bands[n].dst = dstPtr + y * scale * dstPitch;
+		bands[n].srcPitch = srcPitch;
+		bands[n].dstPitch = dstPitch;
+		bands[n].width = width;
+		bands[n].height = rows;
+		y += rows;
+	}
+
+	pending = helpers;
+	generation++;
+	pthread_cond_broadcast(&wake);
+	pthread_mutex_unlock(&lock);
+
+	RunBand(bands[0]);
+
+	pthread_mutex_lock(&lock);
+	while (pending)
+		pthread_cond_wait(&done, &lock);
+	pthread_mutex_unlock(&lock);
+}
+
+#else
+
+// the Wii and GameCube have a single core, so bands would only add overhead
+bool8 InitFilterThreads (int threads)
+{
+	return (threads <= 1);
+}
+
+void DeinitFilterThreads (void)
+{
+}
+
+void RunFilterBands (TFilterMethod method, int scale, uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	method(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
+#endif
@@ -0,0 +1,51 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * filterkernels.h
+ *
+ * Video filter kernels and the band scheduler. Nothing in here depends on
+ * libogc, so the host benchmark builds and times the same code.
+ ****************************************************************************/
+
+#ifndef _FILTERKERNELS_H_
+#define _FILTERKERNELS_H_
+
+#include "snes9x/snes9x.h"
+
+enum RenderFilter{
+	FILTER_NONE = 0,
+
+	FILTER_TVMODE,
+	FILTER_SCALE2X,
+	FILTER_2XBR,
+
+	NUM_FILTERS
+};
+
+#define EXT_WIDTH (MAX_SNES_WIDTH + 4)
+#define EXT_PITCH (EXT_WIDTH * 2)
+#define EXT_HEIGHT (MAX_SNES_HEIGHT + 4)
+// Offset into buffer to allow a two pixel border around the whole rendered
+// SNES image. This is a speed up hack to allow some of the image processing
+// routines to access black pixel data outside the normal bounds of the buffer.
+#define EXT_OFFSET (EXT_PITCH * 2 + 2 * 2)
+
+#define FILTER_MAX_THREADS	4
+
+typedef void (*TFilterMethod)(uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height);
+
+const char* GetFilterName (RenderFilter filterID);
+int GetFilterScale(RenderFilter filterID);
+// Also builds the lookup tables the filter needs, so call it when the filter
+// is selected rather than per frame. Returns 0 for FILTER_NONE.
+TFilterMethod FilterToMethod (RenderFilter filterID);
+
+// Splits the image into up to `threads` horizontal bands that are filtered in
+// parallel. Every band reads the rows around it from the source, so the
+// output does not depend on the number of bands. Without helper threads (and
+// always on the single core consoles) the whole image is filtered inline.
+bool8 InitFilterThreads (int threads);
+void DeinitFilterThreads (void);
+void RunFilterBands (TFilterMethod method, int scale, uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height);
+
+#endif
@@ -57,18 +57,15 @@ SaveSnapshot (char * filepath, bool silent)
 		SaveFile((char *)gameScreenPng, screenpath, gameScreenPngSize, silent);
 	}
 
-	STREAM fp = OPEN_STREAM(filepath, "wb");
-	
-	if(!fp)
+	// binary container with deflated sections, LoadSnapshot still reads the
+	// stream format written by earlier versions
+	if(!S9xFreezeGameBinary(filepath, TRUE))
 	{
 		if(!silent)
 			ErrorPrompt("Save failed!");
 		return 0;
 	}
 
-	S9xFreezeToStream(fp);
-	CLOSE_STREAM(fp);
-
 	if(!silent)
 		InfoPrompt("Save successful");
 	return 1;
@@ -96,17 +93,29 @@ LoadSnapshot (char * filepath, bool silent)
 	if(!FindDevice(filepath, &device))
 		return 0;
 
-	STREAM fp = OPEN_STREAM(filepath, "rb");
+	int	result = S9xUnfreezeGameBinary(filepath);
 
-	if(!fp)
+	if (result == FILE_NOT_FOUND)
 	{
 		if(!silent)
 			ErrorPrompt("Unable to open state!");
 		return 0;
 	}
 
-	int	result = S9xUnfreezeFromStream(fp);
-	CLOSE_STREAM(fp);
+	if (result == WRONG_FORMAT)
+	{
+		STREAM fp = OPEN_STREAM(filepath, "rb");
+
+		if(!fp)
+		{
+			if(!silent)
+				ErrorPrompt("Unable to open state!");
+			return 0;
+		}
+
+		result = S9xUnfreezeFromStream(fp);
+		CLOSE_STREAM(fp);
+	}
 
 	if (result == SUCCESS)
 		return 1;
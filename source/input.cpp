@@ -757,9 +757,9 @@ bool MenuRequested()
 	return false;
 }
 
-bool IsFastForwardInputPressed()
+static bool IsSpecialButtonPressed(int button)
 {
-	switch(GCSettings.FastForwardButton)
+	switch(button)
 	{
 		case FASTFORWARD_BUTTON_RSTICK:
 			return (
@@ -850,9 +850,11 @@ void ReportButtons ()
 
 	if (GCSettings.FastForward == 1)
 	{
-		Settings.TurboMode = IsFastForwardInputPressed();
+		Settings.TurboMode = IsSpecialButtonPressed(GCSettings.FastForwardButton);
 	}
 
+	Settings.Rewinding = (GCSettings.Rewind == 1 && IsSpecialButtonPressed(GCSettings.RewindButton));
+
 	if(Settings.TurboMode) {
 		Settings.SoundSync = false;
 	}
@@ -27,6 +27,7 @@
 #include "filebrowser.h"
 #include "gcunzip.h"
 #include "fileop.h"
+#include "romindex.h"
 #include "sram.h"
 #include "freeze.h"
 #include "preferences.h"
@@ -44,6 +45,7 @@
 #include "snes9x/memmap.h"
 #include "snes9x/apu/apu.h"
 #include "snes9x/cheats.h"
+#include "snes9x/rewind.h"
 
 extern SCheatData Cheat;
 extern void ToggleCheat(uint32);
@@ -1051,6 +1053,15 @@ static int MenuGameSelection()
 	GuiTrigger trigPlusMinus;
 	trigPlusMinus.SetButtonOnlyTrigger(-1, WPAD_BUTTON_PLUS | WPAD_CLASSIC_BUTTON_PLUS, PAD_TRIGGER_Z, WIIDRC_BUTTON_PLUS);
 	
+	// search the titles and names of the listed games
+	GuiTrigger trigMinus;
+	trigMinus.SetButtonOnlyTrigger(-1, WPAD_BUTTON_MINUS | WPAD_CLASSIC_BUTTON_MINUS, PAD_BUTTON_Y, WIIDRC_BUTTON_MINUS);
+	GuiButton searchBtn(0, 0);
+	searchBtn.SetTrigger(&trigMinus);
+	searchBtn.SetSelectable(false);
+	buttonWindow.Append(&searchBtn);
+	char searchText[ROM_TITLE_LEN + 1] = "";
+	
 	GuiImage bgPreview(&bgPreviewImg);
 	GuiButton bgPreviewBtn(bgPreview.GetWidth(), bgPreview.GetHeight());
 	bgPreviewBtn.SetImage(&bgPreview);
@@ -1165,6 +1176,34 @@ static int MenuGameSelection()
 			GCSettings.PreviewImage = (GCSettings.PreviewImage + 1) % 3;
 			bgPreviewBtn.ResetState();
 		}
+		else if(searchBtn.GetState() == STATE_CLICKED)
+		{
+			searchBtn.ResetState();
+			OnScreenKeyboard(searchText, sizeof(searchText));
+
+			if(searchText[0])
+			{
+				// the next match after the selected game, then from the top
+				int found = RomIndexFindTitle(searchText, browser.selIndex + 1);
+				if(found < 0)
+					found = RomIndexFindTitle(searchText, 0);
+
+				if(found < 0)
+				{
+					InfoPrompt("No matching game found");
+				}
+				else
+				{
+					HaltGui();
+					SelectBrowserEntry(found);
+					gameBrowser.ResetState();
+					gameBrowser.fileList[browser.selIndex - browser.pageIndex]->SetState(STATE_SELECTED);
+					gameBrowser.TriggerUpdate();
+					mainWindow->ChangeFocus(&gameBrowser);
+					ResumeGui();
+				}
+			}
+		}
 	}
 
 	HaltParseThread(); // halt parsing
@@ -3504,6 +3543,23 @@ static void ScreenPositionWindow()
 	delete(settingText);
 }
 
+/****************************************************************************
+ * SpecialButtonName
+ *
+ * Label for the FASTFORWARD_BUTTON_* values used by fast forward and rewind
+ ***************************************************************************/
+static const char * SpecialButtonName(int button)
+{
+	static const char *names[] = {
+		"Right Stick", "A", "B", "X", "Y", "L", "R", "ZL", "ZR",
+		"Z", "C", "1", "2", "PLUS", "MINUS"
+	};
+
+	if (button < 0 || button > FASTFORWARD_BUTTON_MINUS)
+		return "";
+	return names[button];
+}
+
 static int MenuSettingsFastForward()
 {
 	int menu = MENU_NONE;
@@ -3514,8 +3570,15 @@ static int MenuSettingsFastForward()
 
 	sprintf(options.name[i++], "Fast Forward");
 	sprintf(options.name[i++], "Button");
+	sprintf(options.name[i++], "Rewind");
+	sprintf(options.name[i++], "Rewind Button");
 	options.length = i;
 
+#ifdef HW_DOL
+	options.name[2][0] = 0; // no memory for the rewind history on GameCube
+	options.name[3][0] = 0;
+#endif
+
 	for(i=0; i < options.length; i++)
 		options.value[i][0] = 0;
 
@@ -3523,7 +3586,7 @@ static int MenuSettingsFastForward()
 	titleTxt.SetAlignment(ALIGN_LEFT, ALIGN_TOP);
 	titleTxt.SetPosition(50,30);
 
-	GuiText subtitleTxt("Fast Forward", 20, (GXColor){255, 255, 255, 255});
+	GuiText subtitleTxt("Fast Forward / Rewind", 20, (GXColor){255, 255, 255, 255});
 	subtitleTxt.SetAlignment(ALIGN_LEFT, ALIGN_TOP);
 	subtitleTxt.SetPosition(50,60);
 
@@ -3582,9 +3645,19 @@ static int MenuSettingsFastForward()
 
 			case 1:
 				GCSettings.FastForwardButton++;
-				if (GCSettings.FastForwardButton > 14)
+				if (GCSettings.FastForwardButton > FASTFORWARD_BUTTON_MINUS)
 					GCSettings.FastForwardButton = 0;
 				break;
+
+			case 2:
+				GCSettings.Rewind ^= 1;
+				break;
+
+			case 3:
+				GCSettings.RewindButton++;
+				if (GCSettings.RewindButton > FASTFORWARD_BUTTON_MINUS)
+					GCSettings.RewindButton = 0;
+				break;
 		}
 
 		if(ret >= 0 || firstRun)
@@ -3592,39 +3665,12 @@ static int MenuSettingsFastForward()
 			firstRun = false;
 			sprintf (options.value[0], "%s", GCSettings.FastForward == 1 ? "On" : "Off");
 
-			switch(GCSettings.FastForwardButton)
-			{
-				case 0:
-					sprintf (options.value[1], "Right Stick"); break;
-				case 1:
-					sprintf (options.value[1], "A"); break;
-				case 2:
-					sprintf (options.value[1], "B"); break;
-				case 3:
-					sprintf (options.value[1], "X"); break;
-				case 4:
-					sprintf (options.value[1], "Y"); break;
-				case 5:
-					sprintf (options.value[1], "L"); break;
-				case 6:
-					sprintf (options.value[1], "R"); break;
-				case 7:
-					sprintf (options.value[1], "ZL"); break;
-				case 8:
-					sprintf (options.value[1], "ZR"); break;
-				case 9:
-					sprintf (options.value[1], "Z"); break;
-				case 10:
-					sprintf (options.value[1], "C"); break;
-				case 11:
-					sprintf (options.value[1], "1"); break;
-				case 12:
-					sprintf (options.value[1], "2"); break;
-				case 13:
-					sprintf (options.value[1], "PLUS"); break;
-				case 14:
-					sprintf (options.value[1], "MINUS"); break;
-			}
+			sprintf (options.value[1], "%s", SpecialButtonName(GCSettings.FastForwardButton));
+			if (GCSettings.Rewind == 1)
+				sprintf (options.value[2], "On (%dx speed)", REWIND_DEFAULT_INTERVAL);
+			else
+				sprintf (options.value[2], "Off");
+			sprintf (options.value[3], "%s", SpecialButtonName(GCSettings.RewindButton));
 
 			optionBrowser.TriggerUpdate();
 		}
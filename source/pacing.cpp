@@ -0,0 +1,214 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * pacing.cpp
+ *
+ * Frame pacing and frame skip controller
+ *
+ * The cost of the last frames, drawn and not drawn, is kept in two rolling
+ * histograms. Before a frame starts, the cost it is likely to have (a high
+ * percentile of the drawn frames) is held against the time left to its
+ * deadline, so drawing is skipped before the deadline is missed rather than
+ * after. Times are in microseconds throughout.
+ ***************************************************************************/
+
+#include <string.h>
+
+#include "pacing.h"
+
+#define PACING_WINDOW		64		// frames each histogram covers
+#define PACING_BUCKET		128		// usec per histogram bucket
+#define PACING_BUCKETS		256		// costs past the last bucket land in it
+#define PACING_PERCENTILE	90
+#define PACING_MIN_SAMPLES	8		// drawn frames needed before predicting from them
+#define PACING_MAX_SKIP		3		// predicted skips in a row, missed deadlines may skip more
+#define PACING_RESYNC		4		// frames behind at which the schedule is restarted
+#define PACING_AUDIO_NUDGE	0.995	// slows the audio down while the frames run late
+
+typedef struct
+{
+	u16 count[PACING_BUCKETS];
+	u8 sample[PACING_WINDOW];	// the bucket of each frame in the window
+	int next;
+	int used;
+} CostHistogram;
+
+static CostHistogram drawn;
+static CostHistogram undrawn;
+static PacingStats stats;
+
+static u32 frameTime;
+static u64 deadline;		// when the current frame should end, 0 until known
+static u64 frameStart;
+static u32 skipRun;			// frames skipped in a row
+static u32 jitterSum;		// 16 times the running average of the jitter
+static bool late;			// the current frame is not expected to make its deadline
+
+static void HistogramAdd (CostHistogram *h, u64 cost)
+{
+	u32 bucket = cost / PACING_BUCKET;
+
+	if (bucket >= PACING_BUCKETS)
+		bucket = PACING_BUCKETS - 1;
+
+	if (h->used == PACING_WINDOW)
+		h->count[h->sample[h->next]]--;
+	else
+		h->used++;
+
+	h->sample[h->next] = bucket;
+	h->count[bucket]++;
+	h->next = (h->next + 1) % PACING_WINDOW;
+}
+
+// rounds up to the end of the bucket, the prediction errs on the slow side
+static u32 HistogramPercentile (const CostHistogram *h)
+{
+	int want = (h->used * PACING_PERCENTILE + 99) / 100;
+	int seen = 0;
+
+	if (h->used == 0)
+		return 0;
+
+	for (int b = 0; b < PACING_BUCKETS; b++)
+	{
+		seen += h->count[b];
+		if (seen >= want)
+			return (b + 1) * PACING_BUCKET;
+	}
+
+	return PACING_BUCKETS * PACING_BUCKET;
+}
+
+/****************************************************************************
+ * PacingReset
+ *
+ * Forgets the costs and the schedule, when emulation (re)starts
+ ***************************************************************************/
+void PacingReset (u64 now)
+{
+	memset(&drawn, 0, sizeof(drawn));
+	memset(&undrawn, 0, sizeof(undrawn));
+	memset(&stats, 0, sizeof(stats));
+	deadline = 0;
+	frameStart = now;
+	skipRun = 0;
+	jitterSum = 0;
+	late = false;
+}
+
+/****************************************************************************
+ * PacingEndFrame
+ *
+ * A frameTime of 0 runs unpaced (turbo), every frame is then behind and
+ * skipped up to the skip limit.
+ ***************************************************************************/
+u32 PacingEndFrame (u64 now, u32 target, bool rendered)
+{
+	HistogramAdd(rendered ? &drawn : &undrawn, now - frameStart);
+
+	stats.frames++;
+	if (rendered)
+		stats.rendered++;
+	else
+		stats.skipped++;
+
+	frameTime = target;
+
+	if (frameTime == 0 || deadline == 0)
+	{
+		deadline = frameTime ? frameStart + frameTime : now;
+		if (frameTime == 0)
+			return 0;
+	}
+
+	if (now <= deadline)
+		return deadline - now;
+
+	stats.missed++;
+
+	// too far behind to catch up without a burst of frames, start over from here
+	if (now - deadline > (u64) PACING_RESYNC * frameTime)
+	{
+		deadline = now;
+		stats.resyncs++;
+	}
+
+	return 0;
+}
+
+/****************************************************************************
+ * PacingRetrace
+ *
+ * With the display paced by vertical sync, the frame that just ended was due
+ * at the retrace that was waited for.
+ ***************************************************************************/
+void PacingRetrace (u64 now)
+{
+	deadline = now;
+}
+
+/****************************************************************************
+ * PacingStartFrame
+ ***************************************************************************/
+bool PacingStartFrame (u64 now, u32 skipLimit)
+{
+	if (frameTime && stats.frames > 1)
+	{
+		u32 period = now - frameStart;
+		u32 deviation = (period > frameTime) ? period - frameTime : frameTime - period;
+
+		jitterSum += deviation - jitterSum / 16;
+		stats.jitter = jitterSum / 16;
+	}
+
+	frameStart = now;
+	deadline += frameTime;
+
+	s64 budget = (s64) deadline - (s64) now;
+	u32 drawCost = HistogramPercentile(&drawn);
+	u32 emulateCost = HistogramPercentile(&undrawn);
+	bool render = true;
+
+	if (skipRun < skipLimit)
+	{
+		if (budget <= 0)
+		{
+			// already behind, whatever the frame costs
+			render = false;
+		}
+		else if (drawn.used >= PACING_MIN_SAMPLES && drawCost > budget && skipRun < PACING_MAX_SKIP)
+		{
+			render = false;
+			stats.predicted++;
+		}
+	}
+
+	skipRun = render ? 0 : skipRun + 1;
+
+	// a frame that will be late either way produces its sound late too
+	late = frameTime && (budget < (s64) (render ? drawCost : emulateCost));
+	if (late)
+		stats.nudged++;
+
+	stats.drawCost = drawCost;
+	stats.emulateCost = emulateCost;
+
+	return render;
+}
+
+/****************************************************************************
+ * PacingAudioRate
+ *
+ * Multiplier for the audio resampling rate, below 1 while the frames run
+ * late so the sound buffer does not run dry before they catch up
+ ***************************************************************************/
+double PacingAudioRate ()
+{
+	return late ? PACING_AUDIO_NUDGE : 1.0;
+}
+
+void PacingGetStats (PacingStats *s)
+{
+	*s = stats;
+}
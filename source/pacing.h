@@ -0,0 +1,38 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * pacing.h
+ *
+ * Frame pacing and frame skip controller
+ ***************************************************************************/
+
+#ifndef _PACING_H_
+#define _PACING_H_
+
+#include <gctypes.h>
+
+typedef struct
+{
+	u32 frames;			// frames paced since emulation (re)started
+	u32 rendered;
+	u32 skipped;		// frames emulated without drawing them
+	u32 predicted;		// of those, skipped because the frame would not have fit
+	u32 missed;			// frames that ended past their deadline
+	u32 resyncs;		// times the schedule was given up on and restarted
+	u32 nudged;			// frames the audio rate was nudged for
+	u32 jitter;			// average deviation of the frame period from the target, usec
+	u32 drawCost;		// predicted cost of a drawn frame, usec
+	u32 emulateCost;	// predicted cost of a frame that is not drawn, usec
+} PacingStats;
+
+void PacingReset (u64 now);
+// Records the frame that just ended and returns how long to sleep until its deadline
+u32 PacingEndFrame (u64 now, u32 frameTime, bool rendered);
+// Starts the next frame and returns whether to draw it
+bool PacingStartFrame (u64 now, u32 skipLimit);
+// Restarts the schedule from a display retrace
+void PacingRetrace (u64 now);
+double PacingAudioRate ();
+void PacingGetStats (PacingStats *stats);
+
+#endif
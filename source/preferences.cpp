@@ -185,6 +185,8 @@ preparePrefsData ()
 	createXMLSetting("Controller", "Controller", toStr(GCSettings.Controller));
 	createXMLSetting("FastForward", "Fast Forward", toStr(GCSettings.FastForward));
 	createXMLSetting("FastForwardButton", "Fast Forward Button", toStr(GCSettings.FastForwardButton));
+	createXMLSetting("Rewind", "Rewind", toStr(GCSettings.Rewind));
+	createXMLSetting("RewindButton", "Rewind Button", toStr(GCSettings.RewindButton));
 
 	createXMLController(btnmap[CTRL_PAD][CTRLR_GCPAD], "btnmap_pad_gcpad", "SNES Pad - GameCube Controller");
 #ifdef HW_RVL
@@ -378,6 +380,8 @@ decodePrefsData ()
 			loadXMLSetting(&GCSettings.Controller, "Controller");
 			loadXMLSetting(&GCSettings.FastForward, "FastForward");
 			loadXMLSetting(&GCSettings.FastForwardButton, "FastForwardButton");
+			loadXMLSetting(&GCSettings.Rewind, "Rewind");
+			loadXMLSetting(&GCSettings.RewindButton, "RewindButton");
 
 			loadXMLController(btnmap[CTRL_PAD][CTRLR_GCPAD], "btnmap_pad_gcpad");
 			loadXMLController(btnmap[CTRL_PAD][CTRLR_WIIMOTE], "btnmap_pad_wiimote");
@@ -447,6 +451,8 @@ DefaultSettings ()
 	GCSettings.Controller = CTRL_PAD2; // SNES Controllers, Super Scope, Konami Justifier, SNES Mouse
 	GCSettings.FastForward = 1; // Enabled by default
 	GCSettings.FastForwardButton = 0; // Right analog stick
+	GCSettings.Rewind = 0; // Disabled by default
+	GCSettings.RewindButton = FASTFORWARD_BUTTON_ZL;
 
 	GCSettings.videomode = 0; // Automatic video mode detection
 	GCSettings.render = 0; // Default rendering mode
@@ -553,6 +559,8 @@ DefaultSettings ()
 
 	GCSettings.cpuOverclock = 0;
 	/* Initialize CPU to normal speed by default */
+	Settings.CPUBlockCache = true;
+	Settings.SA1Quantum = 1;
 	Settings.OneClockCycle = 6;
 	Settings.OneSlowClockCycle = 8;
 	Settings.TwoClockCycles = 12;
@@ -0,0 +1,497 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * romindex.cpp
+ *
+ * Per-directory index of the file browser entries
+ *
+ * The entries of each ROM directory that was browsed are kept in a file
+ * under the app folder, with the size and time of every ROM and what was
+ * read from it: copier header, internal title, CRC32 and SHA-256. When the
+ * directory's modification time is the one the index was made at and it
+ * still holds the names in the index, the browser list is restored from the
+ * index without looking at each file. Otherwise the directory is listed
+ * again. Either way, only the ROMs whose size or time changed are reread.
+ ***************************************************************************/
+
+#include <gccore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "snes9xtx.h"
+#include "fileop.h"
+#include "romindex.h"
+#include "snes9x/sha256.h"
+
+#define INDEX_MAGIC		"S9XI"
+#define INDEX_VERSION	1
+#define INDEX_FOLDER	"cache"
+#define INDEX_CHUNK		(32 * 1024)	// read size when hashing a ROM
+
+typedef struct
+{
+	char magic[4];
+	u32 version;
+	u32 dirTime;	// modification time of the directory the index was made from
+	u32 count;
+	u16 dirLength;	// the directory path follows, directories can share a file name
+	u16 pad;
+} INDEXHEADER;
+
+typedef struct
+{
+	u32 length;
+	u32 mtime;
+	u32 crc32;
+	u8 sha256[32];
+	char title[ROM_TITLE_LEN + 1];
+	u8 isdir;
+	u8 romInfo;
+	u8 nameLength;	// the name follows, without a terminator
+} INDEXRECORD;
+
+static char indexPath[MAXPATHLEN];	// empty when no directory is open
+static char indexDir[MAXPATHLEN];
+static u32 indexDirTime;
+static u8 *indexData = NULL;		// the index file as it was loaded
+static u8 **indexRecords = NULL;	// its records in file order
+static u8 **indexByName = NULL;		// and sorted by name
+static int indexCount = 0;
+
+// offsets of the LoROM, HiROM and ExHiROM headers
+static const u32 headerOffset[3] = { 0x7FC0, 0xFFC0, 0x40FFC0 };
+
+static int CompareName (const char *a, int alen, const char *b, int blen)
+{
+	int c = memcmp(a, b, alen < blen ? alen : blen);
+	return c ? c : alen - blen;
+}
+
+static int RecordSortCallback (const void *p1, const void *p2)
+{
+	const u8 *r1 = *(u8 * const *) p1;
+	const u8 *r2 = *(u8 * const *) p2;
+
+	return CompareName((const char *) r1 + sizeof(INDEXRECORD), r1[offsetof(INDEXRECORD, nameLength)],
+		(const char *) r2 + sizeof(INDEXRECORD), r2[offsetof(INDEXRECORD, nameLength)]);
+}
+
+void RomIndexClose ()
+{
+	free(indexData);
+	free(indexRecords);
+	free(indexByName);
+	indexData = NULL;
+	indexRecords = NULL;
+	indexByName = NULL;
+	indexCount = 0;
+	indexPath[0] = 0;
+}
+
+/****************************************************************************
+ * RomIndexOpen
+ *
+ * A directory time of 0 is taken as unknown and never matches
+ ***************************************************************************/
+bool RomIndexOpen (const char *dir, u32 dirTime)
+{
+	RomIndexClose();
+
+	if(appPath[0] == 0)
+		return false;
+
+	snprintf(indexDir, MAXPATHLEN, "%s", dir);
+	snprintf(indexPath, MAXPATHLEN, "%s/%s/%08lx.idx", appPath, INDEX_FOLDER,
+		(unsigned long) crc32(0, (const Bytef *) dir, strlen(dir)));
+	indexDirTime = dirTime;
+
+	FILE *f = fopen(indexPath, "rb");
+	if(!f)
+		return false;
+
+	fseeko(f, 0, SEEK_END);
+	size_t size = ftello(f);
+	fseeko(f, 0, SEEK_SET);
+
+	if(size >= sizeof(INDEXHEADER))
+	{
+		indexData = (u8 *) malloc(size);
+		if(indexData && fread(indexData, 1, size, f) != size)
+		{
+			free(indexData);
+			indexData = NULL;
+		}
+	}
+	fclose(f);
+
+	if(!indexData)
+		return false;
+
+	INDEXHEADER header;
+	memcpy(&header, indexData, sizeof(header));
+
+	size_t pos = sizeof(header) + header.dirLength;
+
+	if(memcmp(header.magic, INDEX_MAGIC, 4) != 0 || header.version != INDEX_VERSION ||
+		header.count > MAX_BROWSER_SIZE || pos > size ||
+		CompareName((const char *) indexData + sizeof(header), header.dirLength, dir, strlen(dir)) != 0)
+	{
+		free(indexData);
+		indexData = NULL;
+		return false;
+	}
+
+	indexRecords = (u8 **) malloc(sizeof(u8 *) * (header.count + 1));
+	indexByName = (u8 **) malloc(sizeof(u8 *) * (header.count + 1));
+
+	if(!indexRecords || !indexByName)
+	{
+		free(indexData);
+		free(indexRecords);
+		free(indexByName);
+		indexData = NULL;
+		indexRecords = NULL;
+		indexByName = NULL;
+		return false;
+	}
+
+	for(u32 i = 0; i < header.count; i++)
+	{
+		if(pos + sizeof(INDEXRECORD) > size ||
+			pos + sizeof(INDEXRECORD) + indexData[pos + offsetof(INDEXRECORD, nameLength)] > size)
+			break; // truncated, keep what is there
+
+		indexRecords[indexCount++] = indexData + pos;
+		pos += sizeof(INDEXRECORD) + indexData[pos + offsetof(INDEXRECORD, nameLength)];
+	}
+
+	memcpy(indexByName, indexRecords, sizeof(u8 *) * indexCount);
+	qsort(indexByName, indexCount, sizeof(u8 *), RecordSortCallback);
+
+	return (dirTime != 0 && header.dirTime == dirTime && indexCount == (int) header.count);
+}
+
+bool RomIndexMatches (int count, u32 nameSum)
+{
+	for(int i = 0; i < indexCount; i++)
+	{
+		const char *name = (const char *) indexRecords[i] + sizeof(INDEXRECORD);
+		int len = indexRecords[i][offsetof(INDEXRECORD, nameLength)];
+
+		if(CompareName(name, len, "..", 2) == 0)
+			continue;
+
+		count--;
+		nameSum -= crc32(0, (const Bytef *) name, len);
+	}
+	return (count == 0 && nameSum == 0);
+}
+
+int RomIndexCount ()
+{
+	return indexCount;
+}
+
+static void RecordToEntry (const u8 *data, BROWSERENTRY *entry)
+{
+	INDEXRECORD r;
+	memcpy(&r, data, sizeof(r));
+
+	memcpy(entry->filename, data + sizeof(r), r.nameLength);
+	entry->filename[r.nameLength] = 0;
+	entry->isdir = r.isdir;
+	entry->length = r.length;
+	entry->mtime = r.mtime;
+	entry->romInfo = r.romInfo;
+	memcpy(entry->title, r.title, sizeof(entry->title));
+	entry->title[ROM_TITLE_LEN] = 0;
+	entry->crc32 = r.crc32;
+	memcpy(entry->sha256, r.sha256, sizeof(entry->sha256));
+}
+
+void RomIndexGet (int i, BROWSERENTRY *entry)
+{
+	RecordToEntry(indexRecords[i], entry);
+}
+
+void RomIndexLookup (BROWSERENTRY *entry)
+{
+	int len = strlen(entry->filename);
+	int lo = 0, hi = indexCount - 1;
+
+	while(lo <= hi)
+	{
+		int mid = (lo + hi) / 2;
+		const u8 *r = indexByName[mid];
+		int c = CompareName(entry->filename, len, (const char *) r + sizeof(INDEXRECORD),
+			r[offsetof(INDEXRECORD, nameLength)]);
+
+		if(c == 0)
+		{
+			int isdir = entry->isdir;
+			RecordToEntry(r, entry);
+			entry->isdir = isdir; // the directory is right about what it holds
+			return;
+		}
+
+		if(c < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+}
+
+/****************************************************************************
+ * ScoreHeader
+ *
+ * How much the 32 bytes at a header offset look like a cartridge header
+ ***************************************************************************/
+static int ScoreHeader (const u8 *h, int kind)
+{
+	int score = 0;
+	int map = h[0x15] & ~0x10; // without the FastROM bit
+
+	if(((h[0x1C] | (h[0x1D] << 8)) ^ (h[0x1E] | (h[0x1F] << 8))) == 0xFFFF)
+		score += 4;
+
+	if((kind == 0 && (map == 0x20 || map == 0x22 || map == 0x23 || map == 0x2A)) ||
+		(kind == 1 && (map == 0x21 || map == 0x2A)) ||
+		(kind == 2 && map == 0x25))
+		score += 2;
+
+	for(int i = 0; i < ROM_TITLE_LEN; i++)
+	{
+		if(h[i] < 0x20 || h[i] > 0x7E)
+			return score;
+	}
+	return score + 1;
+}
+
+static void ReadTitle (const u8 headers[3][32], u32 romSize, char *title)
+{
+	int best = -1, bestScore = 0;
+
+	for(int k = 0; k < 3; k++)
+	{
+		if(headerOffset[k] + 32 > romSize)
+			break;
+
+		int score = ScoreHeader(headers[k], k);
+		if(score > bestScore)
+		{
+			best = k;
+			bestScore = score;
+		}
+	}
+
+	title[0] = 0;
+	if(best < 0)
+		return;
+
+	int len = 0;
+	for(int i = 0; i < ROM_TITLE_LEN; i++)
+	{
+		u8 c = headers[best][i];
+		title[i] = (c >= 0x20 && c <= 0x7E) ? c : ' ';
+		if(title[i] != ' ')
+			len = i + 1;
+	}
+	title[len] = 0;
+}
+
+static bool IsArchive (const char *filename)
+{
+	const char *ext = strrchr(filename, '.');
+	return (ext && (strcasecmp(ext, ".zip") == 0 || strcasecmp(ext, ".7z") == 0));
+}
+
+/****************************************************************************
+ * ReadRomInfo
+ *
+ * Reads the whole ROM once for the hashes, picking up the header candidates
+ * on the way. The hashes leave out a copier header, like Memory.ROMCRC32.
+ ***************************************************************************/
+static bool ReadRomInfo (const char *path, BROWSERENTRY *entry, const bool *halt)
+{
+	FILE *f = fopen(path, "rb");
+	if(!f)
+		return false;
+
+	u8 *buf = (u8 *) malloc(INDEX_CHUNK);
+	if(!buf)
+	{
+		fclose(f);
+		return false;
+	}
+
+	u32 header = (entry->length % 1024 == 512) ? 512 : 0;
+	u8 headers[3][32];
+	uLong crc = crc32(0, Z_NULL, 0);
+	SHA256_CTX sha;
+	u32 pos = 0;
+	size_t n;
+
+	memset(headers, 0, sizeof(headers));
+	sha256_init(&sha);
+
+	while(!*halt && (n = fread(buf, 1, INDEX_CHUNK, f)) > 0)
+	{
+		u32 skip = 0;
+		if(pos < header)
+			skip = (header - pos < n) ? header - pos : n;
+
+		const u8 *data = buf + skip;
+		u32 len = n - skip;
+		u32 romPos = pos + skip - header;
+
+		crc = crc32(crc, data, len);
+		sha256_update(&sha, data, len);
+
+		for(int k = 0; k < 3; k++)
+		{
+			u32 from = headerOffset[k] > romPos ? headerOffset[k] : romPos;
+			u32 to = headerOffset[k] + 32 < romPos + len ? headerOffset[k] + 32 : romPos + len;
+
+			if(from < to)
+				memcpy(headers[k] + from - headerOffset[k], data + from - romPos, to - from);
+		}
+
+		pos += n;
+	}
+
+	fclose(f);
+	free(buf);
+
+	if(*halt)
+		return false;
+
+	entry->crc32 = crc;
+	sha256_final(&sha, entry->sha256);
+	ReadTitle(headers, pos > header ? pos - header : 0, entry->title);
+	entry->romInfo = ROMINFO_VALID | (header ? ROMINFO_HEADER : 0);
+	return true;
+}
+
+bool RomIndexUpdate (BROWSERENTRY *entry, const bool *halt)
+{
+	if(entry->isdir || (entry->romInfo & ROMINFO_CHECKED))
+		return false;
+
+	char path[MAXPATHLEN];
+	struct stat st;
+
+	snprintf(path, MAXPATHLEN, "%s%s", indexDir, entry->filename);
+	if(stat(path, &st) != 0)
+		return false;
+
+	if((entry->romInfo & (ROMINFO_VALID | ROMINFO_ARCHIVE)) &&
+		entry->length == (size_t) st.st_size && entry->mtime == (u32) st.st_mtime)
+	{
+		entry->romInfo |= ROMINFO_CHECKED;
+		return false;
+	}
+
+	BROWSERENTRY e = *entry;
+	e.length = st.st_size;
+	e.mtime = st.st_mtime;
+	e.romInfo = 0;
+	e.title[0] = 0;
+	e.crc32 = 0;
+	memset(e.sha256, 0, sizeof(e.sha256));
+
+	if(IsArchive(entry->filename))
+		e.romInfo = ROMINFO_ARCHIVE;
+	else if(!ReadRomInfo(path, &e, halt))
+		return false;
+
+	e.romInfo |= ROMINFO_CHECKED;
+	*entry = e;
+	return true;
+}
+
+/****************************************************************************
+ * RomIndexSave
+ *
+ * Made at the directory time it was opened with, so a directory that
+ * changed while it was read is read again next time
+ ***************************************************************************/
+bool RomIndexSave (bool complete)
+{
+	if(indexPath[0] == 0)
+		return false;
+
+	char folder[MAXPATHLEN];
+	snprintf(folder, MAXPATHLEN, "%s/%s", appPath, INDEX_FOLDER);
+	if(!CreateDirectory(folder))
+		return false;
+
+	FILE *f = fopen(indexPath, "wb");
+	if(!f)
+		return false;
+
+	INDEXHEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDEX_MAGIC, 4);
+	header.version = INDEX_VERSION;
+	header.dirTime = complete ? indexDirTime : 0;
+	header.count = browser.numEntries;
+	header.dirLength = strlen(indexDir);
+
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+		fwrite(indexDir, 1, header.dirLength, f) == header.dirLength;
+
+	for(int i = 0; ok && i < browser.numEntries; i++)
+	{
+		const BROWSERENTRY *e = &browserList[i];
+		INDEXRECORD r;
+
+		memset(&r, 0, sizeof(r));
+		r.length = e->length;
+		r.mtime = e->mtime;
+		r.crc32 = e->crc32;
+		memcpy(r.sha256, e->sha256, sizeof(r.sha256));
+		memcpy(r.title, e->title, sizeof(r.title));
+		r.isdir = e->isdir;
+		r.romInfo = e->romInfo & ~ROMINFO_CHECKED;
+		r.nameLength = strlen(e->filename);
+
+		ok = fwrite(&r, sizeof(r), 1, f) == 1 &&
+			fwrite(e->filename, 1, r.nameLength, f) == r.nameLength;
+	}
+
+	fclose(f);
+
+	if(!ok)
+		remove(indexPath);
+
+	return ok;
+}
+
+static bool ContainsNoCase (const char *s, const char *text)
+{
+	int len = strlen(text);
+
+	for(; *s; s++)
+	{
+		if(strncasecmp(s, text, len) == 0)
+			return true;
+	}
+	return (len == 0);
+}
+
+int RomIndexFindTitle (const char *text, int start)
+{
+	for(int i = start < 0 ? 0 : start; i < browser.numEntries; i++)
+	{
+		if(browserList[i].isdir)
+			continue;
+
+		if(ContainsNoCase(browserList[i].title, text) || ContainsNoCase(browserList[i].displayname, text))
+			return i;
+	}
+	return -1;
+}
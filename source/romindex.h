@@ -0,0 +1,42 @@
+/****************************************************************************
+ * Snes9x Nintendo Wii/GameCube Port
+ *
+ * romindex.h
+ *
+ * Per-directory index of the file browser entries
+ ***************************************************************************/
+
+#ifndef _ROMINDEX_H_
+#define _ROMINDEX_H_
+
+#include "filebrowser.h"
+
+enum
+{
+	ROMINFO_VALID	= 0x01,	// title and hashes were read from the ROM
+	ROMINFO_HEADER	= 0x02,	// the file starts with a 512 byte copier header
+	ROMINFO_ARCHIVE	= 0x04,	// zip or 7z, only the size and time are indexed
+	ROMINFO_CHECKED	= 0x80	// size and time confirmed this visit, not saved
+};
+
+// Loads the index of a directory, returns whether it is still current
+bool RomIndexOpen (const char *dir, u32 dirTime);
+void RomIndexClose ();
+// Whether the loaded index holds count entries besides "..", whose names
+// have CRC32s that add up to nameSum
+bool RomIndexMatches (int count, u32 nameSum);
+// Entries of the loaded index, in browser order
+int RomIndexCount ();
+void RomIndexGet (int i, BROWSERENTRY *entry);
+// Copies what the index knows about an entry that was read from the directory
+void RomIndexLookup (BROWSERENTRY *entry);
+// Checks an entry against its file and rereads the ROM if it changed,
+// returns whether the entry changed. Gives up when *halt is set.
+bool RomIndexUpdate (BROWSERENTRY *entry, const bool *halt);
+// Writes browserList out as the index of the open directory. Unless every
+// entry was checked it is saved out of date, so the next visit checks them.
+bool RomIndexSave (bool complete);
+// Next entry from start whose title or name contains text, -1 if none
+int RomIndexFindTitle (const char *text, int start);
+
+#endif
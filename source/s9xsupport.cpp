@@ -23,6 +23,7 @@
 #include "snes9xtx.h"
 #include "video.h"
 #include "audio.h"
+#include "pacing.h"
 #include "snes9x/snes9x.h"
 #include "snes9x/memmap.h"
 #include "snes9x/display.h"
@@ -31,9 +32,6 @@
 
 #define MAX_MESSAGE_LEN (36 * 3)
 
-static long long prev;
-static long long now;
-
 /*** Miscellaneous Functions ***/
 void S9xExit()
 {
@@ -80,7 +78,7 @@ bool8 S9xOpenSoundDevice(void)
 void S9xInitSync()
 {
 	FrameTimer = 0;
-	prev = gettime();
+	PacingReset(ticks_to_microsecs(gettime()));
 }
 
 /*** Synchronisation ***/
@@ -91,60 +89,35 @@ void S9xSyncSpeed () {
 	if (Settings.TurboMode)
 		skipFrms = Settings.TurboSkipFrames;
 
+	unsigned int frameTime = Settings.TurboMode ? 0 : Settings.FrameTime;
+	u32 wait = PacingEndFrame(ticks_to_microsecs(gettime()), frameTime, IPPU.RenderThisFrame);
+
 	if (timerstyle == 0) /* use Wii vertical sync (VSYNC) with NTSC roms */
 	{
-		while (FrameTimer == 0)
+		if (FrameTimer == 0)
 		{
-			usleep(50);
+			/*** Ahead - sleep until the retrace ***/
+			while (FrameTimer == 0)
+				VIDEO_WaitVSync();
+
+			PacingRetrace(ticks_to_microsecs(gettime()));
 		}
 
 		if (FrameTimer > skipFrms)
 			FrameTimer = skipFrms;
-
-		if ((FrameTimer > 1) && (IPPU.SkippedFrames < skipFrms))
-		{
-			IPPU.SkippedFrames++;
-			IPPU.RenderThisFrame = FALSE;
-		}
-		else
-		{
-			IPPU.SkippedFrames = 0;
-			IPPU.RenderThisFrame = TRUE;
-		}
 	}
-	else /* use internal timer for PAL roms */
+	else if (wait) /* use internal timer for PAL roms */
 	{
-		unsigned int timediffallowed = Settings.TurboMode ? 0 : Settings.FrameTime;
-		now = gettime();
+		/*** Ahead - so hold up ***/
+		usleep(wait);
+	}
 
-		if (diff_usec(prev, now) > timediffallowed)
-		{
-			/* Timer has already expired */
-			if (IPPU.SkippedFrames < skipFrms)
-			{
-				IPPU.SkippedFrames++;
-				IPPU.RenderThisFrame = FALSE;
-			}
-			else
-			{
-				IPPU.SkippedFrames = 0;
-				IPPU.RenderThisFrame = TRUE;
-			}
-		}
-		else
-		{
-			/*** Ahead - so hold up ***/
-			while (diff_usec(prev, now) < timediffallowed)
-			{
-				now = gettime();
-				usleep(50);
-			}
-			IPPU.RenderThisFrame = TRUE;
-			IPPU.SkippedFrames = 0;
-		}
+	IPPU.RenderThisFrame = PacingStartFrame(ticks_to_microsecs(gettime()), skipFrms);
 
-		prev = now;
-	}
+	if (IPPU.RenderThisFrame)
+		IPPU.SkippedFrames = 0;
+	else
+		IPPU.SkippedFrames++;
 
 	if (!Settings.TurboMode)
 		FrameTimer--;
@@ -2,6 +2,8 @@
 
 // snes_spc 0.9.0. http://www.slack.net/~ant/
 
+#include "../snes9x.h"
+#include "../profile.h"
 #include "SNES_SPC.h"
 
 #include <string.h>
@@ -123,7 +125,9 @@ void SNES_SPC::enable_rom( int enable )
 		{\
 			int clock_count = (count & ~(clocks_per_sample - 1)) + clocks_per_sample;\
 			m.dsp_time += clock_count;\
+			PROFILE_SAMPLE_BEGIN( dsp_start, PROFILE_DSP );\
 			dsp.run( clock_count );\
+			PROFILE_SAMPLE_END( dsp_start, PROFILE_DSP );\
 		}
 #else
 	#define RUN_DSP( time, offset ) \
@@ -132,7 +136,9 @@ void SNES_SPC::enable_rom( int enable )
 			if ( !SPC_MORE_ACCURACY || count )\
 			{\
 				m.dsp_time = (time);\
+				PROFILE_SAMPLE_BEGIN( dsp_start, PROFILE_DSP );\
 				dsp.run( count );\
+				PROFILE_SAMPLE_END( dsp_start, PROFILE_DSP );\
 			}\
 		}
 #endif
@@ -5,11 +5,20 @@
 \*****************************************************************************/
 
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef USE_APU_THREAD
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
 #include "../snes9x.h"
 #include "apu.h"
 #include "../msu1.h"
 #include "../snapshot.h"
 #include "../display.h"
+#include "../profile.h"
 #include "resampler.h"
 
 #define APU_DEFAULT_INPUT_RATE		32040
@@ -41,6 +50,7 @@ namespace spc
 
 	static bool8		sound_in_sync   = TRUE;
 	static bool8		sound_enabled   = FALSE;
+	static bool8		hold_samples    = FALSE;
 
 	static int			buffer_size;
 	static int			lag_master      = 0;
@@ -73,6 +83,326 @@ namespace msu
 	static uint8		*resample_buffer		= NULL;
 } // namespace msu
 
+// dest += src, clamped instead of wrapping around when a loud MSU-1 track meets loud DSP output
+static void MixSaturate (int16 *dest, const int16 *src, int32 count)
+{
+	int32	i = 0;
+
+#ifdef __SSE2__
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i	d = _mm_loadu_si128((const __m128i *) (dest + i));
+		__m128i	s = _mm_loadu_si128((const __m128i *) (src + i));
+		_mm_storeu_si128((__m128i *) (dest + i), _mm_adds_epi16(d, s));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		int32	sum = dest[i] + src[i];
+
+		if (sum > 32767)
+			sum = 32767;
+		else
+		if (sum < -32768)
+			sum = -32768;
+
+		dest[i] = sum;
+	}
+}
+
+#ifdef USE_APU_THREAD
+/*
+  APU thread.
+
+  SNES_SPC and SPC_DSP can run on a thread of their own. The CPU thread still
+  keeps the APU clock (reference_time/remainder) and turns every port access
+  and scanline end into a command stamped with the SPC time it happens at, so
+  the SPC sees exactly the same sequence of run_until/port accesses as it does
+  when driven directly. Commands go through a single producer/single consumer
+  ring; only port reads and direct accesses to spc_core (savestates, resets,
+  settings) wait for the thread to catch up. The CPU thread also waits when
+  it gets APU_THREAD_MAX_LAG scanlines ahead, so the samples keep arriving
+  at the pace the sound output expects.
+
+  At every scanline end the thread moves the samples it generated into a
+  second ring, which S9xFinalizeSamples drains on the CPU thread instead of
+  the landing buffer.
+*/
+
+#define APU_THREAD_COMMANDS	4096	// must be a power of two
+#define APU_THREAD_SAMPLES	32768	// 16-bit samples, must be a power of two
+#define APU_THREAD_SPIN		4096	// polls before waiting gives up the CPU
+#define APU_THREAD_MAX_LAG	32		// scanlines the APU thread may fall behind
+
+enum
+{
+	APU_COMMAND_WRITE,
+	APU_COMMAND_READ,
+	APU_COMMAND_END_FRAME
+};
+
+struct SAPUCommand
+{
+	int32	time;
+	uint8	type;
+	uint8	port;
+	uint8	data;
+};
+
+namespace aputhread
+{
+	static pthread_t		thread;
+	static pthread_mutex_t	lock = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t	cond = PTHREAD_COND_INITIALIZER;
+
+	static bool8			running = FALSE;
+	static int				spin_limit = APU_THREAD_SPIN;	// no spinning on a single CPU
+	static bool8			sleeping = FALSE;
+	static bool8			quit = FALSE;
+
+	static SAPUCommand		commands[APU_THREAD_COMMANDS];
+	static uint32			command_head = 0;	// written by the CPU thread
+	static uint32			command_tail = 0;	// written by the APU thread
+	static uint8			read_result;
+	static uint32			lines_queued = 0;	// written by the CPU thread
+	static uint32			lines_done = 0;		// written by the APU thread
+
+	static int16			samples[APU_THREAD_SAMPLES];
+	static uint32			sample_head = 0;	// written by the APU thread
+	static uint32			sample_tail = 0;	// written by the CPU thread
+	static int16			*drain_buffer = NULL;
+} // namespace aputhread
+
+static inline void Backoff (int *spins)
+{
+	if (++*spins < aputhread::spin_limit)
+	{
+	#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+	#endif
+	}
+	else
+		sched_yield();
+}
+
+static void APUThreadWait (void)
+{
+	int	spins = 0;
+
+	while (__atomic_load_n(&aputhread::command_tail, __ATOMIC_ACQUIRE) != aputhread::command_head)
+		Backoff(&spins);
+}
+
+static void APUThreadPush (uint8 type, int32 time, int port = 0, uint8 data = 0)
+{
+	using namespace aputhread;
+
+	uint32	head = command_head;
+	int		spins = 0;
+
+	while (head - __atomic_load_n(&command_tail, __ATOMIC_ACQUIRE) >= APU_THREAD_COMMANDS)
+		Backoff(&spins);
+
+	if (type == APU_COMMAND_END_FRAME)
+	{
+		while (lines_queued - __atomic_load_n(&lines_done, __ATOMIC_ACQUIRE) >= APU_THREAD_MAX_LAG)
+			Backoff(&spins);
+		lines_queued++;
+	}
+
+	SAPUCommand	*c = &commands[head & (APU_THREAD_COMMANDS - 1)];
+	c->time = time;
+	c->type = type;
+	c->port = port;
+	c->data = data;
+
+	// pairs with the sleeping/command_head check in APUThreadSleep
+	__atomic_store_n(&command_head, head + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&sleeping, __ATOMIC_SEQ_CST))
+	{
+		pthread_mutex_lock(&lock);
+		pthread_cond_signal(&cond);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+static bool8 APUThreadSleep (uint32 tail)
+{
+	using namespace aputhread;
+
+	for (int i = 0; i < spin_limit; i++)
+	{
+		if (__atomic_load_n(&command_head, __ATOMIC_ACQUIRE) != tail)
+			return (TRUE);
+	#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+	#endif
+	}
+
+	pthread_mutex_lock(&lock);
+	__atomic_store_n(&sleeping, TRUE, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&command_head, __ATOMIC_SEQ_CST) == tail && !quit)
+		pthread_cond_wait(&cond, &lock);
+	__atomic_store_n(&sleeping, FALSE, __ATOMIC_SEQ_CST);
+	bool8	done = quit && command_head == tail;
+	pthread_mutex_unlock(&lock);
+
+	return (!done);
+}
+
+static void APUThreadLandSamples (void)
+{
+	using namespace aputhread;
+
+	uint32	count = spc_core->sample_count();
+	uint32	head = sample_head;
+
+	// an overrun drops the samples, like a full landing buffer does
+	if (count <= APU_THREAD_SAMPLES - (head - __atomic_load_n(&sample_tail, __ATOMIC_ACQUIRE)))
+	{
+		int16	*src = (int16 *) spc::landing_buffer;
+
+		for (uint32 i = 0; i < count; i++)
+			samples[(head + i) & (APU_THREAD_SAMPLES - 1)] = src[i];
+
+		__atomic_store_n(&sample_head, head + count, __ATOMIC_RELEASE);
+	}
+
+	spc_core->set_output((SNES_SPC::sample_t *) spc::landing_buffer, spc::buffer_size >> 1);
+}
+
+static void * APUThread (void *)
+{
+	using namespace aputhread;
+
+	uint32	tail = command_tail;
+
+	for (;;)
+	{
+		if (__atomic_load_n(&command_head, __ATOMIC_ACQUIRE) == tail)
+		{
+			if (!APUThreadSleep(tail))
+				break;
+			continue;
+		}
+
+		SAPUCommand	*c = &commands[tail & (APU_THREAD_COMMANDS - 1)];
+
+		switch (c->type)
+		{
+			case APU_COMMAND_WRITE:
+				spc_core->write_port(c->time, c->port, c->data);
+				break;
+
+			case APU_COMMAND_READ:
+				read_result = spc_core->read_port(c->time, c->port);
+				break;
+
+			case APU_COMMAND_END_FRAME:
+			{
+				PROFILE_SAMPLE_BEGIN(start, PROFILE_SPC);
+				spc_core->end_frame(c->time);
+				PROFILE_SAMPLE_END(start, PROFILE_SPC);
+				APUThreadLandSamples();
+				__atomic_store_n(&lines_done, lines_done + 1, __ATOMIC_RELEASE);
+				break;
+			}
+		}
+
+		__atomic_store_n(&command_tail, ++tail, __ATOMIC_RELEASE);
+	}
+
+	return (NULL);
+}
+
+// Number of samples S9xFinalizeSamples would land, copied to drain_buffer.
+static int APUThreadPeekSamples (void)
+{
+	using namespace aputhread;
+
+	uint32	tail = sample_tail;
+	uint32	count = __atomic_load_n(&sample_head, __ATOMIC_ACQUIRE) - tail;
+
+	// no more than the landing buffer holds, the MSU-1 buffer is sized after it
+	if (count > (uint32) (spc::buffer_size >> 1))
+		count = (spc::buffer_size >> 1) & ~1;
+
+	for (uint32 i = 0; i < count; i++)
+		drain_buffer[i] = samples[(tail + i) & (APU_THREAD_SAMPLES - 1)];
+
+	return (count);
+}
+
+static void APUThreadConsumeSamples (int count)
+{
+	__atomic_store_n(&aputhread::sample_tail, aputhread::sample_tail + count, __ATOMIC_RELEASE);
+}
+
+bool8 S9xAPUThreadStart (void)
+{
+	using namespace aputhread;
+
+	if (running)
+		return (TRUE);
+
+	drain_buffer = new int16[APU_THREAD_SAMPLES];
+	spin_limit = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? APU_THREAD_SPIN : 0;
+
+	S9xLandSamples();
+
+	command_head = command_tail = 0;
+	lines_queued = lines_done = 0;
+	sample_head = sample_tail = 0;
+	sleeping = quit = FALSE;
+
+	if (pthread_create(&thread, NULL, APUThread, NULL))
+	{
+		delete[] drain_buffer;
+		drain_buffer = NULL;
+		return (FALSE);
+	}
+
+	running = TRUE;
+
+	return (TRUE);
+}
+
+void S9xAPUThreadStop (void)
+{
+	using namespace aputhread;
+
+	if (!running)
+		return;
+
+	APUThreadWait();
+	S9xLandSamples();
+
+	pthread_mutex_lock(&lock);
+	quit = TRUE;
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&lock);
+
+	pthread_join(thread, NULL);
+
+	running = FALSE;
+
+	delete[] drain_buffer;
+	drain_buffer = NULL;
+}
+
+void S9xAPUThreadSync (void)
+{
+	if (aputhread::running)
+		APUThreadWait();
+}
+
+// spc_core belongs to the APU thread while it runs
+#define APU_THREAD_SYNC()	S9xAPUThreadSync()
+#else
+#define APU_THREAD_SYNC()
+#endif
+
 static void EightBitize (uint8 *, int);
 static void DeStereo (uint8 *, int);
 static void ReverseStereo (uint8 *, int);
@@ -172,8 +502,7 @@ bool8 S9xMixSamples (uint8 *buffer, int sample_count)
                 if (msu::resampler->avail() >= sample_count)
                 {
                     msu::resampler->read((short *)msu::resample_buffer, sample_count);
-                    for (int32 i = 0; i < sample_count; ++i)
-                        *((int16*)(dest+(i * 2))) += *((int16*)(msu::resample_buffer+(i * 2)));
+                    MixSaturate((int16 *) dest, (int16 *) msu::resample_buffer, sample_count);
 				}
 			}
 		}
@@ -214,13 +543,25 @@ int S9xGetSampleCount (void)
 
 void S9xFinalizeSamples (void)
 {
-	bool drop_current_msu1_samples = TRUE;
+	bool	drop_current_msu1_samples = TRUE;
+	short	*landed = (short *) spc::landing_buffer;
+	int		count;
+
+#ifdef USE_APU_THREAD
+	if (aputhread::running)
+	{
+		count = APUThreadPeekSamples();
+		landed = aputhread::drain_buffer;
+	}
+	else
+#endif
+	count = spc_core->sample_count();
 
 	if (!Settings.Mute)
 	{
 		drop_current_msu1_samples = FALSE;
 
-		if (!spc::resampler->push((short *) spc::landing_buffer, spc_core->sample_count()))
+		if (!spc::resampler->push(landed, count))
 		{
 			/* We weren't able to process the entire buffer. Potential overrun. */
 			spc::sound_in_sync = FALSE;
@@ -240,7 +581,7 @@ void S9xFinalizeSamples (void)
 	{
 		// generate the same number of msu1 samples as dsp samples were generated
 		S9xMSU1SetOutput((int16 *)msu::landing_buffer, msu::buffer_size);
-		S9xMSU1Generate(spc_core->sample_count());
+		S9xMSU1Generate(count);
 		if (!drop_current_msu1_samples && !msu::resampler->push((short *)msu::landing_buffer, S9xMSU1Samples()))
 		{
 			// should not occur, msu buffer is larger and we drop msu samples if spc buffer overruns
@@ -255,6 +596,11 @@ void S9xFinalizeSamples (void)
 	else
 		spc::sound_in_sync = FALSE;
 
+#ifdef USE_APU_THREAD
+	if (aputhread::running)
+		APUThreadConsumeSamples(count);
+	else
+#endif
 	spc_core->set_output((SNES_SPC::sample_t *) spc::landing_buffer, spc::buffer_size >> 1);
 }
 
@@ -311,11 +657,13 @@ void UpdatePlaybackRate (void)
 	}
 
 	spc::resampler->time_ratio(time_ratio);
+	spc::resampler->set_quality(Settings.SincResampling ? Resampler::SINC : Resampler::HERMITE);
 
 	if (Settings.MSU1)
 	{
 		time_ratio = (44100.0 / Settings.SoundPlaybackRate) * (Settings.SoundInputRate / 32040.0);
 		msu::resampler->time_ratio(time_ratio);
+		msu::resampler->set_quality(Settings.SincResampling ? Resampler::SINC : Resampler::HERMITE);
 	}
 }
 
@@ -382,6 +730,7 @@ bool8 S9xInitSound (int buffer_ms, int lag_ms)
 	else
 		msu::resampler->resize(msu::buffer_size);
 
+	APU_THREAD_SYNC();
 	spc_core->set_output((SNES_SPC::sample_t *) spc::landing_buffer, spc::buffer_size >> 1);
 
 	UpdatePlaybackRate();
@@ -393,6 +742,7 @@ bool8 S9xInitSound (int buffer_ms, int lag_ms)
 
 void S9xSetSoundControl (uint8 voice_switch)
 {
+	APU_THREAD_SYNC();
 	spc_core->dsp_set_stereo_switch(voice_switch << 8 | voice_switch);
 }
 
@@ -405,6 +755,7 @@ void S9xSetSoundMute (bool8 mute)
 
 void S9xDumpSPCSnapshot (void)
 {
+	APU_THREAD_SYNC();
 	spc_core->dsp_dump_spc_snapshot();
 }
 
@@ -435,6 +786,10 @@ bool8 S9xInitAPU (void)
 
 void S9xDeinitAPU (void)
 {
+#ifdef USE_APU_THREAD
+	S9xAPUThreadStop();
+#endif
+
 	if (spc_core)
 	{
 		delete spc_core;
@@ -494,11 +849,28 @@ static inline int S9xAPUGetClockRemainder (int32 cpucycles)
 
 uint8 S9xAPUReadPort (int port)
 {
+#ifdef USE_APU_THREAD
+	if (aputhread::running)
+	{
+		APUThreadPush(APU_COMMAND_READ, S9xAPUGetClock(CPU.Cycles), port);
+		APUThreadWait();
+		return (aputhread::read_result);
+	}
+#endif
+
 	return ((uint8) spc_core->read_port(S9xAPUGetClock(CPU.Cycles), port));
 }
 
 void S9xAPUWritePort (int port, uint8 byte)
 {
+#ifdef USE_APU_THREAD
+	if (aputhread::running)
+	{
+		APUThreadPush(APU_COMMAND_WRITE, S9xAPUGetClock(CPU.Cycles), port, byte);
+		return;
+	}
+#endif
+
 	spc_core->write_port(S9xAPUGetClock(CPU.Cycles), port, byte);
 }
 
@@ -510,7 +882,16 @@ void S9xAPUSetReferenceTime (int32 cpucycles)
 void S9xAPUExecute (void)
 {
 	/* Accumulate partial APU cycles */
-	spc_core->end_frame(S9xAPUGetClock(CPU.Cycles));
+#ifdef USE_APU_THREAD
+	if (aputhread::running)
+		APUThreadPush(APU_COMMAND_END_FRAME, S9xAPUGetClock(CPU.Cycles));
+	else
+#endif
+	{
+		PROFILE_SAMPLE_BEGIN(start, PROFILE_SPC);
+		spc_core->end_frame(S9xAPUGetClock(CPU.Cycles));
+		PROFILE_SAMPLE_END(start, PROFILE_SPC);
+	}
 
 	spc::remainder = S9xAPUGetClockRemainder(CPU.Cycles);
 
@@ -521,7 +902,18 @@ void S9xAPUEndScanline (void)
 {
 	S9xAPUExecute();
 
-	if (spc_core->sample_count() >= APU_MINIMUM_SAMPLE_BLOCK || !spc::sound_in_sync)
+	if (spc::hold_samples)
+		return;
+
+	int	landing = 0;
+#ifdef USE_APU_THREAD
+	if (aputhread::running)
+		landing = __atomic_load_n(&aputhread::sample_head, __ATOMIC_ACQUIRE) - aputhread::sample_tail;
+	else
+#endif
+	landing = spc_core->sample_count();
+
+	if (landing >= APU_MINIMUM_SAMPLE_BLOCK || !spc::sound_in_sync)
 		S9xLandSamples();
 }
 
@@ -531,6 +923,7 @@ void S9xAPUTimingSetSpeedup (int ticks)
 		printf("APU speedup hack: %d\n", ticks);
 
 	spc::timing_hack_denominator = SNES_SPC::tempo_unit - ticks;
+	APU_THREAD_SYNC();
 	spc_core->set_tempo(spc::timing_hack_denominator);
 
 	spc::ratio_numerator = Settings.PAL ? APU_NUMERATOR_PAL : APU_NUMERATOR_NTSC;
@@ -542,17 +935,22 @@ void S9xAPUTimingSetSpeedup (int ticks)
 
 void S9xAPUAllowTimeOverflow (bool allow)
 {
+	APU_THREAD_SYNC();
 	spc_core->spc_allow_time_overflow(allow);
 }
 
 void S9xResetAPU (void)
 {
+	APU_THREAD_SYNC();
 	spc::reference_time = 0;
 	spc::remainder = 0;
 	spc_core->reset();
 	spc_core->set_output((SNES_SPC::sample_t *) spc::landing_buffer, spc::buffer_size >> 1);
 
 	spc::resampler->clear();
+#ifdef USE_APU_THREAD
+	aputhread::sample_tail = aputhread::sample_head;
+#endif
 
 	if (Settings.MSU1)
 		msu::resampler->clear();
@@ -560,12 +958,16 @@ void S9xResetAPU (void)
 
 void S9xSoftResetAPU (void)
 {
+	APU_THREAD_SYNC();
 	spc::reference_time = 0;
 	spc::remainder = 0;
 	spc_core->soft_reset();
 	spc_core->set_output((SNES_SPC::sample_t *) spc::landing_buffer, spc::buffer_size >> 1);
 
 	spc::resampler->clear();
+#ifdef USE_APU_THREAD
+	aputhread::sample_tail = aputhread::sample_head;
+#endif
 
 	if (Settings.MSU1)
 		msu::resampler->clear();
@@ -587,6 +989,7 @@ void S9xAPUSaveState (uint8 *block)
 {
 	uint8	*ptr = block;
 
+	APU_THREAD_SYNC();
 	spc_core->copy_state(&ptr, from_apu_to_state);
 
 	SET_LE32(ptr, spc::reference_time);
@@ -607,6 +1010,56 @@ void S9xAPULoadState (uint8 *block)
 	spc::remainder = GET_LE32(ptr);
 }
 
+uint32 S9xAPUFastStateSize (void)
+{
+	return (sizeof(SNES_SPC) + sizeof(int32) + sizeof(uint32) * 2);
+}
+
+void S9xAPUSaveFastState (uint8 *block)
+{
+	uint32	sample_head = 0;
+
+	APU_THREAD_SYNC();
+#ifdef USE_APU_THREAD
+	sample_head = aputhread::sample_head;
+#endif
+
+	// every pointer in SNES_SPC points into itself or at buffers that stay put
+	memcpy(block, (void *) spc_core, sizeof(SNES_SPC));
+	block += sizeof(SNES_SPC);
+	memcpy(block, &spc::reference_time, sizeof(int32));
+	block += sizeof(int32);
+	memcpy(block, &spc::remainder, sizeof(uint32));
+	block += sizeof(uint32);
+	memcpy(block, &sample_head, sizeof(uint32));
+}
+
+void S9xAPULoadFastState (const uint8 *block)
+{
+	uint32	sample_head;
+
+	APU_THREAD_SYNC();
+
+	memcpy((void *) spc_core, block, sizeof(SNES_SPC));
+	block += sizeof(SNES_SPC);
+	memcpy(&spc::reference_time, block, sizeof(int32));
+	block += sizeof(int32);
+	memcpy(&spc::remainder, block, sizeof(uint32));
+	block += sizeof(uint32);
+	memcpy(&sample_head, block, sizeof(uint32));
+
+#ifdef USE_APU_THREAD
+	// forget what the thread generated since, S9xFinalizeSamples never saw it
+	if (aputhread::running)
+		aputhread::sample_head = sample_head;
+#endif
+}
+
+void S9xAPUHoldSamples (bool8 hold)
+{
+	spc::hold_samples = hold;
+}
+
 bool8 S9xSPCDump (const char *filename)
 {
 	FILE	*fs;
@@ -619,6 +1072,7 @@ bool8 S9xSPCDump (const char *filename)
 
 	S9xSetSoundMute(TRUE);
 
+	APU_THREAD_SYNC();
 	spc_core->init_header(buf);
 	spc_core->save_spc(buf);
 
@@ -27,9 +27,24 @@ void S9xAPUTimingSetSpeedup (int);
 void S9xAPUAllowTimeOverflow (bool);
 void S9xAPULoadState (uint8 *);
 void S9xAPUSaveState (uint8 *);
+// Raw copies of the SPC for S9xFreezeGameFast, only valid in this process
+uint32 S9xAPUFastStateSize (void);
+void S9xAPUSaveFastState (uint8 *);
+void S9xAPULoadFastState (const uint8 *);
+// While held, samples stay in the landing buffer instead of reaching the
+// sound output, for frames that are rolled back before anyone hears them
+void S9xAPUHoldSamples (bool8);
 void S9xDumpSPCSnapshot (void);
 bool8 S9xSPCDump (const char *);
 
+#ifdef USE_APU_THREAD
+// Moves SNES_SPC/SPC_DSP onto a thread of their own, see apu.cpp
+bool8 S9xAPUThreadStart (void);
+void S9xAPUThreadStop (void);
+// Waits until the APU thread has caught up with every port access
+void S9xAPUThreadSync (void);
+#endif
+
 bool8 S9xInitSound (int, int);
 bool8 S9xOpenSoundDevice (void);
 
@@ -15,10 +15,36 @@
 #include <stdint.h>
 #endif
 #include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+  The output is produced a block at a time. A first pass walks the step
+  sequence alone and notes, for each output frame, its fraction and how many
+  input frames were consumed before it; the input frames the block reaches
+  are then converted to floats once, behind the frames kept from the last
+  block, and every output frame is interpolated from that staging area
+  without looking at the ring again. Hermite takes the last four frames of
+  the window, which gives exactly the samples of the frame at a time
+  version, two frames per SSE2 vector. The sinc mode filters all
+  RESAMPLER_TAPS frames with a windowed sinc, low passed for the output rate
+  when downsampling.
+*/
+
+#define RESAMPLER_TAPS      16      // frames the sinc filter spans, the history kept
+#define RESAMPLER_PHASES    128     // filter phases, interpolated between
+#define RESAMPLER_CHUNK     256     // frames produced, and consumed, per block
 
 class Resampler
 {
   public:
+    enum
+    {
+        HERMITE,
+        SINC
+    };
+
     int size;
     int buffer_size;
     int start;
@@ -26,7 +52,15 @@ class Resampler
 
     float r_step;
     float r_frac;
-    int   r_left[4], r_right[4];
+    float r_hist[RESAMPLER_TAPS * 2];   // the last input frames, oldest first, interleaved
+
+    int quality;
+    float *sinc_table;                  // (RESAMPLER_PHASES + 2) rows of RESAMPLER_TAPS coefficients, each twice
+    float sinc_cutoff;
+
+    float stage[(RESAMPLER_TAPS + RESAMPLER_CHUNK) * 2];
+    float stage_mu[RESAMPLER_CHUNK];
+    int   stage_index[RESAMPLER_CHUNK];
 
     static inline int16_t short_clamp(int n)
     {
@@ -56,11 +90,27 @@ class Resampler
         return (a0 * b) + (a1 * m0) + (a2 * m1) + (a3 * c);
     }
 
+    static double bessel_i0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32; k++)
+        {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+        }
+
+        return sum;
+    }
+
     Resampler()
     {
         this->buffer_size = 0;
         buffer = NULL;
         r_step = 1.0;
+        quality = HERMITE;
+        sinc_table = NULL;
+        sinc_cutoff = 0.0;
     }
 
     Resampler(int num_samples)
@@ -68,6 +118,9 @@ class Resampler
         this->buffer_size = num_samples;
         buffer = new int16_t[this->buffer_size];
         r_step = 1.0;
+        quality = HERMITE;
+        sinc_table = NULL;
+        sinc_cutoff = 0.0;
         clear();
     }
 
@@ -75,6 +128,8 @@ class Resampler
     {
         delete[] buffer;
         buffer = NULL;
+        delete[] sinc_table;
+        sinc_table = NULL;
     }
 
     inline void time_ratio(double ratio)
@@ -82,6 +137,11 @@ class Resampler
         r_step = ratio;
     }
 
+    inline void set_quality(int q)
+    {
+        quality = q;
+    }
+
     inline void clear(void)
     {
         if (!buffer)
@@ -92,8 +152,7 @@ class Resampler
         memset(buffer, 0, buffer_size * 2);
 
         r_frac = 0.0;
-        r_left[0] = r_left[1] = r_left[2] = r_left[3] = 0;
-        r_right[0] = r_right[1] = r_right[2] = r_right[3] = 0;
+        memset(r_hist, 0, sizeof(r_hist));
     }
 
     inline bool pull(int16_t *dst, int num_samples)
@@ -112,19 +171,6 @@ class Resampler
         return true;
     }
 
-    inline void push_sample(int16_t l, int16_t r)
-    {
-        if (space_empty() >= 2)
-        {
-            int end = start + size;
-            if (end >= buffer_size)
-                end -= buffer_size;
-            buffer[end] = l;
-            buffer[end + 1] = r;
-            size += 2;
-        }
-    }
-
     inline bool push(int16_t *src, int num_samples)
     {
         if (space_empty() < num_samples)
@@ -145,6 +191,195 @@ class Resampler
         return true;
     }
 
+    // Kaiser windowed sinc, cutoff relative to the input Nyquist frequency
+    void build_sinc(float cutoff)
+    {
+        const int half = RESAMPLER_TAPS / 2;
+        const double beta = 7.0;
+
+        if (!sinc_table)
+            sinc_table = new float[(RESAMPLER_PHASES + 2) * RESAMPLER_TAPS * 2];
+
+        for (int p = 0; p < RESAMPLER_PHASES + 2; p++)
+        {
+            float *row = sinc_table + p * RESAMPLER_TAPS * 2;
+            double mu = (double)p / RESAMPLER_PHASES;
+            double coef[RESAMPLER_TAPS], sum = 0.0;
+
+            for (int i = 0; i < RESAMPLER_TAPS; i++)
+            {
+                // the output falls between taps half - 1 and half
+                double x = i - (half - 1) - mu;
+                double w = x / half;
+                double s = (x == 0.0) ? 1.0 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+
+                w = (w <= -1.0 || w >= 1.0) ? 0.0 : bessel_i0(beta * sqrt(1.0 - w * w)) / bessel_i0(beta);
+                coef[i] = s * w;
+                sum += coef[i];
+            }
+
+            for (int i = 0; i < RESAMPLER_TAPS; i++)
+                row[i * 2] = row[i * 2 + 1] = (float)(coef[i] / sum);
+        }
+
+        sinc_cutoff = cutoff;
+    }
+
+    // Walks the steps of up to max_out output frames, consuming at most max_in
+    // input frames, the same way the frame at a time version did.
+    inline void plan_block(int max_out, int max_in, int &out, int &in)
+    {
+        float frac = r_frac;
+        int k = 0, j = 0;
+
+        while (k < max_out && j < max_in)
+        {
+            while (frac <= 1.0 && k < max_out)
+            {
+                stage_mu[k] = frac;
+                stage_index[k] = j;
+                k++;
+
+                frac += r_step;
+            }
+
+            if (frac > 1.0)
+            {
+                frac -= 1.0;
+                j++;
+            }
+        }
+
+        r_frac = frac;
+        out = k;
+        in = j;
+    }
+
+    // The history, then in input frames from the ring, as floats.
+    inline void fill_stage(int in)
+    {
+        float *dst = stage + RESAMPLER_TAPS * 2;
+        int count = in * 2;
+        int pos = start;
+
+        memcpy(stage, r_hist, sizeof(r_hist));
+
+        while (count > 0)
+        {
+            int n = min(count, buffer_size - pos);
+            const int16_t *src = buffer + pos;
+            int i = 0;
+
+#ifdef __SSE2__
+            for (; i + 8 <= n; i += 8)
+            {
+                __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+                _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+                _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)));
+            }
+#endif
+            for (; i < n; i++)
+                dst[i] = src[i];
+
+            dst += n;
+            count -= n;
+            pos += n;
+            if (pos >= buffer_size)
+                pos = 0;
+        }
+    }
+
+    void interpolate_hermite(int16_t *data, int out)
+    {
+        const float *base = stage + (RESAMPLER_TAPS - 4) * 2;
+        int k = 0;
+
+#ifdef __SSE2__
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 three = _mm_set1_ps(3.0f);
+        const __m128 minus_two = _mm_set1_ps(-2.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        // the operations of hermite(), in the same order, for two frames at once
+        for (; k + 2 <= out; k += 2)
+        {
+            const float *p0 = base + stage_index[k] * 2;
+            const float *p1 = base + stage_index[k + 1] * 2;
+
+            __m128 a = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(p0)), (const __m64 *)(p1));
+            __m128 b = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(p0 + 2)), (const __m64 *)(p1 + 2));
+            __m128 c = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(p0 + 4)), (const __m64 *)(p1 + 4));
+            __m128 d = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(p0 + 6)), (const __m64 *)(p1 + 6));
+            __m128 mu1 = _mm_setr_ps(stage_mu[k], stage_mu[k], stage_mu[k + 1], stage_mu[k + 1]);
+
+            __m128 mu2 = _mm_mul_ps(mu1, mu1);
+            __m128 mu3 = _mm_mul_ps(mu2, mu1);
+            __m128 m0 = _mm_mul_ps(_mm_sub_ps(c, a), half);
+            __m128 m1 = _mm_mul_ps(_mm_sub_ps(d, b), half);
+            __m128 a0 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(two, mu3), _mm_mul_ps(three, mu2)), one);
+            __m128 a1 = _mm_add_ps(_mm_sub_ps(mu3, _mm_mul_ps(two, mu2)), mu1);
+            __m128 a2 = _mm_sub_ps(mu3, mu2);
+            __m128 a3 = _mm_add_ps(_mm_mul_ps(minus_two, mu3), _mm_mul_ps(three, mu2));
+
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, b), _mm_mul_ps(a1, m0)), _mm_mul_ps(a2, m1)), _mm_mul_ps(a3, c));
+            __m128i v = _mm_cvttps_epi32(r);
+
+            _mm_storel_epi64((__m128i *)(data + k * 2), _mm_packs_epi32(v, v));
+        }
+#endif
+
+        for (; k < out; k++)
+        {
+            const float *p = base + stage_index[k] * 2;
+
+            data[k * 2] = short_clamp((int)hermite(stage_mu[k], p[0], p[2], p[4], p[6]));
+            data[k * 2 + 1] = short_clamp((int)hermite(stage_mu[k], p[1], p[3], p[5], p[7]));
+        }
+    }
+
+    void interpolate_sinc(int16_t *data, int out)
+    {
+        for (int k = 0; k < out; k++)
+        {
+            float x = stage_mu[k] * RESAMPLER_PHASES;
+            int phase = (int)x;
+            float f = x - phase;
+            const float *row0 = sinc_table + phase * RESAMPLER_TAPS * 2;
+            const float *row1 = row0 + RESAMPLER_TAPS * 2;
+            const float *p = stage + stage_index[k] * 2;
+
+#ifdef __SSE2__
+            __m128 vf = _mm_set1_ps(f);
+            __m128 acc = _mm_setzero_ps();
+
+            for (int i = 0; i < RESAMPLER_TAPS * 2; i += 4)
+            {
+                __m128 c0 = _mm_loadu_ps(row0 + i);
+                __m128 c = _mm_add_ps(c0, _mm_mul_ps(vf, _mm_sub_ps(_mm_loadu_ps(row1 + i), c0)));
+                acc = _mm_add_ps(acc, _mm_mul_ps(c, _mm_loadu_ps(p + i)));
+            }
+
+            acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+            __m128i v = _mm_cvtps_epi32(acc);
+            v = _mm_packs_epi32(v, v);
+            *(int32_t *)(data + k * 2) = _mm_cvtsi128_si32(v);
+#else
+            float l = 0.0f, r = 0.0f;
+
+            for (int i = 0; i < RESAMPLER_TAPS * 2; i += 2)
+            {
+                float c = row0[i] + f * (row1[i] - row0[i]);
+                l += c * p[i];
+                r += c * p[i + 1];
+            }
+
+            data[k * 2] = short_clamp((int)floorf(l + 0.5f));
+            data[k * 2 + 1] = short_clamp((int)floorf(r + 0.5f));
+#endif
+        }
+    }
+
     void read(int16_t *data, int num_samples)
     {
         //If we are outputting the exact same ratio as the input, pull directly from the input buffer
@@ -155,45 +390,36 @@ class Resampler
         }
 
         assert((num_samples & 1) == 0); // resampler always processes both stereo samples
+
+        if (quality == SINC)
+        {
+            // low pass below the output's Nyquist frequency when downsampling
+            float cutoff = (r_step > 1.0f ? 1.0f / r_step : 1.0f) * 0.9f;
+            if (!sinc_table || fabsf(cutoff - sinc_cutoff) > sinc_cutoff * 0.01f)
+                build_sinc(cutoff);
+        }
+
         int o_position = 0;
 
         while (o_position < num_samples && size > 0)
         {
-            int s_left = buffer[start];
-            int s_right = buffer[start + 1];
-            int hermite_val[2];
+            int out, in;
 
-            while (r_frac <= 1.0 && o_position < num_samples)
-            {
-                hermite_val[0] = (int)hermite(r_frac, r_left[0], r_left[1], r_left[2], r_left[3]);
-                hermite_val[1] = (int)hermite(r_frac, r_right[0], r_right[1], r_right[2], r_right[3]);
-                data[o_position] = short_clamp(hermite_val[0]);
-                data[o_position + 1] = short_clamp(hermite_val[1]);
+            plan_block(min((num_samples - o_position) >> 1, RESAMPLER_CHUNK), min(size >> 1, RESAMPLER_CHUNK), out, in);
+            fill_stage(in);
 
-                o_position += 2;
+            if (quality == SINC)
+                interpolate_sinc(data + o_position, out);
+            else
+                interpolate_hermite(data + o_position, out);
 
-                r_frac += r_step;
-            }
+            memcpy(r_hist, stage + in * 2, sizeof(r_hist));
 
-            if (r_frac > 1.0)
-            {
-                r_left[0] = r_left[1];
-                r_left[1] = r_left[2];
-                r_left[2] = r_left[3];
-                r_left[3] = s_left;
-
-                r_right[0] = r_right[1];
-                r_right[1] = r_right[2];
-                r_right[2] = r_right[3];
-                r_right[3] = s_right;
-
-                r_frac -= 1.0;
-
-                start += 2;
-                if (start >= buffer_size)
-                    start -= buffer_size;
-                size -= 2;
-            }
+            start += in * 2;
+            if (start >= buffer_size)
+                start -= buffer_size;
+            size -= in * 2;
+            o_position += out * 2;
         }
     }
 
@@ -226,4 +452,4 @@ class Resampler
     }
 };
 
-#endif /* __NEW_RESAMPLER_H */
\ No newline at end of file
+#endif /* __NEW_RESAMPLER_H */
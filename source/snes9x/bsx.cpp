@@ -16,6 +16,9 @@
 
 #ifdef GEKKO
 #include "snes9xtx.h" /* for pathPrefix, APPFOLDER, GCSettings */
+#define SAT_DATA_ENABLED	(GCSettings.SatellaviewSatData)
+#else
+#define SAT_DATA_ENABLED	(FALSE)
 #endif
 
 
@@ -892,7 +895,7 @@ uint8 S9xGetBSXPPU (uint16 address)
 				t = 1;
 				break;
 			}
-            if (GCSettings.SatellaviewSatData)
+            if (SAT_DATA_ENABLED)
 			{
 			if (BSX.sat_stream1_queue <= 0)
 			{
@@ -1012,7 +1015,7 @@ uint8 S9xGetBSXPPU (uint16 address)
 				break;
 			}
 
-			if (GCSettings.SatellaviewSatData)
+			if (SAT_DATA_ENABLED)
 			{
 			if (BSX.sat_stream2_queue <= 0)
 			{
@@ -5,18 +5,13 @@
 \*****************************************************************************/
 
 #include <ctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "snes9x.h"
 #include "memmap.h"
 #include "cheats.h"
 
-#define WRAM_BITS	ALL_BITS
-#define SRAM_BITS	ALL_BITS + (0x20000 >> 5)
-#define IRAM_BITS	ALL_BITS + (0x30000 >> 5)
-
-#define BIT_CLEAR(a, v)	(a)[(v) >> 5] &= ~(1 << ((v) & 31))
-
-#define TEST_BIT(a, v)	((a)[(v) >> 5] & (1 << ((v) & 31)))
-
 #define _S9XCHTC(c, a, b) \
 	((c) == S9X_LESS_THAN             ? (a) <  (b) : \
 	 (c) == S9X_GREATER_THAN          ? (a) >  (b) : \
@@ -143,268 +138,530 @@ const char * S9xGameGenieToRaw (const char *code, uint32 &address, uint8 &byte)
 	return (NULL);
 }
 
-void S9xStartCheatSearch (SCheatData *d)
+// The search runs over three regions, the candidates of each stop short of
+// its end by the size of the value less one.
+static const uint32	search_start[3]  = { 0, 0x20000, 0x30000 };
+static const uint32	search_length[3] = { 0x20000, 0x10000, 0x2000 };
+
+static inline int S9xCheatSearchRegion (uint32 address)
 {
-	memmove(d->CWRAM, d->RAM, 0x20000);
-	memmove(d->CSRAM, d->SRAM, 0x80000);
-	memmove(d->CIRAM, &d->FillRAM[0x3000], 0x2000);
-	memset((char *) d->ALL_BITS, 0xff, 0x32000 >> 3);
+	return (address < 0x20000 ? 0 : address < 0x30000 ? 1 : 2);
 }
 
-void S9xSearchForChange (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, bool8 is_signed, bool8 update)
+static inline uint8 * S9xCheatSearchMemory (SCheatData *d, int r)
 {
-	int	l, i;
+	return (r == 0 ? d->RAM : r == 1 ? d->SRAM : d->FillRAM + 0x3000);
+}
 
-	switch (size)
+static bool8 S9xCheatSearchTest (const SCheatSearch *s, const uint8 *cur, const uint8 *prev, uint32 address)
+{
+	switch (s->type)
 	{
-		case S9X_8_BITS:	l = 0; break;
-		case S9X_16_BITS:	l = 1; break;
-		case S9X_24_BITS:	l = 2; break;
+		case S9X_SEARCH_CHANGE:
+			if (s->is_signed)
+				return (_S9XCHTC(s->cmp, _S9XCHTDS(s->size, cur, 0), _S9XCHTDS(s->size, prev, 0)));
+			return (_S9XCHTC(s->cmp, _S9XCHTD(s->size, cur, 0), _S9XCHTD(s->size, prev, 0)));
+
+		case S9X_SEARCH_VALUE:
+			if (s->is_signed)
+				return (_S9XCHTC(s->cmp, _S9XCHTDS(s->size, cur, 0), (int32) s->value));
+			return (_S9XCHTC(s->cmp, _S9XCHTD(s->size, cur, 0), s->value));
+
 		default:
-		case S9X_32_BITS:	l = 3; break;
+			return (_S9XCHTC(s->cmp, (int32) address, (int32) s->value));
 	}
+}
 
-	if (is_signed)
+// Tests the candidates of one bitmap word, base is the address of bit 0
+static uint32 S9xCheatSearchWord (const SCheatSearch *s, const uint8 *cur, const uint8 *prev, uint32 base, uint32 word)
+{
+	uint32	keep = 0;
+
+	while (word)
 	{
-		for (i = 0; i < 0x20000 - l; i++)
-		{
-			if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->RAM, i), _S9XCHTDS(size, d->CWRAM, i)))
-			{
-				if (update)
-					d->CWRAM[i] = d->RAM[i];
-			}
-			else
-				BIT_CLEAR(d->WRAM_BITS, i);
-		}
+		int	b = __builtin_ctz(word);
+		word &= word - 1;
 
-		for (i = 0; i < 0x10000 - l; i++)
-		{
-			if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->SRAM, i), _S9XCHTDS(size, d->CSRAM, i)))
-			{
-				if (update)
-					d->CSRAM[i] = d->SRAM[i];
-			}
-			else
-				BIT_CLEAR(d->SRAM_BITS, i);
-		}
+		if (S9xCheatSearchTest(s, cur + b, prev + b, base + b))
+			keep |= 1u << b;
+	}
 
-		for (i = 0; i < 0x2000 - l; i++)
-		{
-			if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->FillRAM + 0x3000, i), _S9XCHTDS(size, d->CIRAM, i)))
-			{
-				if (update)
-					d->CIRAM[i] = d->FillRAM[i + 0x3000];
-			}
-			else
-				BIT_CLEAR(d->IRAM_BITS, i);
-		}
+	return (keep);
+}
+
+template <int size, bool is_signed>
+static inline int64 S9xCheatSearchRead (const uint8 *m)
+{
+	return (is_signed ? (int64) _S9XCHTDS(size, m, 0) : (int64) _S9XCHTD(size, m, 0));
+}
+
+// Tests all 32 addresses of a word with the terms of the search hoisted out,
+// all of them have to be readable at the search size
+template <int size, bool is_signed>
+static uint32 S9xCheatSearchWordDense (const SCheatSearch *s, const uint8 *cur, const uint8 *prev)
+{
+	int64	a[32], b[32];
+	uint32	keep = 0;
+
+	for (int i = 0; i < 32; i++)
+	{
+		a[i] = S9xCheatSearchRead<size, is_signed>(cur + i);
+		b[i] = (s->type == S9X_SEARCH_CHANGE) ? S9xCheatSearchRead<size, is_signed>(prev + i) :
+				is_signed ? (int64) (int32) s->value : (int64) s->value;
 	}
-	else
+
+	switch (s->cmp)
 	{
-		for (i = 0; i < 0x20000 - l; i++)
-		{
-			if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->RAM, i), _S9XCHTD(size, d->CWRAM, i)))
-			{
-				if (update)
-					d->CWRAM[i] = d->RAM[i];
-			}
-			else
-				BIT_CLEAR(d->WRAM_BITS, i);
-		}
+		case S9X_LESS_THAN:				for (int i = 0; i < 32; i++) keep |= (uint32) (a[i] <  b[i]) << i; break;
+		case S9X_GREATER_THAN:			for (int i = 0; i < 32; i++) keep |= (uint32) (a[i] >  b[i]) << i; break;
+		case S9X_LESS_THAN_OR_EQUAL:	for (int i = 0; i < 32; i++) keep |= (uint32) (a[i] <= b[i]) << i; break;
+		case S9X_GREATER_THAN_OR_EQUAL:	for (int i = 0; i < 32; i++) keep |= (uint32) (a[i] >= b[i]) << i; break;
+		case S9X_EQUAL:					for (int i = 0; i < 32; i++) keep |= (uint32) (a[i] == b[i]) << i; break;
+		default:						for (int i = 0; i < 32; i++) keep |= (uint32) (a[i] != b[i]) << i; break;
+	}
 
-		for (i = 0; i < 0x10000 - l; i++)
-		{
-			if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->SRAM, i), _S9XCHTD(size, d->CSRAM, i)))
-			{
-				if (update)
-					d->CSRAM[i] = d->SRAM[i];
-			}
-			else
-				BIT_CLEAR(d->SRAM_BITS, i);
-		}
+	return (keep);
+}
 
-		for (i = 0; i < 0x2000 - l; i++)
-		{
-			if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->FillRAM + 0x3000, i), _S9XCHTD(size, d->CIRAM, i)))
-			{
-				if (update)
-					d->CIRAM[i] = d->FillRAM[i + 0x3000];
-			}
-			else
-				BIT_CLEAR(d->IRAM_BITS, i);
-		}
+typedef uint32 (*S9xCheatSearchWordFunc) (const SCheatSearch *, const uint8 *, const uint8 *);
+
+static const S9xCheatSearchWordFunc	search_word_dense[4][2] =
+{
+	{ S9xCheatSearchWordDense<S9X_8_BITS,  false>, S9xCheatSearchWordDense<S9X_8_BITS,  true> },
+	{ S9xCheatSearchWordDense<S9X_16_BITS, false>, S9xCheatSearchWordDense<S9X_16_BITS, true> },
+	{ S9xCheatSearchWordDense<S9X_24_BITS, false>, S9xCheatSearchWordDense<S9X_24_BITS, true> },
+	{ S9xCheatSearchWordDense<S9X_32_BITS, false>, S9xCheatSearchWordDense<S9X_32_BITS, true> }
+};
+
+#ifdef __SSE2__
+// SSE2 only compares signed lanes, unsigned values are biased by the sign bit.
+// Each comparison is one of <, > or == and the rest are their inverse.
+struct SCheatSearchVector
+{
+	int		op;		// 0 <, 1 >, 2 ==
+	uint32	invert;
+	__m128i	value;
+};
+
+static bool8 S9xCheatSearchVectorSetup (const SCheatSearch *s, SCheatSearchVector *v)
+{
+	if (s->type == S9X_SEARCH_ADDRESS)
+		return (FALSE);
+
+	switch (s->cmp)
+	{
+		case S9X_LESS_THAN:				v->op = 0; v->invert = 0; break;
+		case S9X_GREATER_THAN:			v->op = 1; v->invert = 0; break;
+		case S9X_LESS_THAN_OR_EQUAL:	v->op = 1; v->invert = ~0u; break;
+		case S9X_GREATER_THAN_OR_EQUAL:	v->op = 0; v->invert = ~0u; break;
+		case S9X_EQUAL:					v->op = 2; v->invert = 0; break;
+		default:						v->op = 2; v->invert = ~0u; break;
 	}
 
-	for (i = 0x20000 - l; i < 0x20000; i++)
-		BIT_CLEAR(d->WRAM_BITS, i);
+	if (s->type == S9X_SEARCH_CHANGE)
+		return (TRUE);
 
-	for (i = 0x10000 - l; i < 0x10000; i++)
-		BIT_CLEAR(d->SRAM_BITS, i);
+	// a value out of the lane's range has to go the scalar way
+	int32	sv = (int32) s->value;
+
+	switch (s->size)
+	{
+		case S9X_8_BITS:
+			if (s->is_signed ? (sv < -128 || sv > 127) : s->value > 0xff)
+				return (FALSE);
+			v->value = _mm_set1_epi8((char) (s->is_signed ? s->value : s->value ^ 0x80));
+			break;
+
+		case S9X_16_BITS:
+			if (s->is_signed ? (sv < -32768 || sv > 32767) : s->value > 0xffff)
+				return (FALSE);
+			v->value = _mm_set1_epi16((short) (s->is_signed ? s->value : s->value ^ 0x8000));
+			break;
+
+		default:
+			v->value = _mm_set1_epi32((int) (s->is_signed ? s->value : s->value ^ 0x80000000));
+			break;
+	}
+
+	return (TRUE);
 }
 
-void S9xSearchForValue (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 is_signed, bool8 update)
+// The values at the 16 addresses from m in 1, 2 or 4 vectors of lanes
+static inline int S9xCheatSearchLanes (const uint8 *m, int size, bool8 is_signed, __m128i *v)
 {
-	int l, i;
+	__m128i	a = _mm_loadu_si128((const __m128i *) m);
 
-	switch (size)
+	if (size == S9X_8_BITS)
 	{
-		case S9X_8_BITS:	l = 0; break;
-		case S9X_16_BITS:	l = 1; break;
-		case S9X_24_BITS:	l = 2; break;
-		default:
-		case S9X_32_BITS:	l = 3; break;
+		v[0] = is_signed ? a : _mm_xor_si128(a, _mm_set1_epi8(-128));
+		return (1);
 	}
 
-	if (is_signed)
+	__m128i	b = _mm_loadu_si128((const __m128i *) (m + 1));
+
+	if (size == S9X_16_BITS)
 	{
-		for (i = 0; i < 0x20000 - l; i++)
-		{
-			if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->RAM, i), (int32) value))
-			{
-				if (update)
-					d->CWRAM[i] = d->RAM[i];
-			}
-			else
-				BIT_CLEAR(d->WRAM_BITS, i);
-		}
+		__m128i	bias = is_signed ? _mm_setzero_si128() : _mm_set1_epi16(-32768);
+		v[0] = _mm_xor_si128(_mm_unpacklo_epi8(a, b), bias);
+		v[1] = _mm_xor_si128(_mm_unpackhi_epi8(a, b), bias);
+		return (2);
+	}
 
-		for (i = 0; i < 0x10000 - l; i++)
-		{
-			if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->SRAM, i), (int32) value))
-			{
-				if (update)
-					d->CSRAM[i] = d->SRAM[i];
-			}
-			else
-				BIT_CLEAR(d->SRAM_BITS, i);
-		}
+	__m128i	c = _mm_loadu_si128((const __m128i *) (m + 2));
+	__m128i	e = _mm_loadu_si128((const __m128i *) (m + 3));
+	__m128i	ablo = _mm_unpacklo_epi8(a, b), abhi = _mm_unpackhi_epi8(a, b);
+	__m128i	celo = _mm_unpacklo_epi8(c, e), cehi = _mm_unpackhi_epi8(c, e);
 
-		for (i = 0; i < 0x2000 - l; i++)
-		{
-			if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->FillRAM + 0x3000, i), (int32) value))
-			{
-				if (update)
-					d->CIRAM[i] = d->FillRAM[i + 0x3000];
-			}
-			else
-				BIT_CLEAR(d->IRAM_BITS, i);
-		}
+	v[0] = _mm_unpacklo_epi16(ablo, celo);
+	v[1] = _mm_unpackhi_epi16(ablo, celo);
+	v[2] = _mm_unpacklo_epi16(abhi, cehi);
+	v[3] = _mm_unpackhi_epi16(abhi, cehi);
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (size == S9X_24_BITS)
+			v[i] = is_signed ? _mm_srai_epi32(_mm_slli_epi32(v[i], 8), 8) : _mm_and_si128(v[i], _mm_set1_epi32(0xffffff));
+
+		if (!is_signed)
+			v[i] = _mm_xor_si128(v[i], _mm_set1_epi32(0x80000000));
 	}
-	else
+
+	return (4);
+}
+
+static inline __m128i S9xCheatSearchCompare (__m128i a, __m128i b, int n, int op)
+{
+	if (n == 1)
+		return (op == 0 ? _mm_cmplt_epi8(a, b) : op == 1 ? _mm_cmpgt_epi8(a, b) : _mm_cmpeq_epi8(a, b));
+	if (n == 2)
+		return (op == 0 ? _mm_cmplt_epi16(a, b) : op == 1 ? _mm_cmpgt_epi16(a, b) : _mm_cmpeq_epi16(a, b));
+	return (op == 0 ? _mm_cmplt_epi32(a, b) : op == 1 ? _mm_cmpgt_epi32(a, b) : _mm_cmpeq_epi32(a, b));
+}
+
+// Tests 32 addresses at once, all of them have to be readable at the search size
+static uint32 S9xCheatSearchWordSSE2 (const SCheatSearch *s, const SCheatSearchVector *v, const uint8 *cur, const uint8 *prev)
+{
+	uint32	keep = 0;
+
+	for (int half = 0; half < 32; half += 16)
 	{
-		for (i = 0; i < 0x20000 - l; i++)
-		{
-			if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->RAM, i), value))
-			{
-				if (update)
-					d->CWRAM[i] = d->RAM[i];
-			}
-			else
-				BIT_CLEAR(d->WRAM_BITS, i);
-		}
+		__m128i	a[4], b[4], m[4];
+		int		n = S9xCheatSearchLanes(cur + half, s->size, s->is_signed, a);
 
-		for (i = 0; i < 0x10000 - l; i++)
-		{
-			if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->SRAM, i), value))
-			{
-				if (update)
-					d->CSRAM[i] = d->SRAM[i];
-			}
-			else
-				BIT_CLEAR(d->SRAM_BITS, i);
-		}
+		if (s->type == S9X_SEARCH_CHANGE)
+			S9xCheatSearchLanes(prev + half, s->size, s->is_signed, b);
+		else
+			b[0] = b[1] = b[2] = b[3] = v->value;
+
+		for (int i = 0; i < n; i++)
+			m[i] = S9xCheatSearchCompare(a[i], b[i], n, v->op);
+
+		if (n == 2)
+			m[0] = _mm_packs_epi16(m[0], m[1]);
+		else
+		if (n == 4)
+			m[0] = _mm_packs_epi16(_mm_packs_epi32(m[0], m[1]), _mm_packs_epi32(m[2], m[3]));
 
-		for (i = 0; i < 0x2000 - l; i++)
+		keep |= (uint32) _mm_movemask_epi8(m[0]) << half;
+	}
+
+	return (keep ^ v->invert);
+}
+#endif
+
+static void S9xCheatSearchCopyValue (SCheatData *d, uint32 address, uint8 value[4])
+{
+	int		r = S9xCheatSearchRegion(address);
+	uint32	off = address - search_start[r];
+	uint8	*m = S9xCheatSearchMemory(d, r);
+
+	for (int i = 0; i < 4; i++)
+		value[i] = (off + i < search_length[r]) ? m[off + i] : 0;
+}
+
+static void S9xCheatSearchFreeBits (SCheatSearch *s)
+{
+	free(s->bits);
+	free(s->shadow);
+	s->bits = NULL;
+	s->shadow = NULL;
+}
+
+// Few enough candidates left for a list to hold them in less than the bitmap
+static void S9xCheatSearchToList (SCheatData *d)
+{
+	SCheatSearch	*s = &d->search;
+	uint32			n = 0;
+
+	s->list = (SCheatCandidate *) malloc(sizeof(SCheatCandidate) * (s->count ? s->count : 1));
+	if (!s->list)
+		return;
+
+	for (uint32 w = 0; w < (CHEAT_SEARCH_SIZE >> 5); w++)
+	{
+		for (uint32 word = s->bits[w]; word; word &= word - 1)
 		{
-			if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->FillRAM + 0x3000, i), value))
-			{
-				if (update)
-					d->CIRAM[i] = d->FillRAM[i + 0x3000];
-			}
-			else
-				BIT_CLEAR(d->IRAM_BITS, i);
+			uint32	address = (w << 5) + __builtin_ctz(word);
+			int		r = S9xCheatSearchRegion(address);
+
+			s->list[n].address = address;
+			for (int i = 0; i < 4; i++)
+				s->list[n].value[i] = (address + i < search_start[r] + search_length[r]) ? s->shadow[address + i] : 0;
+			n++;
 		}
 	}
 
-	for (i = 0x20000 - l; i < 0x20000; i++)
-		BIT_CLEAR(d->WRAM_BITS, i);
+	s->count = n;
+	S9xCheatSearchFreeBits(s);
+}
+
+// Leaves the candidates consistent when a search is cut short
+static void S9xCheatSearchAbandon (SCheatSearch *s)
+{
+	if (!s->busy)
+		return;
+
+	if (s->list)
+	{
+		memmove(&s->list[s->found], &s->list[s->pos], sizeof(SCheatCandidate) * (s->count - s->pos));
+		s->count = s->found + s->count - s->pos;
+	}
+	else
+	if (s->bits)
+	{
+		s->count = 0;
+		for (uint32 w = 0; w < (CHEAT_SEARCH_SIZE >> 5); w++)
+			s->count += __builtin_popcount(s->bits[w]);
+	}
 
-	for (i = 0x10000 - l; i < 0x10000; i++)
-		BIT_CLEAR(d->SRAM_BITS, i);
+	s->busy = FALSE;
 }
 
-void S9xSearchForAddress (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 update)
+void S9xEndCheatSearch (SCheatData *d)
 {
-	int	l, i;
+	SCheatSearch	*s = &d->search;
 
-	switch (size)
+	S9xCheatSearchFreeBits(s);
+	free(s->list);
+	s->list = NULL;
+	s->count = 0;
+	s->busy = FALSE;
+}
+
+void S9xStartCheatSearch (SCheatData *d)
+{
+	SCheatSearch	*s = &d->search;
+
+	S9xEndCheatSearch(d);
+
+	s->bits = (uint32 *) malloc(CHEAT_SEARCH_SIZE >> 3);
+	s->shadow = (uint8 *) malloc(CHEAT_SEARCH_SIZE);
+	if (!s->bits || !s->shadow)
 	{
-		case S9X_8_BITS:	l = 0; break;
-		case S9X_16_BITS:	l = 1; break;
-		case S9X_24_BITS:	l = 2; break;
-		default:
-		case S9X_32_BITS:	l = 3; break;
+		S9xCheatSearchFreeBits(s);
+		return;
 	}
 
-	for (i = 0; i < 0x20000 - l; i++)
+	memset(s->bits, 0xff, CHEAT_SEARCH_SIZE >> 3);
+	for (int r = 0; r < 3; r++)
+		memmove(s->shadow + search_start[r], S9xCheatSearchMemory(d, r), search_length[r]);
+	s->count = CHEAT_SEARCH_SIZE;
+}
+
+/*
+ * Starts narrowing the candidates down, S9xCheatSearchStep carries it out a
+ * bit at a time. An update makes the values the next search compares
+ * against the current ones.
+ */
+void S9xBeginCheatSearch (SCheatData *d, S9xCheatSearchType type, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 is_signed, bool8 update)
+{
+	SCheatSearch	*s = &d->search;
+
+	S9xCheatSearchAbandon(s);
+
+	s->type = type;
+	s->cmp = cmp;
+	s->size = size;
+	s->value = value;
+	s->is_signed = is_signed;
+	s->update = update;
+	s->pos = 0;
+	s->found = 0;
+	s->busy = s->bits || s->list;
+
+	// the last addresses of each region are too short for the size
+	if (s->bits)
 	{
-		if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, i, (int32) value))
-		{
-			if (update)
-				d->CWRAM[i] = d->RAM[i];
-		}
-		else
-			BIT_CLEAR(d->WRAM_BITS, i);
+		for (int r = 0; r < 3; r++)
+			for (uint32 a = search_start[r] + search_length[r] - size; a < search_start[r] + search_length[r]; a++)
+				s->bits[a >> 5] &= ~(1u << (a & 31));
 	}
+}
 
-	for (i = 0; i < 0x10000 - l; i++)
+/*
+ * Runs the search for up to budget addresses, or candidates once they are in
+ * a list. Returns TRUE when the search is done.
+ */
+bool8 S9xCheatSearchStep (SCheatData *d, uint32 budget)
+{
+	SCheatSearch	*s = &d->search;
+
+	if (!s->busy)
+		return (TRUE);
+
+	if (s->list)
 	{
-		if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, i + 0x20000, (int32) value))
+		for (; s->pos < s->count && budget; s->pos++, budget--)
 		{
-			if (update)
-				d->CSRAM[i] = d->SRAM[i];
+			SCheatCandidate	c = s->list[s->pos];
+			int				r = S9xCheatSearchRegion(c.address);
+			uint32			off = c.address - search_start[r];
+
+			if (off + s->size >= search_length[r])
+				continue;
+
+			if (!S9xCheatSearchTest(s, S9xCheatSearchMemory(d, r) + off, c.value, c.address))
+				continue;
+
+			if (s->update)
+				S9xCheatSearchCopyValue(d, c.address, c.value);
+
+			s->list[s->found++] = c;
 		}
-		else
-			BIT_CLEAR(d->SRAM_BITS, i);
+
+		if (s->pos < s->count)
+			return (FALSE);
+
+		s->count = s->found;
+		s->busy = FALSE;
+		return (TRUE);
 	}
 
-	for (i = 0; i < 0x2000 - l; i++)
+#ifdef __SSE2__
+	SCheatSearchVector	v;
+	bool8				vector = S9xCheatSearchVectorSetup(s, &v);
+#endif
+	S9xCheatSearchWordFunc	dense = (s->type == S9X_SEARCH_ADDRESS) ? NULL : search_word_dense[s->size][s->is_signed ? 1 : 0];
+
+	for (; s->pos < CHEAT_SEARCH_SIZE && budget; s->pos += 32)
 	{
-		if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, i + 0x30000, (int32) value))
+		uint32	base = s->pos;
+		int		r = S9xCheatSearchRegion(base);
+		uint32	off = base - search_start[r];
+		uint8	*cur = S9xCheatSearchMemory(d, r) + off;
+		uint8	*prev = s->shadow + base;
+		uint32	word = s->bits[base >> 5];
+
+		if (word)
 		{
-			if (update)
-				d->CIRAM[i] = d->FillRAM[i + 0x3000];
+			uint32	keep;
+
+			// whole words are worth it, the odd candidate is not
+			bool8	whole = dense && __builtin_popcount(word) > 4 && off + 32 + s->size <= search_length[r];
+
+		#ifdef __SSE2__
+			if (whole && vector)
+				keep = S9xCheatSearchWordSSE2(s, &v, cur, prev);
+			else
+		#endif
+			if (whole)
+				keep = dense(s, cur, prev);
+			else
+				keep = S9xCheatSearchWord(s, cur, prev, base, word);
+
+			word &= keep;
+			s->bits[base >> 5] = word;
+			s->found += __builtin_popcount(word);
 		}
-		else
-			BIT_CLEAR(d->IRAM_BITS, i);
+
+		// the whole word, a candidate before it may read into it
+		if (s->update)
+			memmove(prev, cur, 32);
+
+		budget = (budget > 32) ? budget - 32 : 0;
 	}
 
-	for (i = 0x20000 - l; i < 0x20000; i++)
-		BIT_CLEAR(d->WRAM_BITS, i);
+	if (s->pos < CHEAT_SEARCH_SIZE)
+		return (FALSE);
+
+	s->count = s->found;
+	s->busy = FALSE;
 
-	for (i = 0x10000 - l; i < 0x10000; i++)
-		BIT_CLEAR(d->SRAM_BITS, i);
+	if (s->count <= CHEAT_SEARCH_LIST_MAX)
+		S9xCheatSearchToList(d);
+
+	return (TRUE);
 }
 
-void S9xOutputCheatSearchResults (SCheatData *d)
+uint32 S9xCheatSearchCount (SCheatData *d)
+{
+	return (d->search.count);
+}
+
+// The first candidate at or after address, CHEAT_SEARCH_SIZE when there is none
+uint32 S9xCheatSearchNext (SCheatData *d, uint32 address)
 {
-	int	i;
+	SCheatSearch	*s = &d->search;
 
-	for (i = 0; i < 0x20000; i++)
+	if (s->list)
 	{
-		if (TEST_BIT(d->WRAM_BITS, i))
-			printf("WRAM: %05x: %02x\n", i, d->RAM[i]);
+		uint32	lo = 0, hi = s->busy ? s->found : s->count;
+
+		while (lo < hi)
+		{
+			uint32	mid = (lo + hi) / 2;
+
+			if (s->list[mid].address < address)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		return (lo < (s->busy ? s->found : s->count) ? s->list[lo].address : CHEAT_SEARCH_SIZE);
 	}
 
-	for (i = 0; i < 0x10000; i++)
+	if (s->bits)
 	{
-		if (TEST_BIT(d->SRAM_BITS, i))
-			printf("SRAM: %04x: %02x\n", i, d->SRAM[i]);
+		for (; address < CHEAT_SEARCH_SIZE; address = (address | 31) + 1)
+		{
+			uint32	word = s->bits[address >> 5] >> (address & 31);
+
+			if (word)
+				return (address + __builtin_ctz(word));
+		}
 	}
 
-	for (i = 0; i < 0x2000; i++)
+	return (CHEAT_SEARCH_SIZE);
+}
+
+void S9xSearchForChange (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, bool8 is_signed, bool8 update)
+{
+	S9xBeginCheatSearch(d, S9X_SEARCH_CHANGE, cmp, size, 0, is_signed, update);
+	while (!S9xCheatSearchStep(d, CHEAT_SEARCH_SIZE)) ;
+}
+
+void S9xSearchForValue (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 is_signed, bool8 update)
+{
+	S9xBeginCheatSearch(d, S9X_SEARCH_VALUE, cmp, size, value, is_signed, update);
+	while (!S9xCheatSearchStep(d, CHEAT_SEARCH_SIZE)) ;
+}
+
+void S9xSearchForAddress (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 update)
+{
+	S9xBeginCheatSearch(d, S9X_SEARCH_ADDRESS, cmp, size, value, FALSE, update);
+	while (!S9xCheatSearchStep(d, CHEAT_SEARCH_SIZE)) ;
+}
+
+void S9xOutputCheatSearchResults (SCheatData *d)
+{
+	for (uint32 a = S9xCheatSearchNext(d, 0); a < CHEAT_SEARCH_SIZE; a = S9xCheatSearchNext(d, a + 1))
 	{
-		if (TEST_BIT(d->IRAM_BITS, i))
-			printf("IRAM: %05x: %02x\n", i, d->FillRAM[i + 0x3000]);
+		if (a < 0x20000)
+			printf("WRAM: %05x: %02x\n", a, d->RAM[a]);
+		else
+		if (a < 0x30000)
+			printf("SRAM: %04x: %02x\n", a - 0x20000, d->SRAM[a - 0x20000]);
+		else
+			printf("IRAM: %05x: %02x\n", a - 0x30000, d->FillRAM[a - 0x30000 + 0x3000]);
 	}
 }
@@ -29,17 +29,43 @@ struct SCheatGroup
 	std::vector<struct SCheat> c;
 };
 
+// Cheat search addresses: WRAM at 0, the first 64 KB of SRAM at 0x20000,
+// I-RAM at 0x30000
+#define CHEAT_SEARCH_SIZE		0x32000
+#define CHEAT_SEARCH_LIST_MAX	4096	// candidates kept as a list rather than a bitmap
+#define CHEAT_SEARCH_FRAME_STEP	0x4000	// addresses a search runs in the background each frame
+
+struct SCheatCandidate
+{
+	uint32	address;
+	uint8	value[4];	// at the address, as of the last update
+};
+
+struct SCheatSearch
+{
+	uint32	*bits;		// one bit per address while there are many candidates,
+	uint8	*shadow;	// with the values as of the last update
+	struct SCheatCandidate *list;	// sorted by address once there are few
+	uint32	count;		// candidates after the last search
+	bool8	busy;		// a search is under way, below are its terms
+	uint8	type;
+	uint8	cmp;
+	uint8	size;
+	bool8	is_signed;
+	bool8	update;
+	uint32	value;
+	uint32	pos;		// next address, or next list index
+	uint32	found;		// candidates kept so far
+};
+
 struct SCheatData
 {
 	std::vector<struct SCheatGroup> g;
 	bool8	enabled;
-	uint8	CWRAM[0x20000];
-	uint8	CSRAM[0x80000];
-	uint8	CIRAM[0x2000];
 	uint8	*RAM;
 	uint8	*FillRAM;
 	uint8	*SRAM;
-	uint32	ALL_BITS[0x32000 >> 5];
+	struct SCheatSearch search;
 	uint8	CWatchRAM[0x32000];
 };
 
@@ -71,6 +97,13 @@ typedef enum
 	S9X_32_BITS
 }	S9xCheatDataSize;
 
+typedef enum
+{
+	S9X_SEARCH_CHANGE,
+	S9X_SEARCH_VALUE,
+	S9X_SEARCH_ADDRESS
+}	S9xCheatSearchType;
+
 extern SCheatData	Cheat;
 extern Watch		watches[16];
 
@@ -96,6 +129,11 @@ void S9xSearchForChange (SCheatData *, S9xCheatComparisonType, S9xCheatDataSize,
 void S9xSearchForValue (SCheatData *, S9xCheatComparisonType, S9xCheatDataSize, uint32, bool8, bool8);
 void S9xSearchForAddress (SCheatData *, S9xCheatComparisonType, S9xCheatDataSize, uint32, bool8);
 void S9xOutputCheatSearchResults (SCheatData *);
+void S9xBeginCheatSearch (SCheatData *, S9xCheatSearchType, S9xCheatComparisonType, S9xCheatDataSize, uint32, bool8, bool8);
+bool8 S9xCheatSearchStep (SCheatData *, uint32);
+uint32 S9xCheatSearchCount (SCheatData *);
+uint32 S9xCheatSearchNext (SCheatData *, uint32);
+void S9xEndCheatSearch (SCheatData *);
 void S9xLoadCheatsFromBMLNode (bml_node *);
 
 const char * S9xGameGenieToRaw (const char *, uint32 &, uint8 &);
@@ -9,6 +9,9 @@
 #include "snes9x.h"
 #include "memmap.h"
 #include "cheats.h"
+#include "cpublock.h"
+#include "fxemu.h"
+#include "sdd1emu.h"
 #include "bml.h"
 
 static inline char *trim (char *string)
@@ -48,7 +51,6 @@ static inline uint8 S9xGetByteFree (uint32 Address)
         return (byte);
 
     case CMemory::MAP_LOROM_SRAM:
-    case CMemory::MAP_SA1RAM:
         // Address & 0x7fff   : offset into bank
         // Address & 0xff0000 : bank
         // bank >> 1 | offset : SRAM address, unbound
@@ -69,6 +71,10 @@ static inline uint8 S9xGetByteFree (uint32 Address)
         byte = *(Memory.BWRAM + ((Address & 0x7fff) - 0x6000));
         return (byte);
 
+    case CMemory::MAP_SA1RAM:
+        byte = *(Memory.SRAM + (Address & 0x3ffff));
+        return (byte);
+
     case CMemory::MAP_DSP:
         byte = S9xGetDSP(Address & 0xffff);
         return (byte);
@@ -116,6 +122,14 @@ static inline void S9xSetByteFree (uint8 Byte, uint32 Address)
     if (SetAddress >= (uint8 *) CMemory::MAP_LAST)
     {
         *(SetAddress + (Address & 0xffff)) = Byte;
+        if (Memory.BlockIsROM[block])
+        {
+            S9xInvalidateCPUBlocks(SetAddress + (Address & 0xffff));
+            if (Settings.SuperFX)
+                fx_flushDecodeCache();
+            if (Settings.SDD1)
+                SDD1_reset_cache();
+        }
         return;
     }
 
@@ -164,7 +178,7 @@ static inline void S9xSetByteFree (uint8 Byte, uint32 Address)
         return;
 
     case CMemory::MAP_SA1RAM:
-        *(Memory.SRAM + (Address & 0xffff)) = Byte;
+        *(Memory.SRAM + (Address & 0x3ffff)) = Byte;
         return;
 
     case CMemory::MAP_DSP:
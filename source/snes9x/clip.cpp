@@ -189,7 +189,7 @@ void S9xComputeClipWindows (void)
 	uint8	CW_color = 0, CW_math = 0;
 	uint8	CW = CalcWindowMask(5, W1, W2);
 
-	switch (Memory.FillRAM[0x2130] & 0xc0)
+	switch (GFX.FillRAM[0x2130] & 0xc0)
 	{
 		case 0x00:	CW_color = 0;		break;
 		case 0x40:	CW_color = ~CW;		break;
@@ -197,7 +197,7 @@ void S9xComputeClipWindows (void)
 		case 0xc0:	CW_color = 0xff;	break;
 	}
 
-	switch (Memory.FillRAM[0x2130] & 0x30)
+	switch (GFX.FillRAM[0x2130] & 0x30)
 	{
 		case 0x00:	CW_math  = 0;		break;
 		case 0x10:	CW_math  = ~CW;		break;
@@ -225,7 +225,7 @@ void S9xComputeClipWindows (void)
 		uint8	W = Settings.DisableGraphicWindows ? 0 : CalcWindowMask(j, W1, W2);
 		for (int sub = 0; sub < 2; sub++)
 		{
-			if (Memory.FillRAM[sub + 0x212e] & (1 << j))
+			if (GFX.FillRAM[sub + 0x212e] & (1 << j))
 				StoreWindowRegions(W, &IPPU.Clip[sub][j], n_regions, windows, drawing_modes, sub);
 			else
 				StoreWindowRegions(0, &IPPU.Clip[sub][j], n_regions, windows, drawing_modes, sub);
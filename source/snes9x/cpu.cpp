@@ -13,6 +13,7 @@
 #include "srtc.h"
 #include "snapshot.h"
 #include "cheats.h"
+#include "cpublock.h"
 #ifdef DEBUGGER
 #include "debug.h"
 #endif
@@ -129,6 +130,7 @@ void S9xReset (void)
 	if (Settings.MSU1)
 		S9xMSU1Init();
 
+	S9xResetCPUBlocks();
 	S9xInitCheatData();
 }
 
@@ -166,5 +168,6 @@ void S9xSoftReset (void)
 	if (Settings.MSU1)
 		S9xMSU1Init();
 
+	S9xResetCPUBlocks();
 	S9xInitCheatData();
 }
@@ -0,0 +1,125 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+/*
+  Block cache for the main CPU.
+
+  S9xMainLoop normally fetches every opcode, checks it for a MEMMAP block
+  crossing and looks its handler up in the table of the current M/X/E mode.
+  For code running from ROM none of that can change between two visits, so
+  straight-line runs are decoded once into a list of handlers, keyed by PB:PC,
+  the host pointer of the block and the opcode table.
+
+  A run ends after any instruction that can leave it (branches, jumps, calls,
+  returns, interrupts), change the mode (REP, SEP, XCE, PLP) or the data bank,
+  or wait (WAI, STP, block moves), and before any instruction whose operand
+  would cross into the next MEMMAP block, so the slow fetch path stays in
+  charge of those.
+
+  ROM is never written by the emulated CPUs (map_WriteProtectROM), but cheats
+  patch it through the Map pointers, so every 4KB page of the ROM allocation
+  has a generation counter that invalidates the blocks decoded from it.
+*/
+
+#include "snes9x.h"
+#include "memmap.h"
+#include "cpublock.h"
+
+#define CPU_BLOCK_PAGE_SHIFT	12
+#define CPU_BLOCK_ROM_SIZE		(CMemory::MAX_ROM_SIZE + 0x200 + 0x8000)
+#define CPU_BLOCK_PAGES			((CPU_BLOCK_ROM_SIZE + (1 << CPU_BLOCK_PAGE_SHIFT) - 1) >> CPU_BLOCK_PAGE_SHIFT)
+
+struct SCPUBlock	CPUBlocks[CPU_BLOCK_ENTRIES];
+uint32				CPUBlockGeneration[CPU_BLOCK_PAGES];
+
+static inline bool8 IsBlockEnd (uint8 op)
+{
+	switch (op)
+	{
+		case 0x10: case 0x30: case 0x50: case 0x70:	// BPL BMI BVC BVS
+		case 0x90: case 0xb0: case 0xd0: case 0xf0:	// BCC BCS BNE BEQ
+		case 0x80: case 0x82:						// BRA BRL
+		case 0x4c: case 0x5c: case 0x6c: case 0x7c:	// JMP JML
+		case 0xdc: case 0x20: case 0x22: case 0xfc:	// JML JSR JSL
+		case 0x60: case 0x6b: case 0x40:			// RTS RTL RTI
+		case 0x00: case 0x02:						// BRK COP
+		case 0x28: case 0xc2: case 0xe2: case 0xfb:	// PLP REP SEP XCE
+		case 0x58: case 0x78:						// CLI SEI
+		case 0xab:									// PLB
+		case 0xcb: case 0xdb:						// WAI STP
+		case 0x44: case 0x54:						// MVP MVN
+			return (TRUE);
+
+		default:
+			return (FALSE);
+	}
+}
+
+static inline uint8 * ROMAllocation (void)
+{
+	return (Memory.ROM - 0x8000);
+}
+
+struct SCPUBlock * S9xBuildCPUBlock (struct SCPUBlock *block)
+{
+	uint8	*start = CPU.PCBase + Registers.PCw;
+
+	// only code in the ROM allocation is covered by the page generations
+	if (start < ROMAllocation() || start >= ROMAllocation() + CPU_BLOCK_ROM_SIZE - 4)
+		return (NULL);
+
+	uint16	pc = Registers.PCw;
+	uint32	count = 0;
+
+	while (count < CPU_BLOCK_MAX_OPS)
+	{
+		uint8	op = CPU.PCBase[pc];
+
+		if ((pc & MEMMAP_MASK) + ICPU.S9xOpLengths[op] >= MEMMAP_BLOCK_SIZE)
+			break;
+
+	#ifdef USE_PROFILER
+		block->Code[count] = op;
+	#endif
+		block->Op[count++] = ICPU.S9xOpcodes[op].S9xOpcode;
+
+		if (IsBlockEnd(op))
+			break;
+
+		pc += ICPU.S9xOpLengths[op];
+	}
+
+	if (!count)
+		return (NULL);
+
+	block->PCBase = CPU.PCBase;
+	block->Opcodes = ICPU.S9xOpcodes;
+	block->Address = Registers.PBPC;
+	block->Page = (start - ROMAllocation()) >> CPU_BLOCK_PAGE_SHIFT;
+	block->Generation = CPUBlockGeneration[block->Page];
+	block->Count = count;
+
+	return (block);
+}
+
+void S9xResetCPUBlocks (void)
+{
+	memset(CPUBlocks, 0, sizeof(CPUBlocks));
+	memset(CPUBlockGeneration, 0, sizeof(CPUBlockGeneration));
+}
+
+void S9xInvalidateCPUBlocks (uint8 *ptr)
+{
+	if (ptr < ROMAllocation() || ptr >= ROMAllocation() + CPU_BLOCK_ROM_SIZE)
+		return;
+
+	uint32	page = (ptr - ROMAllocation()) >> CPU_BLOCK_PAGE_SHIFT;
+
+	// a block starting near the end of the previous page may reach into this one
+	CPUBlockGeneration[page]++;
+	if (page)
+		CPUBlockGeneration[page - 1]++;
+}
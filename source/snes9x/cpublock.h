@@ -0,0 +1,51 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+#ifndef _CPUBLOCK_H_
+#define _CPUBLOCK_H_
+
+#include "cpuexec.h"
+
+#define CPU_BLOCK_MAX_OPS	16
+#define CPU_BLOCK_ENTRIES	2048	// must be a power of two
+
+// A straight-line run of 65c816 instructions fetched from ROM, with the
+// handler of every instruction already looked up in the opcode table of the
+// M/X/E mode the run was decoded in. Operands are still fetched by the
+// handlers themselves.
+struct SCPUBlock
+{
+	uint8			*PCBase;	// CPU.PCBase when the block was decoded
+	struct SOpcodes	*Opcodes;	// ICPU.S9xOpcodes when the block was decoded
+	uint32			Address;	// PB:PC of the first instruction
+	uint32			Page;		// ROM page holding the first instruction
+	uint32			Generation;
+	uint32			Count;
+	void			(*Op[CPU_BLOCK_MAX_OPS]) (void);
+#ifdef USE_PROFILER
+	uint8			Code[CPU_BLOCK_MAX_OPS];	// the opcodes behind Op
+#endif
+};
+
+extern struct SCPUBlock	CPUBlocks[CPU_BLOCK_ENTRIES];
+extern uint32			CPUBlockGeneration[];
+
+struct SCPUBlock * S9xBuildCPUBlock (struct SCPUBlock *);
+void S9xResetCPUBlocks (void);
+void S9xInvalidateCPUBlocks (uint8 *);
+
+static inline struct SCPUBlock * S9xGetCPUBlock (void)
+{
+	struct SCPUBlock	*block = &CPUBlocks[(Registers.PBPC ^ (Registers.PBPC >> 11)) & (CPU_BLOCK_ENTRIES - 1)];
+
+	if (block->Address == Registers.PBPC && block->PCBase == CPU.PCBase && block->Opcodes == ICPU.S9xOpcodes &&
+		block->Generation == CPUBlockGeneration[block->Page])
+		return (block);
+
+	return (S9xBuildCPUBlock(block));
+}
+
+#endif
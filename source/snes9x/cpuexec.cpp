@@ -12,6 +12,9 @@
 #include "fxemu.h"
 #include "snapshot.h"
 #include "movie.h"
+#include "cpublock.h"
+#include "runahead.h"
+#include "profile.h"
 #ifdef DEBUGGER
 #include "debug.h"
 #include "missing.h"
@@ -135,13 +138,54 @@ void S9xMainLoop (void)
 			#ifdef DEBUGGER
 			if (!(CPU.Flags & FRAME_ADVANCE_FLAG))
 			#endif
+			if (!RunAheadSpeculating)
 			{
 				S9xSyncSpeed();
 			}
 
+			PROFILE_END_FRAME();
 			break;
 		}
 
+	#ifndef DEBUGGER
+		if (CPU.PCBase && Settings.CPUBlockCache && !Settings.BS && Memory.BlockIsROM[Registers.PBPC >> MEMMAP_SHIFT])
+		{
+			struct SCPUBlock	*block = S9xGetCPUBlock();
+
+			if (block)
+			{
+				// run the block until something needs the checks above again
+				for (uint32 i = 0; ; )
+				{
+					CPU.Cycles += CPU.MemSpeed;
+					Registers.PCw++;
+					PROFILE_OP_BEGIN(op, block->Code[i]);
+					(*block->Op[i])();
+					PROFILE_OP_END(op, block->Code[i]);
+
+					if (Settings.SA1)
+					{
+						SA1.SyncCycles = CPU.Cycles;
+						if (++SA1.Slice >= SA1.SliceEnd)
+						{
+							PROFILE_SAMPLE_BEGIN(sa1, PROFILE_SA1);
+							S9xSA1MainLoop();
+							PROFILE_SAMPLE_END(sa1, PROFILE_SA1);
+						}
+					}
+
+					if (++i == block->Count ||
+						CPU.NMIPending || Timings.IRQFlagChanging || CPU.Cycles >= Timings.NextIRQTimer ||
+						((CPU.IRQLine || CPU.IRQExternal) && !CheckFlag(IRQ)) || (CPU.Flags & SCAN_KEYS_FLAG) ||
+						CPU.PCBase != block->PCBase || ICPU.S9xOpcodes != block->Opcodes)
+						break;
+				}
+
+				continue;
+			}
+		}
+	#endif
+
 		uint8				Op;
 		struct	SOpcodes	*Opcodes;
 
@@ -168,10 +212,20 @@ void S9xMainLoop (void)
 		}
 
 		Registers.PCw++;
+		PROFILE_OP_BEGIN(op, Op);
 		(*Opcodes[Op].S9xOpcode)();
+		PROFILE_OP_END(op, Op);
 
 		if (Settings.SA1)
-			S9xSA1MainLoop();
+		{
+			SA1.SyncCycles = CPU.Cycles;
+			if (++SA1.Slice >= SA1.SliceEnd)
+			{
+				PROFILE_SAMPLE_BEGIN(sa1, PROFILE_SA1);
+				S9xSA1MainLoop();
+				PROFILE_SAMPLE_END(sa1, PROFILE_SA1);
+			}
+		}
 	}
 
 	S9xPackStatus();
@@ -234,6 +288,11 @@ void S9xDoHEventProcessing (void)
 			eventname[CPU.WhichEvent], CPU.NextEvent, CPU.Cycles, CPU.V_Counter);
 #endif
 
+#ifdef USE_PROFILER
+	int	event = PROFILE_EVENT_HBLANK_START + CPU.WhichEvent - HC_HBLANK_START_EVENT;
+#endif
+	PROFILE_SAMPLE_BEGIN(start, event);
+
 	switch (CPU.WhichEvent)
 	{
 		case HC_HBLANK_START_EVENT:
@@ -248,7 +307,9 @@ void S9xDoHEventProcessing (void)
 			#ifdef DEBUGGER
 				S9xTraceFormattedMessage("*** HDMA Transfer HC:%04d, Channel:%02x", CPU.Cycles, PPU.HDMA);
 			#endif
+				PROFILE_BEGIN(hdma);
 				PPU.HDMA = S9xDoHDMA(PPU.HDMA);
+				PROFILE_END(hdma, PROFILE_HDMA, 1);
 			}
 
 			break;
@@ -270,7 +331,10 @@ void S9xDoHEventProcessing (void)
 			S9xAPUSetReferenceTime(CPU.Cycles);
 
 			if (Settings.SA1)
+			{
 				SA1.Cycles -= Timings.H_Max * 3;
+				SA1.SyncCycles -= Timings.H_Max;
+			}
 
 			CPU.V_Counter++;
 			if (CPU.V_Counter >= Timings.V_Max)	// V ranges from 0 to Timings.V_Max - 1
@@ -417,6 +481,8 @@ void S9xDoHEventProcessing (void)
 			break;
 	}
 
+	PROFILE_SAMPLE_END(start, event);
+
 #ifdef DEBUGGER
 	if (Settings.TraceHCEvent)
 		S9xTraceFormattedMessage("--- HC event rescheduled (%s)  expected HC:%04d  current  HC:%04d",
@@ -2616,6 +2616,9 @@ void S9xOpcode_IRQ (void)
 		AddCycles(2 * ONE_CYCLE);
 		S9xSA1SetPCBase(Memory.FillRAM[0x2207] | (Memory.FillRAM[0x2208] << 8));
 	#else
+		if (Settings.SA1)
+			S9xSA1CatchUp();
+
 		if (Settings.SA1 && (Memory.FillRAM[0x2209] & 0x40))
 		{
 			OpenBus = Memory.FillRAM[0x220f];
@@ -2644,6 +2647,9 @@ void S9xOpcode_IRQ (void)
 		AddCycles(2 * ONE_CYCLE);
 		S9xSA1SetPCBase(Memory.FillRAM[0x2207] | (Memory.FillRAM[0x2208] << 8));
 	#else
+		if (Settings.SA1)
+			S9xSA1CatchUp();
+
 		if (Settings.SA1 && (Memory.FillRAM[0x2209] & 0x40))
 		{
 			OpenBus = Memory.FillRAM[0x220f];
@@ -2691,6 +2697,9 @@ void S9xOpcode_NMI (void)
 		AddCycles(2 * ONE_CYCLE);
 		S9xSA1SetPCBase(Memory.FillRAM[0x2205] | (Memory.FillRAM[0x2206] << 8));
 	#else
+		if (Settings.SA1)
+			S9xSA1CatchUp();
+
 		if (Settings.SA1 && (Memory.FillRAM[0x2209] & 0x10))
 		{
 			OpenBus = Memory.FillRAM[0x220d];
@@ -2719,6 +2728,9 @@ void S9xOpcode_NMI (void)
 		AddCycles(2 * ONE_CYCLE);
 		S9xSA1SetPCBase(Memory.FillRAM[0x2205] | (Memory.FillRAM[0x2206] << 8));
 	#else
+		if (Settings.SA1)
+			S9xSA1CatchUp();
+
 		if (Settings.SA1 && (Memory.FillRAM[0x2209] & 0x10))
 		{
 			OpenBus = Memory.FillRAM[0x220d];
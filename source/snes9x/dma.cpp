@@ -51,6 +51,10 @@ static inline bool8 addCyclesInDMA (uint8 dma_channel)
 
 bool8 S9xDoDMA (uint8 Channel)
 {
+	// I-RAM and BW-RAM are read through base pointers below
+	if (Settings.SA1)
+		S9xSA1CatchUp();
+
 	CPU.InDMA = TRUE;
     CPU.InDMAorHDMA = TRUE;
 	CPU.CurrentDMAorHDMAChannel = Channel;
@@ -141,7 +145,16 @@ bool8 S9xDoDMA (uint8 Channel)
 			if (in_ptr)
 			{
 				in_ptr += d->AAddress;
-				SDD1_decompress(sdd1_decode_buffer, in_ptr, d->TransferBytes);
+
+				// ROM never changes, so its blocks can be decoded once
+				if (in_ptr >= Memory.ROM && in_ptr < Memory.ROM + Memory.CalculatedSize)
+					in_sdd1_dma = SDD1_decompress_cached(in_ptr, d->TransferBytes);
+
+				if (!in_sdd1_dma)
+				{
+					SDD1_decompress(sdd1_decode_buffer, in_ptr, d->TransferBytes);
+					in_sdd1_dma = sdd1_decode_buffer;
+				}
 			}
 		#ifdef DEBUGGER
 			else
@@ -151,7 +164,8 @@ bool8 S9xDoDMA (uint8 Channel)
 			}
 		#endif
 
-			in_sdd1_dma = sdd1_decode_buffer;
+			if (!in_sdd1_dma)
+				in_sdd1_dma = sdd1_decode_buffer;
 		}
 
 		Memory.FillRAM[0x4801] = 0;
@@ -662,33 +676,89 @@ bool8 S9xDoDMA (uint8 Channel)
 						// VMDATAL
 						if (!PPU.VMA.FullGraphicCount)
 						{
-							switch (b)
+							// Copy in blocks up to the next event while the bytes land one
+							// after the other; the byte that reaches it goes the slow way.
+							while (count > 0 && inc == 1 && PPU.VMA.High && PPU.VMA.Increment == 1 && S9xVRAMWritable())
 							{
-								default:
-								while (count > 1)
+								int32	n = (CPU.NextEvent - CPU.Cycles - 1) / SLOW_ONE_CYCLE;
+
+								if (n > 0)
+								{
+									if (n > count)
+										n = count;
+
+									S9xWriteVRAMBlock(base + p, n, b);
+
+									// the last bytes written to each register
+									if (b == (n & 1))
+									{
+										OpenBus = *(base + p + n - 1);
+										if (n > 1)
+											Work = *(base + p + n - 2);
+									}
+									else
+									{
+										Work = *(base + p + n - 1);
+										if (n > 1)
+											OpenBus = *(base + p + n - 2);
+									}
+
+									ADD_CYCLES(n * SLOW_ONE_CYCLE);
+									d->TransferBytes -= n;
+									d->AAddress += n;
+									p += n;
+									count -= n;
+									b = (b + n) & 1;
+									continue;
+								}
+
+								if (b)
 								{
-									Work = *(base + p);
-									REGISTER_2118_linear(Work);
-									UPDATE_COUNTERS;
-									count--;
-								// Fall through
-								case 1:
 									OpenBus = *(base + p);
 									REGISTER_2119_linear(OpenBus);
-									UPDATE_COUNTERS;
-									count--;
 								}
+								else
+								{
+									Work = *(base + p);
+									REGISTER_2118_linear(Work);
+								}
+
+								UPDATE_COUNTERS;
+								count--;
+								b ^= 1;
 							}
 
-							if (count == 1)
+							// the blocks can use up the chunk, their b then carries on
+							if (count > 0)
 							{
-								Work = *(base + p);
-								REGISTER_2118_linear(Work);
-								UPDATE_COUNTERS;
-								b = 1;
+								switch (b)
+								{
+									default:
+									while (count > 1)
+									{
+										Work = *(base + p);
+										REGISTER_2118_linear(Work);
+										UPDATE_COUNTERS;
+										count--;
+									// Fall through
+									case 1:
+										OpenBus = *(base + p);
+										REGISTER_2119_linear(OpenBus);
+										UPDATE_COUNTERS;
+										count--;
+									}
+								}
+
+								if (count == 1)
+								{
+									Work = *(base + p);
+									REGISTER_2118_linear(Work);
+									UPDATE_COUNTERS;
+									b = 1;
+								}
+								else
+									b = 0;
 							}
-							else
-								b = 0;
 						}
 						else
 						{
@@ -1244,6 +1314,9 @@ uint8 S9xDoHDMA (uint8 byte)
 	int	d;
 	uint8	mask;
 
+	if (Settings.SA1)
+		S9xSA1CatchUp();
+
 	CPU.InHDMA = TRUE;
 	CPU.InDMAorHDMA = TRUE;
 	CPU.HDMARanInDMA = CPU.InDMA ? byte : 0;
@@ -8,6 +8,7 @@
 #include "memmap.h"
 #include "fxinst.h"
 #include "fxemu.h"
+#include "profile.h"
 
 static void FxReset (struct FxInfo_s *);
 static void fx_readRegisterSpace (void);
@@ -38,6 +39,7 @@ void S9xResetSuperFX (void)
 	SuperFX.vFlags = 0;
 	CPU.IRQExternal = FALSE;
 	FxReset(&SuperFX);
+	fx_flushDecodeCache();
 }
 
 void S9xSetSuperFX (uint8 byte, uint16 address)
@@ -148,9 +150,9 @@ void S9xSuperFXExec (void)
 {
 	if ((Memory.FillRAM[0x3000 + GSU_SFR] & FLG_G) && (Memory.FillRAM[0x3000 + GSU_SCMR] & 0x18) == 0x18)
 	{
-		#ifdef GEKKO
+		PROFILE_BEGIN(start);
 		FxEmulate(((Memory.FillRAM[0x3000 + GSU_CLSR] & 1) ? (SuperFX.speedPerLine * Timings.SuperFX2CoreSpeed) : SuperFX.speedPerLine) * Settings.SuperFXClockMultiplier / 100);
-		#endif
+		PROFILE_END(start, PROFILE_SUPERFX, 1);
 
 		uint16 GSUStatus = Memory.FillRAM[0x3000 + GSU_SFR] | (Memory.FillRAM[0x3000 + GSU_SFR + 1] << 8);
 		if ((GSUStatus & (FLG_G | FLG_IRQ)) == FLG_IRQ)
@@ -166,6 +168,9 @@ static void FxReset (struct FxInfo_s *psFxInfo)
 	// Set default registers
 	GSU.pvSreg = GSU.pvDreg = &R0;
 
+	// No pixels are waiting to be plotted
+	GSU.vPlotRow = ~0;
+
 	// Set RAM and ROM pointers
 	GSU.pvRegisters       = psFxInfo->pvRegisters;
 	GSU.nRamBanks         = psFxInfo->nRamBanks;
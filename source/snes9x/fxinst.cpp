@@ -11,6 +11,81 @@
 // Set this define if you wish the plot instruction to check for y-pos limits (I don't think it's nessecary)
 #define CHECK_LIMITS
 
+// Banks 70-73 are the GSU RAM
+#define FX_RAM_BANK(bank)	(((bank) & 0x7c) == 0x70)
+
+#ifdef FX_PLOT_BUFFER
+
+// Plots only go to GSU.avPlotPlanes until a pixel of another row is plotted,
+// so the bitplanes are read and written once per row instead of per pixel.
+// Whatever reads or writes the GSU RAM, or moves the screen, has to flush
+// the row first.
+#define FX_FLUSH_PLOT	if (GSU.vPlotMask) fx_flushPlot()
+
+// 4 bitplanes of a colour nibble
+static const uint32	fx_PlaneBytes[16] =
+{
+	0x00000000, 0x000000ff, 0x0000ff00, 0x0000ffff, 0x00ff0000, 0x00ff00ff, 0x00ffff00, 0x00ffffff,
+	0xff000000, 0xff0000ff, 0xff00ff00, 0xff00ffff, 0xffff0000, 0xffff00ff, 0xffffff00, 0xffffffff
+};
+
+static void fx_flushPlot (void)
+{
+	uint8	*a = GSU.pvPlotRow;
+	uint8	m = (uint8) GSU.vPlotMask;
+	uint32	p = GSU.avPlotPlanes[0];
+
+	a[0x00] = (a[0x00] & ~m) | ((uint8) (p      ) & m);
+	a[0x01] = (a[0x01] & ~m) | ((uint8) (p >>  8) & m);
+
+	if (GSU.vMode != 0)
+	{
+		a[0x10] = (a[0x10] & ~m) | ((uint8) (p >> 16) & m);
+		a[0x11] = (a[0x11] & ~m) | ((uint8) (p >> 24) & m);
+
+		if (GSU.vMode == 3)
+		{
+			p = GSU.avPlotPlanes[1];
+			a[0x20] = (a[0x20] & ~m) | ((uint8) (p      ) & m);
+			a[0x21] = (a[0x21] & ~m) | ((uint8) (p >>  8) & m);
+			a[0x30] = (a[0x30] & ~m) | ((uint8) (p >> 16) & m);
+			a[0x31] = (a[0x31] & ~m) | ((uint8) (p >> 24) & m);
+		}
+	}
+
+	GSU.vPlotMask = 0;
+	GSU.vPlotRow = ~0;
+}
+
+static inline void fx_bufferPixel (uint32 x, uint32 y, uint8 c, bool8 high)
+{
+	uint32	row = (y << 5) | (x >> 3);
+	uint8	v = 128 >> (x & 7);
+	uint32	m = v * 0x01010101;
+
+	if (row != GSU.vPlotRow)
+	{
+		FX_FLUSH_PLOT;
+		GSU.vPlotRow = row;
+		GSU.pvPlotRow = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
+	}
+
+	GSU.avPlotPlanes[0] = (GSU.avPlotPlanes[0] & ~m) | (fx_PlaneBytes[c & 0xf] & m);
+	if (high)
+		GSU.avPlotPlanes[1] = (GSU.avPlotPlanes[1] & ~m) | (fx_PlaneBytes[c >> 4] & m);
+	GSU.vPlotMask |= v;
+
+	// code and R14 reads can come from the RAM too
+	if (FX_RAM_BANK(GSU.vPrgBankReg) || FX_RAM_BANK(GSU.vRomBankReg))
+		fx_flushPlot();
+}
+
+#else
+
+#define FX_FLUSH_PLOT
+
+#endif
+
 
 /*
  Codes used:
@@ -393,6 +468,7 @@ static void fx_with_r15 (void)
 
 // 30-3b - stw (rn) - store word
 #define FX_STW(reg) \
+	FX_FLUSH_PLOT; \
 	GSU.vLastRamAdr = GSU.avReg[reg]; \
 	RAM(GSU.avReg[reg]) = (uint8) SREG; \
 	RAM(GSU.avReg[reg] ^ 1) = (uint8) (SREG >> 8); \
@@ -461,6 +537,7 @@ static void fx_stw_r11 (void)
 
 // 30-3b (ALT1) - stb (rn) - store byte
 #define FX_STB(reg) \
+	FX_FLUSH_PLOT; \
 	GSU.vLastRamAdr = GSU.avReg[reg]; \
 	RAM(GSU.avReg[reg]) = (uint8) SREG; \
 	CLRFLAGS; \
@@ -564,6 +641,7 @@ static void fx_alt3 (void)
 
 // 40-4b - ldw (rn) - load word from RAM
 #define FX_LDW(reg) \
+	FX_FLUSH_PLOT; \
 	uint32	v; \
 	GSU.vLastRamAdr = GSU.avReg[reg]; \
 	v = (uint32) RAM(GSU.avReg[reg]); \
@@ -635,6 +713,7 @@ static void fx_ldw_r11 (void)
 
 // 40-4b (ALT1) - ldb (rn) - load byte
 #define FX_LDB(reg) \
+	FX_FLUSH_PLOT; \
 	uint32	v; \
 	GSU.vLastRamAdr = GSU.avReg[reg]; \
 	v = (uint32) RAM(GSU.avReg[reg]); \
@@ -708,8 +787,7 @@ static void fx_plot_2bit (void)
 {
 	uint32	x = USEX8(R1);
 	uint32	y = USEX8(R2);
-	uint8	*a;
-	uint8	v, c;
+	uint8	c;
 
 	R15++;
 	CLRFLAGS;
@@ -728,8 +806,11 @@ static void fx_plot_2bit (void)
 	else
 		c = (uint8) GSU.vColorReg;
 
-	a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
-	v = 128 >> (x & 7);
+#ifdef FX_PLOT_BUFFER
+	fx_bufferPixel(x, y, c, FALSE);
+#else
+	uint8	*a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
+	uint8	v = 128 >> (x & 7);
 
 	if (c & 0x01)
 		a[0] |=  v;
@@ -740,6 +821,7 @@ static void fx_plot_2bit (void)
 		a[1] |=  v;
 	else
 		a[1] &= ~v;
+#endif
 }
 
 // 4c (ALT1) - rpix - read color of the pixel with R1, R2 as x, y
@@ -750,6 +832,7 @@ static void fx_rpix_2bit (void)
 	uint8	*a;
 	uint8	v;
 
+	FX_FLUSH_PLOT;
 	R15++;
 	CLRFLAGS;
 
@@ -772,8 +855,7 @@ static void fx_plot_4bit (void)
 {
 	uint32	x = USEX8(R1);
 	uint32	y = USEX8(R2);
-	uint8	*a;
-	uint8	v, c;
+	uint8	c;
 
 	R15++;
 	CLRFLAGS;
@@ -792,8 +874,11 @@ static void fx_plot_4bit (void)
 	else
 		c = (uint8) GSU.vColorReg;
 
-	a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
-	v = 128 >> (x & 7);
+#ifdef FX_PLOT_BUFFER
+	fx_bufferPixel(x, y, c, FALSE);
+#else
+	uint8	*a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
+	uint8	v = 128 >> (x & 7);
 
 	if (c & 0x01)
 		a[0x00] |=  v;
@@ -814,6 +899,7 @@ static void fx_plot_4bit (void)
 		a[0x11] |=  v;
 	else
 		a[0x11] &= ~v;
+#endif
 }
 
 // 4c (ALT1) - rpix - read color of the pixel with R1, R2 as x, y
@@ -824,6 +910,7 @@ static void fx_rpix_4bit (void)
 	uint8	*a;
 	uint8	v;
 
+	FX_FLUSH_PLOT;
 	R15++;
 	CLRFLAGS;
 
@@ -848,8 +935,7 @@ static void fx_plot_8bit (void)
 {
 	uint32	x = USEX8(R1);
 	uint32	y = USEX8(R2);
-	uint8	*a;
-	uint8	v, c;
+	uint8	c;
 
 	R15++;
 	CLRFLAGS;
@@ -870,8 +956,11 @@ static void fx_plot_8bit (void)
 	if (!(GSU.vPlotOptionReg & 0x01) && !c)
 		return;
 
-	a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
-	v = 128 >> (x & 7);
+#ifdef FX_PLOT_BUFFER
+	fx_bufferPixel(x, y, c, TRUE);
+#else
+	uint8	*a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
+	uint8	v = 128 >> (x & 7);
 
 	if (c & 0x01)
 		a[0x00] |=  v;
@@ -912,6 +1001,7 @@ static void fx_plot_8bit (void)
 		a[0x31] |=  v;
 	else
 		a[0x31] &= ~v;
+#endif
 }
 
 // 4c (ALT1) - rpix - read color of the pixel with R1, R2 as x, y
@@ -922,6 +1012,7 @@ static void fx_rpix_8bit (void)
 	uint8	*a;
 	uint8	v;
 
+	FX_FLUSH_PLOT;
 	R15++;
 	CLRFLAGS;
 
@@ -998,6 +1089,7 @@ static void fx_color (void)
 // 4e (ALT1) - cmode - set plot option register
 static void fx_cmode (void)
 {
+	FX_FLUSH_PLOT;
 	GSU.vPlotOptionReg = SREG;
 
 	if (GSU.vPlotOptionReg & 0x10)
@@ -2473,6 +2565,7 @@ static void fx_umult_i15 (void)
 // 90 - sbk - store word to last accessed RAM address
 static void fx_sbk (void)
 {
+	FX_FLUSH_PLOT;
 	RAM(GSU.vLastRamAdr) = (uint8) SREG;
 	RAM(GSU.vLastRamAdr ^ 1) = (uint8) (SREG >> 8);
 	CLRFLAGS;
@@ -2599,6 +2692,7 @@ static void fx_jmp_r13 (void)
 
 // 98-9d (ALT1) - ljmp rn - set program bank to source register and jump to address of register
 #define FX_LJMP(reg) \
+	FX_FLUSH_PLOT; \
 	GSU.vPrgBankReg = GSU.avReg[reg] & 0x7f; \
 	GSU.pvPrgBank = GSU.apvRomBank[GSU.vPrgBankReg]; \
 	R15 = SREG; \
@@ -2772,6 +2866,7 @@ static void fx_ibt_r15 (void)
 
 // a0-af (ALT1) - lms rn, (yy) - load word from RAM (short address)
 #define FX_LMS(reg) \
+	FX_FLUSH_PLOT; \
 	GSU.vLastRamAdr = ((uint32) PIPE) << 1; \
 	R15++; \
 	FETCHPIPE; \
@@ -2864,6 +2959,7 @@ static void fx_lms_r15 (void)
 // a0-af (ALT2) - sms (yy), rn - store word in RAM (short address)
 // XXX: If rn == r15, is the value of r15 before or after the extra byte is read ?
 #define FX_SMS(reg) \
+	FX_FLUSH_PLOT; \
 	uint32	v = GSU.avReg[reg]; \
 	GSU.vLastRamAdr = ((uint32) PIPE) << 1; \
 	R15++; \
@@ -3525,6 +3621,7 @@ static void fx_ramb (void)
 // df (ALT3) - romb - set current ROM bank
 static void fx_romb (void)
 {
+	FX_FLUSH_PLOT;
 	GSU.vRomBankReg = USEX8(SREG) & 0x7f;
 	GSU.pvRomBank = GSU.apvRomBank[GSU.vRomBankReg];
 	CLRFLAGS;
@@ -3774,6 +3871,7 @@ static void fx_iwt_r15 (void)
 
 // f0-ff (ALT1) - lm rn, (xx) - load word from RAM
 #define FX_LM(reg) \
+	FX_FLUSH_PLOT; \
 	GSU.vLastRamAdr = PIPE; \
 	R15++; \
 	FETCHPIPE; \
@@ -3869,6 +3967,7 @@ static void fx_lm_r15 (void)
 // f0-ff (ALT2) - sm (xx), rn - store word in RAM
 // XXX: If rn == r15, is the value of r15 before or after the extra bytes are read ?
 #define FX_SM(reg) \
+	FX_FLUSH_PLOT; \
 	uint32	v = GSU.avReg[reg]; \
 	GSU.vLastRamAdr = PIPE; \
 	R15++; \
@@ -3961,13 +4060,169 @@ static void fx_sm_r15 (void)
 	FX_SM(15);
 }
 
+#ifdef FX_DECODE_CACHE
+
+// Runs of decoded instructions, starting at an offset into the cache with no
+// ALT or B flags set and R0 as the destination. The prefixes within a run are
+// known, so every instruction is stored as the handler for its ALT mode. A
+// run ends after anything that may write R15, so the rest of it always runs
+// in order. The code is read from the program bank, like FX_STEP does, and
+// only from the ROM.
+#define FX_DECODE_RUN	32		// instructions in the longest run
+#define FX_DECODE_OPS	4096	// shared by all runs, decoding starts over when they are used up
+
+namespace fxdecode
+{
+	static void		(*ops[FX_DECODE_OPS]) (void);
+	static uint16	start[512];		// of the run at each cache offset, 0 if not decoded yet
+	static uint8	length[512];	// 0 if none can start there
+	static uint32	used = 1;
+
+	// what the runs were decoded for
+	static uint8	*bank = NULL;
+	static uint32	base = 0;
+	static void		(*plot) (void) = NULL;
+} // namespace fxdecode
+
+using namespace fxdecode;
+
+// The runs point into Memory.ROM, which a reset, another game or a ROM write
+// from a cheat changes under them
+void fx_flushDecodeCache (void)
+{
+	memset(start, 0, sizeof(start));
+	memset(length, 0, sizeof(length));
+	used = 1;
+	bank = NULL;
+}
+
+static void fx_decodeRun (uint32 offset)
+{
+	uint32	alt = 0, dreg = 0, end = 0, n = 0;
+	bool8	b = FALSE;
+
+	if (used + FX_DECODE_RUN > FX_DECODE_OPS)
+	{
+		memset(start, 0, sizeof(start));
+		used = 1;
+	}
+
+	while (n < FX_DECODE_RUN)
+	{
+		uint32	op = PRGBANK(base + offset + end);
+		uint32	size = op >= 0xf0 ? 3 : ((op >= 0x05 && op <= 0x0f) || (op >= 0xa0 && op <= 0xaf)) ? 2 : 1;
+		bool8	prefix = (op >= 0x3d && op <= 0x3f) || (op & 0xf0) == 0x20 || (!b && ((op & 0xf0) == 0x10 || (op & 0xf0) == 0xb0));
+
+		if (offset + end + size > 512)
+			break;
+
+		end += size;
+		ops[used + n++] = fx_OpcodeTable[alt | op];
+
+		// stop, cache, branches, loop, jmp and ljmp, ibt/iwt/lms/lm r15,
+		// move to r15 and everything with r15 as the destination
+		if (op == 0x00 || op == 0x02 || (op >= 0x05 && op <= 0x0f) || op == 0x3c || (op >= 0x98 && op <= 0x9d) || op == 0xaf || op == 0xff ||
+			(b && op == 0x1f) || (dreg == 15 && !prefix))
+			break;
+
+		// The next ALT mode and destination. Prefixes set them, to and from
+		// keep them unless the B flag makes them move and moves.
+		if (op >= 0x3d && op <= 0x3f)
+		{
+			alt |= (op - 0x3c) << 8;
+			b = FALSE;
+		}
+		else
+		if ((op & 0xf0) == 0x20)
+		{
+			dreg = op & 0xf;
+			b = TRUE;
+		}
+		else
+		if (!prefix)
+		{
+			alt = dreg = 0;
+			b = FALSE;
+		}
+		else
+		if ((op & 0xf0) == 0x10)
+			dreg = op & 0xf;
+	}
+
+	start[offset] = used;
+	length[offset] = n;
+	used += n;
+}
+
+// Returns the number of instructions in the run the pipe starts, 0 if there is none.
+static inline uint32 fx_findRun (uint32 offset)
+{
+	if (!GSU.bCacheActive || offset >= 512 || (GSU.vStatusReg & (FLG_ALT1 | FLG_ALT2 | FLG_B)) || GSU.pvDreg != &R0 || FX_RAM_BANK(GSU.vPrgBankReg))
+		return (0);
+
+	if (GSU.pvPrgBank != bank || GSU.vCacheBaseReg != base || GSU.pfPlot != plot)
+	{
+		memset(start, 0, sizeof(start));
+		used = 1;
+		bank = GSU.pvPrgBank;
+		base = GSU.vCacheBaseReg;
+		plot = GSU.pfPlot;
+	}
+
+	if (!start[offset])
+		fx_decodeRun(offset);
+
+	// after a jump the pipe holds the delay slot, not the byte before R15
+	if (PIPE != PRGBANK(R15 - 1))
+		return (0);
+
+	return (length[offset]);
+}
+
+#else
+
+void fx_flushDecodeCache (void)
+{
+}
+
+#endif
+
 // GSU executions functions
 
 uint32 fx_run (uint32 nInstructions)
 {
 	GSU.vCounter = nInstructions;
+#ifdef FX_DECODE_CACHE
+	while (TF(G) && GSU.vCounter > 0)
+	{
+		uint32	offset = USEX16(R15 - 1 - GSU.vCacheBaseReg);
+		uint32	n = fx_findRun(offset);
+
+		if (n && n <= GSU.vCounter)
+		{
+			void	(**op) (void) = &ops[start[offset]];
+
+			GSU.vCounter -= n;
+			do
+			{
+				FETCHPIPE;
+				(*(*op++))();
+			}
+			while (--n);
+
+			// a run mostly ends at a jump, and the pipe holds its delay slot
+			if (!TF(G) || !GSU.vCounter)
+				break;
+		}
+
+		GSU.vCounter--;
+		FX_STEP;
+	}
+#else
 	while (TF(G) && (GSU.vCounter-- > 0))
 		FX_STEP;
+#endif
+	FX_FLUSH_PLOT;
 #if 0
 #ifndef FX_ADDRESS_CHECK
 	GSU.vPipeAdr = USEX16(R15 - 1) | (USEX8(GSU.vPrgBankReg) << 16);
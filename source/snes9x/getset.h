@@ -84,7 +84,6 @@ inline uint8 S9xGetByte (uint32 Address)
 			return (byte);
 
 		case CMemory::MAP_LOROM_SRAM:
-		case CMemory::MAP_SA1RAM:
 			// Address & 0x7fff   : offset into bank
 			// Address & 0xff0000 : bank
 			// bank >> 1 | offset : SRAM address, unbound
@@ -105,10 +104,17 @@ inline uint8 S9xGetByte (uint32 Address)
 			return (byte);
 
 		case CMemory::MAP_BWRAM:
+			S9xSA1CatchUp();
 			byte = *(Memory.BWRAM + ((Address & 0x7fff) - 0x6000));
 			addCyclesInMemoryAccess;
 			return (byte);
 
+		case CMemory::MAP_SA1RAM:
+			S9xSA1CatchUp();
+			byte = *(Memory.SRAM + (Address & 0x3ffff));
+			addCyclesInMemoryAccess;
+			return (byte);
+
 		case CMemory::MAP_DSP:
 			byte = S9xGetDSP(Address & 0xffff);
 			addCyclesInMemoryAccess;
@@ -220,7 +226,6 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 			return (word);
 
 		case CMemory::MAP_LOROM_SRAM:
-		case CMemory::MAP_SA1RAM:
 			if (Memory.SRAMMask >= MEMMAP_MASK)
 				word = READ_WORD(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask));
 			else
@@ -249,10 +254,17 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 			return (word);
 
 		case CMemory::MAP_BWRAM:
+			S9xSA1CatchUp();
 			word = READ_WORD(Memory.BWRAM + ((Address & 0x7fff) - 0x6000));
 			addCyclesInMemoryAccess_x2;
 			return (word);
 
+		case CMemory::MAP_SA1RAM:
+			S9xSA1CatchUp();
+			word = READ_WORD(Memory.SRAM + (Address & 0x3ffff));
+			addCyclesInMemoryAccess_x2;
+			return (word);
+
 		case CMemory::MAP_DSP:
 			word  = S9xGetDSP(Address & 0xffff);
 			addCyclesInMemoryAccess;
@@ -376,13 +388,16 @@ inline void S9xSetByte (uint8 Byte, uint32 Address)
 			return;
 
 		case CMemory::MAP_BWRAM:
+			S9xSA1CatchUp();
 			*(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)) = Byte;
 			CPU.SRAMModified = TRUE;
 			addCyclesInMemoryAccess;
 			return;
 
 		case CMemory::MAP_SA1RAM:
-			*(Memory.SRAM + (Address & 0xffff)) = Byte;
+			S9xSA1CatchUp();
+			*(Memory.SRAM + (Address & 0x3ffff)) = Byte;
+			CPU.SRAMModified = TRUE;
 			addCyclesInMemoryAccess;
 			return;
 
@@ -569,13 +584,16 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 			return;
 
 		case CMemory::MAP_BWRAM:
+			S9xSA1CatchUp();
 			WRITE_WORD(Memory.BWRAM + ((Address & 0x7fff) - 0x6000), Word);
 			CPU.SRAMModified = TRUE;
 			addCyclesInMemoryAccess_x2;
 			return;
 
 		case CMemory::MAP_SA1RAM:
-			WRITE_WORD(Memory.SRAM + (Address & 0xffff), Word);
+			S9xSA1CatchUp();
+			WRITE_WORD(Memory.SRAM + (Address & 0x3ffff), Word);
+			CPU.SRAMModified = TRUE;
 			addCyclesInMemoryAccess_x2;
 			return;
 
@@ -738,7 +756,7 @@ inline void S9xSetPCBase (uint32 Address)
 			return;
 
 		case CMemory::MAP_SA1RAM:
-			CPU.PCBase = Memory.SRAM;
+			CPU.PCBase = Memory.SRAM + (Address & 0x30000);
 			return;
 
 		case CMemory::MAP_SPC7110_ROM:
@@ -792,7 +810,7 @@ inline uint8 * S9xGetBasePointer (uint32 Address)
 			return (Memory.BWRAM - 0x6000 - (Address & 0x8000));
 
 		case CMemory::MAP_SA1RAM:
-			return (Memory.SRAM);
+			return (Memory.SRAM + (Address & 0x30000));
 
 		case CMemory::MAP_SPC7110_ROM:
 			return (S9xGetBasePointerSPC7110(Address));
@@ -14,10 +14,12 @@
 #include "screenshot.h"
 #include "font.h"
 #include "display.h"
+#include "gfxthread.h"
+#include "profile.h"
 
 extern struct SCheatData		Cheat;
-extern struct SLineData			LineData[240];
-extern struct SLineMatrixData	LineMatrixData[240];
+extern RENDER_LOCAL struct SLineData		LineData[240];
+extern RENDER_LOCAL struct SLineMatrixData	LineMatrixData[240];
 
 void S9xComputeClipWindows (void);
 
@@ -38,6 +40,7 @@ static void DrawBackgroundOffsetMosaic (int, uint8, uint8, int);
 static inline void DrawBackgroundMode7 (int, void (*DrawMath) (uint32, uint32, int), void (*DrawNomath) (uint32, uint32, int), int);
 static inline void DrawBackdrop (void);
 static inline void RenderScreen (bool8);
+static void DrawScreen (void);
 static uint16 get_crosshair_color (uint8);
 static void S9xDisplayStringType (const char *, int, int, bool, int);
 
@@ -49,6 +52,9 @@ bool8 S9xGraphicsInit (void)
 	S9xInitTileRenderer();
 	memset(BlackColourMap, 0, 256 * sizeof(uint16));
 
+	GFX.VRAM = Memory.VRAM;
+	GFX.FillRAM = Memory.FillRAM;
+	GFX.Threaded = FALSE;
 	GFX.RealPPL = GFX.Pitch >> 1;
 	IPPU.OBJChanged = TRUE;
 	Settings.BG_Forced = 0;
@@ -61,8 +67,9 @@ bool8 S9xGraphicsInit (void)
 	GFX.SubScreen  = (uint16 *) malloc(GFX.ScreenSize * sizeof(uint16));
 	GFX.ZBuffer    = (uint8 *)  malloc(GFX.ScreenSize);
 	GFX.SubZBuffer = (uint8 *)  malloc(GFX.ScreenSize);
+	GFX.MathMask   = (uint8 *)  calloc(GFX.ScreenSize, 1);
 
-	if (!GFX.ZERO || !GFX.SubScreen || !GFX.ZBuffer || !GFX.SubZBuffer)
+	if (!GFX.ZERO || !GFX.SubScreen || !GFX.ZBuffer || !GFX.SubZBuffer || !GFX.MathMask)
 	{
 		S9xGraphicsDeinit();
 		return (FALSE);
@@ -109,15 +116,16 @@ void S9xGraphicsDeinit (void)
 	if (GFX.SubScreen)  { free(GFX.SubScreen);  GFX.SubScreen  = NULL; }
 	if (GFX.ZBuffer)    { free(GFX.ZBuffer);    GFX.ZBuffer    = NULL; }
 	if (GFX.SubZBuffer) { free(GFX.SubZBuffer); GFX.SubZBuffer = NULL; }
+	if (GFX.MathMask)   { free(GFX.MathMask);   GFX.MathMask   = NULL; }
 }
 
 void S9xGraphicsScreenResize (void)
 {
 	IPPU.MaxBrightness = PPU.Brightness;
 
-	IPPU.Interlace    = Memory.FillRAM[0x2133] & 1;
-	IPPU.InterlaceOBJ = Memory.FillRAM[0x2133] & 2;
-	IPPU.PseudoHires = Memory.FillRAM[0x2133] & 8;
+	IPPU.Interlace    = GFX.FillRAM[0x2133] & 1;
+	IPPU.InterlaceOBJ = GFX.FillRAM[0x2133] & 2;
+	IPPU.PseudoHires = GFX.FillRAM[0x2133] & 8;
 		
 	if (Settings.SupportHiRes && (PPU.BGMode == 5 || PPU.BGMode == 6 || IPPU.PseudoHires))
 	{
@@ -164,15 +172,22 @@ void S9xBuildDirectColourMaps (void)
 
 void S9xStartScreenRefresh (void)
 {
+#ifdef USE_RENDER_THREAD
+	if (GFX.Threaded && IPPU.RenderThisFrame)
+		S9xRenderThreadQueue(RENDER_START);
+#endif
+
 	GFX.InterlaceFrame = !GFX.InterlaceFrame;
 	if (GFX.DoInterlace)
 		GFX.DoInterlace--;
 
 	if (IPPU.RenderThisFrame)
 	{
+		S9xTileCacheStartFrame();
+
 		if (!GFX.DoInterlace || !GFX.InterlaceFrame)
 		{
-			if (!S9xInitUpdate())
+			if (!GFX.Threaded && !S9xInitUpdate())
 			{
 				IPPU.RenderThisFrame = FALSE;
 				return;
@@ -187,8 +202,11 @@ void S9xStartScreenRefresh (void)
 		PPU.RecomputeClipWindows = TRUE;
 		IPPU.PreviousLine = IPPU.CurrentLine = 0;
 
-		memset(GFX.ZBuffer, 0, GFX.ScreenSize);
-		memset(GFX.SubZBuffer, 0, GFX.ScreenSize);
+		if (!GFX.Threaded)
+		{
+			memset(GFX.ZBuffer, 0, GFX.ScreenSize);
+			memset(GFX.SubZBuffer, 0, GFX.ScreenSize);
+		}
 	}
 
 	if (++IPPU.FrameCount == (uint32)Memory.ROMFramesPerSecond)
@@ -210,12 +228,7 @@ void S9xEndScreenRefresh (void)
 	{
 		FLUSH_REDRAW();
 
-		if (GFX.DoInterlace && GFX.InterlaceFrame == 0)
-		{
-			S9xControlEOF();
-			S9xContinueUpdate(IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
-		}
-		else
+		if (!GFX.DoInterlace || GFX.InterlaceFrame != 0)
 		{
 			if (IPPU.ColorsChanged)
 			{
@@ -223,23 +236,25 @@ void S9xEndScreenRefresh (void)
 				IPPU.ColorsChanged = FALSE;
 				PPU.CGDATA[0] = saved;
 			}
+		}
 
-			S9xControlEOF();
-
-			if (Settings.TakeScreenshot)
-				S9xDoScreenshot(IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
-
-			if (Settings.AutoDisplayMessages)
-				S9xDisplayMessages(GFX.Screen, GFX.RealPPL, IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight, 1);
+		S9xControlEOF();
 
-			S9xDeinitUpdate(IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
-		}
+	#ifdef USE_RENDER_THREAD
+		if (GFX.Threaded)
+			S9xRenderThreadQueue(RENDER_END);
+		else
+	#endif
+		S9xPresentFrame();
 	}
 	else
 		S9xControlEOF();
 
 	S9xUpdateCheatsInMemory ();
 
+	if (Cheat.search.busy)
+		S9xCheatSearchStep (&Cheat, CHEAT_SEARCH_FRAME_STEP);
+
 #ifdef DEBUGGER
 	if (CPU.Flags & FRAME_ADVANCE_FLAG)
 	{
@@ -275,6 +290,22 @@ void S9xEndScreenRefresh (void)
 	}
 }
 
+void S9xPresentFrame (void)
+{
+	if (GFX.DoInterlace && GFX.InterlaceFrame == 0)
+		S9xContinueUpdate(IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
+	else
+	{
+		if (Settings.TakeScreenshot)
+			S9xDoScreenshot(IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
+
+		if (Settings.AutoDisplayMessages)
+			S9xDisplayMessages(GFX.Screen, GFX.RealPPL, IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight, 1);
+
+		S9xDeinitUpdate(IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
+	}
+}
+
 void RenderLine (uint8 C)
 {
 	if (IPPU.RenderThisFrame)
@@ -328,7 +359,7 @@ static inline void RenderScreen (bool8 sub)
 			GFX.S += GFX.RealPPL;
 		GFX.DB = GFX.ZBuffer;
 		GFX.Clip = IPPU.Clip[0];
-		BGActive = Memory.FillRAM[0x212c] & ~Settings.BG_Forced;
+		BGActive = GFX.FillRAM[0x212c] & ~Settings.BG_Forced;
 		D = 32;
 	}
 	else
@@ -336,49 +367,56 @@ static inline void RenderScreen (bool8 sub)
 		GFX.S = GFX.SubScreen;
 		GFX.DB = GFX.SubZBuffer;
 		GFX.Clip = IPPU.Clip[1];
-		BGActive = Memory.FillRAM[0x212d] & ~Settings.BG_Forced;
-		D = (Memory.FillRAM[0x2130] & 2) << 4; // 'do math' depth flag
+		BGActive = GFX.FillRAM[0x212d] & ~Settings.BG_Forced;
+		D = (GFX.FillRAM[0x2130] & 2) << 4; // 'do math' depth flag
 	}
 
 	if (BGActive & 0x10)
 	{
 		BG.TileAddress = PPU.OBJNameBase;
 		BG.NameSelect = PPU.OBJNameSelect;
-		BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & 0x10);
+		BG.EnableMath = !sub && (GFX.FillRAM[0x2131] & 0x10);
 		BG.StartPalette = 128;
-		S9xSelectTileConverter(4, FALSE, sub, FALSE);
-		S9xSelectTileRenderers(PPU.BGMode, sub, TRUE);
-		DrawOBJS(D + 4);
+		if (S9xSelectTileConverter(4, FALSE, sub, FALSE))
+		{
+			S9xSelectTileRenderers(PPU.BGMode, sub, TRUE);
+			DrawOBJS(D + 4);
+		}
 	}
 
 	BG.NameSelect = 0;
 	S9xSelectTileRenderers(PPU.BGMode, sub, FALSE);
 
+	PROFILE_BEGIN(start);
+
 	#define DO_BG(n, pal, depth, hires, offset, Zh, Zl, voffoff) \
 		if (BGActive & (1 << n)) \
 		{ \
 			BG.StartPalette = pal; \
-			BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & (1 << n)); \
+			BG.EnableMath = !sub && (GFX.FillRAM[0x2131] & (1 << n)); \
 			BG.TileSizeH = (!hires && PPU.BG[n].BGSize) ? 16 : 8; \
 			BG.TileSizeV = (PPU.BG[n].BGSize) ? 16 : 8; \
-			S9xSelectTileConverter(depth, hires, sub, PPU.BGMosaic[n]); \
 			\
-			if (offset) \
+			/* without memory for its tiles the layer is left out */ \
+			if (S9xSelectTileConverter(depth, hires, sub, PPU.BGMosaic[n])) \
 			{ \
-				BG.OffsetSizeH = (!hires && PPU.BG[2].BGSize) ? 16 : 8; \
-				BG.OffsetSizeV = (PPU.BG[2].BGSize) ? 16 : 8; \
-				\
-				if (PPU.BGMosaic[n] && (hires || PPU.Mosaic > 1)) \
-					DrawBackgroundOffsetMosaic(n, D + Zh, D + Zl, voffoff); \
+				if (offset) \
+				{ \
+					BG.OffsetSizeH = (!hires && PPU.BG[2].BGSize) ? 16 : 8; \
+					BG.OffsetSizeV = (PPU.BG[2].BGSize) ? 16 : 8; \
+					\
+					if (PPU.BGMosaic[n] && (hires || PPU.Mosaic > 1)) \
+						DrawBackgroundOffsetMosaic(n, D + Zh, D + Zl, voffoff); \
+					else \
+						DrawBackgroundOffset(n, D + Zh, D + Zl, voffoff); \
+				} \
 				else \
-					DrawBackgroundOffset(n, D + Zh, D + Zl, voffoff); \
-			} \
-			else \
-			{ \
-				if (PPU.BGMosaic[n] && (hires || PPU.Mosaic > 1)) \
-					DrawBackgroundMosaic(n, D + Zh, D + Zl); \
-				else \
-					DrawBackground(n, D + Zh, D + Zl); \
+				{ \
+					if (PPU.BGMosaic[n] && (hires || PPU.Mosaic > 1)) \
+						DrawBackgroundMosaic(n, D + Zh, D + Zl); \
+					else \
+						DrawBackground(n, D + Zh, D + Zl); \
+				} \
 			} \
 		}
 
@@ -424,13 +462,13 @@ static inline void RenderScreen (bool8 sub)
 		case 7:
 			if (BGActive & 0x01)
 			{
-				BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & 1);
+				BG.EnableMath = !sub && (GFX.FillRAM[0x2131] & 1);
 				DrawBackgroundMode7(0, GFX.DrawMode7BG1Math, GFX.DrawMode7BG1Nomath, D);
 			}
 
-			if ((Memory.FillRAM[0x2133] & 0x40) && (BGActive & 0x02))
+			if ((GFX.FillRAM[0x2133] & 0x40) && (BGActive & 0x02))
 			{
-				BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & 2);
+				BG.EnableMath = !sub && (GFX.FillRAM[0x2131] & 2);
 				DrawBackgroundMode7(1, GFX.DrawMode7BG2Math, GFX.DrawMode7BG2Nomath, D);
 			}
 
@@ -439,13 +477,57 @@ static inline void RenderScreen (bool8 sub)
 
 	#undef DO_BG
 
-	BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & 0x20);
+	PROFILE_END(start, PROFILE_BG_MODE0 + PPU.BGMode, 1);
+
+	BG.EnableMath = !sub && (GFX.FillRAM[0x2131] & 0x20);
 
 	DrawBackdrop();
 }
 
+static void DrawScreen (void)
+{
+	if (PPU.ForcedBlanking)
+	{
+		const uint16	black = BUILD_PIXEL(0, 0, 0);
+
+		GFX.S = GFX.Screen + GFX.StartY * GFX.PPL;
+		if (GFX.DoInterlace && GFX.InterlaceFrame)
+			GFX.S += GFX.RealPPL;
+
+		for (uint32 l = GFX.StartY; l <= GFX.EndY; l++, GFX.S += GFX.PPL)
+			for (int x = 0; x < IPPU.RenderedScreenWidth; x++)
+				GFX.S[x] = black;
+
+		return;
+	}
+
+	if ((GFX.FillRAM[0x2130] & 0x30) != 0x30 && (GFX.FillRAM[0x2131] & 0x3f))
+		GFX.FixedColour = BUILD_PIXEL(IPPU.XB[PPU.FixedColourRed], IPPU.XB[PPU.FixedColourGreen], IPPU.XB[PPU.FixedColourBlue]);
+
+	if (PPU.BGMode == 7)
+		S9xStartMode7Update();
+
+	if (PPU.BGMode == 5 || PPU.BGMode == 6 || IPPU.PseudoHires ||
+		((GFX.FillRAM[0x2130] & 0x30) != 0x30 && (GFX.FillRAM[0x2130] & 2) && (GFX.FillRAM[0x2131] & 0x3f) && (GFX.FillRAM[0x212d] & 0x1f)))
+		// If hires (Mode 5/6 or pseudo-hires) or math is to be done
+		// involving the subscreen, then we need to render the subscreen...
+		RenderScreen(TRUE);
+
+	RenderScreen(FALSE);
+
+	if (S9xLineColourMath())
+		S9xApplyColourMath();
+}
+
 void S9xUpdateScreen (void)
 {
+#ifdef USE_RENDER_THREAD
+	// the render thread replays this from the state as it is now, here we
+	// only keep the bookkeeping that emulation and later frames depend on
+	if (GFX.Threaded)
+		S9xRenderThreadQueue(RENDER_LINES);
+#endif
+
 	if (IPPU.OBJChanged || IPPU.InterlaceOBJ)
 		SetupOBJ();
 
@@ -493,13 +575,16 @@ void S9xUpdateScreen (void)
 				else
 				#endif
 				// Have to back out of the regular speed hack
-				for (uint32 y = 0; y < GFX.StartY; y++)
+				if (!GFX.Threaded)
 				{
-					uint16	*p = GFX.Screen + y * GFX.PPL + 255;
-					uint16	*q = GFX.Screen + y * GFX.PPL + 510;
+					for (uint32 y = 0; y < GFX.StartY; y++)
+					{
+						uint16	*p = GFX.Screen + y * GFX.PPL + 255;
+						uint16	*q = GFX.Screen + y * GFX.PPL + 510;
 
-					for (int x = 255; x >= 0; x--, p--, q -= 2)
-						*q = *(q + 1) = *p;
+						for (int x = 255; x >= 0; x--, p--, q -= 2)
+							*q = *(q + 1) = *p;
+					}
 				}
 
 				IPPU.DoubleWidthPixels = TRUE;
@@ -513,36 +598,148 @@ void S9xUpdateScreen (void)
 				GFX.PPL = GFX.RealPPL << 1;
 				GFX.DoInterlace = 2;
 
-				for (int32 y = (int32) GFX.StartY - 2; y >= 0; y--)
-					memmove(GFX.Screen + (y + 1) * GFX.PPL, GFX.Screen + y * GFX.RealPPL, GFX.PPL * sizeof(uint16));
+				if (!GFX.Threaded)
+					for (int32 y = (int32) GFX.StartY - 2; y >= 0; y--)
+						memmove(GFX.Screen + (y + 1) * GFX.PPL, GFX.Screen + y * GFX.RealPPL, GFX.PPL * sizeof(uint16));
 			}
 		}
+	}
 
-		if ((Memory.FillRAM[0x2130] & 0x30) != 0x30 && (Memory.FillRAM[0x2131] & 0x3f))
-			GFX.FixedColour = BUILD_PIXEL(IPPU.XB[PPU.FixedColourRed], IPPU.XB[PPU.FixedColourGreen], IPPU.XB[PPU.FixedColourBlue]);
+	if (!GFX.Threaded)
+	{
+		PROFILE_BEGIN(start);
+		DrawScreen();
+		PROFILE_END(start, PROFILE_RENDER_MODE0 + PPU.BGMode, GFX.EndY - GFX.StartY + 1);
+	}
 
-		if (PPU.BGMode == 5 || PPU.BGMode == 6 || IPPU.PseudoHires ||
-			((Memory.FillRAM[0x2130] & 0x30) != 0x30 && (Memory.FillRAM[0x2130] & 2) && (Memory.FillRAM[0x2131] & 0x3f) && (Memory.FillRAM[0x212d] & 0x1f)))
-			// If hires (Mode 5/6 or pseudo-hires) or math is to be done
-			// involving the subscreen, then we need to render the subscreen...
-			RenderScreen(TRUE);
+	IPPU.PreviousLine = IPPU.CurrentLine;
+}
 
-		RenderScreen(FALSE);
+// OBJ line lists.
+//
+// The lists are kept from one SetupOBJ to the next, along with the position,
+// size and flip of every sprite they were built from. OAM writes only set
+// IPPU.OBJChanged, so SetupOBJ compares the sprites with the ones it built
+// from, moves those that changed between the lines they cover and rebuilds
+// only the lists of those lines. Every line has a bit per sprite on it, so
+// its list is rebuilt without looking at the other sprites. Other changes to
+// the OBJ settings, like the sizes or the interlace field, rebuild them all.
+
+namespace objlines
+{
+	struct SBuiltOBJ
+	{
+		int16	HPos;
+		uint16	VPos;
+		uint8	VFlip;
+		uint8	Size;
+	};
+
+	static RENDER_LOCAL bool8				valid = FALSE;
+	static RENDER_LOCAL uint8				size_select, start_line, line_inc, rotation, first_sprite;
+	static RENDER_LOCAL int					max_tiles;
+	static RENDER_LOCAL struct SBuiltOBJ	built[128];
+	static RENDER_LOCAL uint32				on_line[SNES_HEIGHT_EXTENDED][4];	// bit S of a line is set if sprite S is on it
+	static RENDER_LOCAL uint8				line_rto[SNES_HEIGHT_EXTENDED];		// RTOFlags before they are carried down
+} // namespace objlines
+
+using namespace objlines;
+
+// Returns 0 if the sprite is off screen. The two priority modes have always
+// disagreed on where HPos -256 is.
+static int VisibleOBJTiles (int HPos, int Width, bool8 rotate)
+{
+	if (HPos == -256)
+		HPos = rotate ? 256 : 0;
+
+	if (HPos <= -Width || HPos > 256)
+		return (0);
+
+	if (HPos < 0)
+		return ((Width + HPos + 7) >> 3);
+
+	if (rotate)
+	{
+		if (HPos + Width >= 257)
+			return ((257 - HPos + 7) >> 3);
 	}
 	else
+	if (HPos + Width > 255)
+		return ((256 - HPos + 7) >> 3);
+
+	return (Width >> 3);
+}
+
+// Sets or clears the bit of sprite S on every line it covers and marks
+// those lines for rebuilding.
+static void MarkOBJLines (int S, int Height, int startline, int inc, bool8 on, bool8 *dirty)
+{
+	uint32	bit = 1 << (S & 31);
+
+	for (uint8 line = startline, Y = (uint8) (built[S].VPos & 0xff); line < Height; Y++, line += inc)
 	{
-		const uint16	black = BUILD_PIXEL(0, 0, 0);
+		if (Y >= SNES_HEIGHT_EXTENDED)
+			continue;
 
-		GFX.S = GFX.Screen + GFX.StartY * GFX.PPL;
-		if (GFX.DoInterlace && GFX.InterlaceFrame)
-			GFX.S += GFX.RealPPL;
+		if (on)
+			on_line[Y][S >> 5] |= bit;
+		else
+			on_line[Y][S >> 5] &= ~bit;
 
-		for (uint32 l = GFX.StartY; l <= GFX.EndY; l++, GFX.S += GFX.PPL)
-			for (int x = 0; x < IPPU.RenderedScreenWidth; x++)
-				GFX.S[x] = black;
+		dirty[Y] = TRUE;
 	}
+}
 
-	IPPU.PreviousLine = IPPU.CurrentLine;
+static void BuildOBJLine (int Y, int startline, int inc, int sprite_limit)
+{
+	uint8	first = rotation ? (first_sprite + Y) & 0x7f : first_sprite;
+	uint8	flags = 0;
+	int		tiles = Settings.MaxSpriteTilesPerLine;
+	int		j = 0;
+
+	// the sprites from first to 127, then from 0 to first - 1
+	for (int n = 0, w = first >> 5; n < 5; n++, w = (w + 1) & 3)
+	{
+		uint32	bits = on_line[Y][w];
+
+		if (n == 0)
+			bits &= ~0u << (first & 31);
+		else
+		if (n == 4)
+			bits &= ~(~0u << (first & 31));
+
+		for (; bits; bits &= bits - 1)
+		{
+			int	S = (w << 5) | __builtin_ctz(bits);
+
+			if (j >= sprite_limit)
+			{
+				flags |= 0x40;
+				goto done;
+			}
+
+			tiles -= GFX.OBJVisibleTiles[S];
+			if (tiles < 0)
+				flags |= 0x80;
+
+			uint8	line = startline + (uint8) (Y - built[S].VPos) * inc;
+
+			GFX.OBJLines[Y].Sprite[j] = S;
+			if (built[S].VFlip)
+				// Yes, Width not Height. It so happens that the
+				// sprites with H=2*W flip as two WxW sprites.
+				GFX.OBJLines[Y].Line[j] = line ^ (GFX.OBJWidths[S] - 1);
+			else
+				GFX.OBJLines[Y].Line[j] = line;
+
+			j++;
+		}
+	}
+
+done:
+	GFX.OBJLines[Y].Count = j;
+	GFX.OBJLines[Y].Tiles = tiles;
+	line_rto[Y] = flags;
 }
 
 static void SetupOBJ (void)
@@ -597,186 +794,62 @@ static void SetupOBJ (void)
 
 	int startline = (IPPU.InterlaceOBJ && GFX.InterlaceFrame) ? 1 : 0;
 
-	// OK, we have three cases here. Either there's no priority, priority is
-	// normal FirstSprite, or priority is FirstSprite+Y. The first two are
-	// easy, the last is somewhat more ... interesting. So we split them up.
+	// Either there's no priority, priority is normal FirstSprite, or priority
+	// is FirstSprite+Y. In the last case every line starts from its own sprite.
 
-	int		Height;
-	uint8	S;
-	int sprite_limit = (Settings.MaxSpriteTilesPerLine == 128) ? 128 : 32;
+	bool8	rotate = PPU.OAMPriorityRotation && (PPU.OAMFlip & PPU.OAMAddr & 1);
+	int		sprite_limit = (Settings.MaxSpriteTilesPerLine == 128) ? 128 : 32;
+	bool8	dirty[SNES_HEIGHT_EXTENDED];
+	bool8	all = !valid || PPU.OBJSizeSelect != size_select || startline != start_line || inc != line_inc ||
+				  rotate != rotation || Settings.MaxSpriteTilesPerLine != max_tiles;
 
-	if (!PPU.OAMPriorityRotation || !(PPU.OAMFlip & PPU.OAMAddr & 1)) // normal case
+	if (all)
 	{
-		uint8	LineOBJ[SNES_HEIGHT_EXTENDED];
-		memset(LineOBJ, 0, sizeof(LineOBJ));
-
-		for (int i = 0; i < SNES_HEIGHT_EXTENDED; i++)
-		{
-			GFX.OBJLines[i].RTOFlags = 0;
-			GFX.OBJLines[i].Tiles = Settings.MaxSpriteTilesPerLine;
-			for (int j = 0; j < sprite_limit; j++)
-				GFX.OBJLines[i].OBJ[j].Sprite = -1;
-		}
-
-		uint8	FirstSprite = PPU.FirstSprite;
-		S = FirstSprite;
-
-		do
-		{
-			if (PPU.OBJ[S].Size)
-			{
-				GFX.OBJWidths[S] = LargeWidth;
-				Height = LargeHeight;
-			}
-			else
-			{
-				GFX.OBJWidths[S] = SmallWidth;
-				Height = SmallHeight;
-			}
-
-			int	HPos = PPU.OBJ[S].HPos;
-			if (HPos == -256)
-				HPos = 0;
-
-			if (HPos > -GFX.OBJWidths[S] && HPos <= 256)
-			{
-				if (HPos < 0)
-					GFX.OBJVisibleTiles[S] = (GFX.OBJWidths[S] + HPos + 7) >> 3;
-				else
-				if (HPos + GFX.OBJWidths[S] > 255)
-					GFX.OBJVisibleTiles[S] = (256 - HPos + 7) >> 3;
-				else
-					GFX.OBJVisibleTiles[S] = GFX.OBJWidths[S] >> 3;
-
-				for (uint8 line = startline, Y = (uint8) (PPU.OBJ[S].VPos & 0xff); line < Height; Y++, line += inc)
-				{
-					if (Y >= SNES_HEIGHT_EXTENDED)
-						continue;
-
-					if (LineOBJ[Y] >= sprite_limit)
-					{
-						GFX.OBJLines[Y].RTOFlags |= 0x40;
-						continue;
-					}
-
-					GFX.OBJLines[Y].Tiles -= GFX.OBJVisibleTiles[S];
-					if (GFX.OBJLines[Y].Tiles < 0)
-						GFX.OBJLines[Y].RTOFlags |= 0x80;
-
-					GFX.OBJLines[Y].OBJ[LineOBJ[Y]].Sprite = S;
-					if (PPU.OBJ[S].VFlip)
-						// Yes, Width not Height. It so happens that the
-						// sprites with H=2*W flip as two WxW sprites.
-						GFX.OBJLines[Y].OBJ[LineOBJ[Y]].Line = line ^ (GFX.OBJWidths[S] - 1);
-					else
-						GFX.OBJLines[Y].OBJ[LineOBJ[Y]].Line = line;
-
-					LineOBJ[Y]++;
-				}
-			}
+		memset(on_line, 0, sizeof(on_line));
+		valid = TRUE;
+		size_select = PPU.OBJSizeSelect;
+		start_line = startline;
+		line_inc = inc;
+		rotation = rotate;
+		max_tiles = Settings.MaxSpriteTilesPerLine;
+	}
 
-			S = (S + 1) & 0x7f;
-		} while (S != FirstSprite);
+	// a new first sprite only changes the order
+	memset(dirty, all || PPU.FirstSprite != first_sprite, sizeof(dirty));
+	first_sprite = PPU.FirstSprite;
 
-		for (int Y = 1; Y < SNES_HEIGHT_EXTENDED; Y++)
-			GFX.OBJLines[Y].RTOFlags |= GFX.OBJLines[Y - 1].RTOFlags;
-	}
-	else // evil FirstSprite+Y case
+	for (int S = 0; S < 128; S++)
 	{
-		// First, find out which sprites are on which lines
-		uint8 OBJOnLine[SNES_HEIGHT_EXTENDED][128];
-		// memset(OBJOnLine, 0, sizeof(OBJOnLine));
-		/* Hold on here, that's a lot of bytes to initialise at once!
-		 * So we only initialise them per line, as needed. [Neb]
-		 * Bonus: We can quickly avoid looping if a line has no OBJs.
-		 */
-        bool8 AnyOBJOnLine[SNES_HEIGHT_EXTENDED];
-        memset(AnyOBJOnLine, FALSE, sizeof(AnyOBJOnLine)); // better
-
-		for (S = 0; S < 128; S++)
-		{
-			if (PPU.OBJ[S].Size)
-			{
-				GFX.OBJWidths[S] = LargeWidth;
-				Height = LargeHeight;
-			}
-			else
-			{
-				GFX.OBJWidths[S] = SmallWidth;
-				Height = SmallHeight;
-			}
+		struct SOBJ			*o = &PPU.OBJ[S];
+		struct SBuiltOBJ	*b = &built[S];
 
-			int	HPos = PPU.OBJ[S].HPos;
-			if (HPos == -256)
-				HPos = 256;
+		if (!all && o->HPos == b->HPos && o->VPos == b->VPos && o->VFlip == b->VFlip && o->Size == b->Size)
+			continue;
 
-			if (HPos > -GFX.OBJWidths[S] && HPos <= 256)
-			{
-				if (HPos < 0)
-					GFX.OBJVisibleTiles[S] = (GFX.OBJWidths[S] + HPos + 7) >> 3;
-				else
-				if (HPos + GFX.OBJWidths[S] >= 257)
-					GFX.OBJVisibleTiles[S] = (257 - HPos + 7) >> 3;
-				else
-					GFX.OBJVisibleTiles[S] = GFX.OBJWidths[S] >> 3;
+		if (!all && VisibleOBJTiles(b->HPos, GFX.OBJWidths[S], rotate))
+			MarkOBJLines(S, b->Size ? LargeHeight : SmallHeight, startline, inc, FALSE, dirty);
 
-				for (uint8 line = startline, Y = (uint8) (PPU.OBJ[S].VPos & 0xff); line < Height; Y++, line += inc)
-				{
-					if (Y >= SNES_HEIGHT_EXTENDED)
-						continue;
+		b->HPos = o->HPos;
+		b->VPos = o->VPos;
+		b->VFlip = o->VFlip;
+		b->Size = o->Size;
 
-					if (!AnyOBJOnLine[Y]) {
-						memset(OBJOnLine[Y], 0, sizeof(OBJOnLine[Y]));
-						AnyOBJOnLine[Y] = TRUE;
-					}
+		GFX.OBJWidths[S] = o->Size ? LargeWidth : SmallWidth;
 
-					if (PPU.OBJ[S].VFlip)
-						// Yes, Width not Height. It so happens that the
-						// sprites with H=2*W flip as two WxW sprites.
-						OBJOnLine[Y][S] = (line ^ (GFX.OBJWidths[S] - 1)) | 0x80;
-					else
-						OBJOnLine[Y][S] = line | 0x80;
-				}
-			}
-		}
-
-		// Now go through and pull out those OBJ that are actually visible.
-		int	j;
-		for (int Y = 0; Y < SNES_HEIGHT_EXTENDED; Y++)
+		int	tiles = VisibleOBJTiles(o->HPos, GFX.OBJWidths[S], rotate);
+		if (tiles)
 		{
-			GFX.OBJLines[Y].RTOFlags = Y ? GFX.OBJLines[Y - 1].RTOFlags : 0;
-			GFX.OBJLines[Y].Tiles = Settings.MaxSpriteTilesPerLine;
-
-			uint8	FirstSprite = (PPU.FirstSprite + Y) & 0x7f;
-			S = FirstSprite;
-			j = 0;
-
-			if (AnyOBJOnLine[Y])
-			{
-				do
-				{
-					if (OBJOnLine[Y][S])
-					{
-						if (j >= sprite_limit)
-						{
-							GFX.OBJLines[Y].RTOFlags |= 0x40;
-							break;
-						}
-
-						GFX.OBJLines[Y].Tiles -= GFX.OBJVisibleTiles[S];
-						if (GFX.OBJLines[Y].Tiles < 0)
-							GFX.OBJLines[Y].RTOFlags |= 0x80;
-						GFX.OBJLines[Y].OBJ[j].Sprite = S;
-						GFX.OBJLines[Y].OBJ[j++].Line = OBJOnLine[Y][S] & ~0x80;
-					}
+			GFX.OBJVisibleTiles[S] = tiles;
+			MarkOBJLines(S, o->Size ? LargeHeight : SmallHeight, startline, inc, TRUE, dirty);
+		}
+	}
 
-					S = (S + 1) & 0x7f;
-				} while (S != FirstSprite);
-			}
+	for (int Y = 0; Y < SNES_HEIGHT_EXTENDED; Y++)
+	{
+		if (dirty[Y])
+			BuildOBJLine(Y, startline, inc, sprite_limit);
 
-			if (j < sprite_limit)
-				GFX.OBJLines[Y].OBJ[j].Sprite = -1;
-		}
+		GFX.OBJLines[Y].RTOFlags = line_rto[Y] | (Y ? GFX.OBJLines[Y - 1].RTOFlags : 0);
 	}
 
 	IPPU.OBJChanged = FALSE;
@@ -794,22 +867,22 @@ static void DrawOBJS (int D)
 	int	PixWidth = IPPU.DoubleWidthPixels ? 2 : 1;
 	BG.InterlaceLine = GFX.InterlaceFrame ? 8 : 0;
 	GFX.Z1 = 2;
-	int sprite_limit = (Settings.MaxSpriteTilesPerLine == 128) ? 128 : 32;
 
 	for (uint32 Y = GFX.StartY, Offset = Y * GFX.PPL; Y <= GFX.EndY; Y++, Offset += GFX.PPL)
 	{
-		int	I = 0;
 		int	tiles = GFX.OBJLines[Y].Tiles;
 
-		for (int S = GFX.OBJLines[Y].OBJ[I].Sprite; S >= 0 && I < sprite_limit; S = GFX.OBJLines[Y].OBJ[++I].Sprite)
+		for (int I = 0; I < GFX.OBJLines[Y].Count; I++)
 		{
+			int	S = GFX.OBJLines[Y].Sprite[I];
+
 			tiles += GFX.OBJVisibleTiles[S];
 			if (tiles <= 0)
 				continue;
 
-			int	BaseTile = (((GFX.OBJLines[Y].OBJ[I].Line << 1) + (PPU.OBJ[S].Name & 0xf0)) & 0xf0) | (PPU.OBJ[S].Name & 0x100) | (PPU.OBJ[S].Palette << 10);
+			int	BaseTile = (((GFX.OBJLines[Y].Line[I] << 1) + (PPU.OBJ[S].Name & 0xf0)) & 0xf0) | (PPU.OBJ[S].Name & 0x100) | (PPU.OBJ[S].Palette << 10);
 			int	TileX = PPU.OBJ[S].Name & 0x0f;
-			int	TileLine = (GFX.OBJLines[Y].OBJ[I].Line & 7) * 8;
+			int	TileLine = (GFX.OBJLines[Y].Line[I] & 7) * 8;
 			int	TileInc = 1;
 
 			if (PPU.OBJ[S].HFlip)
@@ -890,15 +963,15 @@ static void DrawBackground (int bg, uint8 Zh, uint8 Zl)
 	uint32	Tile;
 	uint16	*SC0, *SC1, *SC2, *SC3;
 
-	SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
+	SC0 = (uint16 *) &GFX.VRAM[PPU.BG[bg].SCBase << 1];
 	SC1 = (PPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
-	if (SC1 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC1 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC1 -= 0x8000;
 	SC2 = (PPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
-	if (SC2 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC2 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC2 -= 0x8000;
 	SC3 = (PPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
-	if (SC3 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC3 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC3 -= 0x8000;
 
 	uint32	Lines;
@@ -1107,15 +1180,15 @@ static void DrawBackgroundMosaic (int bg, uint8 Zh, uint8 Zl)
 	uint32	Tile;
 	uint16	*SC0, *SC1, *SC2, *SC3;
 
-	SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
+	SC0 = (uint16 *) &GFX.VRAM[PPU.BG[bg].SCBase << 1];
 	SC1 = (PPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
-	if (SC1 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC1 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC1 -= 0x8000;
 	SC2 = (PPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
-	if (SC2 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC2 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC2 -= 0x8000;
 	SC3 = (PPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
-	if (SC3 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC3 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC3 -= 0x8000;
 
 	int	Lines;
@@ -1274,26 +1347,26 @@ static void DrawBackgroundOffset (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 	uint16	*SC0, *SC1, *SC2, *SC3;
 	uint16	*BPS0, *BPS1, *BPS2, *BPS3;
 
-	BPS0 = (uint16 *) &Memory.VRAM[PPU.BG[2].SCBase << 1];
+	BPS0 = (uint16 *) &GFX.VRAM[PPU.BG[2].SCBase << 1];
 	BPS1 = (PPU.BG[2].SCSize & 1) ? BPS0 + 1024 : BPS0;
-	if (BPS1 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (BPS1 >= (uint16 *) (GFX.VRAM + 0x10000))
 		BPS1 -= 0x8000;
 	BPS2 = (PPU.BG[2].SCSize & 2) ? BPS1 + 1024 : BPS0;
-	if (BPS2 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (BPS2 >= (uint16 *) (GFX.VRAM + 0x10000))
 		BPS2 -= 0x8000;
 	BPS3 = (PPU.BG[2].SCSize & 1) ? BPS2 + 1024 : BPS2;
-	if (BPS3 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (BPS3 >= (uint16 *) (GFX.VRAM + 0x10000))
 		BPS3 -= 0x8000;
 
-	SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
+	SC0 = (uint16 *) &GFX.VRAM[PPU.BG[bg].SCBase << 1];
 	SC1 = (PPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
-	if (SC1 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC1 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC1 -= 0x8000;
 	SC2 = (PPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
-	if (SC2 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC2 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC2 -= 0x8000;
 	SC3 = (PPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
-	if (SC3 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC3 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC3 -= 0x8000;
 
 	int	OffsetMask   = (BG.TileSizeH   == 16) ? 0x3ff : 0x1ff;
@@ -1502,26 +1575,26 @@ static void DrawBackgroundOffsetMosaic (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 	uint16	*SC0, *SC1, *SC2, *SC3;
 	uint16	*BPS0, *BPS1, *BPS2, *BPS3;
 
-	BPS0 = (uint16 *) &Memory.VRAM[PPU.BG[2].SCBase << 1];
+	BPS0 = (uint16 *) &GFX.VRAM[PPU.BG[2].SCBase << 1];
 	BPS1 = (PPU.BG[2].SCSize & 1) ? BPS0 + 1024 : BPS0;
-	if (BPS1 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (BPS1 >= (uint16 *) (GFX.VRAM + 0x10000))
 		BPS1 -= 0x8000;
 	BPS2 = (PPU.BG[2].SCSize & 2) ? BPS1 + 1024 : BPS0;
-	if (BPS2 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (BPS2 >= (uint16 *) (GFX.VRAM + 0x10000))
 		BPS2 -= 0x8000;
 	BPS3 = (PPU.BG[2].SCSize & 1) ? BPS2 + 1024 : BPS2;
-	if (BPS3 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (BPS3 >= (uint16 *) (GFX.VRAM + 0x10000))
 		BPS3 -= 0x8000;
 
-	SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
+	SC0 = (uint16 *) &GFX.VRAM[PPU.BG[bg].SCBase << 1];
 	SC1 = (PPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
-	if (SC1 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC1 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC1 -= 0x8000;
 	SC2 = (PPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
-	if (SC2 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC2 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC2 -= 0x8000;
 	SC3 = (PPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
-	if (SC3 >= (uint16 *) (Memory.VRAM + 0x10000))
+	if (SC3 >= (uint16 *) (GFX.VRAM + 0x10000))
 		SC3 -= 0x8000;
 
 	int	Lines;
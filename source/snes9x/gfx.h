@@ -15,11 +15,15 @@ struct SGFX
 	uint16	*SubScreen;
 	uint8	*ZBuffer;
 	uint8	*SubZBuffer;
+	uint8	*MathMask;			// colour math owed by each main screen pixel, for Settings.LineColourMath
 	uint32	Pitch;
 	uint32	ScreenSize;
 	uint16	*S;
 	uint8	*DB;
 	uint16	*ZERO;
+	uint8	*VRAM;				// Memory.VRAM, or the render thread's copy of it
+	uint8	*FillRAM;			// Memory.FillRAM, or the render thread's copy of $2100-$21ff
+	bool8	Threaded;			// drawing is queued for the render thread
 	uint32	RealPPL;			// true PPL of Screen buffer
 	uint32	PPL;				// number of pixels on each of Screen buffer
 	uint32	LinesPerTile;		// number of lines in 1 tile (4 or 8 due to interlace)
@@ -42,12 +46,9 @@ struct SGFX
 	{
 		uint8	RTOFlags;
 		int16	Tiles;
-
-		struct
-		{
-			int8	Sprite;
-			uint8	Line;
-		}	OBJ[128];
+		uint8	Count;				// sprites on the line, in the order they are drawn
+		int8	Sprite[128];
+		uint8	Line[128];			// the line of the sprite's image that is on it
 	}	OBJLines[SNES_HEIGHT_EXTENDED];
 
 	void	(*DrawBackdropMath) (uint32, uint32, uint32);
@@ -90,8 +91,9 @@ struct SBG
 
 	uint8	*Buffer;
 	uint8	*BufferFlip;
-	uint8	*Buffered;
-	uint8	*BufferedFlip;
+	uint32	*Buffered;
+	uint32	*BufferedFlip;
+	uint32	TileLines;			// 16-byte lines of VRAM a converted tile depends on
 	bool8	DirectColourMode;
 };
 
@@ -117,11 +119,11 @@ struct SLineMatrixData
 };
 
 extern uint16		BlackColourMap[256];
-extern uint16		DirectColourMaps[8][256];
-extern uint8		mul_brightness[16][32];
-extern uint8		brightness_cap[64];
-extern struct SBG	BG;
-extern struct SGFX	GFX;
+extern RENDER_LOCAL uint16		DirectColourMaps[8][256];
+extern uint8					mul_brightness[16][32];
+extern RENDER_LOCAL uint8		brightness_cap[64];
+extern RENDER_LOCAL struct SBG	BG;
+extern RENDER_LOCAL struct SGFX	GFX;
 
 #define H_FLIP		0x4000
 #define V_FLIP		0x8000
@@ -201,6 +203,7 @@ struct COLOR_SUB
 
 void S9xStartScreenRefresh (void);
 void S9xEndScreenRefresh (void);
+void S9xPresentFrame (void);
 void S9xBuildDirectColourMaps (void);
 void RenderLine (uint8);
 void S9xComputeClipWindows (void);
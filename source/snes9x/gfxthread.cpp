@@ -0,0 +1,465 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+/*
+  Render thread.
+
+  The renderer state (PPU, IPPU, GFX, BG, the line data and the colour maps)
+  is declared RENDER_LOCAL, so the render thread has its own copy of all of it
+  and draws with the same code as the emulation thread does.
+
+  While the render thread runs, S9xStartScreenRefresh, S9xUpdateScreen and
+  S9xPresentFrame on the emulation thread append a record to the log of the
+  current frame instead of drawing. A record holds the renderer state as it
+  was at that point, the line data written since the previous record and the
+  VRAM that changed, found by comparing the generation of every 16-byte line
+  of VRAM with the one it had when it was last sent. The
+  emulation thread still does all the bookkeeping emulation depends on (OBJ
+  range/time over flags, clip windows, screen geometry), so both threads stay
+  in the same state and replaying a record yields exactly the lines the
+  emulation thread would have drawn itself.
+
+  At the end of each rendered frame its log is handed over, so the render
+  thread draws frame N while the emulation thread runs frame N+1.
+*/
+
+#ifdef USE_RENDER_THREAD
+
+#include <pthread.h>
+#ifdef __linux
+#include <malloc.h>
+#endif
+
+#include "snes9x.h"
+#include "memmap.h"
+#include "ppu.h"
+#include "gfxthread.h"
+#include "tile.h"
+
+extern RENDER_LOCAL struct SLineData		LineData[240];
+extern RENDER_LOCAL struct SLineMatrixData	LineMatrixData[240];
+
+#define VRAM_UNIT_SIZE	16	// VRAM bytes per IPPU.VRAMGeneration entry
+
+struct SRenderState
+{
+	struct SPPU			PPU;
+	struct InternalPPU	IPPU;
+	uint8				FillRAM[0x100];	// $2100-$21ff
+	uint8				DoInterlace;
+	uint8				InterlaceFrame;
+	uint32				RealPPL;
+	uint32				PPL;
+	const char			*InfoString;
+	uint32				InfoStringTimeout;
+};
+
+// followed by LineData[Lines], LineMatrixData[Lines] and SVRAMUnit[Units]
+struct SRenderRecord
+{
+	uint32				Type;
+	uint32				Size;
+	uint32				FirstLine;
+	uint32				Lines;
+	uint32				Units;
+	struct SRenderState	State;
+};
+
+struct SVRAMUnit
+{
+	uint32	Unit;
+	uint8	Data[VRAM_UNIT_SIZE];
+};
+
+struct SRenderLog
+{
+	uint8	*Data;
+	uint32	Size;
+	uint32	Used;
+};
+
+namespace renderthread
+{
+	static pthread_t		thread;
+	static pthread_mutex_t	lock = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t	cond = PTHREAD_COND_INITIALIZER;
+
+	static SRenderLog		logs[2];
+	static int				filling = 0;		// the log the emulation thread appends to
+	static bool8			pending = FALSE;	// the other log is waiting for or being replayed
+	static bool8			quit = FALSE;
+	static int				ready = 0;			// 1 once the thread is set up, -1 if that failed
+	static bool8			running = FALSE;
+	static bool8			dropping = FALSE;	// the log could not grow, the frame is skipped
+	static uint32			shipped[MAX_2BIT_TILES];	// the VRAMGeneration sent last, by unit
+
+	static struct SGFX			*mainGFX;
+	static struct SPPU			*mainPPU;
+	static struct InternalPPU	*mainIPPU;
+} // namespace renderthread
+
+using namespace renderthread;
+
+static bool8 MakeRoom (SRenderLog *log, uint32 size)
+{
+	if (log->Used + size <= log->Size)
+		return (TRUE);
+
+	uint32	newsize = log->Size ? log->Size : 0x40000;
+
+	while (log->Used + size > newsize)
+		newsize <<= 1;
+
+	uint8	*data = (uint8 *) realloc(log->Data, newsize);
+	if (!data)
+		return (FALSE);
+
+	log->Data = data;
+	log->Size = newsize;
+
+	return (TRUE);
+}
+
+// MakeRoom must have been called for the whole record first
+static uint8 * Reserve (SRenderLog *log, uint32 size)
+{
+	uint8	*p = log->Data + log->Used;
+	log->Used += size;
+
+	return (p);
+}
+
+static uint32 QueueVRAM (SRenderLog *log)
+{
+	uint32	units = 0;
+
+	for (uint32 i = 0; i < MAX_2BIT_TILES; i++)
+	{
+		if (shipped[i] == IPPU.VRAMGeneration[i])
+			continue;
+
+		SVRAMUnit	*u = (SVRAMUnit *) Reserve(log, sizeof(SVRAMUnit));
+
+		u->Unit = i;
+		memcpy(u->Data, Memory.VRAM + i * VRAM_UNIT_SIZE, VRAM_UNIT_SIZE);
+		shipped[i] = IPPU.VRAMGeneration[i];
+		units++;
+	}
+
+	return (units);
+}
+
+void S9xRenderThreadQueue (int type)
+{
+	SRenderLog	*log = &logs[filling];
+	uint32		start = log->Used;
+	uint32		first = 0, lines = 0;
+
+	if (type == RENDER_LINES)
+	{
+		uint32	last = IPPU.CurrentLine < 240 ? IPPU.CurrentLine : 240;
+
+		first = IPPU.PreviousLine;
+		if (last > first)
+			lines = last - first;
+	}
+
+	// room for the record with every VRAM unit changed, so nothing below can
+	// fail. Without it the rest of the frame is dropped, and since the render
+	// thread never sees the VRAM already queued, all of it is sent again.
+	if (!dropping && !MakeRoom(log, sizeof(SRenderRecord) + lines * (sizeof(SLineData) + sizeof(SLineMatrixData)) +
+										(type == RENDER_LINES ? MAX_2BIT_TILES * sizeof(SVRAMUnit) : 0) + 8))
+		dropping = TRUE;
+
+	if (dropping)
+	{
+		if (type == RENDER_END)
+		{
+			log->Used = 0;
+			memset(shipped, 0, sizeof(shipped));
+			dropping = FALSE;
+		}
+
+		return;
+	}
+
+	SRenderRecord	*r = (SRenderRecord *) Reserve(log, sizeof(SRenderRecord));
+	SRenderState	*s = &r->State;
+
+	r->Type = type;
+
+	memcpy(&s->PPU, &PPU, sizeof(PPU));
+	memcpy(&s->IPPU, &IPPU, sizeof(IPPU));
+	memcpy(s->FillRAM, Memory.FillRAM + 0x2100, sizeof(s->FillRAM));
+	s->DoInterlace = GFX.DoInterlace;
+	s->InterlaceFrame = GFX.InterlaceFrame;
+	s->RealPPL = GFX.RealPPL;
+	s->PPL = GFX.PPL;
+	s->InfoString = GFX.InfoString;
+	s->InfoStringTimeout = GFX.InfoStringTimeout;
+
+	if (type == RENDER_LINES)
+	{
+		memcpy(Reserve(log, lines * sizeof(SLineData)), &LineData[first], lines * sizeof(SLineData));
+		memcpy(Reserve(log, lines * sizeof(SLineMatrixData)), &LineMatrixData[first], lines * sizeof(SLineMatrixData));
+	}
+
+	uint32	units = (type == RENDER_LINES) ? QueueVRAM(log) : 0;
+
+	log->Used = (log->Used + 7) & ~7;
+
+	r->Size = log->Used - start;
+	r->FirstLine = first;
+	r->Lines = lines;
+	r->Units = units;
+
+	if (type == RENDER_END)
+	{
+		pthread_mutex_lock(&lock);
+		while (pending)
+			pthread_cond_wait(&cond, &lock);
+		pending = TRUE;
+		filling ^= 1;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+
+		logs[filling].Used = 0;
+	}
+}
+
+static void ApplyVRAM (const SVRAMUnit *u, uint32 count)
+{
+	for (; count; count--, u++)
+	{
+		memcpy(GFX.VRAM + u->Unit * VRAM_UNIT_SIZE, u->Data, VRAM_UNIT_SIZE);
+		IPPU.VRAMGeneration[u->Unit]++;
+	}
+}
+
+static void Adopt (const SRenderState *s)
+{
+	// the colour tables are RENDER_LOCAL, so a restarted thread builds its own
+	static RENDER_LOCAL uint8	brightness = 0xff;
+
+	memcpy(&PPU, &s->PPU, sizeof(PPU));
+
+	if (PPU.Brightness != brightness)
+	{
+		brightness = PPU.Brightness;
+		S9xFixColourBrightness();
+		S9xBuildDirectColourMaps();
+	}
+
+	// the tile caches are this thread's own
+	uint8	*cache[7];
+	uint32	*cached[7], *generation = IPPU.VRAMGeneration;
+	bool8	used[7];
+	memcpy(cache, IPPU.TileCache, sizeof(cache));
+	memcpy(cached, IPPU.TileCached, sizeof(cached));
+	memcpy(used, IPPU.TileCacheUsed, sizeof(used));
+	memcpy(&IPPU, &s->IPPU, sizeof(IPPU));
+	memcpy(IPPU.TileCache, cache, sizeof(cache));
+	memcpy(IPPU.TileCached, cached, sizeof(cached));
+	memcpy(IPPU.TileCacheUsed, used, sizeof(used));
+	IPPU.VRAMGeneration = generation;
+
+	memcpy(GFX.FillRAM + 0x2100, s->FillRAM, sizeof(s->FillRAM));
+	GFX.DoInterlace = s->DoInterlace;
+	GFX.InterlaceFrame = s->InterlaceFrame;
+	GFX.RealPPL = s->RealPPL;
+	GFX.PPL = s->PPL;
+	GFX.InfoString = s->InfoString;
+	GFX.InfoStringTimeout = s->InfoStringTimeout;
+}
+
+static void Replay (SRenderLog *log)
+{
+	for (uint32 pos = 0; pos < log->Used; )
+	{
+		SRenderRecord	*r = (SRenderRecord *) (log->Data + pos);
+		uint8			*data = (uint8 *) (r + 1);
+
+		Adopt(&r->State);
+
+		switch (r->Type)
+		{
+			case RENDER_START:
+				S9xStartScreenRefresh();
+				break;
+
+			case RENDER_LINES:
+				memcpy(&LineData[r->FirstLine], data, r->Lines * sizeof(SLineData));
+				data += r->Lines * sizeof(SLineData);
+				memcpy(&LineMatrixData[r->FirstLine], data, r->Lines * sizeof(SLineMatrixData));
+				data += r->Lines * sizeof(SLineMatrixData);
+				ApplyVRAM((SVRAMUnit *) data, r->Units);
+				S9xUpdateScreen();
+				break;
+
+			case RENDER_END:
+				S9xPresentFrame();
+				break;
+		}
+
+		pos += r->Size;
+	}
+}
+
+static void FreeRenderState (void)
+{
+	S9xFreeTileCache();
+
+	free(GFX.SubScreen);
+	free(GFX.ZBuffer);
+	free(GFX.SubZBuffer);
+	free(GFX.MathMask);
+	free(GFX.VRAM);
+	free(GFX.FillRAM);
+	GFX.SubScreen = NULL;
+	GFX.ZBuffer = GFX.SubZBuffer = GFX.MathMask = GFX.VRAM = GFX.FillRAM = NULL;
+}
+
+static bool8 InitRenderState (void)
+{
+	// start from the emulation thread's state, everything the renderer draws
+	// with is replaced by the first record anyway
+	memcpy(&GFX, mainGFX, sizeof(GFX));
+	memcpy(&PPU, mainPPU, sizeof(PPU));
+	memcpy(&IPPU, mainIPPU, sizeof(IPPU));
+
+	GFX.Threaded = FALSE;
+	GFX.SubScreen  = (uint16 *) malloc(GFX.ScreenSize * sizeof(uint16));
+	GFX.ZBuffer    = (uint8 *)  malloc(GFX.ScreenSize);
+	GFX.SubZBuffer = (uint8 *)  malloc(GFX.ScreenSize);
+	GFX.MathMask   = (uint8 *)  calloc(GFX.ScreenSize, 1);
+	GFX.VRAM       = (uint8 *)  memalign(32, 0x10000);
+	GFX.FillRAM    = (uint8 *)  calloc(0x2200, 1);
+
+	// allocated as they are drawn with, like the emulation thread's
+	bool8	ok = S9xInitTileCache();
+
+	if (!ok || !GFX.SubScreen || !GFX.ZBuffer || !GFX.SubZBuffer || !GFX.MathMask || !GFX.VRAM || !GFX.FillRAM)
+	{
+		FreeRenderState();
+		return (FALSE);
+	}
+
+	memset(GFX.VRAM, 0, 0x10000);
+
+	return (TRUE);
+}
+
+static void * RenderThread (void *)
+{
+	bool8	ok = InitRenderState();
+
+	pthread_mutex_lock(&lock);
+	ready = ok ? 1 : -1;
+	pthread_cond_broadcast(&cond);
+
+	while (ok)
+	{
+		while (!pending && !quit)
+			pthread_cond_wait(&cond, &lock);
+
+		if (!pending)
+			break;
+
+		SRenderLog	*log = &logs[filling ^ 1];
+		pthread_mutex_unlock(&lock);
+
+		Replay(log);
+
+		pthread_mutex_lock(&lock);
+		pending = FALSE;
+		pthread_cond_broadcast(&cond);
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	if (ok)
+		FreeRenderState();
+
+	return (NULL);
+}
+
+bool8 S9xRenderThreadStart (void)
+{
+	if (running)
+		return (TRUE);
+
+	mainGFX = &GFX;
+	mainPPU = &PPU;
+	mainIPPU = &IPPU;
+
+	filling = 0;
+	pending = quit = dropping = FALSE;
+	ready = 0;
+	logs[0].Used = logs[1].Used = 0;
+
+	if (pthread_create(&thread, NULL, RenderThread, NULL))
+		return (FALSE);
+
+	pthread_mutex_lock(&lock);
+	while (!ready)
+		pthread_cond_wait(&cond, &lock);
+	pthread_mutex_unlock(&lock);
+
+	if (ready < 0)
+	{
+		pthread_join(thread, NULL);
+		return (FALSE);
+	}
+
+	// nothing has been sent yet, so all of VRAM goes with the first lines
+	memset(shipped, 0, sizeof(shipped));
+
+	GFX.Threaded = TRUE;
+	running = TRUE;
+
+	return (TRUE);
+}
+
+void S9xRenderThreadSync (bool8 discard)
+{
+	if (!running)
+		return;
+
+	pthread_mutex_lock(&lock);
+	while (pending)
+		pthread_cond_wait(&cond, &lock);
+	pthread_mutex_unlock(&lock);
+
+	if (discard)
+		logs[filling].Used = 0;
+}
+
+void S9xRenderThreadStop (void)
+{
+	if (!running)
+		return;
+
+	S9xRenderThreadSync(TRUE);
+
+	pthread_mutex_lock(&lock);
+	quit = TRUE;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+
+	pthread_join(thread, NULL);
+
+	for (int i = 0; i < 2; i++)
+	{
+		free(logs[i].Data);
+		logs[i].Data = NULL;
+		logs[i].Size = logs[i].Used = 0;
+	}
+
+	GFX.Threaded = FALSE;
+	running = FALSE;
+}
+
+#endif
@@ -0,0 +1,28 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+#ifndef _GFXTHREAD_H_
+#define _GFXTHREAD_H_
+
+#ifdef USE_RENDER_THREAD
+
+#define RENDER_START	0	// S9xStartScreenRefresh
+#define RENDER_LINES	1	// S9xUpdateScreen
+#define RENDER_END		2	// S9xPresentFrame, hands the frame to the render thread
+
+// Start after S9xGraphicsInit and the port's GFX.Screen setup. From then on
+// the emulation thread only records what the renderer needs and the render
+// thread draws into GFX.Screen and calls S9xDeinitUpdate.
+bool8 S9xRenderThreadStart (void);
+void S9xRenderThreadStop (void);
+// Waits until every handed over frame is presented. With discard the lines
+// queued for the current frame are dropped instead of drawn.
+void S9xRenderThreadSync (bool8 discard);
+void S9xRenderThreadQueue (int);
+
+#endif
+
+#endif
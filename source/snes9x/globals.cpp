@@ -23,14 +23,14 @@
 struct SCPUState		CPU;
 struct SICPU			ICPU;
 struct SRegisters		Registers;
-struct SPPU				PPU;
-struct InternalPPU		IPPU;
+RENDER_LOCAL struct SPPU			PPU;
+RENDER_LOCAL struct InternalPPU	IPPU;
 struct SDMA				DMA[8];
 struct STimings			Timings;
-struct SGFX				GFX;
-struct SBG				BG;
-struct SLineData		LineData[240];
-struct SLineMatrixData	LineMatrixData[240];
+RENDER_LOCAL struct SGFX				GFX;
+RENDER_LOCAL struct SBG					BG;
+RENDER_LOCAL struct SLineData			LineData[240];
+RENDER_LOCAL struct SLineMatrixData		LineMatrixData[240];
 struct SDSP0			DSP0;
 struct SDSP1			DSP1;
 struct SDSP2			DSP2;
@@ -66,7 +66,7 @@ char	String[513];
 uint8	OpenBus = 0;
 uint8	*HDMAMemPointers[8];
 uint16	BlackColourMap[256];
-uint16	DirectColourMaps[8][256];
+RENDER_LOCAL uint16	DirectColourMaps[8][256];
 
 SnesModel	M1SNES = { 1, 3, 2 };
 SnesModel	M2SNES = { 2, 4, 3 };
@@ -119,7 +119,7 @@ uint8 mul_brightness[16][32] =
 	  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f }
 };
 
-uint8 brightness_cap[64];
+RENDER_LOCAL uint8 brightness_cap[64];
 
 uint8 S9xOpLengthsM0X0[256] =
 {
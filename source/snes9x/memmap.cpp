@@ -7,6 +7,8 @@
 #ifdef GEKKO
 #include <gccore.h>
 #include <malloc.h>
+#elif defined(__linux)
+#include <malloc.h>
 #endif
 
 #include <string>
@@ -40,6 +42,7 @@
 #include "display.h"
 #include "sha256.h"
 #include "snapshot.h"
+#include "tile.h"
 
 #ifdef GEKKO
 #include "../filebrowser.h"
@@ -919,37 +922,7 @@ bool8 CMemory::Init (void)
     ROM  = (uint8 *) memalign(32,MAX_ROM_SIZE + 0x200 + 0x8000);
 #endif
 
-	IPPU.TileCache[TILE_2BIT]       = (uint8 *) memalign(32,MAX_2BIT_TILES * 64);
-	IPPU.TileCache[TILE_4BIT]       = (uint8 *) memalign(32,MAX_4BIT_TILES * 64);
-	IPPU.TileCache[TILE_8BIT]       = (uint8 *) memalign(32,MAX_8BIT_TILES * 64);
-	IPPU.TileCache[TILE_2BIT_EVEN]  = (uint8 *) memalign(32,MAX_2BIT_TILES * 64);
-	IPPU.TileCache[TILE_2BIT_ODD]   = (uint8 *) memalign(32,MAX_2BIT_TILES * 64);
-	IPPU.TileCache[TILE_4BIT_EVEN]  = (uint8 *) memalign(32,MAX_4BIT_TILES * 64);
-	IPPU.TileCache[TILE_4BIT_ODD]   = (uint8 *) memalign(32,MAX_4BIT_TILES * 64);
-
-	IPPU.TileCached[TILE_2BIT]      = (uint8 *) memalign(32,MAX_2BIT_TILES);
-	IPPU.TileCached[TILE_4BIT]      = (uint8 *) memalign(32,MAX_4BIT_TILES);
-	IPPU.TileCached[TILE_8BIT]      = (uint8 *) memalign(32,MAX_8BIT_TILES);
-	IPPU.TileCached[TILE_2BIT_EVEN] = (uint8 *) memalign(32,MAX_2BIT_TILES);
-	IPPU.TileCached[TILE_2BIT_ODD]  = (uint8 *) memalign(32,MAX_2BIT_TILES);
-	IPPU.TileCached[TILE_4BIT_EVEN] = (uint8 *) memalign(32,MAX_4BIT_TILES);
-	IPPU.TileCached[TILE_4BIT_ODD]  = (uint8 *) memalign(32,MAX_4BIT_TILES);
-
-	if (!RAM || !SRAM || !VRAM || !ROM ||
-		!IPPU.TileCache[TILE_2BIT]       ||
-		!IPPU.TileCache[TILE_4BIT]       ||
-		!IPPU.TileCache[TILE_8BIT]       ||
-		!IPPU.TileCache[TILE_2BIT_EVEN]  ||
-		!IPPU.TileCache[TILE_2BIT_ODD]   ||
-		!IPPU.TileCache[TILE_4BIT_EVEN]  ||
-		!IPPU.TileCache[TILE_4BIT_ODD]   ||
-		!IPPU.TileCached[TILE_2BIT]      ||
-		!IPPU.TileCached[TILE_4BIT]      ||
-		!IPPU.TileCached[TILE_8BIT]      ||
-		!IPPU.TileCached[TILE_2BIT_EVEN] ||
-		!IPPU.TileCached[TILE_2BIT_ODD]  ||
-		!IPPU.TileCached[TILE_4BIT_EVEN] ||
-		!IPPU.TileCached[TILE_4BIT_ODD])
+	if (!RAM || !SRAM || !VRAM || !ROM || !S9xInitTileCache())
     {
 		Deinit();
 		return (FALSE);
@@ -960,22 +933,6 @@ bool8 CMemory::Init (void)
 	memset(VRAM, 0, 0x10000);
 	memset(ROM, 0,  MAX_ROM_SIZE + 0x200 + 0x8000);
 
-	memset(IPPU.TileCache[TILE_2BIT], 0,       MAX_2BIT_TILES * 64);
-	memset(IPPU.TileCache[TILE_4BIT], 0,       MAX_4BIT_TILES * 64);
-	memset(IPPU.TileCache[TILE_8BIT], 0,       MAX_8BIT_TILES * 64);
-	memset(IPPU.TileCache[TILE_2BIT_EVEN], 0,  MAX_2BIT_TILES * 64);
-	memset(IPPU.TileCache[TILE_2BIT_ODD], 0,   MAX_2BIT_TILES * 64);
-	memset(IPPU.TileCache[TILE_4BIT_EVEN], 0,  MAX_4BIT_TILES * 64);
-	memset(IPPU.TileCache[TILE_4BIT_ODD], 0,   MAX_4BIT_TILES * 64);
-
-	memset(IPPU.TileCached[TILE_2BIT], 0,      MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT], 0,      MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_8BIT], 0,      MAX_8BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_EVEN], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_ODD], 0,  MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_EVEN], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_ODD], 0,  MAX_4BIT_TILES);
-
 	// FillRAM uses first 32K of ROM image area, otherwise space just
 	// wasted. Might be read by the SuperFX code.
 
@@ -1033,20 +990,7 @@ void CMemory::Deinit (void)
 		ROM = NULL;
 	}
 
-	for (int t = 0; t <= TILE_8BIT; t++)
-	{
-		if (IPPU.TileCache[t])
-		{
-			free(IPPU.TileCache[t]);
-			IPPU.TileCache[t] = NULL;
-		}
-
-		if (IPPU.TileCached[t])
-		{
-			free(IPPU.TileCached[t]);
-			IPPU.TileCached[t] = NULL;
-		}
-	}
+	S9xFreeTileCache();
 
 	Safe(NULL);
 	SafeANK(NULL);
@@ -3240,16 +3184,23 @@ void CMemory::Map_SA1LoROMMap (void)
 
 	map_hirom_offset(0xc0, 0xff, 0x0000, 0xffff, CalculatedSize, 0);
 
+	// With quantum SA-1 scheduling the S-CPU has to reach I-RAM and the BW-RAM
+	// banks through the handlers, which let the SA-1 catch up first. Dragon
+	// Ball Z keeps its direct mapping and so runs the SA-1 in lockstep.
+	SA1.Quantum = Settings.SA1Quantum > 1 ? Settings.SA1Quantum : 1;
+
 	#ifdef GEKKO
 	if (match_id("AZIJ"))                    { // Dragon Ball Z - Hyper Dimension (J)	
+		SA1.Quantum = 1;
 		map_space(0x00, 0x3f, 0x3000, 0x3fff, FillRAM);
 		map_space(0x80, 0xbf, 0x3000, 0x3fff, FillRAM);
 	}
-	else {
+	else
+	#endif
+	if (SA1.Quantum == 1) {
 		map_space(0x00, 0x3f, 0x3000, 0x37ff, FillRAM);
 		map_space(0x80, 0xbf, 0x3000, 0x37ff, FillRAM);
 	}
-	#endif
 
 
 	map_index(0x00, 0x3f, 0x6000, 0x7fff, MAP_BWRAM, MAP_TYPE_I_O);
@@ -3260,11 +3211,14 @@ void CMemory::Map_SA1LoROMMap (void)
 		for (int c = 0x40; c < 0x80; c++)
 			map_space(c, c, 0x0000, 0xffff, SRAM + (c & 1) * 0x10000);
 	}
+	else
+	#endif
+	if (SA1.Quantum > 1)
+		map_index(0x40, 0x4e, 0x0000, 0xffff, MAP_SA1RAM, MAP_TYPE_RAM);
 	else {
 		for (int c = 0x40; c < 0x4f; c++)
 			map_space(c, c, 0x0000, 0xffff, SRAM + (c & 3) * 0x10000);
 	}
-	#endif
 
 	map_WRAM();
 
@@ -3281,6 +3235,10 @@ void CMemory::Map_SA1LoROMMap (void)
 		SA1.Map[c + 1] = SA1.Map[c + 0x801] = (uint8 *) MAP_NONE;
 		SA1.WriteMap[c + 0] = SA1.WriteMap[c + 0x800] = FillRAM + 0x3000;
 		SA1.WriteMap[c + 1] = SA1.WriteMap[c + 0x801] = (uint8 *) MAP_NONE;
+
+		// the SA-1 always reaches its I-RAM directly
+		SA1.Map[c + 3] = SA1.Map[c + 0x803] = FillRAM;
+		SA1.WriteMap[c + 3] = SA1.WriteMap[c + 0x803] = FillRAM;
 	}
 	
 	// SA-1 Banks 40->4f
@@ -3799,14 +3757,12 @@ void CMemory::ApplyROMFixes (void)
 	S9xAPUAllowTimeOverflow(Timings.APUAllowTimeOverflow);
 	#endif
 	
-	#ifdef GEKKO
 	if (match_id("YI  ")) { // Super Mario World 2 - Yoshi's Island 
 			Timings.SuperFX2CoreSpeed = 8 / 3;
 		}
 		else {
 			Timings.SuperFX2CoreSpeed = 5 / 2;
 		}
-	#endif
 	
 	// Other timing hacks
 	// The delay to sync CPU and DMA which Snes9x does not emulate.
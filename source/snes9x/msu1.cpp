@@ -11,6 +11,12 @@
 #include "apu/blargg_endian.h"
 #include <fstream>
 #include <sys/stat.h>
+#ifdef USE_MSU1_THREAD
+#include <pthread.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 STREAM dataStream = NULL;
 STREAM audioStream = NULL;
@@ -20,6 +26,343 @@ size_t partial_frames;
 // Sample buffer
 int16 *bufPos, *bufBegin, *bufEnd;
 
+/*
+  Audio track reader.
+
+  The track is read a block at a time into a ring that mirrors a window of
+  the file: a byte at file offset o lives at ring[o % MSU1_RING_SIZE]. The
+  window runs from base to end and pos, the next sample to play, sits in it,
+  so seeking back into what was played lately (a loop point, a reloaded
+  state) costs nothing. Blocks are fetched ahead of pos until the unplayed
+  part of the window fills the ring. The start of the loop is kept in a
+  buffer of its own from the moment the track is opened, and is copied back
+  into the ring when playback jumps to it.
+
+  With USE_MSU1_THREAD the blocks are read on a thread of their own; the
+  emulation thread only touches the stream while the thread is not reading
+  (busy), and only waits for the thread when nothing at all is buffered at
+  pos, so the samples are the same whichever thread reads them. Without it
+  a block is read whenever the ring runs dry.
+*/
+
+#define MSU1_RING_SIZE		0x40000		// must be a power of two
+#define MSU1_BLOCK_SIZE		0x8000		// must divide the ring size
+#define MSU1_LOOP_SIZE		0x10000
+
+namespace msu1reader
+{
+	static uint8		ring[MSU1_RING_SIZE];
+	static uint32		base;			// file offset of the oldest byte in the ring
+	static uint32		pos;			// file offset of the next sample
+	static uint32		end;			// file offset past the newest byte in the ring
+	static bool8		eof;			// end is the end of the file
+	static bool8		error;
+	static uint32		generation;		// bumped whenever the window is thrown away
+	static uint32		stream_at;		// file offset audioStream is at after a block, so runs of blocks need no seeks
+
+	static uint8		loop[MSU1_LOOP_SIZE];
+	static uint32		loop_start;
+	static uint32		loop_fill;
+	static bool8		loop_eof;		// the file ends inside the loop buffer
+
+	static int			track = -1;		// the track audioStream was opened for
+
+#ifdef USE_MSU1_THREAD
+	static pthread_t		thread;
+	static pthread_mutex_t	lock = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t	wake = PTHREAD_COND_INITIALIZER;	// signalled to the reader thread
+	static pthread_cond_t	done = PTHREAD_COND_INITIALIZER;	// signalled by the reader thread
+	static bool8			running = FALSE;
+	static bool8			quit = FALSE;
+	static bool8			busy = FALSE;
+#endif
+} // namespace msu1reader
+
+static inline void ReaderLock (void)
+{
+#ifdef USE_MSU1_THREAD
+	pthread_mutex_lock(&msu1reader::lock);
+#endif
+}
+
+static inline void ReaderUnlock (void)
+{
+#ifdef USE_MSU1_THREAD
+	pthread_mutex_unlock(&msu1reader::lock);
+#endif
+}
+
+// Waits for the reader thread to stop using audioStream. Called with the lock held.
+static inline void ReaderQuiesce (void)
+{
+#ifdef USE_MSU1_THREAD
+	while (msu1reader::busy)
+		pthread_cond_wait(&msu1reader::done, &msu1reader::lock);
+#endif
+}
+
+static inline void ReaderWake (void)
+{
+#ifdef USE_MSU1_THREAD
+	pthread_cond_signal(&msu1reader::wake);
+#endif
+}
+
+// Whether the ring has room for another block. Called with the lock held.
+static inline bool8 ReaderWantsBlock (void)
+{
+	using namespace msu1reader;
+
+	return (audioStream && !eof && !error && end - pos <= MSU1_RING_SIZE - MSU1_BLOCK_SIZE);
+}
+
+// Reads the block at end into the ring. Called with the lock held, returns with it held.
+static void ReaderFetchBlock (void)
+{
+	using namespace msu1reader;
+
+	uint32	offset = end & (MSU1_RING_SIZE - 1);
+	uint32	size = MSU1_BLOCK_SIZE;
+	uint32	from = end;
+	uint32	gen = generation;
+
+	// up to the wrap, the next block starts at the beginning of the ring
+	if (size > MSU1_RING_SIZE - offset)
+		size = MSU1_RING_SIZE - offset;
+
+	// give up the oldest bytes the block is about to overwrite
+	if (end + size - base > MSU1_RING_SIZE)
+		base = end + size - MSU1_RING_SIZE;
+
+#ifdef USE_MSU1_THREAD
+	busy = TRUE;
+	ReaderUnlock();
+#endif
+
+	if (stream_at != from)
+		REVERT_STREAM(audioStream, from, 0);
+	int	got = (int) READ_STREAM((char *) ring + offset, size, audioStream);
+	stream_at = (got == (int) size) ? from + size : ~0U;
+
+#ifdef USE_MSU1_THREAD
+	ReaderLock();
+	busy = FALSE;
+	pthread_cond_broadcast(&done);
+#endif
+
+	if (gen != generation)
+		return;
+
+	if (got < 0)
+		error = TRUE;
+	else
+	{
+		end += got;
+		if ((uint32) got < size)
+			eof = TRUE;
+	}
+}
+
+#ifdef USE_MSU1_THREAD
+static void * ReaderThread (void *)
+{
+	using namespace msu1reader;
+
+	ReaderLock();
+
+	for (;;)
+	{
+		while (!quit && !ReaderWantsBlock())
+			pthread_cond_wait(&wake, &lock);
+
+		if (quit)
+			break;
+
+		ReaderFetchBlock();
+	}
+
+	ReaderUnlock();
+
+	return (NULL);
+}
+
+static void ReaderStart (void)
+{
+	using namespace msu1reader;
+
+	if (running)
+		return;
+
+	quit = FALSE;
+	busy = FALSE;
+	running = !pthread_create(&thread, NULL, ReaderThread, NULL);
+}
+
+static void ReaderStop (void)
+{
+	using namespace msu1reader;
+
+	if (!running)
+		return;
+
+	ReaderLock();
+	quit = TRUE;
+	pthread_cond_signal(&wake);
+	ReaderUnlock();
+
+	pthread_join(thread, NULL);
+	running = FALSE;
+}
+#endif
+
+// Throws the window away and starts a new one at offset. Called with the lock held.
+static void ReaderReset (uint32 offset)
+{
+	using namespace msu1reader;
+
+	ReaderQuiesce();
+
+	generation++;
+	base = pos = end = offset;
+	eof = error = FALSE;
+}
+
+// Keeps the start of the loop at hand, called when the track is opened, with the lock held.
+static void ReaderLoadLoop (void)
+{
+	using namespace msu1reader;
+
+	loop_fill = 0;
+	loop_eof = FALSE;
+
+	for (int attempt = 0; attempt < 2 && !loop_fill; attempt++)
+	{
+		// the same fallback S9xMSU1Generate takes for a loop point past the end
+		loop_start = attempt ? 8 : audioLoopPos;
+
+		REVERT_STREAM(audioStream, loop_start, 0);
+		int	got = (int) READ_STREAM((char *) loop, MSU1_LOOP_SIZE, audioStream);
+		stream_at = ~0U;
+
+		if (got > 0)
+		{
+			loop_fill = got;
+			loop_eof = (got < MSU1_LOOP_SIZE);
+		}
+	}
+}
+
+// Moves playback to offset, as a seek of the stream did.
+static void AudioSeek (uint32 offset)
+{
+	using namespace msu1reader;
+
+	ReaderLock();
+
+	if (offset >= base && offset <= end && !error)
+		pos = offset;
+	else
+	if (offset >= loop_start && offset < loop_start + loop_fill)
+	{
+		uint32	skip = offset - loop_start;
+		uint32	size = loop_fill - skip;
+
+		ReaderReset(offset);
+
+		// fits, the loop buffer is smaller than the ring
+		for (uint32 i = 0; i < size; )
+		{
+			uint32	at = (offset + i) & (MSU1_RING_SIZE - 1);
+			uint32	n = MSU1_RING_SIZE - at;
+
+			if (n > size - i)
+				n = size - i;
+
+			memcpy(ring + at, loop + skip + i, n);
+			i += n;
+		}
+
+		end = offset + size;
+		eof = loop_eof;
+	}
+	else
+		ReaderReset(offset);
+
+	ReaderWake();
+	ReaderUnlock();
+}
+
+// Points *data at the bytes buffered at pos and returns how many follow it in
+// one piece, reading them first if there are none. Fewer than 4 is the end of
+// the file, -1 a read error.
+static int AudioPeek (const uint8 **data)
+{
+	using namespace msu1reader;
+
+	ReaderLock();
+
+	while (end - pos < 4 && !eof && !error)
+	{
+	#ifdef USE_MSU1_THREAD
+		if (running)
+		{
+			pthread_cond_signal(&wake);
+			pthread_cond_wait(&done, &lock);
+			continue;
+		}
+	#endif
+		ReaderFetchBlock();
+	}
+
+	int		avail = error ? -1 : (int) (end - pos);
+	uint32	offset = pos & (MSU1_RING_SIZE - 1);
+
+	ReaderUnlock();
+
+	if (avail > (int) (MSU1_RING_SIZE - offset))
+		avail = MSU1_RING_SIZE - offset;
+
+	*data = ring + offset;
+	return (avail);
+}
+
+static void AudioConsume (uint32 bytes)
+{
+	ReaderLock();
+	msu1reader::pos += bytes;
+	if (ReaderWantsBlock())
+		ReaderWake();
+	ReaderUnlock();
+}
+
+// dst[i] = sample * volume / 255, rounded toward zero like the integer division
+static void AudioScale (int16 *dst, const uint8 *src, size_t count, uint8 volume)
+{
+	size_t	i = 0;
+
+#ifdef __SSE2__
+	// x * volume fits a float's mantissa and the quotient is correctly
+	// rounded, so truncating it gives the same result as the integer division
+	const __m128	v = _mm_set1_ps((float) volume);
+	const __m128	d = _mm_set1_ps(255.0f);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i	s = _mm_loadu_si128((const __m128i *) (src + i * 2));
+		__m128i	lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+		__m128i	hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+		lo = _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), v), d));
+		hi = _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), v), d));
+
+		_mm_storeu_si128((__m128i *) (dst + i), _mm_packs_epi32(lo, hi));
+	}
+#endif
+
+	for (; i < count; i++)
+		dst[i] = (int32) (int16) GET_LE16(src + i * 2) * volume / 255;
+}
+
 #ifdef UNZIP_SUPPORT
 static int unzFindExtension(unzFile &file, const char *ext, bool restart = TRUE, bool print = TRUE, bool allowExact = FALSE)
 {
@@ -104,11 +447,18 @@ STREAM S9xMSU1OpenFile(const char *msu_ext, bool skip_unpacked)
 
 static void AudioClose()
 {
+	ReaderLock();
+	ReaderReset(0);
+
 	if (audioStream)
 	{
 		CLOSE_STREAM(audioStream);
 		audioStream = NULL;
 	}
+
+	msu1reader::loop_fill = 0;
+	msu1reader::track = -1;
+	ReaderUnlock();
 }
 
 static bool AudioOpen()
@@ -120,29 +470,45 @@ static bool AudioOpen()
 	char ext[_MAX_EXT];
 	snprintf(ext, _MAX_EXT, "-%d.pcm", MSU1.MSU1_CURRENT_TRACK);
 
+	// the reader thread only looks at the stream with the lock held
+	ReaderLock();
+
     audioStream = S9xMSU1OpenFile(ext);
 	if (audioStream)
 	{
-		if (GETC_STREAM(audioStream) != 'M')
-			return false;
-		if (GETC_STREAM(audioStream) != 'S')
-			return false;
-		if (GETC_STREAM(audioStream) != 'U')
-			return false;
-		if (GETC_STREAM(audioStream) != '1')
+		if (GETC_STREAM(audioStream) != 'M' ||
+			GETC_STREAM(audioStream) != 'S' ||
+			GETC_STREAM(audioStream) != 'U' ||
+			GETC_STREAM(audioStream) != '1')
+		{
+			// nothing to fetch from a stream that is not a track
+			msu1reader::error = TRUE;
+			msu1reader::stream_at = ~0U;
+			ReaderUnlock();
 			return false;
+		}
 
         READ_STREAM((char *)&audioLoopPos, 4, audioStream);
 		audioLoopPos = GET_LE32(&audioLoopPos);
 		audioLoopPos <<= 2;
 		audioLoopPos += 8;
 
+		ReaderLoadLoop();
+		ReaderReset(8);
+		msu1reader::track = MSU1.MSU1_CURRENT_TRACK;
+		ReaderUnlock();
+
+	#ifdef USE_MSU1_THREAD
+		ReaderStart();
+	#endif
+
         MSU1.MSU1_AUDIO_POS = 8;
 
 		MSU1.MSU1_STATUS &= ~AudioError;
 		return true;
 	}
 
+	ReaderUnlock();
 	return false;
 }
 
@@ -201,6 +567,9 @@ void S9xMSU1Init(void)
 
 void S9xMSU1DeInit(void)
 {
+#ifdef USE_MSU1_THREAD
+	ReaderStop();
+#endif
 	DataClose();
 	AudioClose();
 }
@@ -241,21 +610,26 @@ void S9xMSU1Generate(size_t sample_count)
 	{
 		if (MSU1.MSU1_STATUS & AudioPlaying && audioStream)
 		{
-			int32 sample;
-			int16* left = (int16*)&sample;
-			int16* right = left + 1;
+			const uint8 *data;
 
-			int bytes_read = READ_STREAM((char *)&sample, 4, audioStream);
-			if (bytes_read == 4)
+			int bytes_read = AudioPeek(&data);
+			if (bytes_read >= 4)
 			{
-				*left = ((int32)(int16)GET_LE16(left) * MSU1.MSU1_VOLUME / 255);
-				*right = ((int32)(int16)GET_LE16(right) * MSU1.MSU1_VOLUME / 255);
+				// as many stereo frames as are buffered, wanted and fit the output
+				size_t frames = bytes_read >> 2;
+				size_t room = (bufEnd - bufPos - 1) >> 1;
+
+				if (frames > partial_frames / 3204)
+					frames = partial_frames / 3204;
+				if (frames > room)
+					frames = room;
 
+				AudioScale(bufPos, data, frames * 2, MSU1.MSU1_VOLUME);
+				AudioConsume(frames * 4);
 
-				*(bufPos++) = *left;
-				*(bufPos++) = *right;
-				MSU1.MSU1_AUDIO_POS += 4;
-				partial_frames -= 3204;
+				bufPos += frames * 2;
+				MSU1.MSU1_AUDIO_POS += frames * 4;
+				partial_frames -= frames * 3204;
 			}
 			else
 			if (bytes_read >= 0)
@@ -270,12 +644,12 @@ void S9xMSU1Generate(size_t sample_count)
 					{
 						MSU1.MSU1_AUDIO_POS = 8;
 					}
-					REVERT_STREAM(audioStream, MSU1.MSU1_AUDIO_POS, 0);
+					AudioSeek(MSU1.MSU1_AUDIO_POS);
 				}
 				else
 				{
 					MSU1.MSU1_STATUS &= ~(AudioPlaying | AudioRepeating);
-					REVERT_STREAM(audioStream, 8, 0);
+					AudioSeek(8);
 				}
 			}
 			else
@@ -382,7 +756,7 @@ void S9xMSU1WritePort(uint8 port, uint8 byte)
 				MSU1.MSU1_AUDIO_POS = 8;
 			}
 
-            REVERT_STREAM(audioStream, MSU1.MSU1_AUDIO_POS, 0);
+            AudioSeek(MSU1.MSU1_AUDIO_POS);
 		}
 		break;
 	case 6:
@@ -425,16 +799,17 @@ void S9xMSU1PostLoadState(void)
 	{
 		uint32 savedPosition = MSU1.MSU1_AUDIO_POS;
 
+		// the track is still open, what is buffered of it may still be of use
+		if (audioStream && msu1reader::track == MSU1.MSU1_CURRENT_TRACK && !msu1reader::error)
+		{
+			MSU1.MSU1_STATUS &= ~AudioError;
+			AudioSeek(MSU1.MSU1_AUDIO_POS);
+		}
+		else
 		if (AudioOpen())
 		{
-            REVERT_STREAM(audioStream, 4, 0);
-            READ_STREAM((char *)&audioLoopPos, 4, audioStream);
-			audioLoopPos = GET_LE32(&audioLoopPos);
-			audioLoopPos <<= 2;
-			audioLoopPos += 8;
-
 			MSU1.MSU1_AUDIO_POS = savedPosition;
-            REVERT_STREAM(audioStream, MSU1.MSU1_AUDIO_POS, 0);
+            AudioSeek(MSU1.MSU1_AUDIO_POS);
 		}
 		else
 		{
@@ -52,6 +52,14 @@
 #define alwaysinline  inline
 #endif
 
+// The renderer state is per thread when rendering can be moved off the
+// emulation thread, see gfxthread.cpp
+#ifdef USE_RENDER_THREAD
+#define RENDER_LOCAL  __thread
+#else
+#define RENDER_LOCAL
+#endif
+
 #ifndef snes9x_types_defined
 #define snes9x_types_defined
 typedef unsigned char		bool8;
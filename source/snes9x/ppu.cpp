@@ -14,6 +14,8 @@
 #include "controls.h"
 #include "movie.h"
 #include "display.h"
+#include "profile.h"
+#include "tile.h"
 #ifdef NETPLAY_SUPPORT
 #include "netplay.h"
 #endif
@@ -959,8 +961,13 @@ void S9xSetPPU (uint8 Byte, uint16 Address)
 		else
 		if (Settings.SA1     && Address >= 0x2200)
 		{
+			S9xSA1CatchUp();
+
 			if (Address <= 0x23ff)
+			{
 				S9xSetSA1(Byte, Address);
+				S9xSA1EndSlice();
+			}
 			else
 				Memory.FillRAM[Address] = Byte;
 			return;
@@ -1210,7 +1217,10 @@ uint8 S9xGetPPU (uint16 Address)
 			return (S9xGetSuperFX(Address));
 		else
 		if (Settings.SA1     && Address >= 0x2200)
+		{
+			S9xSA1CatchUp();
 			return (S9xGetSA1(Address));
+		}
 		else
 		if (Settings.BS      && Address >= 0x2188 && Address <= 0x219f)
 			return (S9xGetBSXPPU(Address));
@@ -1502,22 +1512,26 @@ void S9xSetCPU (uint8 Byte, uint16 Address)
                 if (Byte) {
 				CPU.Cycles += Timings.DMACPUSync;
                 }
-				if (Byte & 0x01)
-					S9xDoDMA(0);
-				if (Byte & 0x02)
-					S9xDoDMA(1);
-				if (Byte & 0x04)
-					S9xDoDMA(2);
-				if (Byte & 0x08)
-					S9xDoDMA(3);
-				if (Byte & 0x10)
-					S9xDoDMA(4);
-				if (Byte & 0x20)
-					S9xDoDMA(5);
-				if (Byte & 0x40)
-					S9xDoDMA(6);
-				if (Byte & 0x80)
-					S9xDoDMA(7);
+				{
+					PROFILE_BEGIN(dma);
+					if (Byte & 0x01)
+						S9xDoDMA(0);
+					if (Byte & 0x02)
+						S9xDoDMA(1);
+					if (Byte & 0x04)
+						S9xDoDMA(2);
+					if (Byte & 0x08)
+						S9xDoDMA(3);
+					if (Byte & 0x10)
+						S9xDoDMA(4);
+					if (Byte & 0x20)
+						S9xDoDMA(5);
+					if (Byte & 0x40)
+						S9xDoDMA(6);
+					if (Byte & 0x80)
+						S9xDoDMA(7);
+					PROFILE_END(dma, PROFILE_DMA, 1);
+				}
 			#ifdef DEBUGGER
 				missing.dma_this_frame = Byte;
 				missing.dma_channels = Byte;
@@ -1740,13 +1754,7 @@ void S9xResetPPUFast (void)
 	PPU.RecomputeClipWindows = TRUE;
 	IPPU.ColorsChanged = TRUE;
 	IPPU.OBJChanged = TRUE;
-	memset(IPPU.TileCached[TILE_2BIT], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_8BIT], 0, MAX_8BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_EVEN], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_ODD], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_EVEN], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_ODD], 0, MAX_4BIT_TILES);
+	S9xInvalidateTileCache();
 }
 
 void S9xSoftResetPPU (void)
@@ -1886,13 +1894,7 @@ void S9xSoftResetPPU (void)
 		memset(&IPPU.Clip[c], 0, sizeof(struct ClipData));
 	IPPU.ColorsChanged = TRUE;
 	IPPU.OBJChanged = TRUE;
-	memset(IPPU.TileCached[TILE_2BIT], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_8BIT], 0, MAX_8BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_EVEN], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_ODD], 0,  MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_EVEN], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_ODD], 0,  MAX_4BIT_TILES);
+	S9xInvalidateTileCache();
 	PPU.VRAMReadBuffer = 0; // XXX: FIXME: anything better?
 	GFX.InterlaceFrame = 0;
 	GFX.DoInterlace = 0;
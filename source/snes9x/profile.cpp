@@ -0,0 +1,218 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+/*
+  Hot path counters.
+
+  Screen updates, DMA and the SuperFX are rare enough to be timed on every
+  call. Everything that runs per scanline or more often is counted on every
+  call but only timed on one in PROFILE_SAMPLE_RATE, and its time is
+  extrapolated from the samples when it is reported. Opcodes are only counted
+  in total; one in PROFILE_OP_RATE is timed and credited to its handler.
+  Reading the time stamp counter costs more than many opcodes, so this is
+  what keeps the counters cheap enough to leave enabled.
+
+  Every counter only grows and has a single writer. S9xProfileEndFrame,
+  called by S9xMainLoop at the end of every emulated frame, stores how much
+  each one grew, so work done on the render or APU thread is credited to the
+  frame in which it finished.
+*/
+
+#ifdef USE_PROFILER
+
+#include <time.h>
+
+#include "snes9x.h"
+#include "profile.h"
+
+struct SProfileCounter	ProfileSlots[PROFILE_SLOTS];
+struct SProfileCounter	ProfileOps[256];
+uint32					ProfileCountdown[PROFILE_SLOTS];
+uint32					ProfileOpcodes = 0;
+
+namespace profile
+{
+	static struct SProfileFrame		ring[PROFILE_RING_FRAMES];
+	static int						first = 0;
+	static int						count = 0;
+	static uint32					frame = 0;
+	static uint64					frame_start = 0;
+	static uint64					ticks_per_second = 0;
+
+	static struct SProfileCounter	last_slots[PROFILE_SLOTS];	// totals when the last frame ended
+	static struct SProfileCounter	last_ops[256];
+	static uint32					last_opcodes = 0;
+} // namespace profile
+
+using namespace profile;
+
+static const char	*SlotNames[PROFILE_SLOTS] =
+{
+	"event_hblank_start", "event_hdma_start", "event_hcounter_max", "event_hdma_init", "event_render", "event_wram_refresh",
+	"render_mode0", "render_mode1", "render_mode2", "render_mode3", "render_mode4", "render_mode5", "render_mode6", "render_mode7",
+	"bg_mode0", "bg_mode1", "bg_mode2", "bg_mode3", "bg_mode4", "bg_mode5", "bg_mode6", "bg_mode7",
+	"dma", "hdma", "spc", "dsp", "superfx", "sa1"
+};
+
+// stores the growth of `live` since `last` and remembers where it is now
+static void Close (struct SProfileCounter *out, struct SProfileCounter *live, struct SProfileCounter *last)
+{
+	struct SProfileCounter	now;
+
+	now.ticks = PROFILE_LOAD(live->ticks);
+	now.count = PROFILE_LOAD(live->count);
+	now.samples = PROFILE_LOAD(live->samples);
+
+	if (out)
+	{
+		out->ticks = now.ticks - last->ticks;
+		out->count = now.count - last->count;
+		out->samples = now.samples - last->samples;
+	}
+
+	*last = now;
+}
+
+void S9xProfileReset (void)
+{
+	for (int i = 0; i < PROFILE_SLOTS; i++)
+		Close(NULL, &ProfileSlots[i], &last_slots[i]);
+
+	for (int i = 0; i < 256; i++)
+		Close(NULL, &ProfileOps[i], &last_ops[i]);
+
+	last_opcodes = ProfileOpcodes;
+	first = count = 0;
+	frame = 0;
+	frame_start = S9xProfileTicks();
+}
+
+void S9xProfileEndFrame (void)
+{
+	struct SProfileFrame	*f;
+
+	if (count == PROFILE_RING_FRAMES)
+	{
+		f = &ring[first];
+		first = (first + 1) % PROFILE_RING_FRAMES;
+	}
+	else
+		f = &ring[(first + count++) % PROFILE_RING_FRAMES];
+
+	uint64	now = S9xProfileTicks();
+
+	f->Frame = frame++;
+	f->Ticks = frame_start ? now - frame_start : 0;
+	frame_start = now;
+
+	for (int i = 0; i < PROFILE_SLOTS; i++)
+		Close(&f->Slot[i], &ProfileSlots[i], &last_slots[i]);
+
+	for (int i = 0; i < 256; i++)
+		Close(&f->Op[i], &ProfileOps[i], &last_ops[i]);
+
+	f->Opcodes = ProfileOpcodes - last_opcodes;
+	last_opcodes = ProfileOpcodes;
+}
+
+int S9xProfileFrameCount (void)
+{
+	return (count);
+}
+
+const struct SProfileFrame * S9xProfileGetFrame (int n)
+{
+	if (n < 0 || n >= count)
+		return (NULL);
+
+	return (&ring[(first + n) % PROFILE_RING_FRAMES]);
+}
+
+uint64 S9xProfileTicksPerSecond (void)
+{
+	if (ticks_per_second)
+		return (ticks_per_second);
+
+#if defined(__x86_64__) || defined(__i386__)
+	// the TSC runs at a fixed rate, but nothing tells us which
+	struct timespec	a, b;
+	uint64			start;
+
+	clock_gettime(CLOCK_MONOTONIC, &a);
+	start = S9xProfileTicks();
+	do
+		clock_gettime(CLOCK_MONOTONIC, &b);
+	while ((b.tv_sec - a.tv_sec) * 1000000000LL + (b.tv_nsec - a.tv_nsec) < 10000000);
+
+	ticks_per_second = (S9xProfileTicks() - start) * 1000000000LL / ((b.tv_sec - a.tv_sec) * 1000000000LL + (b.tv_nsec - a.tv_nsec));
+#elif defined(GEKKO) || defined(__powerpc__)
+	#ifdef HW_RVL
+	ticks_per_second = 60750000;	// bus clock / 4
+	#else
+	ticks_per_second = 40500000;
+	#endif
+#elif defined(__aarch64__)
+	__asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r" (ticks_per_second));
+#else
+	ticks_per_second = 1000000000;
+#endif
+
+	return (ticks_per_second);
+}
+
+const char * S9xProfileSlotName (int slot)
+{
+	if (slot < 0 || slot >= PROFILE_SLOTS)
+		return (NULL);
+
+	return (SlotNames[slot]);
+}
+
+static void WriteCounter (FILE *fp, uint32 frame, const char *name, const struct SProfileCounter *c, double usec_per_tick)
+{
+	if (!c->count)
+		return;
+
+	double	ticks = c->samples ? (double) c->ticks * c->count / c->samples : 0.0;
+
+	fprintf(fp, "%u,%s,%u,%u,%llu,%.3f\n", frame, name, c->count, c->samples, (unsigned long long) c->ticks, ticks * usec_per_tick);
+}
+
+bool8 S9xProfileDumpCSV (const char *filename)
+{
+	FILE	*fp = fopen(filename, "w");
+	if (!fp)
+		return (FALSE);
+
+	double	usec_per_tick = 1e6 / S9xProfileTicksPerSecond();
+
+	fprintf(fp, "frame,counter,count,samples,ticks,usec\n");
+
+	for (int n = 0; n < count; n++)
+	{
+		const struct SProfileFrame	*f = S9xProfileGetFrame(n);
+		struct SProfileCounter		total = { f->Ticks, 1, 1 };
+		char						name[8];
+
+		WriteCounter(fp, f->Frame, "frame", &total, usec_per_tick);
+		fprintf(fp, "%u,opcodes,%u,0,0,0\n", f->Frame, f->Opcodes);
+
+		for (int i = 0; i < PROFILE_SLOTS; i++)
+			WriteCounter(fp, f->Frame, SlotNames[i], &f->Slot[i], usec_per_tick);
+
+		for (int i = 0; i < 256; i++)
+		{
+			sprintf(name, "op_%02x", i);
+			WriteCounter(fp, f->Frame, name, &f->Op[i], usec_per_tick);
+		}
+	}
+
+	fclose(fp);
+
+	return (TRUE);
+}
+
+#endif
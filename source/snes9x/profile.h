@@ -0,0 +1,186 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+// Without USE_PROFILER every PROFILE_ macro expands to nothing.
+#ifdef USE_PROFILER
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif !defined(GEKKO) && !defined(__powerpc__) && !defined(__aarch64__)
+#include <time.h>
+#endif
+
+#define PROFILE_RING_FRAMES	64
+#define PROFILE_OP_RATE		256	// one in this many opcodes is timed, a power of two
+#define PROFILE_SAMPLE_RATE	16	// one in this many calls of a sampled slot is timed
+
+enum
+{
+	PROFILE_EVENT_HBLANK_START,	// S9xDoHEventProcessing by CPU.WhichEvent, sampled
+	PROFILE_EVENT_HDMA_START,
+	PROFILE_EVENT_HCOUNTER_MAX,
+	PROFILE_EVENT_HDMA_INIT,
+	PROFILE_EVENT_RENDER,
+	PROFILE_EVENT_WRAM_REFRESH,
+	PROFILE_RENDER_MODE0,		// DrawScreen by PPU.BGMode, counted in lines
+	PROFILE_BG_MODE0 = PROFILE_RENDER_MODE0 + 8,	// the backgrounds of RenderScreen by PPU.BGMode
+	PROFILE_DMA = PROFILE_BG_MODE0 + 8,
+	PROFILE_HDMA,
+	PROFILE_SPC,				// SNES_SPC::end_frame, including the DSP, sampled
+	PROFILE_DSP,				// SPC_DSP::run, sampled
+	PROFILE_SUPERFX,			// FxEmulate from S9xSuperFXExec, on every build
+	PROFILE_SA1,				// sampled
+	PROFILE_SLOTS
+};
+
+// `ticks` were measured over `samples` of the `count` events. Only sampled
+// counters have fewer samples than events, their time is extrapolated.
+struct SProfileCounter
+{
+	uint64	ticks;
+	uint32	count;
+	uint32	samples;
+};
+
+struct SProfileFrame
+{
+	uint32					Frame;
+	uint64					Ticks;		// since the previous frame ended
+	uint32					Opcodes;	// main CPU opcodes executed
+	struct SProfileCounter	Slot[PROFILE_SLOTS];
+	struct SProfileCounter	Op[256];	// by opcode, the counts are estimated from the samples
+};
+
+// Running totals. Every counter has a single writer, the frame ring stores
+// the difference to the totals at the end of the previous frame, so no
+// thread has to reset another one's counters.
+extern struct SProfileCounter	ProfileSlots[PROFILE_SLOTS];
+extern struct SProfileCounter	ProfileOps[256];
+extern uint32					ProfileCountdown[PROFILE_SLOTS];
+extern uint32					ProfileOpcodes;
+
+static inline uint64 S9xProfileTicks (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return (__rdtsc());
+#elif defined(GEKKO) || defined(__powerpc__)
+	uint32	hi, lo, check;
+
+	do
+	{
+		__asm__ __volatile__ ("mftbu %0; mftb %1; mftbu %2" : "=r" (hi), "=r" (lo), "=r" (check));
+	}
+	while (hi != check);
+
+	return (((uint64) hi << 32) | lo);
+#elif defined(__aarch64__)
+	uint64	t;
+
+	__asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (t));
+	return (t);
+#else
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64) ts.tv_sec * 1000000000 + ts.tv_nsec);
+#endif
+}
+
+// the emulation thread reads the totals of the render and APU threads
+#if defined(USE_RENDER_THREAD) || defined(USE_APU_THREAD)
+#define PROFILE_LOAD(v)		__atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define PROFILE_STORE(v, x)	__atomic_store_n(&(v), (x), __ATOMIC_RELAXED)
+#else
+#define PROFILE_LOAD(v)		(v)
+#define PROFILE_STORE(v, x)	((v) = (x))
+#endif
+
+static inline void S9xProfileCount (struct SProfileCounter *c, uint32 count)
+{
+	PROFILE_STORE(c->count, c->count + count);
+}
+
+static inline void S9xProfileTime (struct SProfileCounter *c, uint64 ticks, uint32 samples)
+{
+	PROFILE_STORE(c->ticks, c->ticks + ticks);
+	PROFILE_STORE(c->samples, c->samples + samples);
+}
+
+// Returns 0 for the calls that are only counted.
+static inline uint64 S9xProfileSample (struct SProfileCounter *c, uint32 *countdown, uint32 rate)
+{
+	S9xProfileCount(c, 1);
+	if (*countdown > 1)
+	{
+		--*countdown;
+		return (0);
+	}
+
+	*countdown = rate;
+	return (S9xProfileTicks());
+}
+
+static inline void S9xProfileSampleEnd (struct SProfileCounter *c, uint64 start)
+{
+	if (start)
+		S9xProfileTime(c, S9xProfileTicks() - start, 1);
+}
+
+// Counting every opcode by handler would cost more than the rest of the
+// counters together, so only the sampled ones are, PROFILE_OP_RATE times.
+static inline uint64 S9xProfileOpStart (void)
+{
+	if (++ProfileOpcodes & (PROFILE_OP_RATE - 1))
+		return (0);
+
+	return (S9xProfileTicks());
+}
+
+static inline void S9xProfileOpEnd (struct SProfileCounter *c, uint64 start)
+{
+	if (start)
+	{
+		S9xProfileCount(c, PROFILE_OP_RATE);
+		S9xProfileTime(c, S9xProfileTicks() - start, 1);
+	}
+}
+
+void S9xProfileReset (void);
+// Closes the counters of the current frame and moves them into the ring.
+void S9xProfileEndFrame (void);
+// Frames kept in the ring, 0 is the oldest.
+int S9xProfileFrameCount (void);
+const struct SProfileFrame * S9xProfileGetFrame (int);
+uint64 S9xProfileTicksPerSecond (void);
+const char * S9xProfileSlotName (int);
+bool8 S9xProfileDumpCSV (const char *);
+
+// timed on every call, `count` is added to the number of events
+#define PROFILE_BEGIN(t)					uint64 t = S9xProfileTicks()
+#define PROFILE_END(t, slot, count)			S9xProfileCount(&ProfileSlots[slot], (count)), S9xProfileTime(&ProfileSlots[slot], S9xProfileTicks() - (t), (count))
+// counted on every call, timed on one in PROFILE_SAMPLE_RATE
+#define PROFILE_SAMPLE_BEGIN(t, slot)		uint64 t = S9xProfileSample(&ProfileSlots[slot], &ProfileCountdown[slot], PROFILE_SAMPLE_RATE)
+#define PROFILE_SAMPLE_END(t, slot)			S9xProfileSampleEnd(&ProfileSlots[slot], (t))
+#define PROFILE_OP_BEGIN(t, op)				uint64 t = S9xProfileOpStart()
+#define PROFILE_OP_END(t, op)				S9xProfileOpEnd(&ProfileOps[op], (t))
+#define PROFILE_END_FRAME()					S9xProfileEndFrame()
+
+#else
+
+#define PROFILE_BEGIN(t)
+#define PROFILE_END(t, slot, count)
+#define PROFILE_SAMPLE_BEGIN(t, slot)
+#define PROFILE_SAMPLE_END(t, slot)
+#define PROFILE_OP_BEGIN(t, op)
+#define PROFILE_OP_END(t, op)
+#define PROFILE_END_FRAME()
+
+#endif
+
+#endif
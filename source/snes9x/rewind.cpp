@@ -0,0 +1,337 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+/*
+  Rewind ring buffer.
+
+  Every `interval` frames the game is frozen with S9xFreezeGameMem. Every
+  `keyframes`-th capture is stored as a keyframe, the others are stored as the
+  XOR against the uncompressed copy of their keyframe, so restoring any entry
+  costs one keyframe decode and one delta decode.
+
+  Both kinds of entry use the same run-length format over 32-bit words:
+  a header word holding the number of unchanged words to skip (low 16 bits)
+  and the number of literal words that follow (high 16 bits). A keyframe is
+  simply the delta against an all-zero state. Since every header is paid for
+  by at least one skipped word, an entry never grows beyond the raw state by
+  more than a few words, which lets the encoder write straight into the ring.
+
+  Before encoding, room for a worst-case entry is made by dropping the oldest
+  keyframe along with the deltas that depend on it, so the usable history is
+  the ring size minus one uncompressed capture.
+*/
+
+#include "snes9x.h"
+#include "memmap.h"
+#include "snapshot.h"
+#include "rewind.h"
+
+struct SRewindEntry
+{
+	uint32	offset;
+	uint32	size;
+	bool8	keyframe;
+};
+
+namespace history
+{
+	static uint8		*ring = NULL;
+	static uint32		ring_size = 0;
+
+	static uint32		*state = NULL;		// the capture being encoded or restored
+	static uint32		*key = NULL;		// uncompressed copy of the newest keyframe
+	static uint32		state_size = 0;		// S9xFreezeSize()
+	static uint32		state_words = 0;
+
+	static SRewindEntry	entries[REWIND_MAX_ENTRIES];
+	static int			first = 0;
+	static int			count = 0;
+
+	static int			interval = REWIND_DEFAULT_INTERVAL;
+	static int			keyframes = REWIND_DEFAULT_KEYFRAMES;
+	static int			frame_counter = 0;
+	static int			since_keyframe = 0;
+} // namespace history
+
+using namespace history;
+
+static inline SRewindEntry * EntryAt (int n)
+{
+	return &entries[(first + n) % REWIND_MAX_ENTRIES];
+}
+
+static uint32 MaxEncodedSize (void)
+{
+	return (state_size + 4 * (2 + state_words / 0xffff)) & ~3;
+}
+
+template <bool delta>
+static uint32 Encode (uint32 *dst, const uint32 *cur, const uint32 *ref)
+{
+	uint32	*out = dst;
+	uint32	i = 0;
+
+	#define DELTA(n)	(delta ? cur[n] ^ ref[n] : cur[n])
+
+	while (i < state_words)
+	{
+		uint32	skip = 0;
+
+		// most of the state is unchanged, so look for the next change eight words at a time
+		while (i + 8 <= state_words && skip <= 0xffff - 8 &&
+			!(DELTA(i) | DELTA(i + 1) | DELTA(i + 2) | DELTA(i + 3) | DELTA(i + 4) | DELTA(i + 5) | DELTA(i + 6) | DELTA(i + 7)))
+		{
+			i += 8;
+			skip += 8;
+		}
+
+		while (i < state_words && skip < 0xffff && DELTA(i) == 0)
+		{
+			i++;
+			skip++;
+		}
+
+		if (i == state_words)
+			break;
+
+		uint32	*header = out++;
+		uint32	lit = 0;
+		uint32	w;
+
+		while (i < state_words && lit < 0xffff && (w = DELTA(i)) != 0)
+		{
+			*out++ = w;
+			i++;
+			lit++;
+		}
+
+		*header = skip | (lit << 16);
+	}
+
+	#undef DELTA
+
+	// an identical state still takes up one empty header, so entries never
+	// share an offset and a full ring can be told apart from an empty one
+	if (out == dst)
+		*out++ = 0;
+
+	return ((out - dst) * 4);
+}
+
+static void Decode (uint32 *dst, const uint32 *src, uint32 size)
+{
+	const uint32	*end = src + size / 4;
+	uint32			pos = 0;
+
+	while (src < end)
+	{
+		uint32	header = *src++;
+		uint32	lit = header >> 16;
+
+		pos += header & 0xffff;
+
+		while (lit--)
+			dst[pos++] ^= *src++;
+	}
+}
+
+static void DropOldest (void)
+{
+	if (!count)
+		return;
+
+	first = (first + 1) % REWIND_MAX_ENTRIES;
+	count--;
+
+	// deltas are useless without the keyframe they were taken against
+	while (count && !EntryAt(0)->keyframe)
+	{
+		first = (first + 1) % REWIND_MAX_ENTRIES;
+		count--;
+	}
+}
+
+static bool8 Allocate (uint32 need, uint32 *offset)
+{
+	if (need > ring_size)
+		return (FALSE);
+
+	for (;;)
+	{
+		if (count == REWIND_MAX_ENTRIES)
+		{
+			DropOldest();
+			continue;
+		}
+
+		if (!count)
+		{
+			*offset = 0;
+			return (TRUE);
+		}
+
+		SRewindEntry	*newest = EntryAt(count - 1);
+		uint32			head = newest->offset + newest->size;
+		uint32			tail = EntryAt(0)->offset;
+
+		if (head > tail)
+		{
+			if (ring_size - head >= need)
+			{
+				*offset = head;
+				return (TRUE);
+			}
+
+			if (tail >= need)
+			{
+				*offset = 0;
+				return (TRUE);
+			}
+		}
+		else
+		if (tail - head >= need)
+		{
+			*offset = head;
+			return (TRUE);
+		}
+
+		DropOldest();
+	}
+}
+
+bool8 S9xRewindInit (uint8 *arena, uint32 arena_size, int frames, int keys)
+{
+	S9xRewindDeinit();
+
+	if (!arena || frames < 1 || keys < 1)
+		return (FALSE);
+
+	state_size = S9xFreezeSize();
+	state_words = (state_size + 3) / 4;
+
+	uint32	scratch = state_words * 4;
+
+	if (arena_size < scratch * 2 + MaxEncodedSize())
+		return (FALSE);
+
+	state = (uint32 *) arena;
+	key = (uint32 *) (arena + scratch);
+	ring = arena + scratch * 2;
+	ring_size = (arena_size - scratch * 2) & ~3;
+
+	memset(state, 0, scratch);
+	memset(key, 0, scratch);
+
+	interval = frames;
+	keyframes = keys;
+
+	S9xRewindReset();
+
+	return (TRUE);
+}
+
+void S9xRewindDeinit (void)
+{
+	ring = NULL;
+	ring_size = 0;
+	state = key = NULL;
+	state_size = state_words = 0;
+	first = count = 0;
+}
+
+void S9xRewindReset (void)
+{
+	first = count = 0;
+	frame_counter = 0;
+	since_keyframe = 0;
+}
+
+void S9xRewindCapture (void)
+{
+	if (!ring || ++frame_counter < interval)
+		return;
+
+	frame_counter = 0;
+
+	bool8	screenshots = Settings.SnapshotScreenshots;
+	Settings.SnapshotScreenshots = FALSE;
+	S9xFreezeGameMem((uint8 *) state, state_size);
+	Settings.SnapshotScreenshots = screenshots;
+
+	uint32	offset;
+	if (!Allocate(MaxEncodedSize(), &offset))
+		return;
+
+	// the allocation may have evicted the keyframe our deltas refer to
+	bool8	keyframe = (!count || since_keyframe >= keyframes);
+
+	SRewindEntry	*entry = &entries[(first + count) % REWIND_MAX_ENTRIES];
+
+	entry->offset = offset;
+	entry->keyframe = keyframe;
+	if (keyframe)
+		entry->size = Encode<false>((uint32 *) (ring + offset), state, NULL);
+	else
+		entry->size = Encode<true>((uint32 *) (ring + offset), state, key);
+	count++;
+
+	if (keyframe)
+	{
+		uint32	*tmp = key;
+		key = state;
+		state = tmp;
+		since_keyframe = 1;
+	}
+	else
+		since_keyframe++;
+}
+
+bool8 S9xRewindStep (void)
+{
+	if (!ring || !count)
+		return (FALSE);
+
+	int	newest = count - 1;
+	int	k = newest;
+
+	while (k > 0 && !EntryAt(k)->keyframe)
+		k--;
+
+	SRewindEntry	*keyentry = EntryAt(k);
+	SRewindEntry	*entry = EntryAt(newest);
+
+	memset(key, 0, state_words * 4);
+	Decode(key, (uint32 *) (ring + keyentry->offset), keyentry->size);
+
+	memcpy(state, key, state_words * 4);
+	if (entry != keyentry)
+		Decode(state, (uint32 *) (ring + entry->offset), entry->size);
+
+	int	result = S9xUnfreezeGameMem((uint8 *) state, state_size);
+
+	// the restored entry is the present now, so the next capture is taken
+	// against the same keyframe unless we just consumed it
+	count--;
+	frame_counter = 0;
+	since_keyframe = (entry == keyentry) ? keyframes : newest - k;
+
+	return (result == SUCCESS);
+}
+
+int S9xRewindCount (void)
+{
+	return (count);
+}
+
+uint32 S9xRewindMemoryUsed (void)
+{
+	uint32	used = 0;
+
+	for (int i = 0; i < count; i++)
+		used += EntryAt(i)->size;
+
+	return (used);
+}
@@ -0,0 +1,27 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+#ifndef _REWIND_H_
+#define _REWIND_H_
+
+#include "snes9x.h"
+
+#define REWIND_DEFAULT_INTERVAL		6	// frames between captures
+#define REWIND_DEFAULT_KEYFRAMES	30	// captures per keyframe
+#define REWIND_MAX_ENTRIES			4096
+
+// The arena is owned by the caller (MEM2 on Wii) and must stay valid until
+// S9xRewindDeinit. Two uncompressed snapshots are carved out of it as working
+// space, the rest holds the delta-compressed history.
+bool8 S9xRewindInit (uint8 *, uint32, int, int);
+void S9xRewindDeinit (void);
+void S9xRewindReset (void);
+void S9xRewindCapture (void);
+bool8 S9xRewindStep (void);
+int S9xRewindCount (void);
+uint32 S9xRewindMemoryUsed (void);
+
+#endif
@@ -0,0 +1,99 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+/*
+  Run-ahead.
+
+  Most games act on input one or more frames after they read it. To hide
+  that lag, every frame is emulated for real without being drawn, then the
+  game is saved with S9xFreezeGameFast and `frames` more frames are emulated
+  with the same input. Only the last of those is drawn, and the game is
+  restored to the saved state afterwards.
+
+  The real frame is the only one heard and the only one that calls
+  S9xSyncSpeed, so pacing, frame skipping and sound stay exactly as they are
+  without run-ahead; only the picture is taken from further ahead.
+*/
+
+#include "snes9x.h"
+#include "memmap.h"
+#include "apu/apu.h"
+#include "movie.h"
+#include "snapshot.h"
+#include "runahead.h"
+
+bool8	RunAheadSpeculating = FALSE;
+
+namespace runahead
+{
+	static uint8	*state = NULL;
+	static uint32	state_size = 0;
+	static int		frames = 0;
+} // namespace runahead
+
+using namespace runahead;
+
+bool8 S9xRunAheadInit (int count)
+{
+	S9xRunAheadDeinit();
+
+	if (count < 1 || count > RUNAHEAD_MAX_FRAMES)
+		return (FALSE);
+
+	state_size = S9xFreezeFastSize();
+	if (!state_size)
+		return (FALSE);
+
+	state = new uint8[state_size];
+	frames = count;
+
+	return (TRUE);
+}
+
+void S9xRunAheadDeinit (void)
+{
+	delete[] state;
+	state = NULL;
+	state_size = 0;
+	frames = 0;
+}
+
+void S9xRunAheadFrame (void)
+{
+	// a movie started since S9xRunAheadInit has to record the real frames only
+	if (!state || S9xMovieActive())
+	{
+		S9xMainLoop();
+		return;
+	}
+
+	IPPU.RenderThisFrame = FALSE;
+	S9xMainLoop();
+
+	// what S9xSyncSpeed decided for the frame that is shown next
+	bool8	render = IPPU.RenderThisFrame;
+
+	S9xFreezeGameFast(state);
+
+	RunAheadSpeculating = TRUE;
+	S9xAPUHoldSamples(TRUE);
+
+	for (int i = 1; i <= frames; i++)
+	{
+		IPPU.RenderThisFrame = (i == frames) ? render : FALSE;
+		S9xMainLoop();
+	}
+
+	S9xAPUHoldSamples(FALSE);
+	RunAheadSpeculating = FALSE;
+
+	S9xUnfreezeGameFast(state);
+}
+
+uint32 S9xRunAheadStateSize (void)
+{
+	return (state_size);
+}
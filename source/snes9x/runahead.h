@@ -0,0 +1,26 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+#ifndef _RUNAHEAD_H_
+#define _RUNAHEAD_H_
+
+#include "snes9x.h"
+
+#define RUNAHEAD_MAX_FRAMES	4
+
+// TRUE while S9xRunAheadFrame emulates the frames it throws away again.
+// Those frames are neither paced by S9xSyncSpeed nor heard.
+extern bool8	RunAheadSpeculating;
+
+// Fails when the loaded game cannot be saved with S9xFreezeGameFast.
+// Run-ahead has to be set up again whenever another game is loaded.
+bool8 S9xRunAheadInit (int);
+void S9xRunAheadDeinit (void);
+// Takes the place of S9xMainLoop, presenting the frame `frames` ahead
+void S9xRunAheadFrame (void);
+uint32 S9xRunAheadStateSize (void);
+
+#endif
@@ -20,6 +20,9 @@ void S9xSA1Init (void)
 {
 	SA1.Cycles = 0;
 	SA1.PrevCycles = 0;
+	SA1.Slice = 0;
+	SA1.SliceEnd = 0;
+	SA1.SyncCycles = 0;
 	SA1.Flags = 0;
 	SA1.WaitingForInterrupt = FALSE;
 
@@ -56,6 +56,10 @@ struct SSA1
 	bool8	overflow;
 	uint8	VirtualBitmapFormat;
 	uint8	variable_bit_pos;
+	int32	Slice;		// S-CPU instructions since the SA-1 last ran
+	int32	SliceEnd;	// the SA-1 runs again when Slice gets here
+	int32	SyncCycles;	// end of the last S-CPU instruction, where the SA-1 catches up to
+	int32	Quantum;	// Settings.SA1Quantum the memory map was built for
 };
 
 #define SA1CheckCarry()		(SA1._Carry)
@@ -95,6 +99,32 @@ void S9xSA1Init (void);
 void S9xSA1MainLoop (void);
 void S9xSA1PostLoadState (void);
 
+// With a quantum above 1 the SA-1 only catches up with the S-CPU
+// every that many S-CPU instructions. In between it lags behind, so the S-CPU
+// calls this before it touches anything the two share: the $2200-$23ff
+// registers, I-RAM, BW-RAM and DMA. The SA-1 is brought to the end of the
+// previous S-CPU instruction, just where lockstep would have left it. The
+// S-CPU interrupts also catch up, as the SA-1 may have replaced their vectors.
+// An S-CPU IRQ raised by the SA-1 could only be noticed a slice late, so
+// S9xSA1MainLoop keeps the SA-1 in lockstep while $2201 enables one.
+static inline void S9xSA1CatchUp (void)
+{
+	if (SA1.Slice)
+		S9xSA1MainLoop();
+}
+
+static inline int32 S9xSA1SliceLength (void)
+{
+	return ((Memory.FillRAM[0x2201] & 0xa0) ? 1 : SA1.Quantum);
+}
+
+// A write to the SA-1 registers can start an interrupt or a DMA on the SA-1,
+// which has to be noticed as soon as in lockstep.
+static inline void S9xSA1EndSlice (void)
+{
+	SA1.SliceEnd = SA1.Slice + 1;
+}
+
 static inline void S9xSA1UnpackStatus (void)
 {
 	SA1._Zero = (SA1Registers.PL & Zero) == 0;
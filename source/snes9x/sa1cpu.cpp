@@ -59,9 +59,16 @@ static void S9xSA1UpdateTimer (void);
 
 void S9xSA1MainLoop (void)
 {
+	// in lockstep this runs after every S-CPU instruction. While the SA-1 may
+	// interrupt the S-CPU it stays in lockstep, since the S-CPU checks for
+	// IRQs before every instruction without catching up.
+	int32	slice = SA1.Slice > 1 ? SA1.Slice : 1;
+	SA1.Slice = 0;
+	SA1.SliceEnd = S9xSA1SliceLength();
+
 	if (Memory.FillRAM[0x2200] & 0x60)
 	{
-		SA1.Cycles += 6; // FIXME
+		SA1.Cycles += 6 * slice; // FIXME
 		S9xSA1UpdateTimer();
 		return;
 	}
@@ -125,9 +132,7 @@ void S9xSA1MainLoop (void)
 			S9xSA1Opcode_IRQ();
 		}
 	}
-	#undef CPU
-	int cycles = CPU.Cycles * 3;
-	#define CPU SA1
+	int cycles = SA1.SyncCycles * 3;
 
 	for (; SA1.Cycles < cycles && !(Memory.FillRAM[0x2200] & 0x60);)
 	{
@@ -7,6 +7,7 @@
 #include "snes9x.h"
 #include "memmap.h"
 #include "sdd1.h"
+#include "sdd1emu.h"
 #include "display.h"
 
 
@@ -31,6 +32,8 @@ void S9xResetSDD1 (void)
 		Memory.FillRAM[0x4804 + i] = i;
 		S9xSetSDD1MemoryMap(i, i);
 	}
+
+	SDD1_reset_cache();
 }
 
 void S9xSDD1PostLoadState (void)
@@ -234,6 +234,70 @@ void SDD1_decompress(uint8 *out, uint8 *in, int len){
     }
 }
 
+/* Decompression cache
+ *
+ * Games stream the same compressed blocks again and again, and decoding
+ * them is by far the most expensive part of an S-DD1 DMA. Since the
+ * decoder starts from scratch on every transfer, its output depends only on
+ * the source address, and a shorter transfer from the same address gets a
+ * prefix of a longer one. So the cache keeps the longest output seen for
+ * each source, in a direct mapped table.
+ *
+ * The output lives in a ring arena of SDD1_CACHE_SIZE bytes. Blocks never
+ * wrap; positions are counted from the last reset, and a block is still
+ * there as long as less than a full arena has been written after it.
+ */
+
+#define SDD1_CACHE_SIZE    0x80000
+#define SDD1_CACHE_ENTRIES 1024
+
+static struct {
+    uint8 *in;
+    uint32 pos;
+    uint32 len;
+} cache_entries[SDD1_CACHE_ENTRIES];
+static uint8 *cache_arena = NULL;
+static uint32 cache_written = 0;
+
+void SDD1_reset_cache(void){
+    memset(cache_entries, 0, sizeof(cache_entries));
+    cache_written = 0;
+}
+
+uint8 *SDD1_decompress_cached(uint8 *in, int len){
+    uint32 key, pos;
+
+    if(len==0) len=0x10000;
+
+    if(!cache_arena){
+        cache_arena=(uint8 *) malloc(SDD1_CACHE_SIZE);
+        if(!cache_arena) return NULL;
+    }
+
+    key=(uint32) (((pint) in ^ ((pint) in >> 10)) & (SDD1_CACHE_ENTRIES-1));
+
+    if(cache_entries[key].in==in && cache_entries[key].len>=(uint32) len &&
+       cache_written-cache_entries[key].pos<=SDD1_CACHE_SIZE)
+        return cache_arena+cache_entries[key].pos%SDD1_CACHE_SIZE;
+
+    /* positions only grow, start over before they overflow */
+    if(cache_written>0xffffffff-2*SDD1_CACHE_SIZE)
+        SDD1_reset_cache();
+
+    pos=cache_written;
+    if(pos%SDD1_CACHE_SIZE+len>SDD1_CACHE_SIZE)
+        pos+=SDD1_CACHE_SIZE-pos%SDD1_CACHE_SIZE;
+    cache_written=pos+len;
+
+    SDD1_decompress(cache_arena+pos%SDD1_CACHE_SIZE, in, len);
+
+    cache_entries[key].in=in;
+    cache_entries[key].pos=pos;
+    cache_entries[key].len=len;
+
+    return cache_arena+pos%SDD1_CACHE_SIZE;
+}
+
 #if 0
 static uint8 cur_plane;
 static uint8 num_bits;
@@ -8,5 +8,9 @@
 #define _SDD1EMU_H_
 
 void SDD1_decompress (uint8 *, uint8 *, int);
+// Returns the output of the block at the source address, NULL if there is
+// no memory for the cache. Only for sources that never change.
+uint8 * SDD1_decompress_cached (uint8 *, int);
+void SDD1_reset_cache (void);
 
 #endif
@@ -16,6 +16,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "sha256.h"
 
 /****************************** MACROS ******************************/
 #define ROTLEFT(a,b) (((a) << (b)) | ((a) >> (32-(b))))
@@ -33,13 +34,6 @@
 typedef unsigned char BYTE;             /* 8-bit byte */
 typedef unsigned int  WORD;             /* 32-bit word, change to "long" for 16-bit machines */
 
-typedef struct {
-	BYTE data[64];
-	WORD datalen;
-	uint64_t bitlen;
-	WORD state[8];
-} SHA256_CTX;
-
 /**************************** VARIABLES *****************************/
 static const WORD k[64] = {
 	0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
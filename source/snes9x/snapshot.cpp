@@ -5,6 +5,13 @@
 \*****************************************************************************/
 
 #include <assert.h>
+#include <stddef.h>
+#ifndef GEKKO
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "snes9x.h"
 #include "memmap.h"
 #include "dma.h"
@@ -19,6 +26,7 @@
 #include "display.h"
 #include "language.h"
 #include "gfx.h"
+#include "gfxthread.h"
 
 #ifndef min
 #define min(a,b)	(((a) < (b)) ? (a) : (b))
@@ -170,6 +178,41 @@ struct SnapshotScreenshotInfo
 	uint8	Data[MAX_SNES_WIDTH * MAX_SNES_HEIGHT * 3];
 };
 
+// The blocks of a snapshot, as read from a stream or found in a binary
+// snapshot. Struct blocks hold their fields packed the FreezeStruct way.
+struct SnapshotBlocks
+{
+	uint8	*cpu;
+	uint8	*registers;
+	uint8	*ppu;
+	uint8	*dma;
+	uint8	*vram;
+	uint8	*ram;
+	uint8	*sram;
+	uint8	*fillram;
+	uint8	*apu_sound;
+	uint8	*control_data;
+	uint8	*timing_data;
+	uint8	*superfx;
+	uint8	*sa1;
+	uint8	*sa1_registers;
+	uint8	*dsp1;
+	uint8	*dsp2;
+	uint8	*dsp4;
+	uint8	*cx4_data;
+	uint8	*st010;
+	uint8	*obc1;
+	uint8	*obc1_data;
+	uint8	*spc7110;
+	uint8	*srtc;
+	uint8	*rtc_data;
+	uint8	*bsx_data;
+	uint8	*msu1_data;
+	uint8	*screenshot;
+	uint8	*movie_data;
+	uint32	sram_size;
+};
+
 static struct Obsolete
 {
 	uint8	CPU_IRQActive;
@@ -514,7 +557,10 @@ static FreezeData	SnapSA1[] =
 	INT_ENTRY(7, VCounter),
 	INT_ENTRY(7, PrevHCounter),
 	INT_ENTRY(7, MemSpeed),
-	INT_ENTRY(7, MemSpeedx2)
+	INT_ENTRY(7, MemSpeedx2),
+	INT_ENTRY(12, Slice),
+	INT_ENTRY(12, SliceEnd),
+	INT_ENTRY(12, SyncCycles)
 };
 
 #undef STRUCT
@@ -921,8 +967,11 @@ static FreezeData	SnapSPC7110Snap[] =
 	O(  0), O(  1), O(  2), O(  3), O(  4), O(  5), O(  6), O(  7),
 	O(  8), O(  9), O( 10), O( 11), O( 12), O( 13), O( 14), O( 15),
 	O( 16), O( 17), O( 18), O( 19), O( 20), O( 21), O( 22), O( 23),
-	O( 24), O( 25), O( 26), O( 27), O( 28), O( 29), O( 30), O( 31)
+	O( 24), O( 25), O( 26), O( 27), O( 28), O( 29), O( 30), O( 31),
 #undef O
+	INT_ENTRY(12, decomp_stream),
+	INT_ENTRY(12, decomp_stream_offset),
+	INT_ENTRY(12, decomp_stream_pos)
 };
 
 #undef STRUCT
@@ -999,6 +1048,9 @@ static int UnfreezeStructCopy (STREAM, const char *, uint8 **, FreezeData *, int
 static void UnfreezeStructFromCopy (void *, FreezeData *, int, uint8 *, int);
 static void FreezeBlock (STREAM, const char *, uint8 *, int);
 static void FreezeStruct (STREAM, const char *, void *, FreezeData *, int);
+static int FreezeStructSize (const char *, FreezeData *, int);
+static void FreezeStructToBlock (void *, FreezeData *, int, uint8 *);
+static int UnfreezeStructSize (FreezeData *, int, int);
 static bool CheckBlockName(STREAM stream, const char *name, int &len);
 static void SkipBlockWithName(STREAM stream, const char *name);
 
@@ -1069,6 +1121,210 @@ int S9xUnfreezeGameMem (const uint8 *buf, uint32 bufSize)
 	return result;
 }
 
+/*
+  Fast snapshots.
+
+  Run-ahead saves and restores the game every frame, which the stream format
+  is far too slow for: every field goes through FreezeStruct's text headers
+  and every load through S9xReset. These snapshots are raw copies of the
+  emulation structures and memories instead, so they only stay valid within
+  the running process and only for the loaded game. Derived state is rebuilt
+  the way S9xUnfreezeFromStream does it, except that only the tiles whose
+  VRAM actually changed lose their cached conversions.
+*/
+
+extern uint8	*HDMAMemPointers[8];
+extern uint8	OpenBus;
+extern bool8	pad_read, pad_read_last;
+
+// The part of Memory.SRAM the loaded game can reach. The coprocessors use
+// SRAM as work RAM beyond what the header declares.
+static uint32 SRAMStateSize (void)
+{
+	if (Settings.SuperFX)
+		return (GSU.nRamBanks << 16);
+
+	if (Settings.SA1)
+		return (0x40000);
+
+	return (Memory.SRAMSize ? min(Memory.SRAMMask + 1, 0x80000) : 0);
+}
+
+#define FAST_MAX_BLOCKS	32
+
+struct SFastBlock
+{
+	void	*data;
+	uint32	size;
+};
+
+static int FastBlocks (SFastBlock *blocks)
+{
+	int	n = 0;
+
+	#define FAST_BLOCK(p, s)	{ blocks[n].data = (void *) (p); blocks[n].size = (s); n++; }
+
+	FAST_BLOCK(&CPU, sizeof(CPU));
+	FAST_BLOCK(&ICPU, sizeof(ICPU));
+	FAST_BLOCK(&Registers, sizeof(Registers));
+	FAST_BLOCK(&PPU, sizeof(PPU));
+	FAST_BLOCK(&IPPU, sizeof(IPPU));
+	FAST_BLOCK(DMA, sizeof(DMA));
+	FAST_BLOCK(HDMAMemPointers, sizeof(HDMAMemPointers));
+	FAST_BLOCK(&Timings, sizeof(Timings));
+	FAST_BLOCK(&OpenBus, sizeof(OpenBus));
+	FAST_BLOCK(&pad_read, sizeof(pad_read));
+	FAST_BLOCK(&pad_read_last, sizeof(pad_read_last));
+	FAST_BLOCK(&GFX.DoInterlace, sizeof(GFX.DoInterlace));
+	FAST_BLOCK(&GFX.InterlaceFrame, sizeof(GFX.InterlaceFrame));
+	FAST_BLOCK(Memory.RAM, 0x20000);
+	FAST_BLOCK(Memory.FillRAM, 0x8000);
+
+	if (SRAMStateSize())
+		FAST_BLOCK(Memory.SRAM, SRAMStateSize());
+
+	if (Settings.SuperFX)
+		FAST_BLOCK(&GSU, sizeof(GSU));
+
+	if (Settings.SA1)
+	{
+		FAST_BLOCK(&SA1, sizeof(SA1));
+		FAST_BLOCK(&SA1Registers, sizeof(SA1Registers));
+		FAST_BLOCK(&SA1OpenBus, sizeof(SA1OpenBus));
+	}
+
+	if (Settings.DSP == 1)
+		FAST_BLOCK(&DSP1, sizeof(DSP1));
+
+	if (Settings.DSP == 2)
+		FAST_BLOCK(&DSP2, sizeof(DSP2));
+
+	if (Settings.DSP == 4)
+		FAST_BLOCK(&DSP4, sizeof(DSP4));
+
+	if (Settings.C4)
+		FAST_BLOCK(Memory.C4RAM, 8192);
+
+	if (Settings.SETA == ST_010)
+		FAST_BLOCK(&ST010, sizeof(ST010));
+
+	if (Settings.OBC1)
+	{
+		FAST_BLOCK(&OBC1, sizeof(OBC1));
+		FAST_BLOCK(Memory.OBC1RAM, 8192);
+	}
+
+	#undef FAST_BLOCK
+
+	return (n);
+}
+
+// Copies VRAM back and bumps the generation of every 16-byte unit that
+// differs, as REGISTER_2118 does.
+static void RestoreVRAM (const uint8 *src)
+{
+	uint8	*vram = Memory.VRAM;
+
+	for (uint32 u = 0; u < 0x10000 / 16; u++, src += 16, vram += 16)
+	{
+		if (!memcmp(vram, src, 16))
+			continue;
+
+		memcpy(vram, src, 16);
+		IPPU.VRAMGeneration[u]++;
+	}
+}
+
+uint32 S9xFreezeFastSize (void)
+{
+	// chips whose state lives outside these structures, and movies, which
+	// have to see every frame, need the full snapshot
+	if (Settings.SPC7110 || Settings.SRTC || Settings.BS || Settings.MSU1 || S9xMovieActive())
+		return (0);
+
+	SFastBlock	blocks[FAST_MAX_BLOCKS];
+	int			n = FastBlocks(blocks);
+	uint32		size = 0x10000 + sizeof(SControlSnapshot) + S9xAPUFastStateSize();
+
+	for (int i = 0; i < n; i++)
+		size += blocks[i].size;
+
+	return (size);
+}
+
+void S9xFreezeGameFast (uint8 *buf)
+{
+	SFastBlock	blocks[FAST_MAX_BLOCKS];
+	int			n;
+
+	if (Settings.SA1)
+		S9xSA1PackStatus();
+
+	n = FastBlocks(blocks);
+	for (int i = 0; i < n; i++)
+	{
+		memcpy(buf, blocks[i].data, blocks[i].size);
+		buf += blocks[i].size;
+	}
+
+	memcpy(buf, Memory.VRAM, 0x10000);
+	buf += 0x10000;
+
+	S9xControlPreSaveState((SControlSnapshot *) buf);
+	buf += sizeof(SControlSnapshot);
+
+	S9xAPUSaveFastState(buf);
+}
+
+void S9xUnfreezeGameFast (const uint8 *buf)
+{
+	SFastBlock	blocks[FAST_MAX_BLOCKS];
+	int			n;
+
+	// the tile caches are allocated and freed as they are drawn with, the
+	// ones in the snapshot may be gone or missing ones made since
+	uint8	*cache[7];
+	uint32	*cached[7], *generation = IPPU.VRAMGeneration;
+	bool8	used[7];
+	memcpy(cache, IPPU.TileCache, sizeof(cache));
+	memcpy(cached, IPPU.TileCached, sizeof(cached));
+	memcpy(used, IPPU.TileCacheUsed, sizeof(used));
+
+	n = FastBlocks(blocks);
+	for (int i = 0; i < n; i++)
+	{
+		memcpy(blocks[i].data, buf, blocks[i].size);
+		buf += blocks[i].size;
+	}
+
+	memcpy(IPPU.TileCache, cache, sizeof(cache));
+	memcpy(IPPU.TileCached, cached, sizeof(cached));
+	memcpy(IPPU.TileCacheUsed, used, sizeof(used));
+	IPPU.VRAMGeneration = generation;
+
+	RestoreVRAM(buf);
+	buf += 0x10000;
+
+	SControlSnapshot	ctl_snap;
+	memcpy(&ctl_snap, buf, sizeof(ctl_snap));
+	buf += sizeof(SControlSnapshot);
+
+	S9xAPULoadFastState(buf);
+
+	S9xFixColourBrightness();
+	S9xBuildDirectColourMaps();
+	IPPU.ColorsChanged = TRUE;
+	IPPU.OBJChanged = TRUE;
+
+	S9xControlPostLoadState(&ctl_snap);
+
+	if (Settings.SA1)
+		S9xSA1PostLoadState();
+
+	if (Settings.SDD1)
+		S9xSDD1PostLoadState();
+}
+
 bool8 S9xUnfreezeGame (const char *filename)
 {
 	STREAM	stream = NULL;
@@ -1141,11 +1397,49 @@ bool8 S9xUnfreezeGame (const char *filename)
 	return (FALSE);
 }
 
+static SnapshotScreenshotInfo * CaptureScreenshot (void)
+{
+#ifdef USE_RENDER_THREAD
+	// the screenshot is the last frame the render thread presented
+	if (GFX.Threaded)
+		S9xRenderThreadSync(FALSE);
+#endif
+
+	SnapshotScreenshotInfo	*ssi = new SnapshotScreenshotInfo;
+
+	ssi->Width  = min(IPPU.RenderedScreenWidth,  MAX_SNES_WIDTH);
+	ssi->Height = min(IPPU.RenderedScreenHeight, MAX_SNES_HEIGHT);
+	ssi->Interlaced = GFX.DoInterlace;
+
+	uint8	*rowpix = ssi->Data;
+	uint16	*screen = GFX.Screen;
+
+	for (int y = 0; y < ssi->Height; y++, screen += GFX.RealPPL)
+	{
+		for (int x = 0; x < ssi->Width; x++)
+		{
+			uint32	r, g, b;
+
+			DECOMPOSE_PIXEL(screen[x], r, g, b);
+			*(rowpix++) = r;
+			*(rowpix++) = g;
+			*(rowpix++) = b;
+		}
+	}
+
+	memset(rowpix, 0, sizeof(ssi->Data) + ssi->Data - rowpix);
+
+	return (ssi);
+}
+
 void S9xFreezeToStream (STREAM stream)
 {
 	char	buffer[8192];
 	uint8	*soundsnapshot = new uint8[SPC_SAVE_STATE_BLOCK_SIZE];
 
+	// the APU state does not fill the whole block, keep the tail deterministic
+	memset(soundsnapshot, 0, SPC_SAVE_STATE_BLOCK_SIZE);
+
 	sprintf(buffer, "%s:%04d\n", SNAPSHOT_MAGIC, SNAPSHOT_VERSION);
 	WRITE_STREAM(buffer, strlen(buffer), stream);
 
@@ -1237,29 +1531,7 @@ void S9xFreezeToStream (STREAM stream)
 
 	if (Settings.SnapshotScreenshots)
 	{
-		SnapshotScreenshotInfo	*ssi = new SnapshotScreenshotInfo;
-
-		ssi->Width  = min(IPPU.RenderedScreenWidth,  MAX_SNES_WIDTH);
-		ssi->Height = min(IPPU.RenderedScreenHeight, MAX_SNES_HEIGHT);
-		ssi->Interlaced = GFX.DoInterlace;
-
-		uint8	*rowpix = ssi->Data;
-		uint16	*screen = GFX.Screen;
-
-		for (int y = 0; y < ssi->Height; y++, screen += GFX.RealPPL)
-		{
-			for (int x = 0; x < ssi->Width; x++)
-			{
-				uint32	r, g, b;
-
-				DECOMPOSE_PIXEL(screen[x], r, g, b);
-				*(rowpix++) = r;
-				*(rowpix++) = g;
-				*(rowpix++) = b;
-			}
-		}
-
-		memset(rowpix, 0, sizeof(ssi->Data) + ssi->Data - rowpix);
+		SnapshotScreenshotInfo	*ssi = CaptureScreenshot();
 
 		FreezeStruct(stream, "SHO", ssi, SnapScreenshot, COUNT(SnapScreenshot));
 
@@ -1287,6 +1559,278 @@ void S9xFreezeToStream (STREAM stream)
 	delete [] soundsnapshot;
 }
 
+// Loads the game from the blocks of a snapshot. Any block may be NULL when
+// the snapshot or the loaded game does not have it.
+static void UnfreezeFromBlocks (SnapshotBlocks &local, int version)
+{
+	const bool8 fast = Settings.FastSavestates;
+
+	uint32 old_flags     = CPU.Flags;
+	uint32 sa1_old_flags = SA1.Flags;
+
+	if (fast)
+	{
+		S9xResetPPUFast();
+	}
+	else
+	{
+		//Do not call this if you have written directly to "Memory." arrays
+		S9xReset();
+	}
+
+	UnfreezeStructFromCopy(&CPU, SnapCPU, COUNT(SnapCPU), local.cpu, version);
+
+	UnfreezeStructFromCopy(&Registers, SnapRegisters, COUNT(SnapRegisters), local.registers, version);
+
+	UnfreezeStructFromCopy(&PPU, SnapPPU, COUNT(SnapPPU), local.ppu, version);
+
+	struct SDMASnapshot	dma_snap;
+	UnfreezeStructFromCopy(&dma_snap, SnapDMA, COUNT(SnapDMA), local.dma, version);
+
+	if (local.vram)
+		memcpy(Memory.VRAM, local.vram, 0x10000);
+
+	if (local.ram)
+		memcpy(Memory.RAM, local.ram, 0x20000);
+
+	if (local.sram)
+		memcpy(Memory.SRAM, local.sram, local.sram_size);
+
+	if (local.fillram)
+		memcpy(Memory.FillRAM, local.fillram, 0x8000);
+
+        S9xAPULoadState(local.apu_sound);
+
+	struct SControlSnapshot	ctl_snap;
+	UnfreezeStructFromCopy(&ctl_snap, SnapControls, COUNT(SnapControls), local.control_data, version);
+
+	UnfreezeStructFromCopy(&Timings, SnapTimings, COUNT(SnapTimings), local.timing_data, version);
+
+	if (local.superfx)
+	{
+		GSU.avRegAddr = (uint8 *) &GSU.avReg;
+		UnfreezeStructFromCopy(&GSU, SnapFX, COUNT(SnapFX), local.superfx, version);
+	}
+
+	if (local.sa1)
+	{
+		UnfreezeStructFromCopy(&SA1, SnapSA1, COUNT(SnapSA1), local.sa1, version);
+
+		// older snapshots have the SA-1 caught up, as in lockstep
+		if (version < SNAPSHOT_VERSION_SA1_SLICE)
+		{
+			SA1.Slice = 0;
+			SA1.SliceEnd = S9xSA1SliceLength();
+		}
+	}
+
+	if (local.sa1_registers)
+		UnfreezeStructFromCopy(&SA1Registers, SnapSA1Registers, COUNT(SnapSA1Registers), local.sa1_registers, version);
+
+	if (local.dsp1)
+		UnfreezeStructFromCopy(&DSP1, SnapDSP1, COUNT(SnapDSP1), local.dsp1, version);
+
+	if (local.dsp2)
+		UnfreezeStructFromCopy(&DSP2, SnapDSP2, COUNT(SnapDSP2), local.dsp2, version);
+
+	if (local.dsp4)
+		UnfreezeStructFromCopy(&DSP4, SnapDSP4, COUNT(SnapDSP4), local.dsp4, version);
+
+	if (local.cx4_data)
+		memcpy(Memory.C4RAM, local.cx4_data, 8192);
+
+	if (local.st010)
+		UnfreezeStructFromCopy(&ST010, SnapST010, COUNT(SnapST010), local.st010, version);
+
+	if (local.obc1)
+		UnfreezeStructFromCopy(&OBC1, SnapOBC1, COUNT(SnapOBC1), local.obc1, version);
+
+	if (local.obc1_data)
+		memcpy(Memory.OBC1RAM, local.obc1_data, 8192);
+
+	if (local.spc7110)
+		UnfreezeStructFromCopy(&s7snap, SnapSPC7110Snap, COUNT(SnapSPC7110Snap), local.spc7110, version);
+
+	if (local.srtc)
+		UnfreezeStructFromCopy(&srtcsnap, SnapSRTCSnap, COUNT(SnapSRTCSnap), local.srtc, version);
+
+	if (local.rtc_data)
+		memcpy(RTCData.reg, local.rtc_data, 20);
+
+	if (local.bsx_data)
+		UnfreezeStructFromCopy(&BSX, SnapBSX, COUNT(SnapBSX), local.bsx_data, version);
+
+	if (local.msu1_data)
+		UnfreezeStructFromCopy(&MSU1, SnapMSU1, COUNT(SnapMSU1), local.msu1_data, version);
+
+	if (version < SNAPSHOT_VERSION_IRQ)
+	{
+		printf("Converting old snapshot version %d to %d\n...", version, SNAPSHOT_VERSION);
+
+		CPU.NMIPending = (CPU.Flags & (1 <<  7)) ? TRUE : FALSE;
+		CPU.IRQLine = (CPU.Flags & (1 << 11)) ? TRUE : FALSE;
+		CPU.IRQTransition = FALSE;
+		CPU.IRQLastState = FALSE;
+		CPU.IRQExternal = (Obsolete.CPU_IRQActive & ~(1 << 1)) ? TRUE : FALSE;
+
+		switch (CPU.WhichEvent)
+		{
+			case 12:	case   1:	CPU.WhichEvent = 1; break;
+			case  2:	case   3:	CPU.WhichEvent = 2; break;
+			case  4:	case   5:	CPU.WhichEvent = 3; break;
+			case  6:	case   7:	CPU.WhichEvent = 4; break;
+			case  8:	case   9:	CPU.WhichEvent = 5; break;
+			case 10:	case  11:	CPU.WhichEvent = 6; break;
+		}
+
+		if (local.sa1) // FIXME
+		{
+			SA1.Cycles = SA1.PrevCycles = 0;
+			SA1.TimerIRQLastState = FALSE;
+			SA1.HTimerIRQPos = Memory.FillRAM[0x2212] | (Memory.FillRAM[0x2213] << 8);
+			SA1.VTimerIRQPos = Memory.FillRAM[0x2214] | (Memory.FillRAM[0x2215] << 8);
+			SA1.HCounter = 0;
+			SA1.VCounter = 0;
+			SA1.PrevHCounter = 0;
+			SA1.MemSpeed = ONE_CYCLE;
+			SA1.MemSpeedx2 = ONE_CYCLE * 2;
+		}
+	}
+
+	CPU.Flags |= old_flags & (DEBUG_MODE_FLAG | TRACE_FLAG | SINGLE_STEP_FLAG | FRAME_ADVANCE_FLAG);
+	ICPU.ShiftedPB = Registers.PB << 16;
+	ICPU.ShiftedDB = Registers.DB << 16;
+	S9xSetPCBase(Registers.PBPC);
+	S9xUnpackStatus();
+	if(version < SNAPSHOT_VERSION_IRQ_2018)
+		S9xUpdateIRQPositions(false); // calculate the new trigger pos from saved PPU data
+	S9xFixCycles();
+
+	for (int d = 0; d < 8; d++)
+		DMA[d] = dma_snap.dma[d];
+	// TODO: these should already be correct since they are stored in the snapshot
+	CPU.InDMA = CPU.InHDMA = FALSE;
+	CPU.InDMAorHDMA = CPU.InWRAMDMAorHDMA = FALSE;
+	CPU.HDMARanInDMA = 0;
+
+	S9xFixColourBrightness();
+	S9xBuildDirectColourMaps();
+	IPPU.ColorsChanged = TRUE;
+	IPPU.OBJChanged = TRUE;
+	IPPU.RenderThisFrame = TRUE;
+	
+	GFX.InterlaceFrame = Timings.InterlaceField;
+	GFX.DoInterlace = 0;
+
+	S9xGraphicsScreenResize();
+
+#ifdef USE_RENDER_THREAD
+	// the lines queued so far belong to the frame that was just replaced
+	if (GFX.Threaded)
+		S9xRenderThreadSync(TRUE);
+#endif
+	
+	if (Settings.FastSavestates == 0)
+		memset(GFX.Screen,0,GFX.Pitch * MAX_SNES_HEIGHT);
+
+	// TODO: this seems to be a relic from 1.43 changes, completely remove if no issues in the future
+	/*uint8 hdma_byte = Memory.FillRAM[0x420c];
+	S9xSetCPU(hdma_byte, 0x420c);*/
+
+	S9xControlPostLoadState(&ctl_snap);
+
+	if (local.superfx)
+	{
+		GSU.pfPlot = fx_PlotTable[GSU.vMode];
+		GSU.pfRpix = fx_PlotTable[GSU.vMode + 5];
+	}
+
+	if (local.sa1 && local.sa1_registers)
+	{
+		SA1.Flags |= sa1_old_flags & TRACE_FLAG;
+		S9xSA1PostLoadState();
+	}
+
+	if (Settings.SDD1)
+		S9xSDD1PostLoadState();
+
+	if (local.spc7110)
+		S9xSPC7110PostLoadState(version);
+
+	if (local.srtc)
+		S9xSRTCPostLoadState(version);
+
+	if (local.bsx_data)
+		S9xBSXPostLoadState();
+
+	if (local.msu1_data)
+		S9xMSU1PostLoadState();
+
+	if (local.movie_data)
+	{
+		// restore last displayed pad_read status
+		extern bool8	pad_read, pad_read_last;
+		bool8			pad_read_temp = pad_read;
+
+		pad_read = pad_read_last;
+		S9xUpdateFrameCounter(-1);
+		pad_read = pad_read_temp;
+	}
+
+	if (local.screenshot)
+	{
+		SnapshotScreenshotInfo	*ssi = new SnapshotScreenshotInfo;
+
+		UnfreezeStructFromCopy(ssi, SnapScreenshot, COUNT(SnapScreenshot), local.screenshot, version);
+
+		IPPU.RenderedScreenWidth  = min(ssi->Width,  IMAGE_WIDTH);
+		IPPU.RenderedScreenHeight = min(ssi->Height, IMAGE_HEIGHT);
+		const bool8 scaleDownX = IPPU.RenderedScreenWidth  < ssi->Width;
+		const bool8 scaleDownY = IPPU.RenderedScreenHeight < ssi->Height && ssi->Height > SNES_HEIGHT_EXTENDED;
+		GFX.DoInterlace = Settings.SupportHiRes ? ssi->Interlaced : 0;
+
+		uint8	*rowpix = ssi->Data;
+		uint16	*screen = GFX.Screen;
+
+		for (int y = 0; y < IPPU.RenderedScreenHeight; y++, screen += GFX.RealPPL)
+		{
+			for (int x = 0; x < IPPU.RenderedScreenWidth; x++)
+			{
+				uint32	r, g, b;
+
+				r = *(rowpix++);
+				g = *(rowpix++);
+				b = *(rowpix++);
+
+				if (scaleDownX)
+				{
+					r = (r + *(rowpix++)) >> 1;
+					g = (g + *(rowpix++)) >> 1;
+					b = (b + *(rowpix++)) >> 1;
+
+					if (x + x + 1 >= ssi->Width)
+						break;
+				}
+
+				screen[x] = BUILD_PIXEL(r, g, b);
+			}
+
+			if (scaleDownY)
+			{
+				rowpix += 3 * ssi->Width;
+				if (y + y + 1 >= ssi->Height)
+					break;
+			}
+		}
+
+		// black out what we might have missed
+		for (uint32 y = IPPU.RenderedScreenHeight; y < (uint32) (IMAGE_HEIGHT); y++)
+			memset(GFX.Screen + y * GFX.RealPPL, 0, GFX.RealPPL * 2);
+
+		delete ssi;
+	}
+}
+
 int S9xUnfreezeFromStream (STREAM stream)
 {
 	const bool8 fast = Settings.FastSavestates;
@@ -1310,114 +1854,89 @@ int S9xUnfreezeFromStream (STREAM stream)
 	if (result != SUCCESS)
 		return (result);
 
-	uint8	*local_cpu           = NULL;
-	uint8	*local_registers     = NULL;
-	uint8	*local_ppu           = NULL;
-	uint8	*local_dma           = NULL;
-	uint8	*local_vram          = NULL;
-	uint8	*local_ram           = NULL;
-	uint8	*local_sram          = NULL;
-	uint8	*local_fillram       = NULL;
-	uint8	*local_apu_sound     = NULL;
-	uint8	*local_control_data  = NULL;
-	uint8	*local_timing_data   = NULL;
-	uint8	*local_superfx       = NULL;
-	uint8	*local_sa1           = NULL;
-	uint8	*local_sa1_registers = NULL;
-	uint8	*local_dsp1          = NULL;
-	uint8	*local_dsp2          = NULL;
-	uint8	*local_dsp4          = NULL;
-	uint8	*local_cx4_data      = NULL;
-	uint8	*local_st010         = NULL;
-	uint8	*local_obc1          = NULL;
-	uint8	*local_obc1_data     = NULL;
-	uint8	*local_spc7110       = NULL;
-	uint8	*local_srtc          = NULL;
-	uint8	*local_rtc_data      = NULL;
-	uint8	*local_bsx_data      = NULL;
-	uint8	*local_msu1_data     = NULL;
-	uint8	*local_screenshot    = NULL;
-	uint8	*local_movie_data    = NULL;
+	SnapshotBlocks	local;
+	memset(&local, 0, sizeof(local));
+	local.sram_size = 0x80000;
 
 	do
 	{
-		result = UnfreezeStructCopy(stream, "CPU", &local_cpu, SnapCPU, COUNT(SnapCPU), version);
+		result = UnfreezeStructCopy(stream, "CPU", &local.cpu, SnapCPU, COUNT(SnapCPU), version);
 		if (result != SUCCESS)
 			break;
 
-		result = UnfreezeStructCopy(stream, "REG", &local_registers, SnapRegisters, COUNT(SnapRegisters), version);
+		result = UnfreezeStructCopy(stream, "REG", &local.registers, SnapRegisters, COUNT(SnapRegisters), version);
 		if (result != SUCCESS)
 			break;
 
-		result = UnfreezeStructCopy(stream, "PPU", &local_ppu, SnapPPU, COUNT(SnapPPU), version);
+		result = UnfreezeStructCopy(stream, "PPU", &local.ppu, SnapPPU, COUNT(SnapPPU), version);
 		if (result != SUCCESS)
 			break;
 
-		result = UnfreezeStructCopy(stream, "DMA", &local_dma, SnapDMA, COUNT(SnapDMA), version);
+		result = UnfreezeStructCopy(stream, "DMA", &local.dma, SnapDMA, COUNT(SnapDMA), version);
 		if (result != SUCCESS)
 			break;
 
 		if (fast)
 			result = UnfreezeBlock(stream, "VRA", Memory.VRAM, 0x10000);
 		else
-			result = UnfreezeBlockCopy(stream, "VRA", &local_vram, 0x10000);
+			result = UnfreezeBlockCopy(stream, "VRA", &local.vram, 0x10000);
 		if (result != SUCCESS)
 			break;
 
 		if (fast)
 			result = UnfreezeBlock(stream, "RAM", Memory.RAM, 0x20000);
 		else
-			result = UnfreezeBlockCopy(stream, "RAM", &local_ram, 0x20000);
+			result = UnfreezeBlockCopy(stream, "RAM", &local.ram, 0x20000);
 		if (result != SUCCESS)
 			break;
 
 		if (fast)
 			result = UnfreezeBlock(stream, "SRA", Memory.SRAM, 0x80000);
 		else
-			result = UnfreezeBlockCopy (stream, "SRA", &local_sram, 0x80000);
+			result = UnfreezeBlockCopy (stream, "SRA", &local.sram, 0x80000);
 		if (result != SUCCESS)
 			break;
 
 		if (fast)
 			result = UnfreezeBlock(stream, "FIL", Memory.FillRAM, 0x8000);
 		else
-			result = UnfreezeBlockCopy(stream, "FIL", &local_fillram, 0x8000);
+			result = UnfreezeBlockCopy(stream, "FIL", &local.fillram, 0x8000);
 		if (result != SUCCESS)
 			break;
 
-		result = UnfreezeBlockCopy (stream, "SND", &local_apu_sound, SPC_SAVE_STATE_BLOCK_SIZE);
+		result = UnfreezeBlockCopy (stream, "SND", &local.apu_sound, SPC_SAVE_STATE_BLOCK_SIZE);
 		if (result != SUCCESS)
 			break;
 
-		result = UnfreezeStructCopy(stream, "CTL", &local_control_data, SnapControls, COUNT(SnapControls), version);
+		result = UnfreezeStructCopy(stream, "CTL", &local.control_data, SnapControls, COUNT(SnapControls), version);
 		if (result != SUCCESS)
 			break;
 
-		result = UnfreezeStructCopy(stream, "TIM", &local_timing_data, SnapTimings, COUNT(SnapTimings), version);
+		result = UnfreezeStructCopy(stream, "TIM", &local.timing_data, SnapTimings, COUNT(SnapTimings), version);
 		if (result != SUCCESS)
 			break;
 
-		result = UnfreezeStructCopy(stream, "SFX", &local_superfx, SnapFX, COUNT(SnapFX), version);
+		result = UnfreezeStructCopy(stream, "SFX", &local.superfx, SnapFX, COUNT(SnapFX), version);
 		if (result != SUCCESS && Settings.SuperFX)
 			break;
 
-		result = UnfreezeStructCopy(stream, "SA1", &local_sa1, SnapSA1, COUNT(SnapSA1), version);
+		result = UnfreezeStructCopy(stream, "SA1", &local.sa1, SnapSA1, COUNT(SnapSA1), version);
 		if (result != SUCCESS && Settings.SA1)
 			break;
 
-		result = UnfreezeStructCopy(stream, "SAR", &local_sa1_registers, SnapSA1Registers, COUNT(SnapSA1Registers), version);
+		result = UnfreezeStructCopy(stream, "SAR", &local.sa1_registers, SnapSA1Registers, COUNT(SnapSA1Registers), version);
 		if (result != SUCCESS && Settings.SA1)
 			break;
 
-		result = UnfreezeStructCopy(stream, "DP1", &local_dsp1, SnapDSP1, COUNT(SnapDSP1), version);
+		result = UnfreezeStructCopy(stream, "DP1", &local.dsp1, SnapDSP1, COUNT(SnapDSP1), version);
 		if (result != SUCCESS && Settings.DSP == 1)
 			break;
 
-		result = UnfreezeStructCopy(stream, "DP2", &local_dsp2, SnapDSP2, COUNT(SnapDSP2), version);
+		result = UnfreezeStructCopy(stream, "DP2", &local.dsp2, SnapDSP2, COUNT(SnapDSP2), version);
 		if (result != SUCCESS && Settings.DSP == 2)
 			break;
 
-		result = UnfreezeStructCopy(stream, "DP4", &local_dsp4, SnapDSP4, COUNT(SnapDSP4), version);
+		result = UnfreezeStructCopy(stream, "DP4", &local.dsp4, SnapDSP4, COUNT(SnapDSP4), version);
 		if (result != SUCCESS && Settings.DSP == 4)
 			break;
 
@@ -1426,7 +1945,7 @@ int S9xUnfreezeFromStream (STREAM stream)
 			if (fast)
 				result = UnfreezeBlock(stream, "CX4", Memory.C4RAM, 8192);
 			else
-				result = UnfreezeBlockCopy(stream, "CX4", &local_cx4_data, 8192);
+				result = UnfreezeBlockCopy(stream, "CX4", &local.cx4_data, 8192);
 			if (result != SUCCESS)
 				break;
 		}
@@ -1435,11 +1954,11 @@ int S9xUnfreezeFromStream (STREAM stream)
 			SkipBlockWithName(stream, "CX4");
 		}
 
-		result = UnfreezeStructCopy(stream, "ST0", &local_st010, SnapST010, COUNT(SnapST010), version);
+		result = UnfreezeStructCopy(stream, "ST0", &local.st010, SnapST010, COUNT(SnapST010), version);
 		if (result != SUCCESS && Settings.SETA == ST_010)
 			break;
 
-		result = UnfreezeStructCopy(stream, "OBC", &local_obc1, SnapOBC1, COUNT(SnapOBC1), version);
+		result = UnfreezeStructCopy(stream, "OBC", &local.obc1, SnapOBC1, COUNT(SnapOBC1), version);
 		if (result != SUCCESS && Settings.OBC1)
 			break;
 
@@ -1448,7 +1967,7 @@ int S9xUnfreezeFromStream (STREAM stream)
 			if (fast)
 				result = UnfreezeBlock(stream, "OBM", Memory.OBC1RAM, 8192);
 			else
-				result = UnfreezeBlockCopy(stream, "OBM", &local_obc1_data, 8192);
+				result = UnfreezeBlockCopy(stream, "OBM", &local.obc1_data, 8192);
 			if (result != SUCCESS)
 				break;
 		}
@@ -1457,27 +1976,27 @@ int S9xUnfreezeFromStream (STREAM stream)
 			SkipBlockWithName(stream, "OBM");
 		}
 
-		result = UnfreezeStructCopy(stream, "S71", &local_spc7110, SnapSPC7110Snap, COUNT(SnapSPC7110Snap), version);
+		result = UnfreezeStructCopy(stream, "S71", &local.spc7110, SnapSPC7110Snap, COUNT(SnapSPC7110Snap), version);
 		if (result != SUCCESS && Settings.SPC7110)
 			break;
 
-		result = UnfreezeStructCopy(stream, "SRT", &local_srtc, SnapSRTCSnap, COUNT(SnapSRTCSnap), version);
+		result = UnfreezeStructCopy(stream, "SRT", &local.srtc, SnapSRTCSnap, COUNT(SnapSRTCSnap), version);
 		if (result != SUCCESS && Settings.SRTC)
 			break;
 
-		result = UnfreezeBlockCopy (stream, "CLK", &local_rtc_data, 20);
+		result = UnfreezeBlockCopy (stream, "CLK", &local.rtc_data, 20);
 		if (result != SUCCESS && (Settings.SRTC || Settings.SPC7110RTC))
 			break;
 
-		result = UnfreezeStructCopy(stream, "BSX", &local_bsx_data, SnapBSX, COUNT(SnapBSX), version);
+		result = UnfreezeStructCopy(stream, "BSX", &local.bsx_data, SnapBSX, COUNT(SnapBSX), version);
 		if (result != SUCCESS && Settings.BS)
 			break;
 
-		result = UnfreezeStructCopy(stream, "MSU", &local_msu1_data, SnapMSU1, COUNT(SnapMSU1), version);
+		result = UnfreezeStructCopy(stream, "MSU", &local.msu1_data, SnapMSU1, COUNT(SnapMSU1), version);
 		if (result != SUCCESS && Settings.MSU1)
 			break;
 
-		result = UnfreezeStructCopy(stream, "SHO", &local_screenshot, SnapScreenshot, COUNT(SnapScreenshot), version);
+		result = UnfreezeStructCopy(stream, "SHO", &local.screenshot, SnapScreenshot, COUNT(SnapScreenshot), version);
 
 		SnapshotMovieInfo	mi;
 
@@ -1492,7 +2011,7 @@ int S9xUnfreezeFromStream (STREAM stream)
 		}
 		else
 		{
-			result = UnfreezeBlockCopy(stream, "MID", &local_movie_data, mi.MovieInputDataSize);
+			result = UnfreezeBlockCopy(stream, "MID", &local.movie_data, mi.MovieInputDataSize);
 			if (result != SUCCESS)
 			{
 				if (S9xMovieActive())
@@ -1504,7 +2023,7 @@ int S9xUnfreezeFromStream (STREAM stream)
 
 			if (S9xMovieActive())
 			{
-				result = S9xMovieUnfreeze(local_movie_data, mi.MovieInputDataSize);
+				result = S9xMovieUnfreeze(local.movie_data, mi.MovieInputDataSize);
 				if (result != SUCCESS)
 					break;
 			}
@@ -1514,285 +2033,638 @@ int S9xUnfreezeFromStream (STREAM stream)
 	} while (false);
 
 	if (result == SUCCESS)
+		UnfreezeFromBlocks(local, version);
+
+	if (local.cpu)				delete [] local.cpu;
+	if (local.registers)		delete [] local.registers;
+	if (local.ppu)				delete [] local.ppu;
+	if (local.dma)				delete [] local.dma;
+	if (local.vram)				delete [] local.vram;
+	if (local.ram)				delete [] local.ram;
+	if (local.sram)				delete [] local.sram;
+	if (local.fillram)			delete [] local.fillram;
+	if (local.apu_sound)		delete [] local.apu_sound;
+	if (local.control_data)		delete [] local.control_data;
+	if (local.timing_data)		delete [] local.timing_data;
+	if (local.superfx)			delete [] local.superfx;
+	if (local.sa1)				delete [] local.sa1;
+	if (local.sa1_registers)	delete [] local.sa1_registers;
+	if (local.dsp1)				delete [] local.dsp1;
+	if (local.dsp2)				delete [] local.dsp2;
+	if (local.dsp4)				delete [] local.dsp4;
+	if (local.cx4_data)			delete [] local.cx4_data;
+	if (local.st010)			delete [] local.st010;
+	if (local.obc1)				delete [] local.obc1;
+	if (local.obc1_data)		delete [] local.obc1_data;
+	if (local.spc7110)			delete [] local.spc7110;
+	if (local.srtc)				delete [] local.srtc;
+	if (local.rtc_data)			delete [] local.rtc_data;
+	if (local.bsx_data)			delete [] local.bsx_data;
+	if (local.screenshot)		delete [] local.screenshot;
+	if (local.movie_data)		delete [] local.movie_data;
+
+	return (result);
+}
+
+/*
+  Binary snapshots.
+
+  The same blocks as the stream format, in a container that can be written
+  and loaded without parsing: a header, a table with one entry per section
+  and the sections themselves, each starting on a BINARY_ALIGN boundary.
+  Struct sections hold their fields packed the FreezeStruct way, so they
+  stay portable between builds and versions; the memories and the APU state
+  are stored as they are. Each section can be deflated on its own.
+
+  Uncompressed, the layout only depends on the loaded game, so it is worked
+  out before anything is written and every section is filled in place.
+  Loading maps the file (or reads it in one go where there is no mmap) and
+  hands pointers into it straight to the code that restores the blocks.
+
+  All header and table fields are little-endian 32-bit words:
+  header  magic[8] container_version snapshot_version sections file_size 0 0
+  entry   name[4] offset size raw_size flags
+*/
+
+#define BINARY_HEADER_SIZE	32
+#define BINARY_ENTRY_SIZE	20
+#define BINARY_ALIGN		64
+#define BINARY_MAX_SECTIONS	40
+#define BINARY_MIN_DEFLATE	1024		// smaller sections are never deflated
+#define BINARY_DEFLATED		1
+
+enum
+{
+	BINARY_MEMORY,
+	BINARY_STRUCT,
+	BINARY_APU
+};
+
+struct SBinarySection
+{
+	const char	*name;
+	int			type;
+	uint8		*data;		// BINARY_MEMORY
+	void		*base;		// BINARY_STRUCT
+	FreezeData	*fields;
+	int			num_fields;
+	uint32		size;
+	uint32		offset;
+	uint32		stored;
+	uint32		flags;
+};
+
+struct SBinarySnapshot
+{
+	SBinarySection			sections[BINARY_MAX_SECTIONS];
+	int						count;
+	struct SDMASnapshot		dma_snap;
+	struct SControlSnapshot	ctl_snap;
+	SnapshotMovieInfo		mi;
+	uint8					*movie;
+	SnapshotScreenshotInfo	*ssi;
+};
+
+// Where each section goes when loading, and the size it must have
+struct SBinaryBlock
+{
+	const char	*name;
+	size_t		local;		// offsetof(SnapshotBlocks, ...)
+	FreezeData	*fields;	// NULL for memory sections
+	int			num_fields;
+	uint32		size;		// memory sections, 0 when the size varies
+	uint32		max;		// most a varying section is saved with, 0 for no limit
+};
+
+#define BINARY_BLOCK(name, local, fields)	{ name, offsetof(SnapshotBlocks, local), fields, COUNT(fields), 0, 0 }
+#define BINARY_MEMORY_BLOCK(name, local, size)	{ name, offsetof(SnapshotBlocks, local), NULL, 0, size, 0 }
+#define BINARY_VARIABLE_BLOCK(name, local, max)	{ name, offsetof(SnapshotBlocks, local), NULL, 0, 0, max }
+
+static SBinaryBlock	BinaryBlocks[] =
+{
+	BINARY_BLOCK("CPU", cpu, SnapCPU),
+	BINARY_BLOCK("REG", registers, SnapRegisters),
+	BINARY_BLOCK("PPU", ppu, SnapPPU),
+	BINARY_BLOCK("DMA", dma, SnapDMA),
+	BINARY_MEMORY_BLOCK("VRA", vram, 0x10000),
+	BINARY_MEMORY_BLOCK("RAM", ram, 0x20000),
+	BINARY_VARIABLE_BLOCK("SRA", sram, 0x80000),
+	BINARY_MEMORY_BLOCK("FIL", fillram, 0x8000),
+	BINARY_MEMORY_BLOCK("SND", apu_sound, SPC_SAVE_STATE_BLOCK_SIZE),
+	BINARY_BLOCK("CTL", control_data, SnapControls),
+	BINARY_BLOCK("TIM", timing_data, SnapTimings),
+	BINARY_BLOCK("SFX", superfx, SnapFX),
+	BINARY_BLOCK("SA1", sa1, SnapSA1),
+	BINARY_BLOCK("SAR", sa1_registers, SnapSA1Registers),
+	BINARY_BLOCK("DP1", dsp1, SnapDSP1),
+	BINARY_BLOCK("DP2", dsp2, SnapDSP2),
+	BINARY_BLOCK("DP4", dsp4, SnapDSP4),
+	BINARY_MEMORY_BLOCK("CX4", cx4_data, 8192),
+	BINARY_BLOCK("ST0", st010, SnapST010),
+	BINARY_BLOCK("OBC", obc1, SnapOBC1),
+	BINARY_MEMORY_BLOCK("OBM", obc1_data, 8192),
+	BINARY_BLOCK("S71", spc7110, SnapSPC7110Snap),
+	BINARY_BLOCK("SRT", srtc, SnapSRTCSnap),
+	BINARY_MEMORY_BLOCK("CLK", rtc_data, 20),
+	BINARY_BLOCK("BSX", bsx_data, SnapBSX),
+	BINARY_BLOCK("MSU", msu1_data, SnapMSU1),
+	BINARY_BLOCK("SHO", screenshot, SnapScreenshot),
+	BINARY_VARIABLE_BLOCK("MID", movie_data, 0)
+};
+
+#undef BINARY_BLOCK
+#undef BINARY_MEMORY_BLOCK
+#undef BINARY_VARIABLE_BLOCK
+
+static inline uint32 BinaryAlign (uint32 offset)
+{
+	return ((offset + BINARY_ALIGN - 1) & ~(BINARY_ALIGN - 1));
+}
+
+static void AddMemorySection (SBinarySnapshot *snap, const char *name, uint8 *data, uint32 size)
+{
+	SBinarySection	*sec = &snap->sections[snap->count++];
+
+	memset(sec, 0, sizeof(*sec));
+	sec->name = name;
+	sec->type = BINARY_MEMORY;
+	sec->data = data;
+	sec->size = size;
+}
+
+static void AddStructSection (SBinarySnapshot *snap, const char *name, void *base, FreezeData *fields, int num_fields)
+{
+	SBinarySection	*sec = &snap->sections[snap->count++];
+
+	memset(sec, 0, sizeof(*sec));
+	sec->name = name;
+	sec->type = BINARY_STRUCT;
+	sec->base = base;
+	sec->fields = fields;
+	sec->num_fields = num_fields;
+	sec->size = FreezeStructSize(name, fields, num_fields);
+}
+
+// Lists the sections S9xFreezeToStream would write, in the same order, and
+// runs the pre-save hooks their contents depend on. Returns the size of the
+// uncompressed file.
+static uint32 PrepareBinarySnapshot (SBinarySnapshot *snap, bool8 screenshot)
+{
+	snap->count = 0;
+	snap->movie = NULL;
+	snap->ssi = NULL;
+
+	AddMemorySection(snap, "NAM", (uint8 *) Memory.ROMFilename, strlen(Memory.ROMFilename) + 1);
+	AddStructSection(snap, "CPU", &CPU, SnapCPU, COUNT(SnapCPU));
+	AddStructSection(snap, "REG", &Registers, SnapRegisters, COUNT(SnapRegisters));
+	AddStructSection(snap, "PPU", &PPU, SnapPPU, COUNT(SnapPPU));
+
+	for (int d = 0; d < 8; d++)
+		snap->dma_snap.dma[d] = DMA[d];
+	AddStructSection(snap, "DMA", &snap->dma_snap, SnapDMA, COUNT(SnapDMA));
+
+	AddMemorySection(snap, "VRA", Memory.VRAM, 0x10000);
+	AddMemorySection(snap, "RAM", Memory.RAM, 0x20000);
+	if (SRAMStateSize())
+		AddMemorySection(snap, "SRA", Memory.SRAM, SRAMStateSize());
+	AddMemorySection(snap, "FIL", Memory.FillRAM, 0x8000);
+
+	AddMemorySection(snap, "SND", NULL, SPC_SAVE_STATE_BLOCK_SIZE);
+	snap->sections[snap->count - 1].type = BINARY_APU;
+
+	S9xControlPreSaveState(&snap->ctl_snap);
+	AddStructSection(snap, "CTL", &snap->ctl_snap, SnapControls, COUNT(SnapControls));
+	AddStructSection(snap, "TIM", &Timings, SnapTimings, COUNT(SnapTimings));
+
+	if (Settings.SuperFX)
 	{
-		uint32 old_flags     = CPU.Flags;
-		uint32 sa1_old_flags = SA1.Flags;
+		GSU.avRegAddr = (uint8 *) &GSU.avReg;
+		AddStructSection(snap, "SFX", &GSU, SnapFX, COUNT(SnapFX));
+	}
 
-		if (fast)
-		{
-			S9xResetPPUFast();
-		}
-		else
-		{
-			//Do not call this if you have written directly to "Memory." arrays
-			S9xReset();
-		}
+	if (Settings.SA1)
+	{
+		S9xSA1PackStatus();
+		AddStructSection(snap, "SA1", &SA1, SnapSA1, COUNT(SnapSA1));
+		AddStructSection(snap, "SAR", &SA1Registers, SnapSA1Registers, COUNT(SnapSA1Registers));
+	}
+
+	if (Settings.DSP == 1)
+		AddStructSection(snap, "DP1", &DSP1, SnapDSP1, COUNT(SnapDSP1));
 
-		UnfreezeStructFromCopy(&CPU, SnapCPU, COUNT(SnapCPU), local_cpu, version);
+	if (Settings.DSP == 2)
+		AddStructSection(snap, "DP2", &DSP2, SnapDSP2, COUNT(SnapDSP2));
 
-		UnfreezeStructFromCopy(&Registers, SnapRegisters, COUNT(SnapRegisters), local_registers, version);
+	if (Settings.DSP == 4)
+		AddStructSection(snap, "DP4", &DSP4, SnapDSP4, COUNT(SnapDSP4));
+
+	if (Settings.C4)
+		AddMemorySection(snap, "CX4", Memory.C4RAM, 8192);
 
-		UnfreezeStructFromCopy(&PPU, SnapPPU, COUNT(SnapPPU), local_ppu, version);
+	if (Settings.SETA == ST_010)
+		AddStructSection(snap, "ST0", &ST010, SnapST010, COUNT(SnapST010));
 
-		struct SDMASnapshot	dma_snap;
-		UnfreezeStructFromCopy(&dma_snap, SnapDMA, COUNT(SnapDMA), local_dma, version);
+	if (Settings.OBC1)
+	{
+		AddStructSection(snap, "OBC", &OBC1, SnapOBC1, COUNT(SnapOBC1));
+		AddMemorySection(snap, "OBM", Memory.OBC1RAM, 8192);
+	}
 
-		if (local_vram)
-			memcpy(Memory.VRAM, local_vram, 0x10000);
+	if (Settings.SPC7110)
+	{
+		S9xSPC7110PreSaveState();
+		AddStructSection(snap, "S71", &s7snap, SnapSPC7110Snap, COUNT(SnapSPC7110Snap));
+	}
 
-		if (local_ram)
-			memcpy(Memory.RAM, local_ram, 0x20000);
+	if (Settings.SRTC)
+	{
+		S9xSRTCPreSaveState();
+		AddStructSection(snap, "SRT", &srtcsnap, SnapSRTCSnap, COUNT(SnapSRTCSnap));
+	}
 
-		if (local_sram)
-			memcpy(Memory.SRAM, local_sram, 0x80000);
+	if (Settings.SRTC || Settings.SPC7110RTC)
+		AddMemorySection(snap, "CLK", RTCData.reg, 20);
 
-		if (local_fillram)
-			memcpy(Memory.FillRAM, local_fillram, 0x8000);
+	if (Settings.BS)
+		AddStructSection(snap, "BSX", &BSX, SnapBSX, COUNT(SnapBSX));
 
-        S9xAPULoadState(local_apu_sound);
+	if (Settings.MSU1)
+		AddStructSection(snap, "MSU", &MSU1, SnapMSU1, COUNT(SnapMSU1));
 
-		struct SControlSnapshot	ctl_snap;
-		UnfreezeStructFromCopy(&ctl_snap, SnapControls, COUNT(SnapControls), local_control_data, version);
+	if (Settings.SnapshotScreenshots)
+	{
+		// only the size is needed when just measuring
+		snap->ssi = screenshot ? CaptureScreenshot() : NULL;
+		AddStructSection(snap, "SHO", snap->ssi, SnapScreenshot, COUNT(SnapScreenshot));
+	}
 
-		UnfreezeStructFromCopy(&Timings, SnapTimings, COUNT(SnapTimings), local_timing_data, version);
+	if (S9xMovieActive())
+	{
+		uint32	movie_size;
 
-		if (local_superfx)
+		S9xMovieFreeze(&snap->movie, &movie_size);
+		if (snap->movie)
 		{
-			GSU.avRegAddr = (uint8 *) &GSU.avReg;
-			UnfreezeStructFromCopy(&GSU, SnapFX, COUNT(SnapFX), local_superfx, version);
+			snap->mi.MovieInputDataSize = movie_size;
+			AddStructSection(snap, "MOV", &snap->mi, SnapMovie, COUNT(SnapMovie));
+			AddMemorySection(snap, "MID", snap->movie, movie_size);
 		}
+	}
 
-		if (local_sa1)
-			UnfreezeStructFromCopy(&SA1, SnapSA1, COUNT(SnapSA1), local_sa1, version);
+	uint32	offset = BinaryAlign(BINARY_HEADER_SIZE + snap->count * BINARY_ENTRY_SIZE);
 
-		if (local_sa1_registers)
-			UnfreezeStructFromCopy(&SA1Registers, SnapSA1Registers, COUNT(SnapSA1Registers), local_sa1_registers, version);
+	for (int i = 0; i < snap->count; i++)
+	{
+		snap->sections[i].offset = offset;
+		offset = BinaryAlign(offset + snap->sections[i].size);
+	}
 
-		if (local_dsp1)
-			UnfreezeStructFromCopy(&DSP1, SnapDSP1, COUNT(SnapDSP1), local_dsp1, version);
+	return (offset);
+}
 
-		if (local_dsp2)
-			UnfreezeStructFromCopy(&DSP2, SnapDSP2, COUNT(SnapDSP2), local_dsp2, version);
+static void ReleaseBinarySnapshot (SBinarySnapshot *snap)
+{
+	delete snap->ssi;
+	delete [] snap->movie;
+	snap->ssi = NULL;
+	snap->movie = NULL;
+}
 
-		if (local_dsp4)
-			UnfreezeStructFromCopy(&DSP4, SnapDSP4, COUNT(SnapDSP4), local_dsp4, version);
+static void FillBinarySection (SBinarySection *sec, uint8 *dest)
+{
+	switch (sec->type)
+	{
+		case BINARY_MEMORY:
+			memcpy(dest, sec->data, sec->size);
+			break;
 
-		if (local_cx4_data)
-			memcpy(Memory.C4RAM, local_cx4_data, 8192);
+		case BINARY_STRUCT:
+			FreezeStructToBlock(sec->base, sec->fields, sec->num_fields, dest);
+			break;
 
-		if (local_st010)
-			UnfreezeStructFromCopy(&ST010, SnapST010, COUNT(SnapST010), local_st010, version);
+		case BINARY_APU:
+			// the APU state does not fill the whole block, keep the tail deterministic
+			memset(dest, 0, sec->size);
+			S9xAPUSaveState(dest);
+			break;
+	}
+}
 
-		if (local_obc1)
-			UnfreezeStructFromCopy(&OBC1, SnapOBC1, COUNT(SnapOBC1), local_obc1, version);
+uint32 S9xFreezeBinarySize (void)
+{
+	SBinarySnapshot	*snap = new SBinarySnapshot;
+	uint32			size = PrepareBinarySnapshot(snap, FALSE);
 
-		if (local_obc1_data)
-			memcpy(Memory.OBC1RAM, local_obc1_data, 8192);
+	ReleaseBinarySnapshot(snap);
+	delete snap;
 
-		if (local_spc7110)
-			UnfreezeStructFromCopy(&s7snap, SnapSPC7110Snap, COUNT(SnapSPC7110Snap), local_spc7110, version);
+	return (size);
+}
 
-		if (local_srtc)
-			UnfreezeStructFromCopy(&srtcsnap, SnapSRTCSnap, COUNT(SnapSRTCSnap), local_srtc, version);
+uint32 S9xFreezeGameBinaryMem (uint8 *buf, uint32 bufSize, bool8 compress)
+{
+	SBinarySnapshot	*snap = new SBinarySnapshot;
+	uint32			size = PrepareBinarySnapshot(snap, TRUE);
+	uint8			*scratch = NULL;
 
-		if (local_rtc_data)
-			memcpy(RTCData.reg, local_rtc_data, 20);
+	if (size > bufSize)
+	{
+		ReleaseBinarySnapshot(snap);
+		delete snap;
+		return (0);
+	}
 
-		if (local_bsx_data)
-			UnfreezeStructFromCopy(&BSX, SnapBSX, COUNT(SnapBSX), local_bsx_data, version);
+#ifdef ZLIB
+	if (compress)
+	{
+		uint32	largest = 0;
 
-		if (local_msu1_data)
-			UnfreezeStructFromCopy(&MSU1, SnapMSU1, COUNT(SnapMSU1), local_msu1_data, version);
+		for (int i = 0; i < snap->count; i++)
+			if (snap->sections[i].size > largest)
+				largest = snap->sections[i].size;
 
-		if (version < SNAPSHOT_VERSION_IRQ)
-		{
-			printf("Converting old snapshot version %d to %d\n...", version, SNAPSHOT_VERSION);
+		scratch = new uint8[largest];
+	}
+#endif
 
-			CPU.NMIPending = (CPU.Flags & (1 <<  7)) ? TRUE : FALSE;
-			CPU.IRQLine = (CPU.Flags & (1 << 11)) ? TRUE : FALSE;
-			CPU.IRQTransition = FALSE;
-			CPU.IRQLastState = FALSE;
-			CPU.IRQExternal = (Obsolete.CPU_IRQActive & ~(1 << 1)) ? TRUE : FALSE;
+	uint32	offset = snap->sections[0].offset;
 
-			switch (CPU.WhichEvent)
-			{
-				case 12:	case   1:	CPU.WhichEvent = 1; break;
-				case  2:	case   3:	CPU.WhichEvent = 2; break;
-				case  4:	case   5:	CPU.WhichEvent = 3; break;
-				case  6:	case   7:	CPU.WhichEvent = 4; break;
-				case  8:	case   9:	CPU.WhichEvent = 5; break;
-				case 10:	case  11:	CPU.WhichEvent = 6; break;
-			}
+	for (int i = 0; i < snap->count; i++)
+	{
+		SBinarySection	*sec = &snap->sections[i];
+
+		sec->stored = sec->size;
+		sec->flags = 0;
+
+	#ifdef ZLIB
+		if (scratch && sec->size >= BINARY_MIN_DEFLATE)
+		{
+			uLongf	stored = sec->size - 1;
 
-			if (local_sa1) // FIXME
+			// compressed sections are packed one after the other instead
+			FillBinarySection(sec, scratch);
+			sec->offset = offset;
+			if (compress2(buf + offset, &stored, scratch, sec->size, Z_BEST_SPEED) == Z_OK)
 			{
-				SA1.Cycles = SA1.PrevCycles = 0;
-				SA1.TimerIRQLastState = FALSE;
-				SA1.HTimerIRQPos = Memory.FillRAM[0x2212] | (Memory.FillRAM[0x2213] << 8);
-				SA1.VTimerIRQPos = Memory.FillRAM[0x2214] | (Memory.FillRAM[0x2215] << 8);
-				SA1.HCounter = 0;
-				SA1.VCounter = 0;
-				SA1.PrevHCounter = 0;
-				SA1.MemSpeed = ONE_CYCLE;
-				SA1.MemSpeedx2 = ONE_CYCLE * 2;
+				sec->stored = stored;
+				sec->flags = BINARY_DEFLATED;
 			}
+			else
+				memcpy(buf + offset, scratch, sec->size);
 		}
-
-		CPU.Flags |= old_flags & (DEBUG_MODE_FLAG | TRACE_FLAG | SINGLE_STEP_FLAG | FRAME_ADVANCE_FLAG);
-		ICPU.ShiftedPB = Registers.PB << 16;
-		ICPU.ShiftedDB = Registers.DB << 16;
-		S9xSetPCBase(Registers.PBPC);
-		S9xUnpackStatus();
-		if(version < SNAPSHOT_VERSION_IRQ_2018)
-			S9xUpdateIRQPositions(false); // calculate the new trigger pos from saved PPU data
-		S9xFixCycles();
-
-		for (int d = 0; d < 8; d++)
-			DMA[d] = dma_snap.dma[d];
-		// TODO: these should already be correct since they are stored in the snapshot
-		CPU.InDMA = CPU.InHDMA = FALSE;
-		CPU.InDMAorHDMA = CPU.InWRAMDMAorHDMA = FALSE;
-		CPU.HDMARanInDMA = 0;
-
-		S9xFixColourBrightness();
-		S9xBuildDirectColourMaps();
-		IPPU.ColorsChanged = TRUE;
-		IPPU.OBJChanged = TRUE;
-		IPPU.RenderThisFrame = TRUE;
-		
-		GFX.InterlaceFrame = Timings.InterlaceField;
-		GFX.DoInterlace = 0;
-
-		S9xGraphicsScreenResize();
-		
-		if (Settings.FastSavestates == 0)
-			memset(GFX.Screen,0,GFX.Pitch * MAX_SNES_HEIGHT);
-
-		// TODO: this seems to be a relic from 1.43 changes, completely remove if no issues in the future
-		/*uint8 hdma_byte = Memory.FillRAM[0x420c];
-		S9xSetCPU(hdma_byte, 0x420c);*/
-
-		S9xControlPostLoadState(&ctl_snap);
-
-		if (local_superfx)
+		else
+	#endif
 		{
-			GSU.pfPlot = fx_PlotTable[GSU.vMode];
-			GSU.pfRpix = fx_PlotTable[GSU.vMode + 5];
+			sec->offset = offset;
+			FillBinarySection(sec, buf + offset);
 		}
 
-		if (local_sa1 && local_sa1_registers)
+		offset = BinaryAlign(offset + sec->stored);
+	}
+
+	memset(buf, 0, snap->sections[0].offset);
+	memcpy(buf, SNAPSHOT_BINARY_MAGIC, 8);
+	WRITE_DWORD(buf + 8, SNAPSHOT_BINARY_VERSION);
+	WRITE_DWORD(buf + 12, SNAPSHOT_VERSION);
+	WRITE_DWORD(buf + 16, snap->count);
+	WRITE_DWORD(buf + 20, offset);
+
+	for (int i = 0; i < snap->count; i++)
+	{
+		SBinarySection	*sec = &snap->sections[i];
+		uint8			*entry = buf + BINARY_HEADER_SIZE + i * BINARY_ENTRY_SIZE;
+
+		memcpy(entry, sec->name, 4);
+		WRITE_DWORD(entry + 4, sec->offset);
+		WRITE_DWORD(entry + 8, sec->stored);
+		WRITE_DWORD(entry + 12, sec->size);
+		WRITE_DWORD(entry + 16, sec->flags);
+	}
+
+	delete [] scratch;
+	ReleaseBinarySnapshot(snap);
+	delete snap;
+
+	return (offset);
+}
+
+bool8 S9xFreezeGameBinary (const char *filename, bool8 compress)
+{
+	uint32	size = S9xFreezeBinarySize();
+	uint8	*buf = new uint8[size];
+	bool8	result = FALSE;
+
+	size = S9xFreezeGameBinaryMem(buf, size, compress);
+	if (size)
+	{
+		FILE	*fp = fopen(filename, "wb");
+
+		if (fp)
 		{
-			SA1.Flags |= sa1_old_flags & TRACE_FLAG;
-			S9xSA1PostLoadState();
+			result = (fwrite(buf, 1, size, fp) == size);
+			result &= (fclose(fp) == 0);
 		}
+	}
 
-		if (Settings.SDD1)
-			S9xSDD1PostLoadState();
+	delete [] buf;
 
-		if (local_spc7110)
-			S9xSPC7110PostLoadState(version);
+	if (result)
+	{
+		S9xResetSaveTimer(TRUE);
 
-		if (local_srtc)
-			S9xSRTCPostLoadState(version);
+		const char *base = S9xBasename(filename);
+		if (S9xMovieActive())
+			sprintf(String, MOVIE_INFO_SNAPSHOT " %s", base);
+		else
+			sprintf(String, SAVE_INFO_SNAPSHOT " %s", base);
 
-		if (local_bsx_data)
-			S9xBSXPostLoadState();
+		S9xMessage(S9X_INFO, S9X_FREEZE_FILE_INFO, String);
+	}
 
-		if (local_msu1_data)
-			S9xMSU1PostLoadState();
+	return (result);
+}
 
-		if (local_movie_data)
+int S9xUnfreezeGameBinaryMem (const uint8 *buf, uint32 bufSize)
+{
+	if (bufSize < BINARY_HEADER_SIZE || memcmp(buf, SNAPSHOT_BINARY_MAGIC, 8) != 0)
+		return (WRONG_FORMAT);
+
+	uint32	container = READ_DWORD(buf + 8);
+	int		version = READ_DWORD(buf + 12);
+	uint32	count = READ_DWORD(buf + 16);
+
+	if (container > SNAPSHOT_BINARY_VERSION || version > SNAPSHOT_VERSION)
+		return (WRONG_VERSION);
+
+	if (READ_DWORD(buf + 20) > bufSize || count > BINARY_MAX_SECTIONS || BINARY_HEADER_SIZE + count * BINARY_ENTRY_SIZE > bufSize)
+		return (WRONG_FORMAT);
+
+	SnapshotBlocks	local;
+	uint8			*inflated[BINARY_MAX_SECTIONS];
+	uint32			movie_size = 0;
+	int				result = SUCCESS;
+
+	memset(&local, 0, sizeof(local));
+	memset(inflated, 0, sizeof(inflated));
+
+	for (uint32 i = 0; i < count && result == SUCCESS; i++)
+	{
+		const uint8	*entry = buf + BINARY_HEADER_SIZE + i * BINARY_ENTRY_SIZE;
+		uint32		offset = READ_DWORD(entry + 4);
+		uint32		stored = READ_DWORD(entry + 8);
+		uint32		size = READ_DWORD(entry + 12);
+		uint32		flags = READ_DWORD(entry + 16);
+
+		SBinaryBlock	*block = NULL;
+		for (uint32 b = 0; b < COUNT(BinaryBlocks); b++)
 		{
-			// restore last displayed pad_read status
-			extern bool8	pad_read, pad_read_last;
-			bool8			pad_read_temp = pad_read;
+			if (!memcmp(entry, BinaryBlocks[b].name, 4))
+				block = &BinaryBlocks[b];
+		}
+
+		// sections from newer versions are skipped, like unknown stream blocks
+		if (!block)
+			continue;
 
-			pad_read = pad_read_last;
-			S9xUpdateFrameCounter(-1);
-			pad_read = pad_read_temp;
+		if (offset > bufSize || stored > bufSize - offset)
+		{
+			result = WRONG_FORMAT;
+			break;
 		}
 
-		if (local_screenshot)
+		if (block->fields)
 		{
-			SnapshotScreenshotInfo	*ssi = new SnapshotScreenshotInfo;
+			if (size < (uint32) UnfreezeStructSize(block->fields, block->num_fields, version))
+				result = WRONG_FORMAT;
+		}
+		else
+		if (block->size ? size != block->size : block->max && size > block->max)
+			result = WRONG_FORMAT;
 
-			UnfreezeStructFromCopy(ssi, SnapScreenshot, COUNT(SnapScreenshot), local_screenshot, version);
+		// deflate shrinks nothing more than 1032 times, a larger size is not allocated
+		if ((flags & BINARY_DEFLATED) && size / 1032 > stored)
+			result = WRONG_FORMAT;
 
-			IPPU.RenderedScreenWidth  = min(ssi->Width,  IMAGE_WIDTH);
-			IPPU.RenderedScreenHeight = min(ssi->Height, IMAGE_HEIGHT);
-			const bool8 scaleDownX = IPPU.RenderedScreenWidth  < ssi->Width;
-			const bool8 scaleDownY = IPPU.RenderedScreenHeight < ssi->Height && ssi->Height > SNES_HEIGHT_EXTENDED;
-			GFX.DoInterlace = Settings.SupportHiRes ? ssi->Interlaced : 0;
+		if (result != SUCCESS)
+			break;
 
-			uint8	*rowpix = ssi->Data;
-			uint16	*screen = GFX.Screen;
+		const uint8	*data = buf + offset;
 
-			for (int y = 0; y < IPPU.RenderedScreenHeight; y++, screen += GFX.RealPPL)
+		if (flags & BINARY_DEFLATED)
+		{
+		#ifdef ZLIB
+			uLongf	len = size;
+
+			inflated[i] = new uint8[size];
+			if (uncompress(inflated[i], &len, data, stored) != Z_OK || len != size)
 			{
-				for (int x = 0; x < IPPU.RenderedScreenWidth; x++)
-				{
-					uint32	r, g, b;
+				result = WRONG_FORMAT;
+				break;
+			}
 
-					r = *(rowpix++);
-					g = *(rowpix++);
-					b = *(rowpix++);
+			data = inflated[i];
+		#else
+			result = WRONG_FORMAT;
+			break;
+		#endif
+		}
+		else
+		if (stored != size)
+		{
+			result = WRONG_FORMAT;
+			break;
+		}
 
-					if (scaleDownX)
-					{
-						r = (r + *(rowpix++)) >> 1;
-						g = (g + *(rowpix++)) >> 1;
-						b = (b + *(rowpix++)) >> 1;
+		*(const uint8 **) ((uint8 *) &local + block->local) = data;
 
-						if (x + x + 1 >= ssi->Width)
-							break;
-					}
+		if (block->local == offsetof(SnapshotBlocks, sram))
+			local.sram_size = size;
+		if (block->local == offsetof(SnapshotBlocks, movie_data))
+			movie_size = size;
+	}
 
-					screen[x] = BUILD_PIXEL(r, g, b);
-				}
+	// the same blocks S9xUnfreezeFromStream insists on
+	if (result == SUCCESS)
+	{
+		if (!local.cpu || !local.registers || !local.ppu || !local.dma || !local.vram || !local.ram ||
+			!local.fillram || !local.apu_sound || !local.control_data || !local.timing_data ||
+			(Settings.SuperFX && !local.superfx) || (Settings.SA1 && (!local.sa1 || !local.sa1_registers)) ||
+			(Settings.DSP == 1 && !local.dsp1) || (Settings.DSP == 2 && !local.dsp2) || (Settings.DSP == 4 && !local.dsp4) ||
+			(Settings.C4 && !local.cx4_data) || (Settings.SETA == ST_010 && !local.st010) ||
+			(Settings.OBC1 && (!local.obc1 || !local.obc1_data)) || (Settings.SPC7110 && !local.spc7110) ||
+			(Settings.SRTC && !local.srtc) || ((Settings.SRTC || Settings.SPC7110RTC) && !local.rtc_data) ||
+			(Settings.BS && !local.bsx_data) || (Settings.MSU1 && !local.msu1_data))
+			result = WRONG_FORMAT;
+	}
 
-				if (scaleDownY)
-				{
-					rowpix += 3 * ssi->Width;
-					if (y + y + 1 >= ssi->Height)
-						break;
-				}
-			}
+	// chips the loaded game does not have keep their state
+	if (!Settings.C4)
+		local.cx4_data = NULL;
+	if (!Settings.OBC1)
+		local.obc1_data = NULL;
+
+	if (result == SUCCESS && S9xMovieActive())
+	{
+		if (!local.movie_data)
+			result = NOT_A_MOVIE_SNAPSHOT;
+		else
+			result = S9xMovieUnfreeze(local.movie_data, movie_size);
+	}
+
+	if (result == SUCCESS)
+		UnfreezeFromBlocks(local, version);
+
+	for (uint32 i = 0; i < count; i++)
+		delete [] inflated[i];
+
+	return (result);
+}
+
+int S9xUnfreezeGameBinary (const char *filename)
+{
+	int	result = FILE_NOT_FOUND;
+
+#ifdef GEKKO
+	// no mmap here, so read the whole file in one go
+	FILE	*fp = fopen(filename, "rb");
+	if (!fp)
+		return (FILE_NOT_FOUND);
 
-			// black out what we might have missed
-			for (uint32 y = IPPU.RenderedScreenHeight; y < (uint32) (IMAGE_HEIGHT); y++)
-				memset(GFX.Screen + y * GFX.RealPPL, 0, GFX.RealPPL * 2);
+	fseek(fp, 0, SEEK_END);
+	long	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
 
-			delete ssi;
+	uint8	*buf = (size > 0) ? new uint8[size] : NULL;
+	if (buf && fread(buf, 1, size, fp) == (size_t) size)
+		result = S9xUnfreezeGameBinaryMem(buf, size);
+	else
+		result = WRONG_FORMAT;
+
+	delete [] buf;
+	fclose(fp);
+#else
+	int	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return (FILE_NOT_FOUND);
+
+	struct stat	st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void	*map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (map != MAP_FAILED)
+		{
+			result = S9xUnfreezeGameBinaryMem((const uint8 *) map, st.st_size);
+			munmap(map, st.st_size);
 		}
+		else
+			result = WRONG_FORMAT;
 	}
+	else
+		result = WRONG_FORMAT;
 
-	if (local_cpu)				delete [] local_cpu;
-	if (local_registers)		delete [] local_registers;
-	if (local_ppu)				delete [] local_ppu;
-	if (local_dma)				delete [] local_dma;
-	if (local_vram)				delete [] local_vram;
-	if (local_ram)				delete [] local_ram;
-	if (local_sram)				delete [] local_sram;
-	if (local_fillram)			delete [] local_fillram;
-	if (local_apu_sound)		delete [] local_apu_sound;
-	if (local_control_data)		delete [] local_control_data;
-	if (local_timing_data)		delete [] local_timing_data;
-	if (local_superfx)			delete [] local_superfx;
-	if (local_sa1)				delete [] local_sa1;
-	if (local_sa1_registers)	delete [] local_sa1_registers;
-	if (local_dsp1)				delete [] local_dsp1;
-	if (local_dsp2)				delete [] local_dsp2;
-	if (local_dsp4)				delete [] local_dsp4;
-	if (local_cx4_data)			delete [] local_cx4_data;
-	if (local_st010)			delete [] local_st010;
-	if (local_obc1)				delete [] local_obc1;
-	if (local_obc1_data)		delete [] local_obc1_data;
-	if (local_spc7110)			delete [] local_spc7110;
-	if (local_srtc)				delete [] local_srtc;
-	if (local_rtc_data)			delete [] local_rtc_data;
-	if (local_bsx_data)			delete [] local_bsx_data;
-	if (local_screenshot)		delete [] local_screenshot;
-	if (local_movie_data)		delete [] local_movie_data;
+	close(fd);
+#endif
 
 	return (result);
 }
@@ -1814,12 +2686,11 @@ static int FreezeSize (int size, int type)
 	}
 }
 
-static void FreezeStruct (STREAM stream, const char *name, void *base, FreezeData *fields, int num_fields)
+static int FreezeStructSize (const char *name, FreezeData *fields, int num_fields)
 {
 	int	len = 0;
-	int	i, j;
 
-	for (i = 0; i < num_fields; i++)
+	for (int i = 0; i < num_fields; i++)
 	{
 		if (SNAPSHOT_VERSION < fields[i].debuted_in)
 		{
@@ -1831,7 +2702,12 @@ static void FreezeStruct (STREAM stream, const char *name, void *base, FreezeDat
 			len += FreezeSize(fields[i].size, fields[i].type);
 	}
 
-	uint8	*block = new uint8[len];
+	return (len);
+}
+
+static void FreezeStructToBlock (void *base, FreezeData *fields, int num_fields, uint8 *block)
+{
+	int		i, j;
 	uint8	*ptr = block;
 	uint8	*addr;
 	uint16	word;
@@ -1931,7 +2807,14 @@ static void FreezeStruct (STREAM stream, const char *name, void *base, FreezeDat
 				break;
 		}
 	}
+}
 
+static void FreezeStruct (STREAM stream, const char *name, void *base, FreezeData *fields, int num_fields)
+{
+	int		len = FreezeStructSize(name, fields, num_fields);
+	uint8	*block = new uint8[len];
+
+	FreezeStructToBlock(base, fields, num_fields, block);
 	FreezeBlock(stream, name, block, len);
 	delete [] block;
 }
@@ -2110,7 +2993,7 @@ static int UnfreezeStruct (STREAM stream, const char *name, void *base, FreezeDa
 	return (SUCCESS);
 }
 
-static int UnfreezeStructCopy (STREAM stream, const char *name, uint8 **block, FreezeData *fields, int num_fields, int version)
+static int UnfreezeStructSize (FreezeData *fields, int num_fields, int version)
 {
 	int	len = 0;
 
@@ -2120,7 +3003,12 @@ static int UnfreezeStructCopy (STREAM stream, const char *name, uint8 **block, F
 			len += FreezeSize(fields[i].size, fields[i].type);
 	}
 
-	return (UnfreezeBlockCopy(stream, name, block, len));
+	return (len);
+}
+
+static int UnfreezeStructCopy (STREAM stream, const char *name, uint8 **block, FreezeData *fields, int num_fields, int version)
+{
+	return (UnfreezeBlockCopy(stream, name, block, UnfreezeStructSize(fields, num_fields, version)));
 }
 
 static void UnfreezeStructFromCopy (void *sbase, FreezeData *fields, int num_fields, uint8 *block, int version)
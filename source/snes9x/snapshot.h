@@ -13,7 +13,12 @@
 #define SNAPSHOT_VERSION_IRQ		7
 #define SNAPSHOT_VERSION_BAPU		8
 #define SNAPSHOT_VERSION_IRQ_2018	11		// irq changes were introduced earlier, since this we store NextIRQTimer directly
-#define SNAPSHOT_VERSION			11
+#define SNAPSHOT_VERSION_SPC7110	12		// the SPC7110 decompression stream and position are stored, not just the decoder
+#define SNAPSHOT_VERSION_SA1_SLICE	12		// the SA-1 can lag behind the S-CPU, how far is stored
+#define SNAPSHOT_VERSION			12
+
+#define SNAPSHOT_BINARY_MAGIC	"#!s9xbin"
+#define SNAPSHOT_BINARY_VERSION	1
 
 #define SUCCESS					1
 #define WRONG_FORMAT			(-1)
@@ -29,6 +34,18 @@ uint32 S9xFreezeSize (void);
 bool8 S9xFreezeGameMem (uint8 *,uint32);
 bool8 S9xUnfreezeGame (const char *);
 int S9xUnfreezeGameMem (const uint8 *,uint32);
+// Raw in-memory snapshots for run-ahead, only valid within this process.
+// The size is 0 when the loaded game can only be saved with the full snapshot.
+uint32 S9xFreezeFastSize (void);
+void S9xFreezeGameFast (uint8 *);
+void S9xUnfreezeGameFast (const uint8 *);
+// Binary container with aligned, optionally deflated sections, see snapshot.cpp.
+// S9xFreezeGameBinaryMem returns the bytes written, 0 when the buffer is too small.
+uint32 S9xFreezeBinarySize (void);
+uint32 S9xFreezeGameBinaryMem (uint8 *, uint32, bool8);
+bool8 S9xFreezeGameBinary (const char *, bool8);
+int S9xUnfreezeGameBinaryMem (const uint8 *, uint32);
+int S9xUnfreezeGameBinary (const char *);
 void S9xFreezeToStream (STREAM);
 int	 S9xUnfreezeFromStream (STREAM);
 
@@ -68,11 +68,9 @@
 #define SNES_MAX_PAL_VCOUNTER		312
 #define SNES_HCOUNTER_MAX			341
 
-#ifdef GEKKO
 #define ONE_CYCLE      (Settings.OneClockCycle)
 #define SLOW_ONE_CYCLE (Settings.OneSlowClockCycle)
 #define TWO_CYCLES     (Settings.TwoClockCycles)
-#endif
 
 #define	ONE_DOT_CYCLE				4
 
@@ -181,9 +179,7 @@ struct STimings
 	int32	IRQFlagChanging;	// This value is just a hack.
 	int32	APUSpeedup;
 	bool8	APUAllowTimeOverflow;
-#ifdef GEKKO
 	int32	SuperFX2CoreSpeed;		// Make the SuperFX2 Core Speed adjustable
-#endif
 };
 
 struct SSettings
@@ -240,9 +236,11 @@ struct SSettings
 	bool8	Mute;
 	bool8	DynamicRateControl;
 	int32	InterpolationMethod;
+	bool8	SincResampling;		// output rate conversion with a windowed sinc instead of Hermite
 
 	bool8	SupportHiRes;
 	bool8	Transparency;
+	bool8	LineColourMath;		// main screen drawn unmixed, colour math done a line at a time after it
 	uint8	BG_Forced;
 	bool8	DisableGraphicWindows;
 
@@ -308,6 +306,8 @@ struct SSettings
 	bool8   SeparateEchoBuffer;
 	uint32	SuperFXClockMultiplier;
 	int	OverclockMode;
+	bool8	CPUBlockCache;
+	int32	SA1Quantum;	// S-CPU instructions between SA-1 catch-ups, 1 is lockstep; the memory map follows it when a game is loaded
 	int	OneClockCycle;
 	int	OneSlowClockCycle;
 	int	TwoClockCycles;
@@ -28,6 +28,7 @@
 #include "memmap.h"
 #include "srtc.h"
 #include "display.h"
+#include "snapshot.h"
 
 #define memory_cartrom_size()		Memory.CalculatedSize
 #define memory_cartrom_read(a)		Memory.ROM[(a)]
@@ -232,6 +233,11 @@ void S9xSPC7110PreSaveState (void)
 		s7snap.context[i].index  = s7emu.decomp.context[i].index;
 		s7snap.context[i].invert = s7emu.decomp.context[i].invert;
 	}
+
+	// the decoder state may be another stream's, or ahead of the kept one
+	s7snap.decomp_stream        = s7emu.decomp.cur ? TRUE : FALSE;
+	s7snap.decomp_stream_offset = s7emu.decomp.cur ? (uint32) s7emu.decomp.cur->offset : 0;
+	s7snap.decomp_stream_pos    = s7emu.decomp.cur ? (uint32) s7emu.decomp.cur_pos : 0;
 }
 
 void S9xSPC7110PostLoadState (int version)
@@ -314,5 +320,10 @@ void S9xSPC7110PostLoadState (int version)
 		s7emu.decomp.context[i].invert = s7snap.context[i].invert;
 	}
 
+	if (version >= SNAPSHOT_VERSION_SPC7110 && s7snap.decomp_stream)
+		s7emu.decomp.attach(s7emu.decomp.decomp_mode, s7snap.decomp_stream_offset, s7snap.decomp_stream_pos);
+	else
+		s7emu.decomp.detach();
+
 	s7emu.update_time(0);
 }
@@ -88,6 +88,10 @@ struct SSPC7110Snapshot
 		uint8	index;
 		uint8	invert;
 	}	context[32];
+
+	bool8	decomp_stream;			// bool
+	uint32	decomp_stream_offset;	// unsigned
+	uint32	decomp_stream_pos;		// unsigned
 };
 
 extern struct SSPC7110Snapshot	s7snap;
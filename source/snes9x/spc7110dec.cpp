@@ -20,13 +20,9 @@
 
 uint8 SPC7110Decomp::read() {
   if(decomp_buffer_length == 0) {
-    //decompress at least (decomp_buffer_size / 2) bytes to the buffer
-    switch(decomp_mode) {
-      case 0: mode0(false); break;
-      case 1: mode1(false); break;
-      case 2: mode2(false); break;
-      default: return 0x00;
-    }
+    //mode 3 is invalid and always returns 0x00
+    if(decomp_mode > 2) return 0x00;
+    spool();
   }
 
   uint8 data = decomp_buffer[decomp_buffer_rdoffset++];
@@ -39,6 +35,14 @@ void SPC7110Decomp::write(uint8 data) {
   decomp_buffer[decomp_buffer_wroffset++] = data;
   decomp_buffer_wroffset &= decomp_buffer_size - 1;
   decomp_buffer_length++;
+
+  if(owner) {
+    if(owner_pos >= owner->length && owner_pos < stream_size) {
+      owner->data[owner_pos] = data;
+      owner->length = owner_pos + 1;
+    }
+    owner_pos++;
+  }
 }
 
 uint8 SPC7110Decomp::dataread() {
@@ -48,27 +52,142 @@ uint8 SPC7110Decomp::dataread() {
 }
 
 void SPC7110Decomp::init(unsigned mode, unsigned offset, unsigned index) {
+  //decomp_offset and the context states belong to the decoder, which only
+  //runs when the stream is not kept yet, see restart()
   decomp_mode = mode;
-  decomp_offset = offset;
 
   decomp_buffer_rdoffset = 0;
   decomp_buffer_wroffset = 0;
   decomp_buffer_length   = 0;
 
-  //reset context states
+  cur = NULL;
+
+  if(mode <= 2) {
+    cur = find(mode, offset);
+    if(index <= cur->length) cur_pos = index;
+    else restart(index);
+    return;
+  }
+
+  decomp_offset = offset;
+
+  //reset context states, which are part of the decoder state
   for(unsigned i = 0; i < 32; i++) {
     context[i].index  = 0;
     context[i].invert = 0;
   }
+  owner = NULL;
+}
+
+//returns the kept stream for (mode, offset), or the least recently started
+//one emptied for it
+SPC7110Decomp::Stream *SPC7110Decomp::find(unsigned mode, unsigned offset) {
+  if(!stream_data) {
+    stream_data = new uint8[stream_count * stream_size];
+    for(unsigned i = 0; i < stream_count; i++) stream[i].data = stream_data + i * stream_size;
+  }
+
+  Stream *lru = &stream[0];
+  for(unsigned i = 0; i < stream_count; i++) {
+    if(stream[i].length && stream[i].mode == mode && stream[i].offset == offset) {
+      lru = &stream[i];
+      lru->used = ++stream_clock;
+      return lru;
+    }
+    if(stream[i].used < lru->used) lru = &stream[i];
+  }
+
+  if(owner == lru) owner = NULL;
+  lru->mode   = mode;
+  lru->offset = offset;
+  lru->length = 0;
+  lru->used   = ++stream_clock;
+  return lru;
+}
+
+//refills decomp_buffer, which is empty
+void SPC7110Decomp::spool() {
+  if(!cur) {
+    decode();
+    return;
+  }
+
+  if(cur_pos < cur->length) {
+    //half the buffer at a time, like the decoder
+    unsigned length = cur->length - cur_pos;
+    if(length > (decomp_buffer_size >> 1)) length = decomp_buffer_size >> 1;
+    while(length--) {
+      decomp_buffer[decomp_buffer_wroffset++] = cur->data[cur_pos++];
+      decomp_buffer_wroffset &= decomp_buffer_size - 1;
+      decomp_buffer_length++;
+    }
+    return;
+  }
+
+  if(owner != cur || owner_pos != cur_pos) restart(cur_pos);
+  if(decomp_buffer_length == 0) {
+    decode();
+    cur_pos = owner_pos;
+  }
+}
 
+//decompresses at least (decomp_buffer_size / 2) bytes to the buffer
+void SPC7110Decomp::decode() {
   switch(decomp_mode) {
-    case 0: mode0(true); break;
-    case 1: mode1(true); break;
-    case 2: mode2(true); break;
+    case 0: mode0(false); break;
+    case 1: mode1(false); break;
+    case 2: mode2(false); break;
+  }
+}
+
+//runs the decoder for cur up to pos and leaves what it produced past pos
+//in decomp_buffer
+void SPC7110Decomp::restart(unsigned pos) {
+  if(owner != cur || owner_pos > pos) {
+    decomp_mode   = cur->mode;
+    decomp_offset = cur->offset;
+
+    //reset context states
+    for(unsigned i = 0; i < 32; i++) {
+      context[i].index  = 0;
+      context[i].invert = 0;
+    }
+
+    switch(decomp_mode) {
+      case 0: mode0(true); break;
+      case 1: mode1(true); break;
+      case 2: mode2(true); break;
+    }
+
+    owner = cur;
+    owner_pos = 0;
   }
 
-  //decompress up to requested output data index
-  while(index--) read();
+  while(owner_pos < pos) {
+    decomp_buffer_rdoffset = decomp_buffer_wroffset;
+    decomp_buffer_length = 0;
+    decode();
+  }
+
+  unsigned skip = decomp_buffer_length - (owner_pos - pos);
+  decomp_buffer_rdoffset = (decomp_buffer_rdoffset + skip) & (decomp_buffer_size - 1);
+  decomp_buffer_length -= skip;
+  cur_pos = owner_pos;
+}
+
+//snapshots keep the stream and the position of the next byte to enter
+//decomp_buffer; the decoder runs up to it again when it is not kept here
+void SPC7110Decomp::attach(unsigned mode, unsigned offset, unsigned pos) {
+  decomp_mode = mode;
+  cur = find(mode, offset);
+  cur_pos = pos;
+  owner = NULL;
+}
+
+//older snapshots only have the decoder state, so reads continue with it
+void SPC7110Decomp::detach() {
+  cur = NULL;
+  owner = NULL;
 }
 
 //
@@ -495,10 +614,20 @@ void SPC7110Decomp::reset() {
   decomp_buffer_rdoffset = 0;
   decomp_buffer_wroffset = 0;
   decomp_buffer_length   = 0;
+
+  //another cartridge may have been loaded
+  for(unsigned i = 0; i < stream_count; i++) {
+    stream[i].length = 0;
+    stream[i].used   = 0;
+  }
+  stream_clock = 0;
+  detach();
 }
 
 SPC7110Decomp::SPC7110Decomp() {
   decomp_buffer = new uint8[decomp_buffer_size];
+  stream_data = NULL;
+  for(unsigned i = 0; i < stream_count; i++) stream[i].data = NULL;
   reset();
 
   //initialize reverse morton lookup tables
@@ -524,6 +653,7 @@ SPC7110Decomp::SPC7110Decomp() {
 
 SPC7110Decomp::~SPC7110Decomp() {
   delete[] decomp_buffer;
+  delete[] stream_data;
 }
 
 #endif
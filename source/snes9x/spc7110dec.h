@@ -41,6 +41,32 @@ public:
   void write(uint8 data);
   uint8 dataread();
 
+  //Decoded output is kept per (mode, offset), so a stream that is started
+  //again, at any index, is read from memory instead of being decoded again.
+  //The decoder only runs when a stream goes past what has been kept.
+  enum { stream_count = 8, stream_size = 0x8000 };
+  struct Stream {
+    unsigned mode;
+    unsigned offset;
+    unsigned length;  //bytes kept in data
+    unsigned used;    //for picking the least recently started stream
+    uint8 *data;
+  } stream[stream_count];
+  uint8 *stream_data;
+  unsigned stream_clock;
+
+  Stream *cur;        //stream being read, NULL when it is not kept
+  unsigned cur_pos;   //position of the next byte of cur to enter decomp_buffer
+  Stream *owner;      //stream the decoder state belongs to, NULL for none
+  unsigned owner_pos; //bytes the decoder has produced for owner
+
+  Stream *find(unsigned mode, unsigned offset);
+  void spool();
+  void decode();
+  void restart(unsigned pos);
+  void attach(unsigned mode, unsigned offset, unsigned pos);
+  void detach();
+
   void mode0(bool init);
   void mode1(bool init);
   void mode2(bool init);
@@ -4,8 +4,22 @@
    For further information, consult the LICENSE file in the root directory.
 \*****************************************************************************/
 
+#ifdef GEKKO
+#include <malloc.h>
+#elif defined(__linux)
+#include <malloc.h>
+#endif
+
 #include "tileimpl.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TILE_CONVERTER_HAVE_AVX2
+#endif
+
 using namespace TileImpl;
 
 namespace {
@@ -26,7 +40,7 @@ namespace {
 
 	uint8 ConvertTile2 (uint8 *pCache, uint32 TileAddr, uint32)
 	{
-		uint8	*tp      = &Memory.VRAM[TileAddr];
+		uint8	*tp      = &GFX.VRAM[TileAddr];
 		uint32			*p       = (uint32 *) pCache;
 		uint32			non_zero = 0;
 		uint8			line;
@@ -49,7 +63,7 @@ namespace {
 
 	uint8 ConvertTile4 (uint8 *pCache, uint32 TileAddr, uint32)
 	{
-		uint8	*tp      = &Memory.VRAM[TileAddr];
+		uint8	*tp      = &GFX.VRAM[TileAddr];
 		uint32			*p       = (uint32 *) pCache;
 		uint32			non_zero = 0;
 		uint8			line;
@@ -74,7 +88,7 @@ namespace {
 
 	uint8 ConvertTile8 (uint8 *pCache, uint32 TileAddr, uint32)
 	{
-		uint8	*tp      = &Memory.VRAM[TileAddr];
+		uint8	*tp      = &GFX.VRAM[TileAddr];
 		uint32			*p       = (uint32 *) pCache;
 		uint32			non_zero = 0;
 		uint8			line;
@@ -111,7 +125,7 @@ namespace {
 
 	uint8 ConvertTile2h_odd (uint8 *pCache, uint32 TileAddr, uint32 Tile)
 	{
-		uint8	*tp1     = &Memory.VRAM[TileAddr], *tp2;
+		uint8	*tp1     = &GFX.VRAM[TileAddr], *tp2;
 		uint32			*p       = (uint32 *) pCache;
 		uint32			non_zero = 0;
 		uint8			line;
@@ -139,7 +153,7 @@ namespace {
 
 	uint8 ConvertTile4h_odd (uint8 *pCache, uint32 TileAddr, uint32 Tile)
 	{
-		uint8	*tp1     = &Memory.VRAM[TileAddr], *tp2;
+		uint8	*tp1     = &GFX.VRAM[TileAddr], *tp2;
 		uint32			*p       = (uint32 *) pCache;
 		uint32			non_zero = 0;
 		uint8			line;
@@ -177,7 +191,7 @@ namespace {
 
 	uint8 ConvertTile2h_even (uint8 *pCache, uint32 TileAddr, uint32 Tile)
 	{
-		uint8	*tp1     = &Memory.VRAM[TileAddr], *tp2;
+		uint8	*tp1     = &GFX.VRAM[TileAddr], *tp2;
 		uint32			*p       = (uint32 *) pCache;
 		uint32			non_zero = 0;
 		uint8			line;
@@ -205,7 +219,7 @@ namespace {
 
 	uint8 ConvertTile4h_even (uint8 *pCache, uint32 TileAddr, uint32 Tile)
 	{
-		uint8	*tp1     = &Memory.VRAM[TileAddr], *tp2;
+		uint8	*tp1     = &GFX.VRAM[TileAddr], *tp2;
 		uint32			*p       = (uint32 *) pCache;
 		uint32			non_zero = 0;
 		uint8			line;
@@ -235,6 +249,199 @@ namespace {
 
 	#undef DOBIT
 
+	// The same conversion as a bit matrix transpose of every line: byte i of
+	// the input holds pixels 0-7 of plane i, byte x of the output holds planes
+	// 0-7 of pixel x. ConvertPlanar* take the planes in VRAM order, two planes
+	// interleaved per 16 bytes, so the hires converters can merge the halves of
+	// two tiles into a buffer first and convert that.
+
+	template <int depth>
+	uint8 ConvertPlanarSWAR (uint8 *pCache, const uint8 *tp)
+	{
+		uint32	*p       = (uint32 *) pCache;
+		uint32	non_zero = 0;
+
+		for (int line = 8; line != 0; line--, tp += 2)
+		{
+			// plane 7 in the top byte of x, plane 0 in the bottom byte of y
+			uint32	x = 0, y = tp[0] | (tp[1] << 8);
+			uint32	t;
+
+			if (depth >= 4)
+				y |= (tp[16] << 16) | (tp[17] << 24);
+			if (depth == 8)
+				x = tp[32] | (tp[33] << 8) | (tp[48] << 16) | (tp[49] << 24);
+
+			// Hacker's Delight transpose8, 32-bit version
+			t = (x ^ (x >>  7)) & 0x00aa00aa;	x ^= t ^ (t <<  7);
+			t = (y ^ (y >>  7)) & 0x00aa00aa;	y ^= t ^ (t <<  7);
+			t = (x ^ (x >> 14)) & 0x0000cccc;	x ^= t ^ (t << 14);
+			t = (y ^ (y >> 14)) & 0x0000cccc;	y ^= t ^ (t << 14);
+			t = (x & 0xf0f0f0f0) | ((y >> 4) & 0x0f0f0f0f);
+			y = ((x << 4) & 0xf0f0f0f0) | (y & 0x0f0f0f0f);
+			x = t;
+
+			// pixel 0 is in the top byte now
+		#ifdef LSB_FIRST
+			SWAP_DWORD(x);
+			SWAP_DWORD(y);
+		#endif
+			*p++ = x;
+			*p++ = y;
+			non_zero |= x | y;
+		}
+
+		return (non_zero ? TRUE : BLANK_TILE);
+	}
+
+#ifdef __SSE2__
+	// Each 16-byte vector holds two lines. Every plane byte is broadcast to the
+	// eight pixels of its line, tested against the pixel's bit and shifted into
+	// the pixels, highest plane first.
+	static inline void AccumulatePlaneSSE2 (__m128i *acc, __m128i lines)
+	{
+		const __m128i	bits = _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+		__m128i			lo   = _mm_unpacklo_epi16(lines, lines);
+		__m128i			hi   = _mm_unpackhi_epi16(lines, lines);
+		__m128i			v[4];
+
+		v[0] = _mm_unpacklo_epi32(lo, lo);
+		v[1] = _mm_unpackhi_epi32(lo, lo);
+		v[2] = _mm_unpacklo_epi32(hi, hi);
+		v[3] = _mm_unpackhi_epi32(hi, hi);
+
+		for (int i = 0; i < 4; i++)
+			acc[i] = _mm_sub_epi8(_mm_add_epi8(acc[i], acc[i]), _mm_cmpeq_epi8(_mm_and_si128(v[i], bits), bits));
+	}
+
+	template <int depth>
+	uint8 ConvertPlanarSSE2 (uint8 *pCache, const uint8 *tp)
+	{
+		__m128i	acc[4];
+
+		for (int i = 0; i < 4; i++)
+			acc[i] = _mm_setzero_si128();
+
+		for (int pair = depth / 2 - 1; pair >= 0; pair--)
+		{
+			__m128i	v      = _mm_loadu_si128((const __m128i *) (tp + pair * 16));
+			__m128i	planes = _mm_packus_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), _mm_srli_epi16(v, 8));
+
+			AccumulatePlaneSSE2(acc, _mm_unpackhi_epi8(planes, planes));
+			AccumulatePlaneSSE2(acc, _mm_unpacklo_epi8(planes, planes));
+		}
+
+		__m128i	non_zero = _mm_setzero_si128();
+
+		for (int i = 0; i < 4; i++)
+		{
+			_mm_storeu_si128((__m128i *) (pCache + i * 16), acc[i]);
+			non_zero = _mm_or_si128(non_zero, acc[i]);
+		}
+
+		return (_mm_movemask_epi8(_mm_cmpeq_epi8(non_zero, _mm_setzero_si128())) != 0xffff ? TRUE : BLANK_TILE);
+	}
+#endif
+
+#ifdef TILE_CONVERTER_HAVE_AVX2
+	// Four lines per vector, the plane bytes are broadcast with a shuffle.
+	template <int depth>
+	__attribute__((target("avx2"))) uint8 ConvertPlanarAVX2 (uint8 *pCache, const uint8 *tp)
+	{
+		const __m256i	bits  = _mm256_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+												 -128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+		const __m256i	lines = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2,
+												 4, 4, 4, 4, 4, 4, 4, 4, 6, 6, 6, 6, 6, 6, 6, 6);
+		const __m256i	one   = _mm256_set1_epi8(1);
+		const __m256i	eight = _mm256_set1_epi8(8);
+		__m256i			acc0  = _mm256_setzero_si256();
+		__m256i			acc1  = _mm256_setzero_si256();
+
+		for (int plane = depth - 1; plane >= 0; plane--)
+		{
+			__m256i	v  = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (tp + (plane >> 1) * 16)));
+			__m256i	i0 = (plane & 1) ? _mm256_add_epi8(lines, one) : lines;
+			__m256i	v0 = _mm256_shuffle_epi8(v, i0);
+			__m256i	v1 = _mm256_shuffle_epi8(v, _mm256_add_epi8(i0, eight));
+
+			acc0 = _mm256_sub_epi8(_mm256_add_epi8(acc0, acc0), _mm256_cmpeq_epi8(_mm256_and_si256(v0, bits), bits));
+			acc1 = _mm256_sub_epi8(_mm256_add_epi8(acc1, acc1), _mm256_cmpeq_epi8(_mm256_and_si256(v1, bits), bits));
+		}
+
+		_mm256_storeu_si256((__m256i *) pCache, acc0);
+		_mm256_storeu_si256((__m256i *) (pCache + 32), acc1);
+
+		return (_mm256_testz_si256(_mm256_or_si256(acc0, acc1), _mm256_or_si256(acc0, acc1)) ? BLANK_TILE : TRUE);
+	}
+#endif
+
+	template <int depth, uint8 (*Planar) (uint8 *, const uint8 *)>
+	uint8 ConvertTilePlanar (uint8 *pCache, uint32 TileAddr, uint32)
+	{
+		return (Planar(pCache, &GFX.VRAM[TileAddr]));
+	}
+
+	template <int depth, bool odd, uint8 (*Planar) (uint8 *, const uint8 *)>
+	uint8 ConvertTilePlanarHires (uint8 *pCache, uint32 TileAddr, uint32 Tile)
+	{
+		const uint8	*hrbit = odd ? hrbit_odd : hrbit_even;
+		uint8		*tp1   = &GFX.VRAM[TileAddr], *tp2;
+		uint8		planes[depth * 8];
+
+		if (Tile == 0x3ff)
+			tp2 = tp1 - (0x3ff << (depth == 2 ? 4 : 5));
+		else
+			tp2 = tp1 + (1 << (depth == 2 ? 4 : 5));
+
+		// pixels 0-3 come from the first tile, 4-7 from the second one
+		for (int n = 0; n < depth * 8; n++)
+			planes[n] = (hrbit[tp1[n]] << 4) | hrbit[tp2[n]];
+
+		return (Planar(pCache, planes));
+	}
+
+	struct STileConverters
+	{
+		uint8	(*Tile2) (uint8 *, uint32, uint32);
+		uint8	(*Tile4) (uint8 *, uint32, uint32);
+		uint8	(*Tile8) (uint8 *, uint32, uint32);
+		uint8	(*Tile2h_odd) (uint8 *, uint32, uint32);
+		uint8	(*Tile4h_odd) (uint8 *, uint32, uint32);
+		uint8	(*Tile2h_even) (uint8 *, uint32, uint32);
+		uint8	(*Tile4h_even) (uint8 *, uint32, uint32);
+	};
+
+	#define PLANAR_CONVERTERS(Planar) \
+		{ \
+			ConvertTilePlanar<2, Planar<2> >, \
+			ConvertTilePlanar<4, Planar<4> >, \
+			ConvertTilePlanar<8, Planar<8> >, \
+			ConvertTilePlanarHires<2, true,  Planar<2> >, \
+			ConvertTilePlanarHires<4, true,  Planar<4> >, \
+			ConvertTilePlanarHires<2, false, Planar<2> >, \
+			ConvertTilePlanarHires<4, false, Planar<4> > \
+		}
+
+	const STileConverters	TileConverters[] =
+	{
+		{ ConvertTile2, ConvertTile4, ConvertTile8, ConvertTile2h_odd, ConvertTile4h_odd, ConvertTile2h_even, ConvertTile4h_even },
+		PLANAR_CONVERTERS(ConvertPlanarSWAR),
+	#ifdef __SSE2__
+		PLANAR_CONVERTERS(ConvertPlanarSSE2),
+	#else
+		PLANAR_CONVERTERS(ConvertPlanarSWAR),
+	#endif
+	#ifdef TILE_CONVERTER_HAVE_AVX2
+		PLANAR_CONVERTERS(ConvertPlanarAVX2)
+	#else
+		PLANAR_CONVERTERS(ConvertPlanarSWAR)
+	#endif
+	};
+
+	#undef PLANAR_CONVERTERS
+
+	const STileConverters	*Converters = &TileConverters[TILE_CONVERTER_SWAR];
+
 } // anonymous namespace
 
 void S9xInitTileRenderer (void)
@@ -294,6 +501,40 @@ void S9xInitTileRenderer (void)
 		hrbit_odd[i]  = m;
 		hrbit_even[i] = s;
 	}
+
+	if (!S9xSetTileConverters(TILE_CONVERTER_AVX2) && !S9xSetTileConverters(TILE_CONVERTER_SSE2))
+		S9xSetTileConverters(TILE_CONVERTER_SWAR);
+}
+
+bool8 S9xSetTileConverters (int type)
+{
+	switch (type)
+	{
+		case TILE_CONVERTER_TABLE:
+		case TILE_CONVERTER_SWAR:
+			break;
+
+		case TILE_CONVERTER_SSE2:
+		#ifdef __SSE2__
+			break;
+		#else
+			return (FALSE);
+		#endif
+
+		case TILE_CONVERTER_AVX2:
+		#ifdef TILE_CONVERTER_HAVE_AVX2
+			if (__builtin_cpu_supports("avx2"))
+				break;
+		#endif
+			return (FALSE);
+
+		default:
+			return (FALSE);
+	}
+
+	Converters = &TileConverters[type];
+
+	return (TRUE);
 }
 
 // Functions to select which converter and renderer to use.
@@ -330,6 +571,37 @@ extern template struct TileImpl::Renderers<DrawTile16, HiresInterlace>;
 extern template struct TileImpl::Renderers<DrawClippedTile16, HiresInterlace>;
 extern template struct TileImpl::Renderers<DrawMosaicPixel16, HiresInterlace>;
 
+// The index into Renderers<>::Functions of the colour math set up in $2130/$2131.
+static int ColourMathOp (void)
+{
+	int	i;
+
+	if (!Settings.Transparency)
+		return (0);
+
+	i = (GFX.FillRAM[0x2131] & 0x80) ? 4 : 1;
+	if (GFX.FillRAM[0x2131] & 0x40)
+	{
+		i++;
+		if (GFX.FillRAM[0x2130] & 2)
+			i++;
+	}
+	if (IPPU.MaxBrightness != 0xf)
+	{
+		if (i == 1)
+			i = 7;
+		else if (i == 3)
+			i = 8;
+	}
+
+	return (i);
+}
+
+bool8 S9xLineColourMath (void)
+{
+	return (Settings.LineColourMath && !IPPU.DoubleWidthPixels);
+}
+
 void S9xSelectTileRenderers (int BGMode, bool8 sub, bool8 obj)
 {
 	void	(**DT)		(uint32, uint32, uint32, uint32);
@@ -346,7 +618,17 @@ void S9xSelectTileRenderers (int BGMode, bool8 sub, bool8 obj)
 	bool8 interlace = obj ? FALSE : IPPU.Interlace;
 	bool8 hires = !sub && (BGMode == 5 || BGMode == 6 || IPPU.PseudoHires);
 
-	if (!IPPU.DoubleWidthPixels)	// normal width
+	if (!sub && S9xLineColourMath())	// normal width, math done per line
+	{
+		DT     = Renderers<DrawTile16, Deferred1x1>::Functions;
+		DCT    = Renderers<DrawClippedTile16, Deferred1x1>::Functions;
+		DMP    = Renderers<DrawMosaicPixel16, Deferred1x1>::Functions;
+		DB     = Renderers<DrawBackdrop16, Deferred1x1>::Functions;
+		DM7BG1 = M7M1 ? Renderers<DrawMode7MosaicBG1, Deferred1x1>::Functions : Renderers<DrawMode7BG1, Deferred1x1>::Functions;
+		DM7BG2 = M7M2 ? Renderers<DrawMode7MosaicBG2, Deferred1x1>::Functions : Renderers<DrawMode7BG2, Deferred1x1>::Functions;
+		GFX.LinesPerTile = 8;
+	}
+	else if (!IPPU.DoubleWidthPixels)	// normal width
 	{
 		DT     = Renderers<DrawTile16, Normal1x1>::Functions;
 		DCT    = Renderers<DrawClippedTile16, Normal1x1>::Functions;
@@ -410,79 +692,401 @@ void S9xSelectTileRenderers (int BGMode, bool8 sub, bool8 obj)
 	GFX.DrawMode7BG1Nomath    = DM7BG1[0];
 	GFX.DrawMode7BG2Nomath    = DM7BG2[0];
 
-	int	i;
+	int	i = ColourMathOp();
 
-	if (!Settings.Transparency)
-		i = 0;
-	else
+	GFX.DrawTileMath        = DT[i];
+	GFX.DrawClippedTileMath = DCT[i];
+	GFX.DrawMosaicPixelMath = DMP[i];
+	GFX.DrawBackdropMath    = DB[i];
+	GFX.DrawMode7BG1Math    = DM7BG1[i];
+	GFX.DrawMode7BG2Math    = DM7BG2[i];
+}
+
+// Per line colour math.
+//
+// The math that is to be done is the same for every pixel of an update, only
+// whether a pixel gets it, whether the colour window clipped it and whether
+// the subscreen is transparent under it change, so once the main screen has
+// been drawn it is done over whole lines. The results are the ones the
+// REGMATH, MATHF1_2 and MATHS1_2 plotters give, bit for bit.
+
+enum
+{
+	HALF_NEVER,		// REGMATH
+	HALF_FIXED,		// MATHF1_2, halved unless clipped, always with the fixed colour
+	HALF_SUB		// MATHS1_2, halved unless clipped where there is a subscreen pixel
+};
+
+#ifdef __SSE2__
+// The scalar operations on four pixels at once, one in each 32-bit lane.
+template<class Op> struct ColourMathSSE2;
+
+template<>
+struct ColourMathSSE2<COLOR_ADD>
+{
+	static alwaysinline __m128i fn (__m128i C1, __m128i C2)
 	{
-		i = (Memory.FillRAM[0x2131] & 0x80) ? 4 : 1;
-		if (Memory.FillRAM[0x2131] & 0x40)
+		const __m128i	rb_mask = _mm_set1_epi32((0x1F << RED_SHIFT_BITS) | 0x1F);
+		const __m128i	g_mask = _mm_set1_epi32(0x1F << GREEN_SHIFT_BITS);
+
+		__m128i	rb = _mm_add_epi32(_mm_and_si128(C1, rb_mask), _mm_and_si128(C2, rb_mask));
+		__m128i	rbcarry = _mm_and_si128(rb, _mm_set1_epi32((0x20 << RED_SHIFT_BITS) | (0x20 << 0)));
+		__m128i	g = _mm_add_epi32(_mm_and_si128(C1, g_mask), _mm_and_si128(C2, g_mask));
+		__m128i	carry = _mm_srli_epi32(_mm_or_si128(_mm_and_si128(g, _mm_set1_epi32(0x20 << GREEN_SHIFT_BITS)), rbcarry), 5);
+		__m128i	retval = _mm_or_si128(_mm_or_si128(_mm_and_si128(rb, rb_mask), _mm_and_si128(g, g_mask)), _mm_sub_epi32(_mm_slli_epi32(carry, 5), carry));
+	#if GREEN_SHIFT_BITS == 6
+		retval = _mm_or_si128(retval, _mm_srli_epi32(_mm_and_si128(retval, _mm_set1_epi32(0x0400)), 5));
+	#endif
+		return (retval);
+	}
+
+	static alwaysinline __m128i fn1_2 (__m128i C1, __m128i C2)
+	{
+		const __m128i	remove_low = _mm_set1_epi32(RGB_REMOVE_LOW_BITS_MASK);
+
+		__m128i	sum = _mm_srli_epi32(_mm_add_epi32(_mm_and_si128(C1, remove_low), _mm_and_si128(C2, remove_low)), 1);
+		__m128i	low = _mm_and_si128(_mm_and_si128(C1, C2), _mm_set1_epi32(RGB_LOW_BITS_MASK));
+		return (_mm_or_si128(_mm_add_epi32(sum, low), _mm_set1_epi32(ALPHA_BITS_MASK)));
+	}
+};
+
+template<>
+struct ColourMathSSE2<COLOR_SUB>
+{
+	static alwaysinline __m128i fn (__m128i C1, __m128i C2)
+	{
+		const __m128i	rb_mask = _mm_set1_epi32(THIRD_COLOR_MASK | FIRST_COLOR_MASK);
+		const __m128i	g_mask = _mm_set1_epi32(SECOND_COLOR_MASK);
+
+		__m128i	rb = _mm_sub_epi32(_mm_or_si128(_mm_and_si128(C1, rb_mask), _mm_set1_epi32((0x20 << 0) | (0x20 << RED_SHIFT_BITS))), _mm_and_si128(C2, rb_mask));
+		__m128i	rbcarry = _mm_and_si128(rb, _mm_set1_epi32((0x20 << RED_SHIFT_BITS) | (0x20 << 0)));
+		__m128i	g = _mm_sub_epi32(_mm_or_si128(_mm_and_si128(C1, g_mask), _mm_set1_epi32(0x20 << GREEN_SHIFT_BITS)), _mm_and_si128(C2, g_mask));
+		__m128i	carry = _mm_srli_epi32(_mm_or_si128(_mm_and_si128(g, _mm_set1_epi32(0x20 << GREEN_SHIFT_BITS)), rbcarry), 5);
+		__m128i	retval = _mm_and_si128(_mm_or_si128(_mm_and_si128(rb, rb_mask), _mm_and_si128(g, g_mask)), _mm_sub_epi32(_mm_slli_epi32(carry, 5), carry));
+	#if GREEN_SHIFT_BITS == 6
+		retval = _mm_or_si128(retval, _mm_srli_epi32(_mm_and_si128(retval, _mm_set1_epi32(0x0400)), 5));
+	#endif
+		return (retval);
+	}
+
+	// GFX.ZERO keeps each component that is left with its top bit set, without it
+	static alwaysinline __m128i fn1_2 (__m128i C1, __m128i C2)
+	{
+		__m128i	d = _mm_srli_epi32(_mm_sub_epi32(_mm_or_si128(C1, _mm_set1_epi32(RGB_HI_BITS_MASKx2)), _mm_and_si128(C2, _mm_set1_epi32(RGB_REMOVE_LOW_BITS_MASK))), 1);
+		__m128i	retval = _mm_setzero_si128();
+
+		#define ZERO_COMPONENT(hi, low) \
+			retval = _mm_or_si128(retval, _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(d, _mm_set1_epi32(hi)), _mm_set1_epi32(hi)), _mm_and_si128(d, _mm_set1_epi32((hi) - (low)))))
+
+		ZERO_COMPONENT(RED_HI_BIT_MASK, RED_LOW_BIT_MASK);
+		ZERO_COMPONENT(GREEN_HI_BIT_MASK, GREEN_LOW_BIT_MASK);
+		ZERO_COMPONENT(BLUE_HI_BIT_MASK, BLUE_LOW_BIT_MASK);
+
+		#undef ZERO_COMPONENT
+
+		return (retval);
+	}
+};
+
+template<>
+struct ColourMathSSE2<COLOR_ADD_BRIGHTNESS>
+{
+	// brightness_cap[i] is i up to the brightest component, and that beyond it
+	static alwaysinline __m128i fn (__m128i C1, __m128i C2)
+	{
+		const __m128i	cap = _mm_set1_epi32(brightness_cap[0x3f]);
+		const __m128i	c_mask = _mm_set1_epi32(0x1f);
+
+		__m128i	r = _mm_min_epi16(_mm_add_epi32(_mm_srli_epi32(C1, RED_SHIFT_BITS), _mm_srli_epi32(C2, RED_SHIFT_BITS)), cap);
+		__m128i	g = _mm_min_epi16(_mm_add_epi32(_mm_and_si128(_mm_srli_epi32(C1, GREEN_SHIFT_BITS), c_mask), _mm_and_si128(_mm_srli_epi32(C2, GREEN_SHIFT_BITS), c_mask)), cap);
+		__m128i	b = _mm_min_epi16(_mm_add_epi32(_mm_and_si128(C1, c_mask), _mm_and_si128(C2, c_mask)), cap);
+		__m128i	retval = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, RED_SHIFT_BITS), _mm_slli_epi32(g, GREEN_SHIFT_BITS)), b);
+	#if GREEN_SHIFT_BITS == 6
+		retval = _mm_or_si128(retval, _mm_slli_epi32(_mm_and_si128(g, _mm_set1_epi32(0x10)), 1));
+	#endif
+		return (retval);
+	}
+
+	static alwaysinline __m128i fn1_2 (__m128i C1, __m128i C2)
+	{
+		return (ColourMathSSE2<COLOR_ADD>::fn1_2(C1, C2));
+	}
+};
+#endif
+
+template<class Op, int HALF>
+static void ApplyColourMathLine (uint16 *S, const uint16 *Sub, const uint8 *SD, const uint8 *Mask)
+{
+	int	x = 0;
+
+#ifdef __SSE2__
+	typedef ColourMathSSE2<Op>	VOp;
+
+	const __m128i	zero = _mm_setzero_si128();
+	const __m128i	fixed = _mm_set1_epi32(GFX.FixedColour);
+	const __m128i	sd_bit = _mm_set1_epi32(0x20);
+	const __m128i	math_bit = _mm_set1_epi32(LINE_MATH);
+	const __m128i	clipped_bit = _mm_set1_epi32(LINE_MATH_CLIPPED);
+
+	for (; x + 8 <= SNES_WIDTH; x += 8)
+	{
+		uint64	any;
+
+		memcpy(&any, Mask + x, sizeof(any));
+		if (!any)
+			continue;
+
+		__m128i	main8 = _mm_loadu_si128((const __m128i *) (S + x));
+		__m128i	sub8 = _mm_loadu_si128((const __m128i *) (Sub + x));
+		__m128i	sd8 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (SD + x)), zero);
+		__m128i	mask8 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (Mask + x)), zero);
+		__m128i	out[2];
+
+		for (int h = 0; h < 2; h++)
 		{
-			i++;
-			if (Memory.FillRAM[0x2130] & 2)
-				i++;
+			__m128i	C1 = h ? _mm_unpackhi_epi16(main8, zero) : _mm_unpacklo_epi16(main8, zero);
+			__m128i	sub = h ? _mm_unpackhi_epi16(sub8, zero) : _mm_unpacklo_epi16(sub8, zero);
+			__m128i	sd = h ? _mm_unpackhi_epi16(sd8, zero) : _mm_unpacklo_epi16(sd8, zero);
+			__m128i	mask = h ? _mm_unpackhi_epi16(mask8, zero) : _mm_unpacklo_epi16(mask8, zero);
+
+			__m128i	use_sub = (HALF == HALF_FIXED) ? zero : _mm_cmpeq_epi32(_mm_and_si128(sd, sd_bit), sd_bit);
+			__m128i	C2 = _mm_or_si128(_mm_and_si128(use_sub, sub), _mm_andnot_si128(use_sub, fixed));
+			__m128i	retval = VOp::fn(C1, C2);
+
+			if (HALF != HALF_NEVER)
+			{
+				__m128i	half = _mm_cmpeq_epi32(_mm_and_si128(mask, clipped_bit), zero);
+				if (HALF == HALF_SUB)
+					half = _mm_and_si128(half, use_sub);
+				retval = _mm_or_si128(_mm_and_si128(half, VOp::fn1_2(C1, C2)), _mm_andnot_si128(half, retval));
+			}
+
+			__m128i	math = _mm_cmpeq_epi32(_mm_and_si128(mask, math_bit), math_bit);
+			retval = _mm_or_si128(_mm_and_si128(math, retval), _mm_andnot_si128(math, C1));
+
+			// sign extend so packing does not saturate
+			out[h] = _mm_srai_epi32(_mm_slli_epi32(retval, 16), 16);
 		}
-		if (IPPU.MaxBrightness != 0xf)
+
+		_mm_storeu_si128((__m128i *) (S + x), _mm_packs_epi32(out[0], out[1]));
+	}
+#endif
+
+	for (; x < SNES_WIDTH; x++)
+	{
+		if (!(Mask[x] & LINE_MATH))
+			continue;
+
+		bool8	use_sub = HALF != HALF_FIXED && (SD[x] & 0x20);
+		uint16	C2 = use_sub ? Sub[x] : GFX.FixedColour;
+
+		if (HALF != HALF_NEVER && !(Mask[x] & LINE_MATH_CLIPPED) && (HALF == HALF_FIXED || use_sub))
+			S[x] = Op::fn1_2(S[x], C2);
+		else
+			S[x] = Op::fn(S[x], C2);
+	}
+}
+
+void S9xApplyColourMath (void)
+{
+	void	(*ApplyLine) (uint16 *, const uint16 *, const uint8 *, const uint8 *);
+
+	switch (ColourMathOp())
+	{
+		case 1:	ApplyLine = ApplyColourMathLine<COLOR_ADD, HALF_NEVER>;				break;
+		case 2:	ApplyLine = ApplyColourMathLine<COLOR_ADD, HALF_FIXED>;				break;
+		case 3:	ApplyLine = ApplyColourMathLine<COLOR_ADD, HALF_SUB>;				break;
+		case 4:	ApplyLine = ApplyColourMathLine<COLOR_SUB, HALF_NEVER>;				break;
+		case 5:	ApplyLine = ApplyColourMathLine<COLOR_SUB, HALF_FIXED>;				break;
+		case 6:	ApplyLine = ApplyColourMathLine<COLOR_SUB, HALF_SUB>;				break;
+		case 7:	ApplyLine = ApplyColourMathLine<COLOR_ADD_BRIGHTNESS, HALF_NEVER>;	break;
+		case 8:	ApplyLine = ApplyColourMathLine<COLOR_ADD_BRIGHTNESS, HALF_SUB>;	break;
+		default:	return;
+	}
+
+	uint16	*S = GFX.Screen;
+	if (GFX.DoInterlace && GFX.InterlaceFrame)
+		S += GFX.RealPPL;
+
+	for (uint32 y = GFX.StartY; y <= GFX.EndY; y++)
+	{
+		uint32	Offset = y * GFX.PPL;
+		ApplyLine(S + Offset, GFX.SubScreen + Offset, GFX.SubZBuffer + Offset, GFX.MathMask + Offset);
+	}
+}
+
+// Tile cache.
+//
+// Every 16-byte line of VRAM has a generation that each write to it bumps,
+// so a write costs one increment whatever formats are cached. A converted
+// tile keeps the sum of the generations of the lines it was converted from
+// and is converted again once that no longer matches, see CachedTile. The
+// formats are only allocated once they are drawn with; with
+// TILE_CACHE_LIMIT set, formats that were not drawn with in the current
+// frame make room for new ones.
+
+#if defined(GEKKO) && !defined(HW_RVL)
+#define TILE_CACHE_LIMIT	(512 * 1024)
+#endif
+
+static const uint32	TileCacheTiles[7] =
+{
+	MAX_2BIT_TILES, MAX_4BIT_TILES, MAX_8BIT_TILES,
+	MAX_2BIT_TILES, MAX_2BIT_TILES, MAX_4BIT_TILES, MAX_4BIT_TILES
+};
+
+bool8 S9xInitTileCache (void)
+{
+	for (int t = 0; t < 7; t++)
+	{
+		IPPU.TileCache[t] = NULL;
+		IPPU.TileCached[t] = NULL;
+		IPPU.TileCacheUsed[t] = FALSE;
+	}
+
+	IPPU.VRAMGeneration = (uint32 *) memalign(32, MAX_2BIT_TILES * sizeof(uint32));
+	if (!IPPU.VRAMGeneration)
+		return (FALSE);
+
+	// a tile that was never converted has 0, which no sum of these matches
+	for (int i = 0; i < MAX_2BIT_TILES; i++)
+		IPPU.VRAMGeneration[i] = 1;
+
+	return (TRUE);
+}
+
+static void FreeTileCacheFormat (int t)
+{
+	// the converted tiles and their generations are one block
+	free(IPPU.TileCache[t]);
+	IPPU.TileCache[t] = NULL;
+	IPPU.TileCached[t] = NULL;
+}
+
+void S9xFreeTileCache (void)
+{
+	for (int t = 0; t < 7; t++)
+		FreeTileCacheFormat(t);
+
+	free(IPPU.VRAMGeneration);
+	IPPU.VRAMGeneration = NULL;
+}
+
+void S9xInvalidateTileCache (void)
+{
+	for (int i = 0; i < MAX_2BIT_TILES; i++)
+		IPPU.VRAMGeneration[i]++;
+}
+
+void S9xTileCacheStartFrame (void)
+{
+	memset(IPPU.TileCacheUsed, FALSE, sizeof(IPPU.TileCacheUsed));
+}
+
+// keep is the other half of a hires pair, or t itself
+static bool8 UseTileCacheFormat (int t, int keep)
+{
+	IPPU.TileCacheUsed[t] = TRUE;
+
+	if (IPPU.TileCache[t])
+		return (TRUE);
+
+	uint32	size = TileCacheTiles[t] * (64 + sizeof(uint32));
+
+#ifdef TILE_CACHE_LIMIT
+	uint32	total = size;
+
+	for (int i = 0; i < 7; i++)
+		if (IPPU.TileCache[i])
+			total += TileCacheTiles[i] * (64 + sizeof(uint32));
+
+	for (int i = 0; i < 7 && total > TILE_CACHE_LIMIT; i++)
+	{
+		if (IPPU.TileCache[i] && !IPPU.TileCacheUsed[i])
 		{
-			if (i == 1)
-				i = 7;
-			else if (i == 3)
-				i = 8;
+			total -= TileCacheTiles[i] * (64 + sizeof(uint32));
+			FreeTileCacheFormat(i);
 		}
+	}
+#endif
 
+	uint8	*block = (uint8 *) memalign(32, size);
+	if (!block)
+	{
+		// the layers drawn before this one are done with their formats
+		for (int i = 0; i < 7; i++)
+			if (i != keep)
+				FreeTileCacheFormat(i);
+
+		block = (uint8 *) memalign(32, size);
+		if (!block)
+			return (FALSE);
 	}
 
-	GFX.DrawTileMath        = DT[i];
-	GFX.DrawClippedTileMath = DCT[i];
-	GFX.DrawMosaicPixelMath = DMP[i];
-	GFX.DrawBackdropMath    = DB[i];
-	GFX.DrawMode7BG1Math    = DM7BG1[i];
-	GFX.DrawMode7BG2Math    = DM7BG2[i];
+	IPPU.TileCache[t] = block;
+	IPPU.TileCached[t] = (uint32 *) (block + TileCacheTiles[t] * 64);
+	memset(IPPU.TileCached[t], 0, TileCacheTiles[t] * sizeof(uint32));
+
+	return (TRUE);
 }
 
-void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
+// FALSE when there is no memory for the tiles, the layer is then left out
+bool8 S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 {
 	switch (depth)
 	{
 		case 8:
-			BG.ConvertTile      = BG.ConvertTileFlip = ConvertTile8;
+			if (!UseTileCacheFormat(TILE_8BIT, TILE_8BIT))
+				return (FALSE);
+
+			BG.ConvertTile      = BG.ConvertTileFlip = Converters->Tile8;
 			BG.Buffer           = BG.BufferFlip      = IPPU.TileCache[TILE_8BIT];
 			BG.Buffered         = BG.BufferedFlip    = IPPU.TileCached[TILE_8BIT];
 			BG.TileShift        = 6;
+			BG.TileLines        = 4;
 			BG.PaletteShift     = 0;
 			BG.PaletteMask      = 0;
-			BG.DirectColourMode = Memory.FillRAM[0x2130] & 1;
+			BG.DirectColourMode = GFX.FillRAM[0x2130] & 1;
 
 			break;
 
 		case 4:
 			if (hires)
 			{
+				if (!UseTileCacheFormat(TILE_4BIT_EVEN, TILE_4BIT_ODD) || !UseTileCacheFormat(TILE_4BIT_ODD, TILE_4BIT_EVEN))
+					return (FALSE);
+
 				if (sub || mosaic)
 				{
-					BG.ConvertTile     = ConvertTile4h_even;
+					BG.ConvertTile     = Converters->Tile4h_even;
 					BG.Buffer          = IPPU.TileCache[TILE_4BIT_EVEN];
 					BG.Buffered        = IPPU.TileCached[TILE_4BIT_EVEN];
-					BG.ConvertTileFlip = ConvertTile4h_odd;
+					BG.ConvertTileFlip = Converters->Tile4h_odd;
 					BG.BufferFlip      = IPPU.TileCache[TILE_4BIT_ODD];
 					BG.BufferedFlip    = IPPU.TileCached[TILE_4BIT_ODD];
 				}
 				else
 				{
-					BG.ConvertTile     = ConvertTile4h_odd;
+					BG.ConvertTile     = Converters->Tile4h_odd;
 					BG.Buffer          = IPPU.TileCache[TILE_4BIT_ODD];
 					BG.Buffered        = IPPU.TileCached[TILE_4BIT_ODD];
-					BG.ConvertTileFlip = ConvertTile4h_even;
+					BG.ConvertTileFlip = Converters->Tile4h_even;
 					BG.BufferFlip      = IPPU.TileCache[TILE_4BIT_EVEN];
 					BG.BufferedFlip    = IPPU.TileCached[TILE_4BIT_EVEN];
 				}
+
+				// with the tile after it
+				BG.TileLines = 4;
 			}
 			else
 			{
-				BG.ConvertTile = BG.ConvertTileFlip = ConvertTile4;
+				if (!UseTileCacheFormat(TILE_4BIT, TILE_4BIT))
+					return (FALSE);
+
+				BG.ConvertTile = BG.ConvertTileFlip = Converters->Tile4;
 				BG.Buffer      = BG.BufferFlip      = IPPU.TileCache[TILE_4BIT];
 				BG.Buffered    = BG.BufferedFlip    = IPPU.TileCached[TILE_4BIT];
+				BG.TileLines   = 2;
 			}
 
 			BG.TileShift        = 5;
@@ -495,30 +1099,40 @@ void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 		case 2:
 			if (hires)
 			{
+				if (!UseTileCacheFormat(TILE_2BIT_EVEN, TILE_2BIT_ODD) || !UseTileCacheFormat(TILE_2BIT_ODD, TILE_2BIT_EVEN))
+					return (FALSE);
+
 				if (sub || mosaic)
 				{
-					BG.ConvertTile     = ConvertTile2h_even;
+					BG.ConvertTile     = Converters->Tile2h_even;
 					BG.Buffer          = IPPU.TileCache[TILE_2BIT_EVEN];
 					BG.Buffered        = IPPU.TileCached[TILE_2BIT_EVEN];
-					BG.ConvertTileFlip = ConvertTile2h_odd;
+					BG.ConvertTileFlip = Converters->Tile2h_odd;
 					BG.BufferFlip      = IPPU.TileCache[TILE_2BIT_ODD];
 					BG.BufferedFlip    = IPPU.TileCached[TILE_2BIT_ODD];
 				}
 				else
 				{
-					BG.ConvertTile     = ConvertTile2h_odd;
+					BG.ConvertTile     = Converters->Tile2h_odd;
 					BG.Buffer          = IPPU.TileCache[TILE_2BIT_ODD];
 					BG.Buffered        = IPPU.TileCached[TILE_2BIT_ODD];
-					BG.ConvertTileFlip = ConvertTile2h_even;
+					BG.ConvertTileFlip = Converters->Tile2h_even;
 					BG.BufferFlip      = IPPU.TileCache[TILE_2BIT_EVEN];
 					BG.BufferedFlip    = IPPU.TileCached[TILE_2BIT_EVEN];
 				}
+
+				// with the tile after it
+				BG.TileLines = 2;
 			}
 			else
 			{
-				BG.ConvertTile = BG.ConvertTileFlip = ConvertTile2;
+				if (!UseTileCacheFormat(TILE_2BIT, TILE_2BIT))
+					return (FALSE);
+
+				BG.ConvertTile = BG.ConvertTileFlip = Converters->Tile2;
 				BG.Buffer      = BG.BufferFlip      = IPPU.TileCache[TILE_2BIT];
 				BG.Buffered    = BG.BufferedFlip    = IPPU.TileCached[TILE_2BIT];
+				BG.TileLines   = 1;
 			}
 
 			BG.TileShift        = 4;
@@ -528,4 +1142,169 @@ void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 
 			break;
 	}
+
+	return (TRUE);
+}
+
+// Mode 7 lines.
+//
+// What a Mode 7 line shows only depends on its matrix, centre and scroll, on
+// M7SEL and on the first 32K of VRAM, so every line keeps the texels it was
+// fetched with and is only fetched again once one of those has changed. BG1
+// and BG2 of EXTBG, the main screen and the subscreen and every clip window
+// of a line draw from the same fetch.
+
+#define MODE7_VRAM_LINES	(0x8000 >> 4)
+
+#define CLIP_10_BIT_SIGNED(a)	(((a) & 0x2000) ? ((a) | ~0x3ff) : ((a) & 0x3ff))
+
+struct SMode7Line
+{
+	struct SLineMatrixData	Matrix;
+	uint32	VRAM;			// the VRAMGeneration sum it was fetched at, 0 if never
+	uint8	Repeat;
+	uint8	VFlip;
+	uint8	Texels[MODE7_LINE_TEXELS];
+};
+
+static RENDER_LOCAL struct SMode7Line	Mode7Lines[240];
+static RENDER_LOCAL uint32				Mode7VRAM;
+
+void S9xStartMode7Update (void)
+{
+	const uint32	*gen = IPPU.VRAMGeneration;
+	uint32			sum = 0;
+
+	// generations only grow, so the sum changes with any write to them
+	for (int i = 0; i < MODE7_VRAM_LINES; i++)
+		sum += gen[i];
+
+	Mode7VRAM = sum ? sum : 1;
+}
+
+// The texel at x is the one the renderer used to step to from Left at x,
+// or from Right - 1 with the matrix negated when M7SEL flips horizontally.
+static void FetchMode7Line (struct SMode7Line *m, uint32 Line)
+{
+	const struct SLineMatrixData	*l = &LineMatrixData[Line];
+	const uint8	*VRAM = GFX.VRAM, *VRAM1 = GFX.VRAM + 1;
+	uint8		*out = m->Texels;
+	int			yy, starty;
+
+	int32	HOffset = ((int32) l->M7HOFS  << 19) >> 19;
+	int32	VOffset = ((int32) l->M7VOFS  << 19) >> 19;
+
+	int32	CentreX = ((int32) l->CentreX << 19) >> 19;
+	int32	CentreY = ((int32) l->CentreY << 19) >> 19;
+
+	if (PPU.Mode7VFlip)
+		starty = 255 - (int) (Line + 1);
+	else
+		starty = Line + 1;
+
+	yy = CLIP_10_BIT_SIGNED(VOffset - CentreY);
+
+	int	BB = ((l->MatrixB * starty) & ~63) + ((l->MatrixB * yy) & ~63) + (CentreX << 8);
+	int	DD = ((l->MatrixD * starty) & ~63) + ((l->MatrixD * yy) & ~63) + (CentreY << 8);
+
+	int	xx = CLIP_10_BIT_SIGNED(HOffset - CentreX);
+	int	AA = ((l->MatrixA * xx) & ~63) + BB;
+	int	CC = ((l->MatrixC * xx) & ~63) + DD;
+	int	aa = l->MatrixA, cc = l->MatrixC;
+
+	int	x = 0;
+
+#ifdef __SSE2__
+	// eight texel addresses at a time, the fetches themselves stay scalar
+	alignas(16) int32	map[8], fine[8];
+	const __m128i		mask10 = _mm_set1_epi32(0x3ff);
+	const __m128i		mask3 = _mm_set1_epi32(7);
+	__m128i				vx = _mm_setr_epi32(AA, AA + aa, AA + 2 * aa, AA + 3 * aa);
+	__m128i				vy = _mm_setr_epi32(CC, CC + cc, CC + 2 * cc, CC + 3 * cc);
+	const __m128i		dx = _mm_set1_epi32(4 * aa), dy = _mm_set1_epi32(4 * cc);
+
+	for (; x < MODE7_LINE_TEXELS; x += 8, out += 8)
+	{
+		int	outside = 0;
+
+		for (int h = 0; h < 2; h++)
+		{
+			__m128i	X = _mm_srai_epi32(vx, 8);
+			__m128i	Y = _mm_srai_epi32(vy, 8);
+
+			if (!PPU.Mode7Repeat)
+			{
+				X = _mm_and_si128(X, mask10);
+				Y = _mm_and_si128(Y, mask10);
+			}
+			else
+				outside |= (0xf ^ _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_andnot_si128(mask10, _mm_or_si128(X, Y)), _mm_setzero_si128())))) << (h * 4);
+
+			__m128i	m = _mm_add_epi32(_mm_slli_epi32(_mm_andnot_si128(mask3, Y), 5), _mm_andnot_si128(_mm_set1_epi32(1), _mm_srai_epi32(X, 2)));
+			__m128i	f = _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(Y, mask3), 4), _mm_slli_epi32(_mm_and_si128(X, mask3), 1));
+
+			_mm_store_si128((__m128i *) (map + h * 4), m);
+			_mm_store_si128((__m128i *) (fine + h * 4), f);
+
+			vx = _mm_add_epi32(vx, dx);
+			vy = _mm_add_epi32(vy, dy);
+		}
+
+		if (!outside)
+		{
+			for (int k = 0; k < 8; k++)
+				out[k] = VRAM1[(VRAM[map[k]] << 7) + fine[k]];
+		}
+		else
+		{
+			for (int k = 0; k < 8; k++)
+			{
+				if (!(outside & (1 << k)))
+					out[k] = VRAM1[(VRAM[map[k]] << 7) + fine[k]];
+				else
+				if (PPU.Mode7Repeat == 3)
+					out[k] = VRAM1[fine[k]];
+				else
+					out[k] = 0;
+			}
+		}
+	}
+#endif
+
+	for (AA += x * aa, CC += x * cc; x < MODE7_LINE_TEXELS; x++, AA += aa, CC += cc)
+	{
+		int	X = AA >> 8;
+		int	Y = CC >> 8;
+
+		if (!PPU.Mode7Repeat)
+		{
+			X &= 0x3ff;
+			Y &= 0x3ff;
+		}
+		else
+		if ((X | Y) & ~0x3ff)
+		{
+			*out++ = (PPU.Mode7Repeat == 3) ? VRAM1[((Y & 7) << 4) + ((X & 7) << 1)] : 0;
+			continue;
+		}
+
+		*out++ = VRAM1[(VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7) + ((Y & 7) << 4) + ((X & 7) << 1)];
+	}
+}
+
+const uint8 * S9xMode7Line (uint32 Line)
+{
+	struct SMode7Line	*m = &Mode7Lines[Line];
+
+	if (m->VRAM != Mode7VRAM || m->Repeat != PPU.Mode7Repeat || m->VFlip != PPU.Mode7VFlip ||
+		memcmp(&m->Matrix, &LineMatrixData[Line], sizeof(m->Matrix)))
+	{
+		FetchMode7Line(m, Line);
+		m->Matrix = LineMatrixData[Line];
+		m->VRAM = Mode7VRAM;
+		m->Repeat = PPU.Mode7Repeat;
+		m->VFlip = PPU.Mode7VFlip;
+	}
+
+	return (m->Texels);
 }
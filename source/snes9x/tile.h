@@ -7,8 +7,34 @@
 #ifndef _TILE_H_
 #define _TILE_H_
 
+// Tile converter implementations for S9xSetTileConverters. They all produce
+// the same tile cache, S9xInitTileRenderer picks the fastest one available.
+#define TILE_CONVERTER_TABLE	0	// pixbit table lookups
+#define TILE_CONVERTER_SWAR		1	// 32-bit bit matrix transpose, used on the consoles
+#define TILE_CONVERTER_SSE2		2
+#define TILE_CONVERTER_AVX2		3	// detected at run time
+
 void S9xInitTileRenderer (void);
+bool8 S9xSetTileConverters (int);
 void S9xSelectTileRenderers (int, bool8, bool8);
-void S9xSelectTileConverter (int, bool8, bool8, bool8);
+bool8 S9xSelectTileConverter (int, bool8, bool8, bool8);
+// With Settings.LineColourMath the main screen is drawn without colour math,
+// GFX.MathMask keeps what each pixel owes and S9xApplyColourMath settles it
+// for GFX.StartY to GFX.EndY once the main screen is done.
+#define LINE_MATH			1	// the pixel is mathed with the subscreen or the fixed colour
+#define LINE_MATH_CLIPPED	2	// its colour was clipped by the colour window, no half math
+bool8 S9xLineColourMath (void);
+void S9xApplyColourMath (void);
+bool8 S9xInitTileCache (void);
+void S9xFreeTileCache (void);
+// Drops every converted tile.
+void S9xInvalidateTileCache (void);
+void S9xTileCacheStartFrame (void);
+// Mode 7 texels of a line by screen x, past 255 for the mosaic blocks that
+// stick out on the right. S9xStartMode7Update checks VRAM for changes once
+// per update, before any line is drawn.
+#define MODE7_LINE_TEXELS	(256 + 16)
+void S9xStartMode7Update (void);
+const uint8 * S9xMode7Line (uint32);
 
 #endif
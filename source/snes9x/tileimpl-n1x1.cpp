@@ -20,6 +20,18 @@ namespace TileImpl {
 		}
 	}
 
+	template<class MATH, class BPSTART>
+	void Deferred1x1Base<MATH, BPSTART>::Draw(int N, int M, uint32 Offset, uint32 OffsetInLine, uint8 Pix, uint8 Z1, uint8 Z2)
+	{
+		(void) OffsetInLine;
+		if (Z1 > GFX.DB[Offset + N] && (M))
+		{
+			GFX.S[Offset + N] = GFX.ScreenColors[Pix];
+			GFX.MathMask[Offset + N] = MATH::Mask();
+			GFX.DB[Offset + N] = Z2;
+		}
+	}
+
 
 	// normal width
 	template struct Renderers<DrawTile16, Normal1x1>;
@@ -31,4 +43,14 @@ namespace TileImpl {
 	template struct Renderers<DrawMode7MosaicBG2, Normal1x1>;
 	template struct Renderers<DrawMode7BG2, Normal1x1>;
 
+	// normal width, colour math done by S9xApplyColourMath
+	template struct Renderers<DrawTile16, Deferred1x1>;
+	template struct Renderers<DrawClippedTile16, Deferred1x1>;
+	template struct Renderers<DrawMosaicPixel16, Deferred1x1>;
+	template struct Renderers<DrawBackdrop16, Deferred1x1>;
+	template struct Renderers<DrawMode7MosaicBG1, Deferred1x1>;
+	template struct Renderers<DrawMode7BG1, Deferred1x1>;
+	template struct Renderers<DrawMode7MosaicBG2, Deferred1x1>;
+	template struct Renderers<DrawMode7BG2, Deferred1x1>;
+
 } // namespace TileImpl
@@ -11,7 +11,7 @@
 #include "ppu.h"
 #include "tile.h"
 
-extern struct SLineMatrixData	LineMatrixData[240];
+extern RENDER_LOCAL struct SLineMatrixData	LineMatrixData[240];
 
 
 namespace TileImpl {
@@ -45,6 +45,21 @@ namespace TileImpl {
 	struct Normal1x1 : public Normal1x1Base<MATH, BPProgressive> {};
 
 
+	// The 1x1 pixel plotter for Settings.LineColourMath. It draws the main pixel as it is
+	// and leaves the math that is to be done on it in GFX.MathMask for S9xApplyColourMath.
+	template<class MATH, class BPSTART>
+	struct Deferred1x1Base
+	{
+		enum { Pitch = BPSTART::Pitch };
+		typedef BPSTART bpstart_t;
+
+		static void Draw(int N, int M, uint32 Offset, uint32 OffsetInLine, uint8 Pix, uint8 Z1, uint8 Z2);
+	};
+
+	template<class MATH>
+	struct Deferred1x1 : public Deferred1x1Base<MATH, BPProgressive> {};
+
+
 	// The 2x1 pixel plotter, for normal rendering when we've used hires/interlace already this frame.
 	template<class MATH, class BPSTART>
 	struct Normal2x1Base
@@ -96,23 +111,40 @@ namespace TileImpl {
 				TileAddr += BG.NameSelect;
 			TileAddr &= 0xffff;
 			TileNumber = TileAddr >> BG.TileShift;
+
+			// A converted tile keeps the sum of the generations of the lines
+			// it was converted from, in the bits above its TRUE or BLANK_TILE.
+			// Generations only grow, so the sum changes with any write to them.
+			const uint32	*gen = IPPU.VRAMGeneration;
+			uint32			line = TileAddr >> 4;
+			uint32			sum = gen[line];
+
+			if (BG.TileLines > 1)
+			{
+				sum += gen[(line + 1) & (MAX_2BIT_TILES - 1)];
+				if (BG.TileLines > 2)
+					sum += gen[(line + 2) & (MAX_2BIT_TILES - 1)] + gen[(line + 3) & (MAX_2BIT_TILES - 1)];
+			}
+
+			sum <<= 2;
+
 			if (Tile & H_FLIP)
 			{
 				pCache = &BG.BufferFlip[TileNumber << 6];
-				if (!BG.BufferedFlip[TileNumber])
-					BG.BufferedFlip[TileNumber] = BG.ConvertTileFlip(pCache, TileAddr, Tile & 0x3ff);
+				if ((BG.BufferedFlip[TileNumber] & ~3) != sum)
+					BG.BufferedFlip[TileNumber] = sum | BG.ConvertTileFlip(pCache, TileAddr, Tile & 0x3ff);
 			}
 			else
 			{
 				pCache = &BG.Buffer[TileNumber << 6];
-				if (!BG.Buffered[TileNumber])
-					BG.Buffered[TileNumber] = BG.ConvertTile(pCache, TileAddr, Tile & 0x3ff);
+				if ((BG.Buffered[TileNumber] & ~3) != sum)
+					BG.Buffered[TileNumber] = sum | BG.ConvertTile(pCache, TileAddr, Tile & 0x3ff);
 			}
 		}
 
 		alwaysinline bool IsBlankTile() const
 		{
-			return ((Tile & H_FLIP) ? BG.BufferedFlip[TileNumber] : BG.Buffered[TileNumber]) == BLANK_TILE;
+			return (((Tile & H_FLIP) ? BG.BufferedFlip[TileNumber] : BG.Buffered[TileNumber]) & 3) == BLANK_TILE;
 		}
 
 		alwaysinline void SelectPalette() const
@@ -145,6 +177,11 @@ namespace TileImpl {
 		{
 			return Main;
 		}
+
+		static alwaysinline uint8 Mask()
+		{
+			return 0;
+		}
 	};
 	typedef NOMATH Blend_None;
 
@@ -155,6 +192,11 @@ namespace TileImpl {
 		{
 			return Op::fn(Main, (SD & 0x20) ? Sub : GFX.FixedColour);
 		}
+
+		static alwaysinline uint8 Mask()
+		{
+			return GFX.ClipColors ? (LINE_MATH | LINE_MATH_CLIPPED) : LINE_MATH;
+		}
 	};
 	typedef REGMATH<COLOR_ADD> Blend_Add;
 	typedef REGMATH<COLOR_SUB> Blend_Sub;
@@ -167,6 +209,11 @@ namespace TileImpl {
 		{
 			return GFX.ClipColors ? Op::fn(Main, GFX.FixedColour) : Op::fn1_2(Main, GFX.FixedColour);
 		}
+
+		static alwaysinline uint8 Mask()
+		{
+			return GFX.ClipColors ? (LINE_MATH | LINE_MATH_CLIPPED) : LINE_MATH;
+		}
 	};
 	typedef MATHF1_2<COLOR_ADD> Blend_AddF1_2;
 	typedef MATHF1_2<COLOR_SUB> Blend_SubF1_2;
@@ -178,6 +225,11 @@ namespace TileImpl {
 		{
 			return GFX.ClipColors ? REGMATH<Op>::Calc(Main, Sub, SD) : (SD & 0x20) ? Op::fn1_2(Main, Sub) : Op::fn(Main, GFX.FixedColour);
 		}
+
+		static alwaysinline uint8 Mask()
+		{
+			return GFX.ClipColors ? (LINE_MATH | LINE_MATH_CLIPPED) : LINE_MATH;
+		}
 	};
 	typedef MATHS1_2<COLOR_ADD> Blend_AddS1_2;
 	typedef MATHS1_2<COLOR_SUB> Blend_SubS1_2;
@@ -504,8 +556,6 @@ namespace TileImpl {
 	//     MASK is 0xff or 0x7f, the 'color' portion of the pixel.
 	// We define Z1/Z2 to either be constant 5 or to vary depending on the 'priority' portion of the pixel.
 
-	#define CLIP_10_BIT_SIGNED(a)	(((a) & 0x2000) ? ((a) | ~0x3ff) : ((a) & 0x3ff))
-
 	#define DRAW_PIXEL(N, M) PIXEL::Draw(N, M, Offset, OffsetInLine, Pix, OP::Z1(D, b), OP::Z2(D, b))
 
 	struct DrawMode7BG1_OP
@@ -516,7 +566,7 @@ namespace TileImpl {
 		};
 		static uint8 Z1(int D, uint8 b) { return D + 7; }
 		static uint8 Z2(int D, uint8 b) { return D + 7; }
-		static uint8 DCMODE() { return Memory.FillRAM[0x2130] & 1; }
+		static uint8 DCMODE() { return GFX.FillRAM[0x2130] & 1; }
 	};
 	struct DrawMode7BG2_OP
 	{
@@ -529,6 +579,9 @@ namespace TileImpl {
 		static uint8 DCMODE() { return 0; }
 	};
 
+	// The texels of a line come from S9xMode7Line, which only fetches them
+	// again once something they depend on has changed. A horizontal flip
+	// reads them backwards from the right edge of the span.
 	template<class PIXEL, class OP>
 	struct DrawTileNormal
 	{
@@ -536,8 +589,6 @@ namespace TileImpl {
 
 		static void Draw(uint32 Left, uint32 Right, int D)
 		{
-			uint8	*VRAM1 = Memory.VRAM + 1;
-
 			if (OP::DCMODE())
 			{
 				GFX.RealScreenColors = DirectColourMaps[0];
@@ -547,87 +598,23 @@ namespace TileImpl {
 
 			GFX.ScreenColors = GFX.ClipColors ? BlackColourMap : GFX.RealScreenColors;
 
-			int	aa, cc;
-			int	startx;
+			int32	startx = PPU.Mode7HFlip ? Right - 1 : Left;
+			int32	step = PPU.Mode7HFlip ? -1 : 1;
 
 			uint32	Offset = GFX.StartY * GFX.PPL;
-			struct SLineMatrixData	*l = &LineMatrixData[GFX.StartY];
 
 			OFFSET_IN_LINE;
-			for (uint32 Line = GFX.StartY; Line <= GFX.EndY; Line++, Offset += GFX.PPL, l++)
+			for (uint32 Line = GFX.StartY; Line <= GFX.EndY; Line++, Offset += GFX.PPL)
 			{
-				int	yy, starty;
-
-				int32	HOffset = ((int32) l->M7HOFS  << 19) >> 19;
-				int32	VOffset = ((int32) l->M7VOFS  << 19) >> 19;
+				const uint8	*Texels = S9xMode7Line(Line);
+				int32		s = startx;
+				uint8		Pix;
 
-				int32	CentreX = ((int32) l->CentreX << 19) >> 19;
-				int32	CentreY = ((int32) l->CentreY << 19) >> 19;
-
-				if (PPU.Mode7VFlip)
-					starty = 255 - (int) (Line + 1);
-				else
-					starty = Line + 1;
-
-				yy = CLIP_10_BIT_SIGNED(VOffset - CentreY);
-
-				int	BB = ((l->MatrixB * starty) & ~63) + ((l->MatrixB * yy) & ~63) + (CentreX << 8);
-				int	DD = ((l->MatrixD * starty) & ~63) + ((l->MatrixD * yy) & ~63) + (CentreY << 8);
-
-				if (PPU.Mode7HFlip)
-				{
-					startx = Right - 1;
-					aa = -l->MatrixA;
-					cc = -l->MatrixC;
-				}
-				else
+				for (uint32 x = Left; x < Right; x++, s += step)
 				{
-					startx = Left;
-					aa = l->MatrixA;
-					cc = l->MatrixC;
-				}
-
-				int	xx = CLIP_10_BIT_SIGNED(HOffset - CentreX);
-				int	AA = l->MatrixA * startx + ((l->MatrixA * xx) & ~63);
-				int	CC = l->MatrixC * startx + ((l->MatrixC * xx) & ~63);
+					uint8	b = Texels[s];
 
-				uint8	Pix;
-
-				if (!PPU.Mode7Repeat)
-				{
-					for (uint32 x = Left; x < Right; x++, AA += aa, CC += cc)
-					{
-						int	X = ((AA + BB) >> 8) & 0x3ff;
-						int	Y = ((CC + DD) >> 8) & 0x3ff;
-
-						uint8	*TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7);
-						uint8	b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1));
-
-						Pix = b & OP::MASK; DRAW_PIXEL(x, Pix);
-					}
-				}
-				else
-				{
-					for (uint32 x = Left; x < Right; x++, AA += aa, CC += cc)
-					{
-						int	X = ((AA + BB) >> 8);
-						int	Y = ((CC + DD) >> 8);
-
-						uint8	b;
-
-						if (((X | Y) & ~0x3ff) == 0)
-						{
-							uint8	*TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7);
-							b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1));
-						}
-						else
-						if (PPU.Mode7Repeat == 3)
-							b = *(VRAM1    + ((Y & 7) << 4) + ((X & 7) << 1));
-						else
-							continue;
-
-						Pix = b & OP::MASK; DRAW_PIXEL(x, Pix);
-					}
+					Pix = b & OP::MASK; DRAW_PIXEL(x, Pix);
 				}
 			}
 		}
@@ -645,8 +632,6 @@ namespace TileImpl {
 
 		static void Draw(uint32 Left, uint32 Right, int D)
 		{
-			uint8	*VRAM1 = Memory.VRAM + 1;
-
 			if (OP::DCMODE())
 			{
 				GFX.RealScreenColors = DirectColourMaps[0];
@@ -656,8 +641,7 @@ namespace TileImpl {
 
 			GFX.ScreenColors = GFX.ClipColors ? BlackColourMap : GFX.RealScreenColors;
 
-			int	aa, cc;
-			int	startx, StartY = GFX.StartY;
+			int	StartY = GFX.StartY;
 
 			int		HMosaic = 1, VMosaic = 1, MosaicStart = 0;
 			int32	MLeft = Left, MRight = Right;
@@ -677,108 +661,31 @@ namespace TileImpl {
 				MRight -= MRight % HMosaic;
 			}
 
+			int32	startx = PPU.Mode7HFlip ? MRight - 1 : MLeft;
+			int32	step = PPU.Mode7HFlip ? -HMosaic : HMosaic;
+
 			uint32	Offset = StartY * GFX.PPL;
-			struct SLineMatrixData	*l = &LineMatrixData[StartY];
 
 			OFFSET_IN_LINE;
-			for (uint32 Line = StartY; Line <= GFX.EndY; Line += VMosaic, Offset += VMosaic * GFX.PPL, l += VMosaic)
+			for (uint32 Line = StartY; Line <= GFX.EndY; Line += VMosaic, Offset += VMosaic * GFX.PPL)
 			{
 				if (Line + VMosaic > GFX.EndY)
 					VMosaic = GFX.EndY - Line + 1;
 
-				int	yy, starty;
-
-				int32	HOffset = ((int32) l->M7HOFS  << 19) >> 19;
-				int32	VOffset = ((int32) l->M7VOFS  << 19) >> 19;
+				const uint8	*Texels = S9xMode7Line(Line);
+				int32		s = startx;
+				uint8		Pix;
 
-				int32	CentreX = ((int32) l->CentreX << 19) >> 19;
-				int32	CentreY = ((int32) l->CentreY << 19) >> 19;
-
-				if (PPU.Mode7VFlip)
-					starty = 255 - (int) (Line + 1);
-				else
-					starty = Line + 1;
-
-				yy = CLIP_10_BIT_SIGNED(VOffset - CentreY);
-
-				int	BB = ((l->MatrixB * starty) & ~63) + ((l->MatrixB * yy) & ~63) + (CentreX << 8);
-				int	DD = ((l->MatrixD * starty) & ~63) + ((l->MatrixD * yy) & ~63) + (CentreY << 8);
-
-				if (PPU.Mode7HFlip)
+				for (int32 x = MLeft; x < MRight; x += HMosaic, s += step)
 				{
-					startx = MRight - 1;
-					aa = -l->MatrixA;
-					cc = -l->MatrixC;
-				}
-				else
-				{
-					startx = MLeft;
-					aa = l->MatrixA;
-					cc = l->MatrixC;
-				}
-
-				int	xx = CLIP_10_BIT_SIGNED(HOffset - CentreX);
-				int	AA = l->MatrixA * startx + ((l->MatrixA * xx) & ~63);
-				int	CC = l->MatrixC * startx + ((l->MatrixC * xx) & ~63);
-
-				uint8	Pix;
-				uint8	ctr = 1;
-
-				if (!PPU.Mode7Repeat)
-				{
-					for (int32 x = MLeft; x < MRight; x++, AA += aa, CC += cc)
-					{
-						if (--ctr)
-							continue;
-						ctr = HMosaic;
-
-						int	X = ((AA + BB) >> 8) & 0x3ff;
-						int	Y = ((CC + DD) >> 8) & 0x3ff;
+					uint8	b = Texels[s];
 
-						uint8	*TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7);
-						uint8	b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1));
-
-						if ((Pix = (b & OP::MASK)))
-						{
-							for (int32 h = MosaicStart; h < VMosaic; h++)
-							{
-								for (int32 w = x + HMosaic - 1; w >= x; w--)
-									DRAW_PIXEL(w + h * GFX.PPL, (w >= (int32) Left && w < (int32) Right));
-							}
-						}
-					}
-				}
-				else
-				{
-					for (int32 x = MLeft; x < MRight; x++, AA += aa, CC += cc)
+					if ((Pix = (b & OP::MASK)))
 					{
-						if (--ctr)
-							continue;
-						ctr = HMosaic;
-
-						int	X = ((AA + BB) >> 8);
-						int	Y = ((CC + DD) >> 8);
-
-						uint8	b;
-
-						if (((X | Y) & ~0x3ff) == 0)
-						{
-							uint8	*TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7);
-							b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1));
-						}
-						else
-						if (PPU.Mode7Repeat == 3)
-							b = *(VRAM1    + ((Y & 7) << 4) + ((X & 7) << 1));
-						else
-							continue;
-
-						if ((Pix = (b & OP::MASK)))
+						for (int32 h = MosaicStart; h < VMosaic; h++)
 						{
-							for (int32 h = MosaicStart; h < VMosaic; h++)
-							{
-								for (int32 w = x + HMosaic - 1; w >= x; w--)
-									DRAW_PIXEL(w + h * GFX.PPL, (w >= (int32) Left && w < (int32) Right));
-							}
+							for (int32 w = x + HMosaic - 1; w >= x; w--)
+								DRAW_PIXEL(w + h * GFX.PPL, (w >= (int32) Left && w < (int32) Right));
 						}
 					}
 				}
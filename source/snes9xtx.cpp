@@ -15,6 +15,7 @@
 #include <gccore.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <malloc.h>
 #include <string.h>
 #include <string>
 #include <ogcsys.h>
@@ -51,6 +52,9 @@
 #include "snes9x/memmap.h"
 #include "snes9x/apu/apu.h"
 #include "snes9x/controls.h"
+#include "snes9x/rewind.h"
+
+#define REWIND_ARENA_SIZE (8*1024*1024)
 
 int ScreenshotRequested = 0;
 int ConfigRequested = 0;
@@ -60,6 +64,9 @@ int ExitRequested = 0;
 bool isWiiVC = false;
 char appPath[1024] = { 0 };
 bool firstRun = true;
+#ifdef HW_RVL
+static uint8 *rewindArena = NULL;
+#endif
 
 extern "C" {
 #ifdef USE_VM
@@ -559,17 +566,47 @@ int main(int argc, char *argv[])
 
 		AudioStart();
 
-		FrameTimer = 0;
+		S9xInitSync(); // restart frame pacing
 		setFrameTimerMethod(); // set frametimer method every time a ROM is loaded
 
 		CheckVideo = 2;		// force video update
 		prevRenderedFrameCount = IPPU.RenderedFramesCount;
 
+		#ifdef HW_RVL
+		// the history is dropped whenever the menu was open, since a state
+		// may have been loaded or the game reset or changed in the meantime
+		if (GCSettings.Rewind == 1 && !rewindArena)
+		{
+			rewindArena = (uint8 *)memalign(32, REWIND_ARENA_SIZE);
+			if (rewindArena && !S9xRewindInit(rewindArena, REWIND_ARENA_SIZE, REWIND_DEFAULT_INTERVAL, REWIND_DEFAULT_KEYFRAMES))
+			{
+				free(rewindArena);
+				rewindArena = NULL;
+			}
+		}
+		else if (GCSettings.Rewind != 1 && rewindArena)
+		{
+			// stops the captures as well, they do nothing without a buffer
+			S9xRewindDeinit();
+			free(rewindArena);
+			rewindArena = NULL;
+		}
+		S9xRewindReset();
+		#endif
+
 		while(1) // emulation loop
 		{
+			// while the button is held, every frame shown steps back one capture,
+			// so the game runs backwards at REWIND_DEFAULT_INTERVAL times speed
+			if (Settings.Rewinding)
+				S9xRewindStep();
+
 			S9xMainLoop();
 			ReportButtons();
 
+			if (!Settings.Rewinding)
+				S9xRewindCapture();
+
 			if (ResetRequested)
 			{
 				S9xSoftReset(); // reset game
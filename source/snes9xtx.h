@@ -134,6 +134,8 @@ struct SGCSettings{
 	int		Controller;
 	int		FastForward;
 	int		FastForwardButton;
+	int		Rewind;
+	int		RewindButton;
 	int		HiResMode;
 	int		FrameSkip;
 	int		ShowFrameRate;